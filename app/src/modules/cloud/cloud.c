@@ -16,6 +16,13 @@
 #include <zephyr/net/coap.h>
 #include <app_version.h>
 #include <date_time.h>
+#include <stdarg.h>
+#include <math.h>
+#include <string.h>
+
+#if defined(CONFIG_APP_CLOUD_AGNSS_CACHE_PERSIST)
+#include <zephyr/settings/settings.h>
+#endif /* CONFIG_APP_CLOUD_AGNSS_CACHE_PERSIST */
 
 #if defined(CONFIG_MEMFAULT)
 #include <memfault/ports/zephyr/http.h>
@@ -36,6 +43,10 @@
 #include "environmental.h"
 #endif /* CONFIG_APP_ENVIRONMENTAL */
 
+#if defined(CONFIG_APP_CLOUD_AGNSS_CACHE)
+#include "cloud_agnss_cache.h"
+#endif /* CONFIG_APP_CLOUD_AGNSS_CACHE */
+
 /* Register log module */
 LOG_MODULE_REGISTER(cloud, CONFIG_APP_CLOUD_LOG_LEVEL);
 
@@ -44,6 +55,11 @@ LOG_MODULE_REGISTER(cloud, CONFIG_APP_CLOUD_LOG_LEVEL);
 
 #define AGNSS_MAX_DATA_SIZE 3800
 
+#if defined(CONFIG_APP_CLOUD_AGNSS_CACHE)
+/* Bump the version when struct agnss_cache_entry changes, older entries are then not loaded */
+#define AGNSS_SETTINGS_SUBTREE "cloud_agnss_v1"
+#endif /* CONFIG_APP_CLOUD_AGNSS_CACHE */
+
 BUILD_ASSERT(CONFIG_APP_CLOUD_WATCHDOG_TIMEOUT_SECONDS >
 	     CONFIG_APP_CLOUD_MSG_PROCESSING_TIMEOUT_SECONDS,
 	     "Watchdog timeout must be greater than maximum message processing time");
@@ -87,6 +103,8 @@ ZBUS_CHAN_DEFINE(CLOUD_CHAN,
 enum priv_cloud_msg {
 	CLOUD_BACKOFF_EXPIRED,
 	CLOUD_SEND_REQUEST_FAILED,
+	CLOUD_BULK_TIMEOUT,
+	CLOUD_REQUEST_DONE,
 };
 
 /* Create private cloud channel for internal messaging that is not intended for external use.
@@ -106,6 +124,191 @@ ZBUS_CHAN_DEFINE(PRIV_CLOUD_CHAN,
 static void backoff_timer_work_fn(struct k_work *work);
 static K_WORK_DELAYABLE_DEFINE(backoff_timer_work, backoff_timer_work_fn);
 
+/* Sample responses of a sampling cycle */
+enum sample_source {
+	SAMPLE_SOURCE_NETWORK,
+	SAMPLE_SOURCE_POWER,
+	SAMPLE_SOURCE_ENVIRONMENTAL,
+};
+
+#if defined(CONFIG_APP_CLOUD_BULK)
+/* Sampling cycle timeout is run as a delayable work on the system workqueue */
+static void bulk_timer_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(bulk_timer_work, bulk_timer_work_fn);
+
+/* Sample responses that complete a sampling cycle, the ones requested by the main module */
+#define BULK_SOURCES_EXPECTED									\
+	((IS_ENABLED(CONFIG_APP_REQUEST_NETWORK_QUALITY) ? BIT(SAMPLE_SOURCE_NETWORK) : 0) |	\
+	 (IS_ENABLED(CONFIG_APP_POWER) ? BIT(SAMPLE_SOURCE_POWER) : 0) |			\
+	 (IS_ENABLED(CONFIG_APP_ENVIRONMENTAL) ? BIT(SAMPLE_SOURCE_ENVIRONMENTAL) : 0))
+
+/* nRF Cloud device message of a single sensor value, followed by the value and an optional
+ * timestamp
+ */
+#define BULK_VALUE_TEMPLATE								\
+	"{\"" NRF_CLOUD_JSON_APPID_KEY "\":\"%s\","					\
+	"\"" NRF_CLOUD_JSON_MSG_TYPE_KEY "\":\"" NRF_CLOUD_JSON_MSG_TYPE_VAL_DATA "\","	\
+	"\"" NRF_CLOUD_JSON_DATA_KEY "\":"
+#define BULK_TIMESTAMP_TEMPLATE ",\"" NRF_CLOUD_MSG_TIMESTAMP_KEY "\":%lld"
+
+/* Values are sent with up to three decimals, larger ones than this are not sent */
+#define BULK_VALUE_DECIMALS	3
+#define BULK_VALUE_SCALE	1000
+#define BULK_VALUE_MAX		1e12
+
+/* Sensor value waiting for the bulk message of its sampling cycle */
+struct bulk_value {
+	const char *app_id;
+	double value;
+	int64_t timestamp_ms;
+};
+
+/* Sensor values of the current sampling cycle, only used by the cloud module thread */
+static struct {
+	struct bulk_value values[CONFIG_APP_CLOUD_BULK_MAX_VALUES];
+	size_t count;
+
+	/* Sample responses still missing from the current cycle */
+	uint32_t pending;
+
+	/* Values and CoAP requests of the current cycle, reported when it ends */
+	uint32_t cycle_values;
+	uint32_t cycle_requests;
+} bulk;
+
+/* Encoded bulk message, a JSON array of device messages */
+static char bulk_buf[CONFIG_APP_CLOUD_BULK_BUFFER_SIZE];
+
+#define REQUEST_JSON_SIZE	MAX(CONFIG_APP_CLOUD_PAYLOAD_BUFFER_MAX_SIZE,	\
+				    CONFIG_APP_CLOUD_BULK_BUFFER_SIZE)
+#else
+#define REQUEST_JSON_SIZE	CONFIG_APP_CLOUD_PAYLOAD_BUFFER_MAX_SIZE
+#endif /* CONFIG_APP_CLOUD_BULK */
+
+/* Uptime in milliseconds at the start of the current sampling cycle, 0 before the first one */
+static int64_t cycle_start;
+
+/* Request deadlines in seconds. A queued request that has not been started by its deadline is
+ * completed with -ETIME without being sent, and the earliest deadline is sent first.
+ */
+#if defined(CONFIG_APP_CLOUD_REQUEST_PIPELINE)
+#define REQUEST_DEADLINE_LOCATION	CONFIG_APP_CLOUD_REQUEST_DEADLINE_LOCATION_SECONDS
+#define REQUEST_DEADLINE_DATA		CONFIG_APP_CLOUD_REQUEST_DEADLINE_DATA_SECONDS
+#define REQUEST_DEADLINE_AGNSS		CONFIG_APP_CLOUD_REQUEST_DEADLINE_AGNSS_SECONDS
+#else
+/* Requests are sent right away */
+#define REQUEST_DEADLINE_LOCATION	0
+#define REQUEST_DEADLINE_DATA		0
+#define REQUEST_DEADLINE_AGNSS		0
+#endif /* CONFIG_APP_CLOUD_REQUEST_PIPELINE */
+
+/* CoAP exchange with nRF Cloud. The exchange itself runs on a request worker thread with
+ * CONFIG_APP_CLOUD_REQUEST_PIPELINE, or on the cloud module thread without it. The completion
+ * always runs on the cloud module thread.
+ */
+struct cloud_request {
+	/* nRF Cloud call, used in logs */
+	const char *name;
+
+	/* Blocking exchange that only uses the data of the request, returns 0 on success */
+	int (*run)(struct cloud_request *req);
+
+	/* Completion, the result of the exchange is in err */
+	void (*done)(struct cloud_request *req);
+
+	int err;
+
+	/* Uptime in milliseconds */
+	int64_t submitted;
+	int64_t deadline;
+	int64_t completed;
+
+	/* Start of the sampling cycle of sensor data, 0 for other requests */
+	int64_t cycle_start;
+
+	union {
+		struct {
+			const char *app_id;
+			double value;
+			int64_t timestamp_ms;
+		} sensor;
+
+		/* Device message or bulk message */
+		char json[REQUEST_JSON_SIZE];
+
+		struct {
+			struct cloud_msg msg;
+			bool delta_only;
+
+			/* A shadow has been received and is to be published */
+			bool received;
+		} shadow;
+
+#if defined(CONFIG_APP_LOCATION)
+		struct {
+			struct nrf_cloud_rest_location_request req;
+			struct nrf_cloud_location_result result;
+		} location;
+
+#if defined(CONFIG_NRF_CLOUD_AGNSS)
+		struct {
+			struct nrf_modem_gnss_agnss_data_frame frame;
+
+			/* Size of the data in agnss_buf */
+			size_t size;
+
+#if defined(CONFIG_APP_CLOUD_AGNSS_CACHE)
+			/* UNIX time in milliseconds of the request, 0 if not known */
+			int64_t now;
+
+			/* Kinds of assistance data to download and to take from the cache */
+			uint32_t fetch;
+			uint32_t replay;
+#endif /* CONFIG_APP_CLOUD_AGNSS_CACHE */
+		} agnss;
+#endif /* CONFIG_NRF_CLOUD_AGNSS */
+
+#if defined(CONFIG_LOCATION_METHOD_GNSS)
+		struct nrf_cloud_gnss_data gnss;
+#endif /* CONFIG_LOCATION_METHOD_GNSS */
+#endif /* CONFIG_APP_LOCATION */
+	};
+};
+
+/* Request that runs on the cloud module thread. With the pipeline it is only used for a request
+ * that found all slots in use.
+ */
+static struct cloud_request request_inline;
+
+#if defined(CONFIG_APP_CLOUD_REQUEST_PIPELINE)
+enum request_state {
+	REQUEST_FREE,
+	/* Being filled in by the cloud module thread */
+	REQUEST_ALLOCATED,
+	REQUEST_QUEUED,
+	REQUEST_RUNNING,
+	/* Waiting for its completion on the cloud module thread */
+	REQUEST_DONE,
+};
+
+static struct cloud_request requests[CONFIG_APP_CLOUD_REQUEST_SLOTS];
+static enum request_state request_states[CONFIG_APP_CLOUD_REQUEST_SLOTS];
+static K_MUTEX_DEFINE(request_mutex);
+
+/* Signaled with request_mutex held when a worker is done with a request */
+static K_CONDVAR_DEFINE(request_cond);
+
+/* Given for every queued request, a worker that wakes up takes the earliest deadline */
+static K_SEM_DEFINE(request_sem, 0, K_SEM_MAX_LIMIT);
+
+/* Set while a CLOUD_REQUEST_DONE message is on its way to the cloud module thread */
+static atomic_t request_done_posted;
+
+static K_THREAD_STACK_ARRAY_DEFINE(request_worker_stacks, CONFIG_APP_CLOUD_REQUEST_WORKERS,
+				   CONFIG_APP_CLOUD_REQUEST_WORKER_STACK_SIZE);
+static struct k_thread request_workers[CONFIG_APP_CLOUD_REQUEST_WORKERS];
+#endif /* CONFIG_APP_CLOUD_REQUEST_PIPELINE */
+
 /* State machine */
 
 /* Cloud module states */
@@ -299,6 +502,514 @@ static void send_request_failed(void)
 	}
 }
 
+/* Report a failed request. Failed exchanges mean that the connection has to be set up again,
+ * requests that were canceled or missed their deadline have not been sent.
+ */
+static void request_failed(const struct cloud_request *req)
+{
+	if ((req->err == -ECANCELED) || (req->err == -ETIME)) {
+		LOG_WRN("%s not sent, error: %d", req->name, req->err);
+		return;
+	}
+
+	LOG_ERR("%s, error: %d", req->name, req->err);
+
+	send_request_failed();
+}
+
+/* Completion of requests without results */
+static void request_done(struct cloud_request *req)
+{
+	if (req->err) {
+		request_failed(req);
+	}
+}
+
+static void request_finish(struct cloud_request *req)
+{
+	LOG_DBG("%s completed after %u ms, error: %d", req->name,
+		(uint32_t)(req->completed - req->submitted), req->err);
+
+	/* Comparable with and without the pipeline */
+	if ((req->cycle_start != 0) && (req->err == 0)) {
+		LOG_INF("Sensor data reached nRF Cloud %u ms after the start of the sampling cycle",
+			(uint32_t)(req->completed - req->cycle_start));
+	}
+
+	req->done(req);
+}
+
+/* Get a request to fill in, a free slot of the pipeline or the request that runs on the cloud
+ * module thread
+ */
+static struct cloud_request *request_alloc(void)
+{
+	struct cloud_request *req = &request_inline;
+
+#if defined(CONFIG_APP_CLOUD_REQUEST_PIPELINE)
+	k_mutex_lock(&request_mutex, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(requests); i++) {
+		if (request_states[i] == REQUEST_FREE) {
+			request_states[i] = REQUEST_ALLOCATED;
+			req = &requests[i];
+			break;
+		}
+	}
+
+	k_mutex_unlock(&request_mutex);
+
+	if (req == &request_inline) {
+		LOG_WRN("All request slots in use, sending from the cloud module thread");
+	}
+#endif /* CONFIG_APP_CLOUD_REQUEST_PIPELINE */
+
+	memset(req, 0, sizeof(*req));
+
+	return req;
+}
+
+#if defined(CONFIG_APP_CLOUD_REQUEST_PIPELINE)
+static void request_idle_wait(void);
+#endif /* CONFIG_APP_CLOUD_REQUEST_PIPELINE */
+
+/* Queue a request, or send it right away without the pipeline or when all slots are in use */
+static void request_submit(struct cloud_request *req, uint32_t deadline_seconds)
+{
+	req->submitted = k_uptime_get();
+	req->deadline = req->submitted + (int64_t)deadline_seconds * MSEC_PER_SEC;
+
+#if defined(CONFIG_APP_CLOUD_REQUEST_PIPELINE)
+	if (req != &request_inline) {
+		k_mutex_lock(&request_mutex, K_FOREVER);
+		request_states[req - requests] = REQUEST_QUEUED;
+		k_mutex_unlock(&request_mutex);
+
+		k_sem_give(&request_sem);
+
+		return;
+	}
+
+	/* The nRF Cloud CoAP client is only called from one thread at a time. Rather than
+	 * dropping the request, wait for the workers to finish what they have and send it from
+	 * here, as without the pipeline.
+	 */
+	request_idle_wait();
+#endif /* CONFIG_APP_CLOUD_REQUEST_PIPELINE */
+
+	req->err = req->run(req);
+
+	req->completed = k_uptime_get();
+
+	request_finish(req);
+}
+
+#if defined(CONFIG_APP_CLOUD_REQUEST_PIPELINE)
+static void request_done_post(void)
+{
+	int err;
+	enum priv_cloud_msg msg = CLOUD_REQUEST_DONE;
+
+	/* One message completes all requests that are done by the time it is handled */
+	if (atomic_set(&request_done_posted, 1)) {
+		return;
+	}
+
+	err = zbus_chan_pub(&PRIV_CLOUD_CHAN, &msg, K_SECONDS(1));
+	if (err) {
+		LOG_ERR("zbus_chan_pub, error: %d", err);
+		SEND_FATAL_ERROR();
+	}
+}
+
+/* Take the queued request with the earliest deadline */
+static struct cloud_request *request_next(void)
+{
+	int next = -1;
+
+	k_mutex_lock(&request_mutex, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(requests); i++) {
+		if ((request_states[i] == REQUEST_QUEUED) &&
+		    ((next < 0) || (requests[i].deadline < requests[next].deadline))) {
+			next = i;
+		}
+	}
+
+	if (next >= 0) {
+		request_states[next] = REQUEST_RUNNING;
+	}
+
+	k_mutex_unlock(&request_mutex);
+
+	return (next >= 0) ? &requests[next] : NULL;
+}
+
+static void request_worker(void *p1, void *p2, void *p3)
+{
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	while (true) {
+		struct cloud_request *req;
+
+		(void)k_sem_take(&request_sem, K_FOREVER);
+
+		req = request_next();
+		if (req == NULL) {
+			/* Canceled before a worker got to it */
+			continue;
+		}
+
+		if (k_uptime_get() > req->deadline) {
+			req->err = -ETIME;
+		} else {
+			req->err = req->run(req);
+		}
+
+		req->completed = k_uptime_get();
+
+		k_mutex_lock(&request_mutex, K_FOREVER);
+		request_states[req - requests] = REQUEST_DONE;
+		k_condvar_broadcast(&request_cond);
+		k_mutex_unlock(&request_mutex);
+
+		request_done_post();
+	}
+}
+
+static void request_workers_start(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(request_workers); i++) {
+		k_tid_t tid = k_thread_create(&request_workers[i], request_worker_stacks[i],
+					      K_THREAD_STACK_SIZEOF(request_worker_stacks[i]),
+					      request_worker, NULL, NULL, NULL,
+					      K_LOWEST_APPLICATION_THREAD_PRIO, 0, K_NO_WAIT);
+
+		k_thread_name_set(tid, "cloud_request");
+	}
+}
+
+/* Run the completions of the requests that the workers are done with */
+static void request_complete(void)
+{
+	atomic_clear(&request_done_posted);
+
+	for (size_t i = 0; i < ARRAY_SIZE(requests); i++) {
+		bool done;
+
+		k_mutex_lock(&request_mutex, K_FOREVER);
+		done = (request_states[i] == REQUEST_DONE);
+		k_mutex_unlock(&request_mutex);
+
+		if (!done) {
+			continue;
+		}
+
+		request_finish(&requests[i]);
+
+		k_mutex_lock(&request_mutex, K_FOREVER);
+		request_states[i] = REQUEST_FREE;
+		k_mutex_unlock(&request_mutex);
+	}
+}
+
+static bool request_running(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(requests); i++) {
+		if (request_states[i] == REQUEST_RUNNING) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool request_queued(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(requests); i++) {
+		if (request_states[i] == REQUEST_QUEUED) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Wait until the workers have sent all queued requests. Only the cloud module thread queues
+ * requests, so the workers stay idle until it returns.
+ */
+static void request_idle_wait(void)
+{
+	k_mutex_lock(&request_mutex, K_FOREVER);
+
+	while (request_queued() || request_running()) {
+		(void)k_condvar_wait(&request_cond, &request_mutex, K_FOREVER);
+	}
+
+	k_mutex_unlock(&request_mutex);
+}
+
+/* Complete the queued requests with -ECANCELED and wait for the workers to finish the requests
+ * they have started, so that the connection is not closed underneath them. The cloud module
+ * thread is blocked for no longer than it would be by the same request without the pipeline.
+ */
+static void request_cancel(void)
+{
+	bool canceled = false;
+
+	k_mutex_lock(&request_mutex, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(requests); i++) {
+		if (request_states[i] == REQUEST_QUEUED) {
+			requests[i].err = -ECANCELED;
+			requests[i].completed = k_uptime_get();
+			request_states[i] = REQUEST_DONE;
+			canceled = true;
+		}
+	}
+
+	/* Nothing is queued, so the workers do not start anything new */
+	while (request_running()) {
+		(void)k_condvar_wait(&request_cond, &request_mutex, K_FOREVER);
+	}
+
+	k_mutex_unlock(&request_mutex);
+
+	if (canceled) {
+		request_done_post();
+	}
+}
+#endif /* CONFIG_APP_CLOUD_REQUEST_PIPELINE */
+
+static int json_run(struct cloud_request *req)
+{
+	return nrf_cloud_coap_json_message_send(req->json, false,
+						IS_ENABLED(CONFIG_APP_CLOUD_CONFIRMABLE_MESSAGES));
+}
+
+#if defined(CONFIG_APP_CLOUD_BULK)
+static void bulk_timer_work_fn(struct k_work *work)
+{
+	int err;
+	enum priv_cloud_msg msg = CLOUD_BULK_TIMEOUT;
+
+	ARG_UNUSED(work);
+
+	err = zbus_chan_pub(&PRIV_CLOUD_CHAN, &msg, K_SECONDS(1));
+	if (err) {
+		LOG_ERR("zbus_chan_pub, error: %d", err);
+		SEND_FATAL_ERROR();
+	}
+}
+
+/* Append formatted text to the bulk message, returns -ENOMEM if it does not fit */
+static int bulk_append(size_t *len, const char *fmt, ...)
+{
+	va_list args;
+	int ret;
+
+	va_start(args, fmt);
+	ret = vsnprintk(&bulk_buf[*len], sizeof(bulk_buf) - *len, fmt, args);
+	va_end(args);
+
+	if ((ret < 0) || ((size_t)ret >= (sizeof(bulk_buf) - *len))) {
+		return -ENOMEM;
+	}
+
+	*len += ret;
+
+	return 0;
+}
+
+/* Append a value as a JSON number, formatted without floating point printf support */
+static int bulk_append_number(size_t *len, double value)
+{
+	long long scaled = llround(fabs(value) * BULK_VALUE_SCALE);
+	long long integer = scaled / BULK_VALUE_SCALE;
+	long long fraction = scaled % BULK_VALUE_SCALE;
+	int decimals = BULK_VALUE_DECIMALS;
+	const char *sign = ((value < 0) && (scaled != 0)) ? "-" : "";
+
+	/* Trailing zeros of the fraction are left out */
+	while ((decimals > 0) && (fraction % 10 == 0)) {
+		fraction /= 10;
+		decimals--;
+	}
+
+	if (decimals == 0) {
+		return bulk_append(len, "%s%lld", sign, integer);
+	}
+
+	return bulk_append(len, "%s%lld.%0*lld", sign, integer, decimals, fraction);
+}
+
+static int bulk_encode(void)
+{
+	int err;
+	size_t len = 0;
+
+	err = bulk_append(&len, "[");
+
+	for (size_t i = 0; !err && (i < bulk.count); i++) {
+		const struct bulk_value *value = &bulk.values[i];
+
+		err = bulk_append(&len, "%s" BULK_VALUE_TEMPLATE, (i > 0) ? "," : "",
+				  value->app_id);
+		err = err ? err : bulk_append_number(&len, value->value);
+
+		if (!err && (value->timestamp_ms != NRF_CLOUD_NO_TIMESTAMP)) {
+			err = bulk_append(&len, BULK_TIMESTAMP_TEMPLATE,
+					  (long long)value->timestamp_ms);
+		}
+
+		err = err ? err : bulk_append(&len, "}");
+	}
+
+	return err ? err : bulk_append(&len, "]");
+}
+
+static int bulk_run(struct cloud_request *req)
+{
+	return nrf_cloud_coap_json_message_send(req->json, true,
+						IS_ENABLED(CONFIG_APP_CLOUD_CONFIRMABLE_MESSAGES));
+}
+
+/* Send the collected values as one nRF Cloud bulk message */
+static void bulk_flush(void)
+{
+	int err;
+	struct cloud_request *req;
+	size_t count = bulk.count;
+
+	if (count == 0) {
+		return;
+	}
+
+	err = bulk_encode();
+
+	bulk.count = 0;
+
+	if (err) {
+		LOG_ERR("bulk_encode, error: %d, %zu values dropped", err, count);
+		return;
+	}
+
+	req = request_alloc();
+	req->name = "nrf_cloud_coap_json_message_send";
+	req->run = bulk_run;
+	req->done = request_done;
+	req->cycle_start = cycle_start;
+
+	memcpy(req->json, bulk_buf, sizeof(bulk_buf));
+
+	bulk.cycle_values += count;
+	bulk.cycle_requests++;
+
+	request_submit(req, REQUEST_DEADLINE_DATA);
+}
+
+/* Send what is left of the current sampling cycle and report its request count */
+static void bulk_cycle_end(void)
+{
+	(void)k_work_cancel_delayable(&bulk_timer_work);
+
+	bulk.pending = 0;
+
+	bulk_flush();
+
+	if (bulk.cycle_values > 0) {
+		LOG_INF("Sampling cycle sent %u sensor values in %u CoAP request(s), "
+			"%u without bulk", bulk.cycle_values, bulk.cycle_requests,
+			bulk.cycle_values);
+	}
+
+	bulk.cycle_values = 0;
+	bulk.cycle_requests = 0;
+}
+
+/* Start collecting the sample responses of a new sampling cycle */
+static void bulk_cycle_start(void)
+{
+	/* An unfinished cycle is not held back any longer */
+	bulk_cycle_end();
+
+	bulk.pending = BULK_SOURCES_EXPECTED;
+
+	if (bulk.pending != 0) {
+		(void)k_work_reschedule(&bulk_timer_work,
+					K_SECONDS(CONFIG_APP_CLOUD_BULK_TIMEOUT_SECONDS));
+	}
+}
+
+/* A sample response has been handled, the cycle ends once all have arrived. Responses outside
+ * of a cycle are sent right away.
+ */
+static void bulk_source_done(enum sample_source source)
+{
+	bulk.pending &= ~BIT(source);
+
+	if (bulk.pending != 0) {
+		return;
+	}
+
+	bulk_cycle_end();
+}
+#else
+static int sensor_run(struct cloud_request *req)
+{
+	return nrf_cloud_coap_sensor_send(req->sensor.app_id, req->sensor.value,
+					  req->sensor.timestamp_ms,
+					  IS_ENABLED(CONFIG_APP_CLOUD_CONFIRMABLE_MESSAGES));
+}
+#endif /* CONFIG_APP_CLOUD_BULK */
+
+/* Send a sensor value to nRF Cloud. With CONFIG_APP_CLOUD_BULK it is added to the bulk message
+ * of the current sampling cycle instead, which is sent once the cycle is complete.
+ */
+static void sensor_value_send(const char *app_id, double value, int64_t timestamp_ms)
+{
+#if defined(CONFIG_APP_CLOUD_BULK)
+	if (!isfinite(value) || (fabs(value) >= BULK_VALUE_MAX)) {
+		LOG_WRN("Invalid %s value, ignored", app_id);
+		return;
+	}
+
+	if (bulk.count == ARRAY_SIZE(bulk.values)) {
+		bulk_flush();
+	}
+
+	bulk.values[bulk.count++] = (struct bulk_value) {
+		.app_id = app_id,
+		.value = value,
+		.timestamp_ms = timestamp_ms,
+	};
+#else
+	struct cloud_request *req = request_alloc();
+
+	req->name = "nrf_cloud_coap_sensor_send";
+	req->run = sensor_run;
+	req->done = request_done;
+	req->cycle_start = cycle_start;
+	req->sensor.app_id = app_id;
+	req->sensor.value = value;
+	req->sensor.timestamp_ms = timestamp_ms;
+
+	request_submit(req, REQUEST_DEADLINE_DATA);
+#endif /* CONFIG_APP_CLOUD_BULK */
+}
+
+/* Mark the sample response of a sampling cycle as handled */
+static void sample_response_done(enum sample_source source)
+{
+#if defined(CONFIG_APP_CLOUD_BULK)
+	bulk_source_done(source);
+#else
+	ARG_UNUSED(source);
+#endif /* CONFIG_APP_CLOUD_BULK */
+}
+
 /* State handlers */
 
 static void state_running_entry(void *obj)
@@ -322,6 +1033,19 @@ static void state_running_run(void *obj)
 {
 	struct cloud_state_object const *state_object = obj;
 
+#if defined(CONFIG_APP_CLOUD_REQUEST_PIPELINE)
+	/* Requests complete in any state */
+	if (state_object->chan == &PRIV_CLOUD_CHAN) {
+		const enum priv_cloud_msg msg = *(const enum priv_cloud_msg *)state_object->msg_buf;
+
+		if (msg == CLOUD_REQUEST_DONE) {
+			request_complete();
+
+			return;
+		}
+	}
+#endif /* CONFIG_APP_CLOUD_REQUEST_PIPELINE */
+
 	if (state_object->chan == &NETWORK_CHAN) {
 		struct network_msg msg = MSG_TO_NETWORK_MSG(state_object->msg_buf);
 
@@ -455,6 +1179,10 @@ static void state_connected_exit(void *obj)
 
 	LOG_DBG("%s", __func__);
 
+#if defined(CONFIG_APP_CLOUD_REQUEST_PIPELINE)
+	request_cancel();
+#endif /* CONFIG_APP_CLOUD_REQUEST_PIPELINE */
+
 	err = nrf_cloud_coap_disconnect();
 	if (err && (err != -ENOTCONN && err != -EPERM)) {
 		LOG_ERR("nrf_cloud_coap_disconnect, error: %d", err);
@@ -463,23 +1191,60 @@ static void state_connected_exit(void *obj)
 }
 
 #if defined(CONFIG_APP_LOCATION)
+static int location_run(struct cloud_request *req)
+{
+	return nrf_cloud_coap_location_get(&req->location.req, &req->location.result);
+}
+
+static void location_done(struct cloud_request *req)
+{
+	struct location_data location = { 0 };
+	const struct nrf_cloud_location_result *result = &req->location.result;
+
+	if (req->err == COAP_RESPONSE_CODE_NOT_FOUND) {
+		LOG_WRN("nRF Cloud CoAP location coordinates not found, error: %d", req->err);
+		location_cloud_location_ext_result_set(LOCATION_EXT_RESULT_ERROR, NULL);
+
+		return;
+	} else if (req->err) {
+		location_cloud_location_ext_result_set(LOCATION_EXT_RESULT_ERROR, NULL);
+
+		request_failed(req);
+		return;
+	}
+
+	LOG_INF("Location result: lat: %f, lon: %f, accuracy: %f",
+		result->lat, result->lon, (double)result->unc);
+
+	/* Convert result to location_data format */
+	location.latitude = result->lat;
+	location.longitude = result->lon;
+	location.accuracy = (double)result->unc;
+
+	/* Send successful result back to location library */
+	location_cloud_location_ext_result_set(LOCATION_EXT_RESULT_SUCCESS, &location);
+}
+
 /* Handle cloud location requests from the location module */
 static void handle_cloud_location_request(const struct location_data_cloud *request)
 {
-	int err;
-	struct location_data location = { 0 };
-	struct nrf_cloud_rest_location_request loc_req = { 0 };
-	struct nrf_cloud_location_result result = { 0 };
+	struct cloud_request *req = request_alloc();
 
 	LOG_DBG("Handling cloud location request");
 
+	req->name = "nrf_cloud_coap_location_get";
+	req->run = location_run;
+	req->done = location_done;
+
+	/* The cell and Wi-Fi data stay valid until the result has been set */
 #if defined(CONFIG_LOCATION_METHOD_CELLULAR)
 	if (request->cell_data != NULL) {
 		/* NOSONAR: Cast away const qualifier is required due to API design mismatch
 		 * between location library (const pointers) and nRF Cloud API (non-const pointers).
 		 * The underlying nrf_cloud_coap_location_get function only reads the data.
 		 */
-		loc_req.cell_info = (struct lte_lc_cells_info *)request->cell_data; /* NOSONAR */
+		req->location.req.cell_info =
+			(struct lte_lc_cells_info *)request->cell_data; /* NOSONAR */
 
 		LOG_DBG("Cellular data present: current cell ID: %d, neighbor cells: %d",
 			request->cell_data->current_cell.id,
@@ -493,73 +1258,95 @@ static void handle_cloud_location_request(const struct location_data_cloud *requ
 		 * between location library (const pointers) and nRF Cloud API (non-const pointers).
 		 * The underlying nrf_cloud_coap_location_get function only reads the data.
 		 */
-		loc_req.wifi_info = (struct wifi_scan_info *)request->wifi_data; /* NOSONAR */
+		req->location.req.wifi_info =
+			(struct wifi_scan_info *)request->wifi_data; /* NOSONAR */
 
 		LOG_DBG("Wi-Fi data present: %d APs", request->wifi_data->cnt);
 	}
 #endif
 
 	/* Send location request to nRF Cloud */
-	err = nrf_cloud_coap_location_get(&loc_req, &result);
-	if (err == COAP_RESPONSE_CODE_NOT_FOUND) {
-		LOG_WRN("nRF Cloud CoAP location coordinates not found, error: %d", err);
-		location_cloud_location_ext_result_set(LOCATION_EXT_RESULT_ERROR, NULL);
-
-		return;
-	} else if (err) {
-		LOG_ERR("nrf_cloud_coap_location_get, error: %d", err);
-		location_cloud_location_ext_result_set(LOCATION_EXT_RESULT_ERROR, NULL);
+	request_submit(req, REQUEST_DEADLINE_LOCATION);
+}
 
-		send_request_failed();
-		return;
+#if defined(CONFIG_NRF_CLOUD_AGNSS)
+#if defined(CONFIG_APP_CLOUD_AGNSS_CACHE)
+/* Assistance data that is not cached: system time, TOWs, position and integrity. Holds the
+ * whole request when the cache cannot be used.
+ */
+static char agnss_buf[AGNSS_MAX_DATA_SIZE];
+
+static uint8_t agnss_ephemerides[sizeof(struct agnss_cache_entry) +
+				 CONFIG_APP_CLOUD_AGNSS_CACHE_EPHEMERIDES_SIZE] __aligned(8);
+static uint8_t agnss_almanacs[sizeof(struct agnss_cache_entry) +
+			      CONFIG_APP_CLOUD_AGNSS_CACHE_ALMANACS_SIZE] __aligned(8);
+static uint8_t agnss_models[sizeof(struct agnss_cache_entry) +
+			    CONFIG_APP_CLOUD_AGNSS_CACHE_MODELS_SIZE] __aligned(8);
+
+#define AGNSS_CACHE_SLOT(_buf, _name, _lifetime_ms)					\
+	{										\
+		.entry = (struct agnss_cache_entry *)_buf,				\
+		.capacity = sizeof(_buf) - sizeof(struct agnss_cache_entry),		\
+		.name = _name,								\
+		.lifetime_ms = (_lifetime_ms),						\
 	}
 
-	LOG_INF("Location result: lat: %f, lon: %f, accuracy: %f",
-		result.lat, result.lon, (double)result.unc);
-
-	/* Convert result to location_data format */
-	location.latitude = result.lat;
-	location.longitude = result.lon;
-	location.accuracy = (double)result.unc;
+/* Cache entry of each kind of assistance data, written by A-GNSS requests and read when they
+ * complete
+ */
+static const struct {
+	struct agnss_cache_entry *entry;
+	size_t capacity;
+	const char *name;
+	int64_t lifetime_ms;
+} agnss_cache[AGNSS_CACHE_KIND_COUNT] = {
+	[AGNSS_CACHE_EPHEMERIDES] = AGNSS_CACHE_SLOT(agnss_ephemerides, "ephemerides",
+		(int64_t)CONFIG_APP_CLOUD_AGNSS_CACHE_EPHEMERIDES_MINUTES * SEC_PER_MIN *
+		MSEC_PER_SEC),
+	[AGNSS_CACHE_ALMANACS] = AGNSS_CACHE_SLOT(agnss_almanacs, "almanacs",
+		(int64_t)CONFIG_APP_CLOUD_AGNSS_CACHE_ALMANACS_DAYS * SEC_PER_DAY * MSEC_PER_SEC),
+	[AGNSS_CACHE_MODELS] = AGNSS_CACHE_SLOT(agnss_models, "models",
+		(int64_t)CONFIG_APP_CLOUD_AGNSS_CACHE_MODELS_HOURS * SEC_PER_HOUR * MSEC_PER_SEC),
+};
+#else
+static char agnss_buf[AGNSS_MAX_DATA_SIZE];
+#endif /* CONFIG_APP_CLOUD_AGNSS_CACHE */
 
-	/* Send successful result back to location library */
-	location_cloud_location_ext_result_set(LOCATION_EXT_RESULT_SUCCESS, &location);
-}
+/* An A-GNSS request owns agnss_buf and the cache entries until it has completed */
+static bool agnss_busy;
 
-#if defined(CONFIG_NRF_CLOUD_AGNSS)
-/* Handle A-GNSS data requests from the location module */
-static void handle_agnss_request(const struct nrf_modem_gnss_agnss_data_frame *request)
+static int agnss_download(struct nrf_modem_gnss_agnss_data_frame *request, char *buf,
+			  size_t buf_sz, size_t *size)
 {
 	int err;
-	static char agnss_buf[AGNSS_MAX_DATA_SIZE];
 	struct nrf_cloud_rest_agnss_request agnss_req = {
 		.type = NRF_CLOUD_REST_AGNSS_REQ_CUSTOM,
-		.agnss_req = (struct nrf_modem_gnss_agnss_data_frame *)request,
+		.agnss_req = request,
 		.net_info = NULL,
 		.filtered = false,
 		.mask_angle = 0
 	};
 	struct nrf_cloud_rest_agnss_result result = {
-		.buf = agnss_buf,
-		.buf_sz = sizeof(agnss_buf),
+		.buf = buf,
+		.buf_sz = buf_sz,
 		.agnss_sz = 0
 	};
 
-	LOG_DBG("Handling A-GNSS data request");
-
-	/* Send A-GNSS request to nRF Cloud */
 	err = nrf_cloud_coap_agnss_data_get(&agnss_req, &result);
-	if (err) {
-		LOG_ERR("nrf_cloud_coap_agnss_data_get, error: %d", err);
 
-		send_request_failed();
-		return;
-	}
+	*size = result.agnss_sz;
+
+	return err;
+}
+
+static void agnss_process(const char *buf, size_t size)
+{
+	int err;
 
-	LOG_DBG("A-GNSS data received, size: %d bytes", result.agnss_sz);
+	LOG_DBG("A-GNSS data received, size: %zu bytes", size);
 
 	/* Process the A-GNSS data */
-	err = location_agnss_data_process(result.buf, result.agnss_sz);
+	err = location_agnss_data_process(buf, size);
 	if (err) {
 		LOG_ERR("Failed to process A-GNSS data, error: %d", err);
 		return;
@@ -567,15 +1354,304 @@ static void handle_agnss_request(const struct nrf_modem_gnss_agnss_data_frame *r
 
 	LOG_DBG("A-GNSS data processed successfully");
 }
+
+#if defined(CONFIG_APP_CLOUD_AGNSS_CACHE)
+#if defined(CONFIG_APP_CLOUD_AGNSS_CACHE_PERSIST)
+static int agnss_settings_set(const char *key, size_t len, settings_read_cb read_cb,
+			      void *cb_arg)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(agnss_cache); i++) {
+		struct agnss_cache_entry *entry = agnss_cache[i].entry;
+		int ret;
+
+		if (strcmp(key, agnss_cache[i].name) != 0) {
+			continue;
+		}
+
+		if ((len < sizeof(*entry)) || (len > sizeof(*entry) + agnss_cache[i].capacity)) {
+			return -EINVAL;
+		}
+
+		ret = read_cb(cb_arg, entry, len);
+		if (ret < 0) {
+			entry->fetched = 0;
+			return ret;
+		}
+
+		if (len != sizeof(*entry) + entry->size) {
+			entry->fetched = 0;
+			return -EINVAL;
+		}
+
+		return 0;
+	}
+
+	return -ENOENT;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(cloud_agnss, AGNSS_SETTINGS_SUBTREE, NULL,
+			       agnss_settings_set, NULL, NULL);
+
+/* Store the entries that have been downloaded, they are used again after a reset */
+static void agnss_cache_save(uint32_t kinds)
+{
+	char key[32];
+
+	for (size_t i = 0; i < ARRAY_SIZE(agnss_cache); i++) {
+		const struct agnss_cache_entry *entry = agnss_cache[i].entry;
+		int ret;
+
+		if (!(kinds & BIT(i)) || (entry->fetched == 0)) {
+			continue;
+		}
+
+		(void)snprintk(key, sizeof(key), AGNSS_SETTINGS_SUBTREE "/%s", agnss_cache[i].name);
+
+		ret = settings_save_one(key, entry, sizeof(*entry) + entry->size);
+		if (ret) {
+			LOG_WRN("Failed to store A-GNSS %s: %d", agnss_cache[i].name, ret);
+		}
+	}
+}
+
+static void agnss_cache_load(void)
+{
+	int ret = settings_subsys_init();
+
+	if (ret) {
+		LOG_WRN("Failed to initialize settings: %d", ret);
+		return;
+	}
+
+	ret = settings_load_subtree(AGNSS_SETTINGS_SUBTREE);
+	if (ret) {
+		LOG_WRN("Failed to load stored A-GNSS data: %d", ret);
+	}
+}
+#endif /* CONFIG_APP_CLOUD_AGNSS_CACHE_PERSIST */
+
+/* Decide for each kind of assistance data in a request if it is taken from the cache or
+ * downloaded. The data that is not cached is always downloaded.
+ */
+static void agnss_cache_plan(const struct nrf_modem_gnss_agnss_data_frame *request, int64_t now,
+			     uint32_t *fetch, uint32_t *replay)
+{
+	struct nrf_modem_gnss_agnss_data_frame part;
+
+	*fetch = 0;
+	*replay = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(agnss_cache); i++) {
+		agnss_cache_part(request, i, &part);
+
+		if (agnss_cache_part_empty(&part)) {
+			continue;
+		}
+
+		/* Expiry is not known without the current time */
+		if ((now != 0) && agnss_cache_covers(agnss_cache[i].entry, &part, now,
+						     agnss_cache[i].lifetime_ms)) {
+			*replay |= BIT(i);
+		} else {
+			*fetch |= BIT(i);
+		}
+	}
+
+	agnss_cache_part(request, AGNSS_CACHE_LIVE, &part);
+
+	if (!agnss_cache_part_empty(&part)) {
+		*fetch |= BIT(AGNSS_CACHE_LIVE);
+	}
+}
+
+/* Hand the downloaded and cached assistance data to the location library. The data that is not
+ * cached goes first, it has the system time.
+ */
+static void agnss_cache_inject(uint32_t fetch, uint32_t replay, size_t live_size)
+{
+	size_t downloaded = 0;
+	size_t cached = 0;
+
+	if (fetch & BIT(AGNSS_CACHE_LIVE)) {
+		agnss_process(agnss_buf, live_size);
+		downloaded += live_size;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(agnss_cache); i++) {
+		const struct agnss_cache_entry *entry = agnss_cache[i].entry;
+
+		if (!((fetch | replay) & BIT(i))) {
+			continue;
+		}
+
+		agnss_process((const char *)entry->data, entry->size);
+
+		if (fetch & BIT(i)) {
+			downloaded += entry->size;
+		} else {
+			cached += entry->size;
+		}
+	}
+
+	LOG_INF("A-GNSS data: %zu bytes downloaded, %zu bytes from the cache", downloaded, cached);
+}
+#endif /* CONFIG_APP_CLOUD_AGNSS_CACHE */
+
+static int agnss_run(struct cloud_request *req)
+{
+#if defined(CONFIG_APP_CLOUD_AGNSS_CACHE)
+	int err;
+	struct nrf_modem_gnss_agnss_data_frame part;
+
+	/* Without the current time nothing is cached, so the request is not split */
+	if (req->agnss.now == 0) {
+		return agnss_download(&req->agnss.frame, agnss_buf, sizeof(agnss_buf),
+				      &req->agnss.size);
+	}
+
+	/* One download for each kind, so that each can be cached on its own */
+	for (size_t i = 0; i <= AGNSS_CACHE_LIVE; i++) {
+		struct agnss_cache_entry *entry;
+		size_t size = 0;
+
+		if (!(req->agnss.fetch & BIT(i))) {
+			continue;
+		}
+
+		agnss_cache_part(&req->agnss.frame, i, &part);
+
+		if (i == AGNSS_CACHE_LIVE) {
+			err = agnss_download(&part, agnss_buf, sizeof(agnss_buf), &req->agnss.size);
+			if (err) {
+				return err;
+			}
+
+			continue;
+		}
+
+		/* The entry is not valid until the download has completed */
+		entry = agnss_cache[i].entry;
+		entry->fetched = 0;
+		entry->size = 0;
+
+		err = agnss_download(&part, (char *)entry->data, agnss_cache[i].capacity, &size);
+		if (err) {
+			return err;
+		}
+
+		entry->coverage = part;
+		entry->size = size;
+		entry->fetched = req->agnss.now;
+	}
+
+	return 0;
+#else
+	return agnss_download(&req->agnss.frame, agnss_buf, sizeof(agnss_buf), &req->agnss.size);
+#endif /* CONFIG_APP_CLOUD_AGNSS_CACHE */
+}
+
+static void agnss_done(struct cloud_request *req)
+{
+	agnss_busy = false;
+
+	if (req->err) {
+		request_failed(req);
+		return;
+	}
+
+#if defined(CONFIG_APP_CLOUD_AGNSS_CACHE)
+	if (req->agnss.now == 0) {
+		agnss_process(agnss_buf, req->agnss.size);
+		return;
+	}
+
+	agnss_cache_inject(req->agnss.fetch, req->agnss.replay, req->agnss.size);
+
+#if defined(CONFIG_APP_CLOUD_AGNSS_CACHE_PERSIST)
+	agnss_cache_save(req->agnss.fetch);
+#endif /* CONFIG_APP_CLOUD_AGNSS_CACHE_PERSIST */
+#else
+	agnss_process(agnss_buf, req->agnss.size);
+#endif /* CONFIG_APP_CLOUD_AGNSS_CACHE */
+}
+
+/* Handle A-GNSS data requests from the location module */
+static void handle_agnss_request(const struct nrf_modem_gnss_agnss_data_frame *request)
+{
+	struct cloud_request *req;
+#if defined(CONFIG_APP_CLOUD_AGNSS_CACHE)
+	int err;
+	int64_t now;
+	uint32_t fetch;
+	uint32_t replay;
+#endif /* CONFIG_APP_CLOUD_AGNSS_CACHE */
+
+	LOG_DBG("Handling A-GNSS data request");
+
+	if (agnss_busy) {
+		LOG_WRN("A-GNSS data request already in progress, ignored");
+		return;
+	}
+
+#if defined(CONFIG_APP_CLOUD_AGNSS_CACHE)
+	err = date_time_now(&now);
+	if (err) {
+		LOG_DBG("Current time not known, A-GNSS cache not used");
+
+		now = 0;
+	}
+
+	agnss_cache_plan(request, now, &fetch, &replay);
+
+	if (fetch == 0) {
+		/* Nothing to download */
+		agnss_cache_inject(fetch, replay, 0);
+		return;
+	}
+#endif /* CONFIG_APP_CLOUD_AGNSS_CACHE */
+
+	req = request_alloc();
+	req->name = "nrf_cloud_coap_agnss_data_get";
+	req->run = agnss_run;
+	req->done = agnss_done;
+	req->agnss.frame = *request;
+
+#if defined(CONFIG_APP_CLOUD_AGNSS_CACHE)
+	req->agnss.now = now;
+	req->agnss.fetch = fetch;
+	req->agnss.replay = replay;
+#endif /* CONFIG_APP_CLOUD_AGNSS_CACHE */
+
+	agnss_busy = true;
+
+	/* Send A-GNSS request to nRF Cloud */
+	request_submit(req, REQUEST_DEADLINE_AGNSS);
+}
 #endif /* CONFIG_NRF_CLOUD_AGNSS */
 
 #if defined(CONFIG_LOCATION_METHOD_GNSS)
+static int gnss_run(struct cloud_request *req)
+{
+	return nrf_cloud_coap_location_send(&req->gnss,
+					    IS_ENABLED(CONFIG_APP_CLOUD_CONFIRMABLE_MESSAGES));
+}
+
+static void gnss_done(struct cloud_request *req)
+{
+	if (req->err) {
+		request_failed(req);
+		return;
+	}
+
+	LOG_INF("GNSS location data sent to nRF Cloud successfully");
+}
+
 /* Handle GNSS location data from the location module */
 static void handle_gnss_location_data(const struct location_data *location_data)
 {
 	int err;
 	int64_t timestamp_ms = NRF_CLOUD_NO_TIMESTAMP;
-	bool confirmable = IS_ENABLED(CONFIG_APP_CLOUD_CONFIRMABLE_MESSAGES);
+	struct cloud_request *req;
 	struct nrf_cloud_gnss_data gnss_data = {
 		.type = NRF_CLOUD_GNSS_TYPE_PVT,
 		.ts_ms = timestamp_ms,
@@ -621,75 +1697,90 @@ static void handle_gnss_location_data(const struct location_data *location_data)
 #endif /* CONFIG_LOCATION_DATA_DETAILS */
 
 	/* Send GNSS location data to nRF Cloud */
-	err = nrf_cloud_coap_location_send(&gnss_data, confirmable);
-	if (err) {
-		LOG_ERR("nrf_cloud_coap_location_send, error: %d", err);
-		send_request_failed();
-		return;
-	}
+	req = request_alloc();
+	req->name = "nrf_cloud_coap_location_send";
+	req->run = gnss_run;
+	req->done = gnss_done;
+	req->gnss = gnss_data;
 
-	LOG_INF("GNSS location data sent to nRF Cloud successfully");
+	request_submit(req, REQUEST_DEADLINE_LOCATION);
 }
 #endif /* CONFIG_LOCATION_METHOD_GNSS */
 #endif /* CONFIG_APP_LOCATION */
 
-static void shadow_get(bool delta_only)
+static int shadow_run(struct cloud_request *req)
 {
 	int err;
-	struct cloud_msg msg = {
-		.type = CLOUD_SHADOW_RESPONSE,
-		.response = {
-			.buffer_data_len = sizeof(msg.response.buffer),
-		},
-	};
+	struct cloud_shadow_response *response = &req->shadow.msg.response;
 
-	LOG_DBG("Requesting device shadow from the device");
+	response->buffer_data_len = sizeof(response->buffer);
 
-	err = nrf_cloud_coap_shadow_get(msg.response.buffer,
-					&msg.response.buffer_data_len,
-					delta_only,
+	err = nrf_cloud_coap_shadow_get(response->buffer,
+					&response->buffer_data_len,
+					req->shadow.delta_only,
 					COAP_CONTENT_FORMAT_APP_CBOR);
 	if (err) {
-		LOG_ERR("nrf_cloud_coap_shadow_get, error: %d", err);
-
-		send_request_failed();
-		return;
+		return err;
 	}
 
-	if (msg.response.buffer_data_len == 0) {
+	if (response->buffer_data_len == 0) {
 		LOG_DBG("No shadow delta changes available");
-		return;
+		return 0;
 	}
 
 	/* Workaroud: Sometimes nrf_cloud_coap_shadow_get() returns 0 even though obtaining
 	 * the shadow failed. Ignore the payload if the first 10 bytes are zero.
 	 */
-	if (!memcmp(msg.response.buffer, "\0\0\0\0\0\0\0\0\0\0", 10)) {
+	if (!memcmp(response->buffer, "\0\0\0\0\0\0\0\0\0\0", 10)) {
 		LOG_WRN("Returned buffeør is empty, ignore");
-		return;
+		return 0;
 	}
 
-	err = zbus_chan_pub(&CLOUD_CHAN, &msg, K_SECONDS(1));
-	if (err) {
-		LOG_ERR("zbus_chan_pub, error: %d", err);
-		SEND_FATAL_ERROR();
-		return;
-	}
+	req->shadow.received = true;
 
 	/* Clear the shadow delta by reporting the same data back to the shadow reported state  */
-	err = nrf_cloud_coap_patch("state/reported", NULL,
-				   msg.response.buffer,
-				   msg.response.buffer_data_len,
-				   COAP_CONTENT_FORMAT_APP_CBOR,
-				   true,
-				   NULL,
-				   NULL);
-	if (err) {
-		LOG_ERR("nrf_cloud_coap_patch, error: %d", err);
+	req->name = "nrf_cloud_coap_patch";
+
+	return nrf_cloud_coap_patch("state/reported", NULL,
+				    response->buffer,
+				    response->buffer_data_len,
+				    COAP_CONTENT_FORMAT_APP_CBOR,
+				    true,
+				    NULL,
+				    NULL);
+}
 
-		send_request_failed();
-		return;
+static void shadow_done(struct cloud_request *req)
+{
+	int err;
+
+	if (req->shadow.received) {
+		err = zbus_chan_pub(&CLOUD_CHAN, &req->shadow.msg, K_SECONDS(1));
+		if (err) {
+			LOG_ERR("zbus_chan_pub, error: %d", err);
+			SEND_FATAL_ERROR();
+			return;
+		}
 	}
+
+	if (req->err) {
+		request_failed(req);
+	}
+}
+
+static void shadow_get(bool delta_only)
+{
+	struct cloud_request *req = request_alloc();
+
+	LOG_DBG("Requesting device shadow from the device");
+
+	req->name = "nrf_cloud_coap_shadow_get";
+	req->run = shadow_run;
+	req->done = shadow_done;
+	req->shadow.msg.type = CLOUD_SHADOW_RESPONSE;
+	req->shadow.delta_only = delta_only;
+
+	request_submit(req, REQUEST_DEADLINE_DATA);
 }
 
 static void state_connected_ready_entry(void *obj)
@@ -716,9 +1807,7 @@ static void state_connected_ready_entry(void *obj)
 
 static void state_connected_ready_run(void *obj)
 {
-	int err;
 	struct cloud_state_object const *state_object = obj;
-	bool confirmable = IS_ENABLED(CONFIG_APP_CLOUD_CONFIRMABLE_MESSAGES);
 
 	if (state_object->chan == &PRIV_CLOUD_CHAN) {
 		enum priv_cloud_msg msg = *(const enum priv_cloud_msg *)state_object->msg_buf;
@@ -728,6 +1817,19 @@ static void state_connected_ready_run(void *obj)
 
 			return;
 		}
+
+#if defined(CONFIG_APP_CLOUD_BULK)
+		if (msg == CLOUD_BULK_TIMEOUT) {
+			/* The timeout may have expired just before the cycle completed */
+			if (bulk.pending != 0) {
+				LOG_WRN("Sampling cycle incomplete, sending the values so far");
+			}
+
+			bulk_cycle_end();
+
+			return;
+		}
+#endif /* CONFIG_APP_CLOUD_BULK */
 	}
 
 	if (state_object->chan == &NETWORK_CHAN) {
@@ -743,27 +1845,15 @@ static void state_connected_ready_run(void *obj)
 
 			return;
 		case NETWORK_QUALITY_SAMPLE_RESPONSE:
-			err = nrf_cloud_coap_sensor_send(CUSTOM_JSON_APPID_VAL_CONEVAL,
-							 msg.conn_eval_params.energy_estimate,
-							 NRF_CLOUD_NO_TIMESTAMP,
-							 confirmable);
-			if (err) {
-				LOG_ERR("nrf_cloud_coap_sensor_send, error: %d", err);
-
-				send_request_failed();
-				return;
-			}
+			sensor_value_send(CUSTOM_JSON_APPID_VAL_CONEVAL,
+					  msg.conn_eval_params.energy_estimate,
+					  NRF_CLOUD_NO_TIMESTAMP);
 
-			err = nrf_cloud_coap_sensor_send(NRF_CLOUD_JSON_APPID_VAL_RSRP,
-							 msg.conn_eval_params.rsrp,
-							 NRF_CLOUD_NO_TIMESTAMP,
-							 confirmable);
-			if (err) {
-				LOG_ERR("nrf_cloud_coap_sensor_send, error: %d", err);
+			sensor_value_send(NRF_CLOUD_JSON_APPID_VAL_RSRP,
+					  msg.conn_eval_params.rsrp,
+					  NRF_CLOUD_NO_TIMESTAMP);
 
-				send_request_failed();
-				return;
-			}
+			sample_response_done(SAMPLE_SOURCE_NETWORK);
 
 			break;
 
@@ -777,16 +1867,11 @@ static void state_connected_ready_run(void *obj)
 		struct power_msg msg = MSG_TO_POWER_MSG(state_object->msg_buf);
 
 		if (msg.type == POWER_BATTERY_PERCENTAGE_SAMPLE_RESPONSE) {
-			err = nrf_cloud_coap_sensor_send(CUSTOM_JSON_APPID_VAL_BATTERY,
-							 msg.percentage,
-							 msg.timestamp,
-							 confirmable);
-			if (err) {
-				LOG_ERR("nrf_cloud_coap_sensor_send, error: %d", err);
+			sensor_value_send(CUSTOM_JSON_APPID_VAL_BATTERY,
+					  msg.percentage,
+					  msg.timestamp);
 
-				send_request_failed();
-				return;
-			}
+			sample_response_done(SAMPLE_SOURCE_POWER);
 
 			return;
 		}
@@ -798,38 +1883,19 @@ static void state_connected_ready_run(void *obj)
 		struct environmental_msg msg = MSG_TO_ENVIRONMENTAL_MSG(state_object->msg_buf);
 
 		if (msg.type == ENVIRONMENTAL_SENSOR_SAMPLE_RESPONSE) {
-			err = nrf_cloud_coap_sensor_send(NRF_CLOUD_JSON_APPID_VAL_TEMP,
-							 msg.temperature,
-							 msg.timestamp,
-							 confirmable);
-			if (err) {
-				LOG_ERR("nrf_cloud_coap_sensor_send, error: %d", err);
-
-				send_request_failed();
-				return;
-			}
-
-			err = nrf_cloud_coap_sensor_send(NRF_CLOUD_JSON_APPID_VAL_AIR_PRESS,
-							 msg.pressure,
-							 msg.timestamp,
-							 confirmable);
-			if (err) {
-				LOG_ERR("nrf_cloud_coap_sensor_send, error: %d", err);
+			sensor_value_send(NRF_CLOUD_JSON_APPID_VAL_TEMP,
+					  msg.temperature,
+					  msg.timestamp);
 
-				send_request_failed();
-				return;
-			}
+			sensor_value_send(NRF_CLOUD_JSON_APPID_VAL_AIR_PRESS,
+					  msg.pressure,
+					  msg.timestamp);
 
-			err = nrf_cloud_coap_sensor_send(NRF_CLOUD_JSON_APPID_VAL_HUMID,
-							 msg.humidity,
-							 msg.timestamp,
-							 confirmable);
-			if (err) {
-				LOG_ERR("nrf_cloud_coap_sensor_send, error: %d", err);
+			sensor_value_send(NRF_CLOUD_JSON_APPID_VAL_HUMID,
+					  msg.humidity,
+					  msg.timestamp);
 
-				send_request_failed();
-				return;
-			}
+			sample_response_done(SAMPLE_SOURCE_ENVIRONMENTAL);
 
 			return;
 		}
@@ -874,17 +1940,25 @@ static void state_connected_ready_run(void *obj)
 		const struct cloud_msg *msg = MSG_TO_CLOUD_MSG_PTR(state_object->msg_buf);
 
 		if (msg->type == CLOUD_PAYLOAD_JSON) {
-			err = nrf_cloud_coap_json_message_send(msg->payload.buffer,
-							       false, confirmable);
-			if (err) {
-				LOG_ERR("nrf_cloud_coap_json_message_send, error: %d", err);
+			struct cloud_request *req = request_alloc();
 
-				send_request_failed();
-				return;
-			}
+			req->name = "nrf_cloud_coap_json_message_send";
+			req->run = json_run;
+			req->done = request_done;
+
+			memcpy(req->json, msg->payload.buffer, sizeof(msg->payload.buffer));
+
+			request_submit(req, REQUEST_DEADLINE_DATA);
 		} else if (msg->type == CLOUD_POLL_SHADOW) {
 			LOG_DBG("Poll shadow trigger received");
 
+			cycle_start = k_uptime_get();
+
+#if defined(CONFIG_APP_CLOUD_BULK)
+			/* The main module requests the samples of a cycle right after the poll */
+			bulk_cycle_start();
+#endif /* CONFIG_APP_CLOUD_BULK */
+
 			shadow_get(true);
 		}
 	}
@@ -936,6 +2010,14 @@ static void cloud_module_thread(void)
 
 	LOG_DBG("Cloud module task started");
 
+#if defined(CONFIG_APP_CLOUD_REQUEST_PIPELINE)
+	request_workers_start();
+#endif /* CONFIG_APP_CLOUD_REQUEST_PIPELINE */
+
+#if defined(CONFIG_APP_CLOUD_AGNSS_CACHE_PERSIST)
+	agnss_cache_load();
+#endif /* CONFIG_APP_CLOUD_AGNSS_CACHE_PERSIST */
+
 	task_wdt_id = task_wdt_add(wdt_timeout_ms, cloud_wdt_callback, (void *)k_current_get());
 	if (task_wdt_id < 0) {
 		LOG_ERR("Failed to add task to watchdog: %d", task_wdt_id);
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <string.h>
+
+#include "cloud_agnss_cache.h"
+
+void agnss_cache_part(const struct nrf_modem_gnss_agnss_data_frame *request,
+		      enum agnss_cache_kind kind, struct nrf_modem_gnss_agnss_data_frame *part)
+{
+	memset(part, 0, sizeof(*part));
+
+	switch (kind) {
+	case AGNSS_CACHE_EPHEMERIDES:
+	case AGNSS_CACHE_ALMANACS:
+		part->system_count = MIN(request->system_count, ARRAY_SIZE(part->system));
+
+		for (size_t i = 0; i < part->system_count; i++) {
+			part->system[i].system_id = request->system[i].system_id;
+
+			if (kind == AGNSS_CACHE_EPHEMERIDES) {
+				part->system[i].sv_mask_ephe = request->system[i].sv_mask_ephe;
+			} else {
+				part->system[i].sv_mask_alm = request->system[i].sv_mask_alm;
+			}
+		}
+
+		break;
+	case AGNSS_CACHE_MODELS:
+		part->data_flags = request->data_flags & AGNSS_CACHE_MODEL_FLAGS;
+		break;
+	default:
+		part->data_flags = request->data_flags & ~AGNSS_CACHE_MODEL_FLAGS;
+		break;
+	}
+}
+
+bool agnss_cache_part_empty(const struct nrf_modem_gnss_agnss_data_frame *request)
+{
+	if (request->data_flags != 0) {
+		return false;
+	}
+
+	for (size_t i = 0; i < MIN(request->system_count, ARRAY_SIZE(request->system)); i++) {
+		const struct nrf_modem_gnss_agnss_system_data_need *system = &request->system[i];
+
+		if ((system->sv_mask_ephe != 0) || (system->sv_mask_alm != 0)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* Satellites of a system in the entry, NULL if the entry has none of that system */
+static const struct nrf_modem_gnss_agnss_system_data_need *
+coverage_system(const struct nrf_modem_gnss_agnss_data_frame *coverage, uint8_t system_id)
+{
+	for (size_t i = 0; i < MIN(coverage->system_count, ARRAY_SIZE(coverage->system)); i++) {
+		if (coverage->system[i].system_id == system_id) {
+			return &coverage->system[i];
+		}
+	}
+
+	return NULL;
+}
+
+bool agnss_cache_covers(const struct agnss_cache_entry *entry,
+			const struct nrf_modem_gnss_agnss_data_frame *part,
+			int64_t now, int64_t lifetime_ms)
+{
+	const struct nrf_modem_gnss_agnss_data_frame *coverage = &entry->coverage;
+
+	/* A clock that went backwards does not make old data valid */
+	if ((entry->fetched == 0) || (now < entry->fetched) ||
+	    (now - entry->fetched >= lifetime_ms)) {
+		return false;
+	}
+
+	if ((part->data_flags & ~coverage->data_flags) != 0) {
+		return false;
+	}
+
+	for (size_t i = 0; i < MIN(part->system_count, ARRAY_SIZE(part->system)); i++) {
+		const struct nrf_modem_gnss_agnss_system_data_need *need = &part->system[i];
+		const struct nrf_modem_gnss_agnss_system_data_need *have;
+
+		if ((need->sv_mask_ephe == 0) && (need->sv_mask_alm == 0)) {
+			continue;
+		}
+
+		have = coverage_system(coverage, need->system_id);
+		if ((have == NULL) ||
+		    ((need->sv_mask_ephe & ~have->sv_mask_ephe) != 0) ||
+		    ((need->sv_mask_alm & ~have->sv_mask_alm) != 0)) {
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CLOUD_AGNSS_CACHE_H_
+#define CLOUD_AGNSS_CACHE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <nrf_modem_gnss.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A-GNSS assistance data cache.
+ *
+ * The assistance data that the modem requests is split into kinds. Each kind is downloaded from
+ * nRF Cloud with its own request and cached as received, together with the data that it covers
+ * and the time of the download. Every kind expires on its own: ephemerides after hours,
+ * almanacs after weeks. System time, TOWs, position and integrity data change all the time and
+ * are not cached.
+ *
+ * The cache is not thread safe, callers serialize access.
+ */
+
+/** @brief Kinds of assistance data. */
+enum agnss_cache_kind {
+	/** Ephemerides of the requested satellites. */
+	AGNSS_CACHE_EPHEMERIDES,
+	/** Almanacs of the requested satellites. */
+	AGNSS_CACHE_ALMANACS,
+	/** UTC parameters and ionospheric corrections. */
+	AGNSS_CACHE_MODELS,
+	AGNSS_CACHE_KIND_COUNT,
+	/** Data that is not cached: system time, TOWs, position, integrity and anything else. */
+	AGNSS_CACHE_LIVE = AGNSS_CACHE_KIND_COUNT,
+};
+
+/** @brief Request flags of AGNSS_CACHE_MODELS. */
+#define AGNSS_CACHE_MODEL_FLAGS (NRF_MODEM_GNSS_AGNSS_GPS_UTC_REQUEST |		\
+				 NRF_MODEM_GNSS_AGNSS_KLOBUCHAR_REQUEST |		\
+				 NRF_MODEM_GNSS_AGNSS_NEQUICK_REQUEST)
+
+/** @brief Cached assistance data of one kind. */
+struct agnss_cache_entry {
+	/** UNIX time in milliseconds of the download, 0 if the entry is not valid. */
+	int64_t fetched;
+
+	/** Assistance data in the entry, the request that it was downloaded with. */
+	struct nrf_modem_gnss_agnss_data_frame coverage;
+
+	/** Size of the data. */
+	uint32_t size;
+
+	/** Data in the nRF Cloud A-GNSS format, as received. */
+	uint8_t data[];
+};
+
+/**
+ * @brief Get the part of a request that is of one kind.
+ *
+ * @param[in]  request Request of the modem.
+ * @param[in]  kind    Kind of assistance data, or AGNSS_CACHE_LIVE.
+ * @param[out] part    Request for the data of that kind only.
+ */
+void agnss_cache_part(const struct nrf_modem_gnss_agnss_data_frame *request,
+		      enum agnss_cache_kind kind, struct nrf_modem_gnss_agnss_data_frame *part);
+
+/**
+ * @brief Check if a request asks for nothing.
+ *
+ * @param[in] request Request.
+ *
+ * @returns true if no flags and no satellites are set.
+ */
+bool agnss_cache_part_empty(const struct nrf_modem_gnss_agnss_data_frame *request);
+
+/**
+ * @brief Check if an entry holds all data of a request and has not expired.
+ *
+ * @param[in] entry       Cache entry.
+ * @param[in] part        Request for data of the kind of the entry.
+ * @param[in] now         Current UNIX time in milliseconds.
+ * @param[in] lifetime_ms Time after the download until the data of the entry expires.
+ *
+ * @returns true if the request can be answered from the entry.
+ */
+bool agnss_cache_covers(const struct agnss_cache_entry *entry,
+			const struct nrf_modem_gnss_agnss_data_frame *part,
+			int64_t now, int64_t lifetime_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLOUD_AGNSS_CACHE_H_ */
@@ -8,18 +8,51 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/zbus/zbus.h>
 #include <zephyr/smf.h>
-#include <zephyr/net/mqtt.h>
 #include <zephyr/net/socket.h>
-#include <zephyr/net/hostname.h>
+#include <zephyr/posix/sys/eventfd.h>
 #include <zephyr/data/json.h>
 #include <zephyr/sys/util.h>
+#if defined(CONFIG_APP_CUSTOM_MQTT_JSON_VALIDATE)
 #include <cJSON.h>
+#endif
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET_PERSIST)
+#include <zephyr/settings/settings.h>
+#endif
 #include <date_time.h>
-#include <arpa/inet.h>
+#include <poll.h>
 #include <math.h>
+#include <errno.h>
+#include <string.h>
 
 #include "custom_mqtt.h"
 #include "custom_mqtt_config.h"
+#include "custom_mqtt_codec.h"
+#include "custom_mqtt_cmd.h"
+#include "custom_mqtt_inflight.h"
+#include "custom_mqtt_ring.h"
+#include "custom_mqtt_sub.h"
+#include "custom_mqtt_transport.h"
+#if defined(CONFIG_APP_CUSTOM_MQTT_STORE)
+#include "custom_mqtt_store.h"
+#endif
+#if defined(CONFIG_APP_CUSTOM_MQTT_BATCH)
+#include "custom_mqtt_batch.h"
+#endif
+#if defined(CONFIG_APP_CUSTOM_MQTT_DEADBAND)
+#include "custom_mqtt_deadband.h"
+#endif
+#if defined(CONFIG_APP_CUSTOM_MQTT_PSM_AWARE)
+#include "custom_mqtt_sched.h"
+#endif
+#if defined(CONFIG_APP_CUSTOM_MQTT_ENERGY_ESTIMATE)
+#include "custom_mqtt_energy.h"
+#endif
+#if defined(CONFIG_APP_CUSTOM_MQTT_ON_DEMAND)
+#include "custom_mqtt_session.h"
+#endif
+#if defined(CONFIG_APP_CUSTOM_MQTT_FAILOVER)
+#include "custom_mqtt_broker.h"
+#endif
 #include "app_common.h"
 #include "network.h"
 
@@ -47,77 +80,221 @@
 LOG_MODULE_REGISTER(custom_mqtt, CONFIG_APP_CUSTOM_MQTT_LOG_LEVEL);
 
 /* MQTT client configuration */
-#define MQTT_BROKER_HOSTNAME CONFIG_APP_CUSTOM_MQTT_BROKER_HOSTNAME
-#define MQTT_BROKER_PORT CONFIG_APP_CUSTOM_MQTT_BROKER_PORT
-#define MQTT_CLIENT_ID "thingy91x-asset-tracker"
-#define MQTT_USERNAME CONFIG_APP_CUSTOM_MQTT_USERNAME
-#define MQTT_PASSWORD CONFIG_APP_CUSTOM_MQTT_PASSWORD
 #define MQTT_PUB_TOPIC CONFIG_APP_CUSTOM_MQTT_PUBLISH_TOPIC
 #define MQTT_SUB_TOPIC CONFIG_APP_CUSTOM_MQTT_SUBSCRIBE_TOPIC
-#define MQTT_KEEPALIVE CONFIG_APP_CUSTOM_MQTT_KEEPALIVE_SECONDS
 
 /* Buffer sizes */
-#define MQTT_RX_BUF_SIZE 512
-#define MQTT_TX_BUF_SIZE 512
 #define MQTT_PAYLOAD_BUF_SIZE CONFIG_APP_CUSTOM_MQTT_PAYLOAD_BUFFER_MAX_SIZE
 
+/* Events signalled to the I/O thread, see mqtt_io_signal() */
+enum mqtt_io_event {
+	MQTT_IO_EVT_NETWORK,
+	MQTT_IO_EVT_CONNECT,
+	MQTT_IO_EVT_HEARTBEAT,
+	/* Heartbeat requested by a command, sent even if other messages were published */
+	MQTT_IO_EVT_HEARTBEAT_NOW,
+	MQTT_IO_EVT_CYCLE_START,
+	MQTT_IO_EVT_TRANSPORT,
+	MQTT_IO_EVT_SUBACK_TIMEOUT,
+	MQTT_IO_EVT_POWER_SAVING,
+	/* Probe the primary broker while connected to a fallback */
+	MQTT_IO_EVT_BROKER_PROBE,
+	/* The probe work queue has a result in probe_ret and probe_rtt */
+	MQTT_IO_EVT_BROKER_PROBE_DONE,
+	/* Move the connection to the broker selected by the failover */
+	MQTT_IO_EVT_BROKER_SWITCH,
+	/* A high priority record was queued, do not wait for the reconnect backoff */
+	MQTT_IO_EVT_URGENT,
+};
+
 /* MQTT client state machine states */
 enum mqtt_state {
 	MQTT_STATE_IDLE,
 	MQTT_STATE_CONNECTING,
 	MQTT_STATE_CONNECTED,
 	MQTT_STATE_DISCONNECTING,
-	MQTT_STATE_ERROR
+	MQTT_STATE_ERROR,
+
+	/* Substates of MQTT_STATE_CONNECTED, after the others so that the state numbers sent in
+	 * heartbeats do not change. mqtt_ctx.state stays MQTT_STATE_CONNECTED in both.
+	 */
+
+	/* Waiting for the SUBACK of the command topic subscription */
+	MQTT_STATE_SUBSCRIBING,
+	/* Subscribed, the status message has been sent */
+	MQTT_STATE_READY,
 };
 
 /* MQTT module context */
 static struct {
-	struct mqtt_client client;
-	struct sockaddr_storage broker_addr;
-	uint8_t rx_buffer[MQTT_RX_BUF_SIZE];
-	uint8_t tx_buffer[MQTT_TX_BUF_SIZE];
 	uint8_t payload_buf[MQTT_PAYLOAD_BUF_SIZE];
 	enum mqtt_state state;
 	struct k_work_delayable connect_work;
 	struct k_work_delayable data_send_work;
+	struct k_work_delayable suback_timeout_work;
+	/* Runs received commands on the system workqueue */
+	struct k_work cmd_work;
+	/* Subscription to the command topic */
+	struct mqtt_sub sub;
 	bool network_connected;
-	struct mqtt_utf8 username;
-	struct mqtt_utf8 password;
-	struct k_mutex data_mutex;
 	uint32_t publish_sequence;
 	uint32_t publish_failures;
 	bool data_validation_enabled;
+	/* Wakes the I/O thread from poll(), written by other threads */
+	int wake_fd;
+	atomic_t io_events;
+	/* Uptime when the socket was last reported readable, for downlink latency */
+	int64_t rx_ready_time;
+	uint32_t downlink_latency_ms;
+	uint32_t downlink_latency_max_ms;
+	/* QoS 1 publishes waiting for PUBACK, only used by the I/O thread */
+	struct mqtt_inflight inflight;
+	/* Time from the first transmission of a publish until its PUBACK */
+	uint32_t ack_latency_ms;
+	uint32_t ack_latency_max_ms;
+#if defined(CONFIG_APP_CUSTOM_MQTT_STORE)
+	bool store_ready;
+	/* Uptime when the next stored record may be replayed */
+	int64_t replay_time;
+	/* Stored records left from a previous boot, their uptime cannot be turned into a time */
+	uint32_t store_old;
+#endif
+#if defined(CONFIG_APP_CUSTOM_MQTT_BATCH)
+	/* Records of the current sampling cycle, only used by the I/O thread */
+	struct mqtt_batch batch;
+#endif
+#if defined(CONFIG_APP_CUSTOM_MQTT_DEADBAND)
+	/* Used by the I/O thread, updated by downlink commands and read by the shell */
+	struct mqtt_deadband deadband;
+	struct k_spinlock deadband_lock;
+#endif
+#if defined(CONFIG_APP_CUSTOM_MQTT_PSM_AWARE)
+	/* Power saving parameters, written by the network message handler */
+	struct mqtt_sched_params sched_params;
+	/* Intervals derived from sched_params, written by the I/O thread and read by the shell */
+	struct mqtt_sched sched;
+	struct k_spinlock sched_lock;
+	/* Keepalive sent in the CONNECT packet of the current connection */
+	uint16_t session_keepalive;
+	/* Uptime of the last publish, the heartbeat is only sent after a quiet interval */
+	int64_t last_publish_time;
+	uint32_t suppressed_heartbeats;
+#endif
+#if defined(CONFIG_APP_CUSTOM_MQTT_ON_DEMAND)
+	/* The application has been told that the module is connected. Sessions of the sampling
+	 * cycles are not announced, only the first one and lost connections.
+	 */
+	bool online;
+	/* The current session is being closed because everything has been sent */
+	bool session_closing;
+	/* Uptime when the current session was opened and of its last packet */
+	struct mqtt_session session;
+	uint32_t sessions;
+#endif
+#if defined(CONFIG_APP_CUSTOM_MQTT_ENERGY_ESTIMATE)
+	/* Radio activity of the current cycle, only used by the I/O thread */
+	struct mqtt_energy energy;
+	/* Last completed cycle, read by the shell */
+	struct mqtt_energy_cycle energy_cycle;
+	struct k_spinlock energy_lock;
+#endif
+#if defined(CONFIG_APP_CUSTOM_MQTT_STATS)
+	/* Written by the I/O thread and read by the shell. Messages per minute are counted in
+	 * publish_rate, the entry for them in hist is not used.
+	 */
+	struct mqtt_hist hist[CUSTOM_MQTT_HIST_COUNT];
+	struct mqtt_hist_rate publish_rate;
+	struct k_spinlock hist_lock;
+	/* Uptime when the connection was lost, 0 while connected */
+	int64_t down_since;
+#endif
+#if defined(CONFIG_APP_CUSTOM_MQTT_FAILOVER)
+	/* Health of the brokers, updated by the I/O thread and read by the shell */
+	struct mqtt_broker_list brokers;
+	struct k_work_delayable probe_work;
+	/* Runs the probe on probe_work_q, the I/O thread keeps serving the connection */
+	struct k_work probe_run_work;
+	atomic_t probe_ret;
+	atomic_t probe_rtt;
+	/* A probe has been submitted and its result not handled yet, only used by the I/O thread */
+	bool probe_busy;
+	/* Uptime when the current connection attempt was started */
+	int64_t connect_start;
+#endif
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET)
+	/* Updated by the I/O thread and read by the shell */
+	struct mqtt_budget budget;
+	struct k_spinlock budget_lock;
+	/* Newest record of each class over its budget, BIT(enum mqtt_budget_class) in the mask */
+	struct mqtt_record budget_held[MQTT_BUDGET_CLASS_COUNT];
+	uint32_t budget_held_mask;
+	/* Byte counts changed since they were stored, and when they may be stored next */
+	bool budget_dirty;
+	int64_t budget_save_time;
+#endif
 } mqtt_ctx;
 
-/* State machine context */
-static struct smf_ctx sm_ctx;
+/* Records waiting to be encoded and published by the I/O thread, one ring per priority class.
+ * Producers never wait for the I/O thread, even while it is blocked in a socket write.
+ */
+MQTT_RING_DEFINE(mqtt_high_ring, sizeof(struct mqtt_record),
+		 CONFIG_APP_CUSTOM_MQTT_HIGH_PRIO_QUEUE_SIZE);
+MQTT_RING_DEFINE(mqtt_normal_ring, sizeof(struct mqtt_record),
+		 CONFIG_APP_CUSTOM_MQTT_MESSAGE_QUEUE_SIZE);
+MQTT_RING_DEFINE(mqtt_low_ring, sizeof(struct mqtt_record),
+		 CONFIG_APP_CUSTOM_MQTT_LOW_PRIO_QUEUE_SIZE);
+
+static struct mqtt_ring *const record_rings[CUSTOM_MQTT_PRIO_COUNT] = {
+	[CUSTOM_MQTT_PRIO_HIGH] = &mqtt_high_ring,
+	[CUSTOM_MQTT_PRIO_NORMAL] = &mqtt_normal_ring,
+	[CUSTOM_MQTT_PRIO_LOW] = &mqtt_low_ring,
+};
+
+/* Downlink command message, copied out of the transport receive buffer */
+struct mqtt_cmd_msg {
+	uint16_t len;
+	/* NULL terminated for CUSTOM_MQTT_EVT_DATA_RECEIVED subscribers */
+	char data[CONFIG_APP_CUSTOM_MQTT_CMD_MAX_SIZE + 1];
+};
 
-/* MQTT client buffers */
-static uint8_t mqtt_client_id[] = MQTT_CLIENT_ID;
+/* Commands waiting to be executed by cmd_work_handler() */
+K_MSGQ_DEFINE(mqtt_cmd_msgq, sizeof(struct mqtt_cmd_msg),
+	      CONFIG_APP_CUSTOM_MQTT_CMD_QUEUE_SIZE, 4);
 
-/* Security tag for TLS */
-static sec_tag_t sec_tag_list[] = { CONFIG_APP_CUSTOM_MQTT_SEC_TAG };
+/* Command acknowledgments waiting to be published by the I/O thread */
+K_MSGQ_DEFINE(mqtt_ack_msgq, sizeof(struct mqtt_record),
+	      CONFIG_APP_CUSTOM_MQTT_CMD_QUEUE_SIZE, 8);
+
+/* State machine context */
+static struct smf_ctx sm_ctx;
 
 /* Register zbus subscriber */
 ZBUS_MSG_SUBSCRIBER_DEFINE(custom_mqtt_subscriber);
 
-/* Subscribe to channels */
-ZBUS_CHAN_ADD_OBS(NETWORK_CHAN, custom_mqtt_subscriber, 0);
-#if defined(CONFIG_APP_LOCATION)
-ZBUS_CHAN_ADD_OBS(LOCATION_CHAN, custom_mqtt_subscriber, 0);
-#endif
-#if defined(CONFIG_APP_ENVIRONMENTAL)
-ZBUS_CHAN_ADD_OBS(ENVIRONMENTAL_CHAN, custom_mqtt_subscriber, 0);
-#endif
-#if defined(CONFIG_APP_POWER)
-ZBUS_CHAN_ADD_OBS(POWER_CHAN, custom_mqtt_subscriber, 0);
-#endif
-#if defined(CONFIG_APP_UART_SENSOR)
-ZBUS_CHAN_ADD_OBS(UART_SENSOR_CHAN, custom_mqtt_subscriber, 0);
-#endif
-#if defined(CONFIG_APP_BUTTON)
-ZBUS_CHAN_ADD_OBS(BUTTON_CHAN, custom_mqtt_subscriber, 0);
-#endif
+/* Define the channels that the module subscribes to and their associated message types.
+ * Data send requests from the main module on CUSTOM_MQTT_CHAN mark the start of a sampling
+ * cycle and are only needed for batching.
+ */
+#define CHANNEL_LIST(X)										\
+					 X(NETWORK_CHAN,	struct network_msg)		\
+IF_ENABLED(CONFIG_APP_LOCATION,		(X(LOCATION_CHAN,	struct location_msg)))		\
+IF_ENABLED(CONFIG_APP_ENVIRONMENTAL,	(X(ENVIRONMENTAL_CHAN,	struct environmental_msg)))	\
+IF_ENABLED(CONFIG_APP_POWER,		(X(POWER_CHAN,		struct power_msg)))		\
+IF_ENABLED(CONFIG_APP_UART_SENSOR,	(X(UART_SENSOR_CHAN,	struct uart_sensor_msg)))	\
+IF_ENABLED(CONFIG_APP_BUTTON,		(X(BUTTON_CHAN,		struct button_msg)))		\
+IF_ENABLED(CONFIG_APP_CUSTOM_MQTT_BATCH, (X(CUSTOM_MQTT_CHAN,	struct custom_mqtt_msg)))
+
+/* Calculate the maximum message size from the list of channels */
+#define MAX_MSG_SIZE			MAX_MSG_SIZE_FROM_LIST(CHANNEL_LIST)
+
+/* Add the custom_mqtt_subscriber as observer to all the channels in the list. */
+#define ADD_OBSERVERS(_chan, _type)	ZBUS_CHAN_ADD_OBS(_chan, custom_mqtt_subscriber, 0);
+
+/*
+ * Expand to a call to ZBUS_CHAN_ADD_OBS for each channel in the list.
+ * Example: ZBUS_CHAN_ADD_OBS(NETWORK_CHAN, custom_mqtt_subscriber, 0);
+ */
+CHANNEL_LIST(ADD_OBSERVERS)
 
 /* Define zbus channel */
 ZBUS_CHAN_DEFINE(CUSTOM_MQTT_CHAN,
@@ -128,18 +305,32 @@ ZBUS_CHAN_DEFINE(CUSTOM_MQTT_CHAN,
 		 ZBUS_MSG_INIT(.type = CUSTOM_MQTT_EVT_DISCONNECTED));
 
 /* Forward declarations */
-static void mqtt_evt_handler(struct mqtt_client *const client,
-			      const struct mqtt_evt *evt);
+static void transport_evt_handler(const struct mqtt_transport_evt *evt);
 static void connect_work_handler(struct k_work *work);
 static void data_send_work_handler(struct k_work *work);
-static int custom_mqtt_connect(void);
-static int custom_mqtt_disconnect(void);
+static void suback_timeout_work_handler(struct k_work *work);
+#if defined(CONFIG_APP_CUSTOM_MQTT_FAILOVER)
+static void probe_work_handler(struct k_work *work);
+static void probe_run_work_handler(struct k_work *work);
+#endif
+static void cmd_work_handler(struct k_work *work);
+static void ack_submit(const struct mqtt_record_ack *ack);
 static int mqtt_publish_data(const char *data, size_t len);
 
 /* Data validation helpers */
 static bool validate_sensor_data(double value, double min, double max);
+#if defined(CONFIG_APP_CUSTOM_MQTT_JSON_VALIDATE)
 static bool validate_json_string(const char *json_str);
-static int safe_publish_json(cJSON *json, const char *data_type);
+#endif
+static const char *record_type_str(enum mqtt_record_type type);
+static enum custom_mqtt_prio record_prio(enum mqtt_record_type type);
+static void record_init(struct mqtt_record *record, enum mqtt_record_type type);
+static int record_submit(const struct mqtt_record *record);
+static int safe_publish_record(struct mqtt_record *record);
+static void mqtt_io_signal(enum mqtt_io_event event);
+static void broker_connected(void);
+static void broker_publish_result(bool ok);
+static void hist_add(enum custom_mqtt_hist_type type, uint32_t value);
 
 /* Message processing functions */
 static void process_network_msg(const struct network_msg *msg);
@@ -166,6 +357,9 @@ static void connecting_entry(void *obj);
 static void connecting_run(void *obj);
 static void connected_entry(void *obj);
 static void connected_run(void *obj);
+static void connected_exit(void *obj);
+static void subscribing_entry(void *obj);
+static void ready_entry(void *obj);
 static void disconnecting_entry(void *obj);
 static void disconnecting_run(void *obj);
 static void error_entry(void *obj);
@@ -175,872 +369,2582 @@ static void error_run(void *obj);
 static const struct smf_state mqtt_states[] = {
 	[MQTT_STATE_IDLE] = SMF_CREATE_STATE(idle_entry, idle_run, NULL, NULL, NULL),
 	[MQTT_STATE_CONNECTING] = SMF_CREATE_STATE(connecting_entry, connecting_run, NULL, NULL, NULL),
-	[MQTT_STATE_CONNECTED] = SMF_CREATE_STATE(connected_entry, connected_run, NULL, NULL, NULL),
+	[MQTT_STATE_CONNECTED] = SMF_CREATE_STATE(connected_entry, connected_run, connected_exit,
+						  NULL, &mqtt_states[MQTT_STATE_SUBSCRIBING]),
+	[MQTT_STATE_SUBSCRIBING] = SMF_CREATE_STATE(subscribing_entry, NULL, NULL,
+						    &mqtt_states[MQTT_STATE_CONNECTED], NULL),
+	[MQTT_STATE_READY] = SMF_CREATE_STATE(ready_entry, NULL, NULL,
+					      &mqtt_states[MQTT_STATE_CONNECTED], NULL),
 	[MQTT_STATE_DISCONNECTING] = SMF_CREATE_STATE(disconnecting_entry, disconnecting_run, NULL, NULL, NULL),
 	[MQTT_STATE_ERROR] = SMF_CREATE_STATE(error_entry, error_run, NULL, NULL, NULL),
 };
 
-static void mqtt_evt_handler(struct mqtt_client *const client,
-			      const struct mqtt_evt *evt)
+/* Tell the application that the connection is up or down. In on-demand mode only the first
+ * connection and lost connections are reported, the main module stops sampling while it
+ * considers the module disconnected.
+ */
+static void connection_announce(bool connected)
+{
+	struct custom_mqtt_msg msg = {
+		.type = connected ? CUSTOM_MQTT_EVT_CONNECTED : CUSTOM_MQTT_EVT_DISCONNECTED,
+	};
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_ON_DEMAND)
+	if (mqtt_ctx.online == connected) {
+		return;
+	}
+
+	mqtt_ctx.online = connected;
+#endif
+
+	zbus_chan_pub(&CUSTOM_MQTT_CHAN, &msg, K_NO_WAIT);
+}
+
+static void transport_evt_handler(const struct mqtt_transport_evt *evt)
 {
 	struct custom_mqtt_msg msg = {0};
 
 	switch (evt->type) {
-	case MQTT_EVT_CONNACK:
+	case MQTT_TRANSPORT_EVT_CONNACK:
 		if (evt->result == 0) {
-			LOG_INF("MQTT client connected");
-			mqtt_ctx.state = MQTT_STATE_CONNECTED;
-			msg.type = CUSTOM_MQTT_EVT_CONNECTED;
-			zbus_chan_pub(&CUSTOM_MQTT_CHAN, &msg, K_NO_WAIT);
+			LOG_INF("MQTT client connected (session present: %d)",
+				evt->session_present);
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_STATS)
+			if (mqtt_ctx.down_since != 0) {
+				hist_add(CUSTOM_MQTT_HIST_RECONNECT_MS,
+					 (uint32_t)(k_uptime_get() - mqtt_ctx.down_since));
+				mqtt_ctx.down_since = 0;
+			}
+#endif
+
+			broker_connected();
+			connection_announce(true);
+			smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_CONNECTED]);
 		} else {
 			LOG_ERR("MQTT connection failed: %d", evt->result);
-			mqtt_ctx.state = MQTT_STATE_ERROR;
 			msg.type = CUSTOM_MQTT_EVT_ERROR;
 			msg.error.err_code = evt->result;
 			zbus_chan_pub(&CUSTOM_MQTT_CHAN, &msg, K_NO_WAIT);
+			smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_ERROR]);
 		}
 		break;
 
-	case MQTT_EVT_DISCONNECT:
+	case MQTT_TRANSPORT_EVT_DISCONNECT:
 		LOG_INF("MQTT client disconnected");
-		mqtt_ctx.state = MQTT_STATE_IDLE;
-		msg.type = CUSTOM_MQTT_EVT_DISCONNECTED;
-		zbus_chan_pub(&CUSTOM_MQTT_CHAN, &msg, K_NO_WAIT);
-		break;
 
-	case MQTT_EVT_PUBLISH:
-		LOG_INF("MQTT message received on topic: %.*s",
-			evt->param.publish.message.topic.topic.size,
-			evt->param.publish.message.topic.topic.utf8);
-		
-		/* Validate payload size */
-		if (evt->param.publish.message.payload.len >= MQTT_PAYLOAD_BUF_SIZE) {
-			LOG_WRN("Received message too large: %u bytes, truncating",
-				evt->param.publish.message.payload.len);
-		}
-		
-		/* Copy received data to message with bounds checking */
-		size_t len = MIN(evt->param.publish.message.payload.len, 
-				 MQTT_PAYLOAD_BUF_SIZE - 1);
-		
-		if (evt->param.publish.message.payload.data != NULL && len > 0) {
-			memcpy(mqtt_ctx.payload_buf, evt->param.publish.message.payload.data, len);
-			mqtt_ctx.payload_buf[len] = '\0';
-			
-			LOG_INF("Received message (%zu bytes): %s", len, (char *)mqtt_ctx.payload_buf);
-			
-			/* Process command and send response */
-			cJSON *response = cJSON_CreateObject();
-			if (response) {
-				cJSON_AddStringToObject(response, "device_id", MQTT_CLIENT_ID);
-				cJSON_AddNumberToObject(response, "timestamp", k_uptime_get());
-				cJSON_AddStringToObject(response, "received_message", (char *)mqtt_ctx.payload_buf);
-				cJSON_AddNumberToObject(response, "response_sequence", mqtt_ctx.publish_sequence + 1);
-				
-				/* Parse command if it's JSON */
-				cJSON *received_json = cJSON_Parse((char *)mqtt_ctx.payload_buf);
-				if (received_json) {
-					cJSON *command = cJSON_GetObjectItem(received_json, "command");
-					if (command && cJSON_IsString(command)) {
-						LOG_INF("Processing command: %s", command->valuestring);
-						cJSON_AddStringToObject(response, "command_processed", command->valuestring);
-						cJSON_AddStringToObject(response, "status", "command_received");
-					}
-					cJSON_Delete(received_json);
-				} else {
-					cJSON_AddStringToObject(response, "status", "message_received");
-				}
-				
-				char *response_string = cJSON_Print(response);
-				if (response_string) {
-					mqtt_publish_data(response_string, strlen(response_string));
-					cJSON_free(response_string);
-				}
-				cJSON_Delete(response);
-			}
-			
-			msg.type = CUSTOM_MQTT_EVT_DATA_RECEIVED;
-			msg.data_received.data = (char *)mqtt_ctx.payload_buf;
-			msg.data_received.len = len;
-			zbus_chan_pub(&CUSTOM_MQTT_CHAN, &msg, K_NO_WAIT);
+#if defined(CONFIG_APP_CUSTOM_MQTT_ON_DEMAND)
+		if (mqtt_ctx.session_closing) {
+			mqtt_ctx.session_closing = false;
 		} else {
+			connection_announce(false);
+		}
+#else
+		connection_announce(false);
+#endif
+
+		/* A requested disconnect ends in idle, anything else is retried with backoff */
+		if (mqtt_ctx.state == MQTT_STATE_DISCONNECTING) {
+			smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_IDLE]);
+		} else if (mqtt_ctx.state != MQTT_STATE_ERROR) {
+			smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_ERROR]);
+		}
+		break;
+
+	case MQTT_TRANSPORT_EVT_PUBLISH: {
+		/* Commands are only copied and queued here, they run on the system workqueue so
+		 * that the I/O thread keeps serving the connection.
+		 */
+		/* Only the I/O thread runs this handler */
+		static struct mqtt_cmd_msg cmd_msg;
+		struct mqtt_record_ack ack = {0};
+
+		/* Time from the socket becoming readable until the message reaches this handler */
+		mqtt_ctx.downlink_latency_ms = (uint32_t)(k_uptime_get() - mqtt_ctx.rx_ready_time);
+		mqtt_ctx.downlink_latency_max_ms = MAX(mqtt_ctx.downlink_latency_max_ms,
+						       mqtt_ctx.downlink_latency_ms);
+
+		LOG_INF("MQTT message received on topic: %s (%zu bytes, latency: %u ms)",
+			MQTT_SUB_TOPIC, evt->len, mqtt_ctx.downlink_latency_ms);
+
+		if (evt->data == NULL || evt->len == 0) {
 			LOG_WRN("Received message with invalid payload");
+			ack.result = -EBADMSG;
+			ack_submit(&ack);
+			break;
+		}
+
+		if (evt->len > CONFIG_APP_CUSTOM_MQTT_CMD_MAX_SIZE) {
+			LOG_WRN("Received message too large: %zu bytes", evt->len);
+			ack.result = -EMSGSIZE;
+			ack_submit(&ack);
+			break;
+		}
+
+		cmd_msg.len = (uint16_t)evt->len;
+		memcpy(cmd_msg.data, evt->data, evt->len);
+		cmd_msg.data[evt->len] = '\0';
+
+		if (k_msgq_put(&mqtt_cmd_msgq, &cmd_msg, K_NO_WAIT)) {
+			LOG_WRN("Command queue full, message rejected");
+			ack.result = -EBUSY;
+			ack_submit(&ack);
+			break;
 		}
+
+		k_work_submit(&mqtt_ctx.cmd_work);
 		break;
+	}
+
+	case MQTT_TRANSPORT_EVT_PUBACK: {
+		uint32_t latency_ms;
+		int ret = mqtt_inflight_ack(&mqtt_ctx.inflight, evt->message_id,
+					    k_uptime_get(), &latency_ms);
+
+		if (ret) {
+			LOG_WRN("PUBACK for unknown message_id: %u", evt->message_id);
+			break;
+		}
+
+		mqtt_ctx.ack_latency_ms = latency_ms;
+		mqtt_ctx.ack_latency_max_ms = MAX(mqtt_ctx.ack_latency_max_ms, latency_ms);
+		hist_add(CUSTOM_MQTT_HIST_ACK_MS, latency_ms);
+
+		LOG_DBG("MQTT publish acknowledged (message_id: %u, latency: %u ms, in flight: %zu)",
+			evt->message_id, latency_ms, mqtt_ctx.inflight.count);
 
-	case MQTT_EVT_PUBACK:
-		LOG_DBG("MQTT publish acknowledged (message_id: %u)", evt->param.puback.message_id);
 		/* Reset failure counter on successful publish */
 		if (mqtt_ctx.publish_failures > 0) {
 			mqtt_ctx.publish_failures = MAX(0, mqtt_ctx.publish_failures - 1);
 		}
-		break;
 
-	case MQTT_EVT_SUBACK:
-		LOG_INF("MQTT subscription acknowledged (message_id: %u)", evt->param.suback.message_id);
+		broker_publish_result(true);
 		break;
+	}
 
-	case MQTT_EVT_UNSUBACK:
-		LOG_INF("MQTT unsubscription acknowledged");
-		break;
+	case MQTT_TRANSPORT_EVT_SUBACK: {
+		int ret = mqtt_sub_ack(&mqtt_ctx.sub, evt->message_id, evt->result);
 
-	case MQTT_EVT_PINGRESP:
-		LOG_DBG("MQTT ping response received");
+		if (ret == -ENOENT) {
+			LOG_WRN("SUBACK for unknown message_id: %u", evt->message_id);
+			break;
+		}
+
+		/* Handled like a missing SUBACK, uplink works without the subscription */
+		if (ret) {
+			LOG_WRN("Subscription to %s rejected (return code: 0x%02x), "
+				"continuing without it", MQTT_SUB_TOPIC, evt->result);
+		} else {
+			LOG_INF("MQTT subscription acknowledged (message_id: %u)",
+				evt->message_id);
+		}
+
+		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_READY]);
 		break;
+	}
 
 	default:
-		LOG_WRN("Unhandled MQTT event: %d", evt->type);
 		break;
 	}
 }
 
+/* Work handlers run on the system workqueue and only signal the I/O thread, which owns the
+ * MQTT client and the state machine.
+ */
 static void connect_work_handler(struct k_work *work)
 {
-	if (mqtt_ctx.state == MQTT_STATE_IDLE) {
-		LOG_INF("Connection work triggered, attempting MQTT connection");
-		/* Try to connect regardless of network_connected flag */
-		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_CONNECTING]);
-	} else {
-		LOG_DBG("Connection work triggered but MQTT not in idle state (%d)", mqtt_ctx.state);
-	}
+	mqtt_io_signal(MQTT_IO_EVT_CONNECT);
 }
 
 static void data_send_work_handler(struct k_work *work)
 {
-	if (mqtt_ctx.state == MQTT_STATE_CONNECTED) {
-		k_mutex_lock(&mqtt_ctx.data_mutex, K_FOREVER);
-		
-		cJSON *json = cJSON_CreateObject();
-		if (json) {
-			cJSON_AddStringToObject(json, "device_id", MQTT_CLIENT_ID);
-			cJSON_AddStringToObject(json, "type", "heartbeat");
-			cJSON_AddNumberToObject(json, "timestamp", k_uptime_get());
-			cJSON_AddNumberToObject(json, "uptime_ms", k_uptime_get());
-			cJSON_AddStringToObject(json, "firmware_version", "v0.0.0-dev");
-			cJSON_AddNumberToObject(json, "sequence", mqtt_ctx.publish_sequence + 1);
-			
-		/* Add diagnostic information */
-		cJSON *diagnostics = cJSON_CreateObject();
-		if (diagnostics) {
-			cJSON_AddNumberToObject(diagnostics, "publish_failures", mqtt_ctx.publish_failures);
-			cJSON_AddNumberToObject(diagnostics, "total_publishes", mqtt_ctx.publish_sequence);
-			cJSON_AddBoolToObject(diagnostics, "network_connected", mqtt_ctx.network_connected);
-			cJSON_AddNumberToObject(diagnostics, "mqtt_state", mqtt_ctx.state);
-			cJSON_AddItemToObject(json, "diagnostics", diagnostics);
-		}
-		
-		char *json_string = cJSON_Print(json);
-			if (json_string) {
-				int ret = mqtt_publish_data(json_string, strlen(json_string));
-				if (ret == 0) {
-					LOG_INF("Heartbeat message sent (seq: %u, failures: %u)", 
-						mqtt_ctx.publish_sequence, mqtt_ctx.publish_failures);
-				} else {
-					LOG_ERR("Failed to send heartbeat: %d", ret);
-				}
-				cJSON_free(json_string);
-			}
-			cJSON_Delete(json);
-		}
-		
-		k_mutex_unlock(&mqtt_ctx.data_mutex);
-		
-		/* Schedule next heartbeat */
-		k_work_schedule(&mqtt_ctx.data_send_work, K_SECONDS(MQTT_HEARTBEAT_INTERVAL_SEC));
-	}
+	mqtt_io_signal(MQTT_IO_EVT_HEARTBEAT);
 }
 
-static int custom_mqtt_connect(void)
+static void suback_timeout_work_handler(struct k_work *work)
 {
-	struct sockaddr_in *broker4 = (struct sockaddr_in *)&mqtt_ctx.broker_addr;
-	
-	/* Configure broker address */
-	broker4->sin_family = AF_INET;
-	broker4->sin_port = htons(MQTT_BROKER_PORT);
-	
-	/* Resolve hostname */
-	LOG_INF("Starting DNS resolution for %s", MQTT_BROKER_HOSTNAME);
-	struct addrinfo hints = {
-		.ai_family = AF_INET,
-		.ai_socktype = SOCK_STREAM,
-	};
-	struct addrinfo *result;
-	
-	int ret = getaddrinfo(MQTT_BROKER_HOSTNAME, NULL, &hints, &result);
-	if (ret != 0) {
-		LOG_ERR("Failed to resolve hostname %s: %d", MQTT_BROKER_HOSTNAME, ret);
-		return ret;
-	}
-	
-	char ip_str[INET_ADDRSTRLEN];
-	inet_ntop(AF_INET, &((struct sockaddr_in *)result->ai_addr)->sin_addr, ip_str, INET_ADDRSTRLEN);
-	LOG_INF("DNS resolved %s to %s", MQTT_BROKER_HOSTNAME, ip_str);
-	
-	broker4->sin_addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
-	freeaddrinfo(result);
-
-	LOG_INF("Initializing MQTT client");
-	/* Initialize MQTT client */
-	mqtt_client_init(&mqtt_ctx.client);
-
-	LOG_INF("Configuring MQTT client parameters");
-	/* Set up client configuration */
-	mqtt_ctx.client.broker = &mqtt_ctx.broker_addr;
-	mqtt_ctx.client.evt_cb = mqtt_evt_handler;
-	mqtt_ctx.client.client_id.utf8 = mqtt_client_id;
-	mqtt_ctx.client.client_id.size = strlen(mqtt_client_id);
-	mqtt_ctx.client.protocol_version = MQTT_VERSION_3_1_1;
-	mqtt_ctx.client.rx_buf = mqtt_ctx.rx_buffer;
-	mqtt_ctx.client.rx_buf_size = sizeof(mqtt_ctx.rx_buffer);
-	mqtt_ctx.client.tx_buf = mqtt_ctx.tx_buffer;
-	mqtt_ctx.client.tx_buf_size = sizeof(mqtt_ctx.tx_buffer);
-	mqtt_ctx.client.keepalive = MQTT_KEEPALIVE;
-
-	LOG_INF("Setting MQTT credentials");
-	/* Set username and password if provided */
-	if (strlen(MQTT_USERNAME) > 0) {
-		mqtt_ctx.username.utf8 = MQTT_USERNAME;
-		mqtt_ctx.username.size = strlen(MQTT_USERNAME);
-		mqtt_ctx.client.user_name = &mqtt_ctx.username;
-		
-		if (strlen(MQTT_PASSWORD) > 0) {
-			mqtt_ctx.password.utf8 = MQTT_PASSWORD;
-			mqtt_ctx.password.size = strlen(MQTT_PASSWORD);
-			mqtt_ctx.client.password = &mqtt_ctx.password;
-		} else {
-			mqtt_ctx.client.password = NULL;
-		}
-		
-		LOG_INF("Using authentication with username: %s", MQTT_USERNAME);
-	} else {
-		mqtt_ctx.client.user_name = NULL;
-		mqtt_ctx.client.password = NULL;
-		LOG_INF("Using anonymous connection (no credentials)");
-	}
-
-	LOG_INF("Configuring TLS settings");
-	/* Configure TLS */
-	mqtt_ctx.client.transport.type = MQTT_TRANSPORT_SECURE;
-	
-	struct mqtt_sec_config *tls_config = &mqtt_ctx.client.transport.tls.config;
-	tls_config->peer_verify = TLS_PEER_VERIFY_NONE;  /* Disable peer verification for now */
-	tls_config->cipher_list = NULL;
-	
-	/* Use security tags if configured, otherwise use system CA certificates */
-	if (CONFIG_APP_CUSTOM_MQTT_SEC_TAG > 0) {
-		tls_config->sec_tag_count = ARRAY_SIZE(sec_tag_list);
-		tls_config->sec_tag_list = sec_tag_list;
-		LOG_INF("Using security tag: %d", CONFIG_APP_CUSTOM_MQTT_SEC_TAG);
-	} else {
-		tls_config->sec_tag_count = 0;
-		tls_config->sec_tag_list = NULL;
-		LOG_INF("Using system CA certificates");
-	}
-	
-	tls_config->hostname = MQTT_BROKER_HOSTNAME;
+	mqtt_io_signal(MQTT_IO_EVT_SUBACK_TIMEOUT);
+}
 
-	LOG_INF("Starting MQTT connection to %s:%d", MQTT_BROKER_HOSTNAME, MQTT_BROKER_PORT);
-	LOG_INF("Client ID: %s, Username: %s", MQTT_CLIENT_ID, MQTT_USERNAME);
-	
-	ret = mqtt_connect(&mqtt_ctx.client);
-	LOG_INF("mqtt_connect() returned: %d", ret);
-	if (ret) {
-		LOG_ERR("Failed to connect to MQTT broker: %d", ret);
-		return ret;
-	}
+#if defined(CONFIG_APP_CUSTOM_MQTT_FAILOVER)
+/* A probe resolves the broker and waits for the TCP handshake, it runs on its own work queue */
+static K_THREAD_STACK_DEFINE(probe_work_q_stack, CONFIG_APP_CUSTOM_MQTT_FAILOVER_PROBE_STACK_SIZE);
+static struct k_work_q probe_work_q;
 
-	LOG_INF("MQTT connection initiated successfully");
-	return 0;
+static void probe_work_handler(struct k_work *work)
+{
+	mqtt_io_signal(MQTT_IO_EVT_BROKER_PROBE);
 }
 
-static int custom_mqtt_disconnect(void)
+static void probe_run_work_handler(struct k_work *work)
 {
-	LOG_INF("Disconnecting from MQTT broker");
-	return mqtt_disconnect(&mqtt_ctx.client, NULL);
+	uint32_t rtt_ms = 0;
+	int ret;
+
+	ret = mqtt_transport_probe(0, &rtt_ms);
+
+	atomic_set(&mqtt_ctx.probe_rtt, (atomic_val_t)rtt_ms);
+	atomic_set(&mqtt_ctx.probe_ret, ret);
+
+	mqtt_io_signal(MQTT_IO_EVT_BROKER_PROBE_DONE);
 }
+#endif
 
-static int mqtt_publish_data(const char *data, size_t len)
+/* Run one received command. The message stays in cmd_msg until the next command, it is
+ * referenced by the CUSTOM_MQTT_EVT_DATA_RECEIVED message.
+ */
+static void cmd_work_handler(struct k_work *work)
 {
-	struct mqtt_publish_param param;
+	static struct mqtt_cmd_msg cmd_msg;
+	struct custom_mqtt_msg msg = {
+		.type = CUSTOM_MQTT_EVT_DATA_RECEIVED,
+	};
+	struct mqtt_record_ack ack;
 	int ret;
 
-	if (!data || len == 0) {
-		LOG_ERR("Invalid data parameters");
-		return -EINVAL;
+	if (k_msgq_get(&mqtt_cmd_msgq, &cmd_msg, K_NO_WAIT)) {
+		return;
 	}
 
-	if (mqtt_ctx.state != MQTT_STATE_CONNECTED) {
-		LOG_WRN("MQTT not connected, cannot publish");
-		return -ENOTCONN;
-	}
+	ret = mqtt_cmd_dispatch(cmd_msg.data, cmd_msg.len, &ack);
 
-	k_mutex_lock(&mqtt_ctx.data_mutex, K_FOREVER);
+	LOG_INF("Command \"%s\" (id: \"%s\") result: %d", ack.command, ack.id, ret);
 
-	param.message.topic.qos = MQTT_QOS_1_AT_LEAST_ONCE;
-	param.message.topic.topic.utf8 = MQTT_PUB_TOPIC;
-	param.message.topic.topic.size = strlen(MQTT_PUB_TOPIC);
-	param.message.payload.data = (uint8_t *)data;
-	param.message.payload.len = len;
-	param.message_id = ++mqtt_ctx.publish_sequence;
-	param.dup_flag = 0;
-	param.retain_flag = 0;
+	ack_submit(&ack);
 
-	LOG_DBG("Publishing %zu bytes to topic %s (seq: %u)", len, MQTT_PUB_TOPIC, 
-		mqtt_ctx.publish_sequence);
+	msg.data_received.data = cmd_msg.data;
+	msg.data_received.len = cmd_msg.len;
+	zbus_chan_pub(&CUSTOM_MQTT_CHAN, &msg, K_NO_WAIT);
 
-	ret = mqtt_publish(&mqtt_ctx.client, &param);
-	if (ret) {
-		mqtt_ctx.publish_failures++;
-		LOG_ERR("Failed to publish data: %d (failures: %u)", ret, mqtt_ctx.publish_failures);
+	/* One command per run, so that other work items are not held up */
+	if (k_msgq_num_used_get(&mqtt_cmd_msgq) > 0) {
+		k_work_submit(work);
 	}
-
-	k_mutex_unlock(&mqtt_ctx.data_mutex);
-	return ret;
 }
 
-/* Data validation and helper functions */
-static bool validate_sensor_data(double value, double min, double max)
+/* Queue a command acknowledgment for the I/O thread. Acknowledgments are not batched or stored,
+ * if the queue is full the new one is dropped.
+ */
+static void ack_submit(const struct mqtt_record_ack *ack)
 {
-	if (!isfinite(value)) {
-		LOG_WRN("Invalid sensor value: not finite");
-		return false;
-	}
-	
-	if (value < min || value > max) {
-		LOG_WRN("Sensor value %.2f out of range [%.2f, %.2f]", value, min, max);
-		return false;
+	struct mqtt_record record;
+
+	record_init(&record, MQTT_RECORD_ACK);
+	record.ack = *ack;
+
+	if (k_msgq_put(&mqtt_ack_msgq, &record, K_NO_WAIT)) {
+		LOG_WRN("Acknowledgment queue full, ack for \"%s\" dropped", ack->command);
+		return;
 	}
-	
-	return true;
+
+	(void)eventfd_write(mqtt_ctx.wake_fd, 1);
 }
 
-static bool validate_json_string(const char *json_str)
+/* Built-in commands. ping only checks the downlink path, heartbeat sends one right away. */
+static int cmd_ping(const struct mqtt_cmd_arg *args)
 {
-	if (!json_str) {
-		return false;
-	}
-	
-	/* Basic validation - check if it's a valid JSON */
-	cJSON *test = cJSON_Parse(json_str);
-	if (!test) {
-		LOG_ERR("Invalid JSON string");
-		return false;
-	}
-	
-	cJSON_Delete(test);
-	return true;
+	ARG_UNUSED(args);
+
+	return 0;
 }
 
-static int safe_publish_json(cJSON *json, const char *data_type)
+static int cmd_heartbeat(const struct mqtt_cmd_arg *args)
 {
-	char *json_string;
-	int ret = -ENOMEM;
-	
-	if (!json) {
-		LOG_ERR("NULL JSON object for %s data", data_type ? data_type : "unknown");
-		return -EINVAL;
-	}
-	
-	/* Add common fields */
-	cJSON_AddStringToObject(json, "device_id", MQTT_CLIENT_ID);
-	cJSON_AddNumberToObject(json, "timestamp", k_uptime_get());
-	
-	json_string = cJSON_Print(json);
-	if (json_string) {
-		if (validate_json_string(json_string)) {
-			if (mqtt_ctx.state == MQTT_STATE_CONNECTED) {
-				ret = mqtt_publish_data(json_string, strlen(json_string));
-				if (ret == 0) {
-					LOG_DBG("Successfully published %s data", data_type ? data_type : "JSON");
-				} else {
-					LOG_ERR("Failed to publish %s data: %d", data_type ? data_type : "JSON", ret);
-				}
-			} else {
-				LOG_WRN("MQTT not connected, cannot publish %s data", data_type ? data_type : "JSON");
-				ret = -ENOTCONN;
-			}
-		} else {
-			LOG_ERR("JSON validation failed for %s data", data_type ? data_type : "JSON");
-			ret = -EINVAL;
-		}
-		cJSON_free(json_string);
-	} else {
-		LOG_ERR("Failed to serialize %s JSON data", data_type ? data_type : "JSON");
-	}
-	
-	return ret;
+	ARG_UNUSED(args);
+
+	mqtt_io_signal(MQTT_IO_EVT_HEARTBEAT_NOW);
+
+	return 0;
 }
 
-/* State machine implementations */
-static void idle_entry(void *obj)
-{
-	LOG_DBG("Entering MQTT idle state");
-	mqtt_ctx.state = MQTT_STATE_IDLE;
+MQTT_CMD_DEFINE(ping, cmd_ping);
+MQTT_CMD_DEFINE(heartbeat, cmd_heartbeat);
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_DEADBAND)
+/* Kconfig options and the deadband command use thousandths of the field unit and per mille */
+#define DEADBAND_BAND(_field) {								\
+	.abs = CONFIG_APP_CUSTOM_MQTT_DEADBAND_##_field##_ABS / 1000.0,			\
+	.rel = CONFIG_APP_CUSTOM_MQTT_DEADBAND_##_field##_REL / 1000.0,			\
 }
 
-static void idle_run(void *obj)
+static const struct mqtt_deadband_band deadband_defaults[] = {
+	[MQTT_DEADBAND_TEMPERATURE] = DEADBAND_BAND(TEMPERATURE),
+	[MQTT_DEADBAND_HUMIDITY] = DEADBAND_BAND(HUMIDITY),
+	[MQTT_DEADBAND_PRESSURE] = DEADBAND_BAND(PRESSURE),
+	[MQTT_DEADBAND_BATTERY] = DEADBAND_BAND(BATTERY),
+	[MQTT_DEADBAND_VOLTAGE] = DEADBAND_BAND(VOLTAGE),
+};
+
+static void deadband_init(void)
 {
-	/* Check network status and attempt connection */
-	if (mqtt_ctx.network_connected) {
-		LOG_INF("Network available, transitioning to connecting state");
-		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_CONNECTING]);
-	} else {
-		/* Periodically log that we're waiting for network */
-		static uint32_t network_wait_count = 0;
-		if (++network_wait_count % 30 == 0) {  /* Log every 30 seconds */
-			LOG_INF("Waiting for network connection... (%d)", network_wait_count);
-		}
+	mqtt_deadband_init(&mqtt_ctx.deadband,
+			   (int64_t)CONFIG_APP_CUSTOM_MQTT_DEADBAND_MAX_SILENCE_SEC * MSEC_PER_SEC);
+
+	for (size_t i = 0; i < ARRAY_SIZE(deadband_defaults); i++) {
+		(void)mqtt_deadband_band_set(&mqtt_ctx.deadband, i, &deadband_defaults[i]);
 	}
 }
 
-static void connecting_entry(void *obj)
+/* Change the dead-band of one field and/or the maximum silence interval, for example
+ * {"command":"deadband","field":"temperature","abs":500,"max_silence":3600}
+ */
+static int cmd_deadband(const struct mqtt_cmd_arg *args)
 {
-	LOG_INF("Entering MQTT connecting state");
-	mqtt_ctx.state = MQTT_STATE_CONNECTING;
-	
-	int ret = custom_mqtt_connect();
-	if (ret != 0) {
-		LOG_ERR("MQTT connection failed with error: %d", ret);
-		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_ERROR]);
-	} else {
-		LOG_INF("MQTT connection initiated, waiting for response");
+	const struct mqtt_cmd_arg *field = &args[0];
+	const struct mqtt_cmd_arg *abs = &args[1];
+	const struct mqtt_cmd_arg *rel = &args[2];
+	const struct mqtt_cmd_arg *max_silence = &args[3];
+	struct mqtt_deadband_band band;
+	k_spinlock_key_t key;
+	int index = 0;
+	int err = 0;
+
+	if (field->present) {
+		index = mqtt_deadband_field_get(field->str.ptr, field->str.len);
+		if (index < 0 || (!abs->present && !rel->present)) {
+			return -EINVAL;
+		}
+	} else if (abs->present || rel->present || !max_silence->present) {
+		return -EINVAL;
 	}
-}
 
-static void connecting_run(void *obj)
-{
-	/* Poll MQTT client for events - this is crucial for processing CONNACK */
-	int ret = mqtt_input(&mqtt_ctx.client);
-	if (ret < 0) {
-		LOG_ERR("MQTT input error during connection: %d", ret);
-		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_ERROR]);
+	if (max_silence->present && max_silence->i < 0) {
+		return -EINVAL;
 	}
-	
-	/* Also call mqtt_live to maintain the connection */
-	ret = mqtt_live(&mqtt_ctx.client);
-	if (ret < 0 && ret != -EAGAIN) {
-		LOG_ERR("MQTT live error: %d", ret);
-		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_ERROR]);
+
+	key = k_spin_lock(&mqtt_ctx.deadband_lock);
+
+	if (field->present) {
+		band = mqtt_ctx.deadband.bands[index];
+		band.abs = abs->present ? abs->i / 1000.0 : band.abs;
+		band.rel = rel->present ? rel->i / 1000.0 : band.rel;
+
+		err = mqtt_deadband_band_set(&mqtt_ctx.deadband, index, &band);
 	}
-}
 
-static void connected_entry(void *obj)
+	if (err == 0 && max_silence->present) {
+		mqtt_ctx.deadband.max_silence_ms = (int64_t)max_silence->i * MSEC_PER_SEC;
+	}
+
+	k_spin_unlock(&mqtt_ctx.deadband_lock, key);
+
+	return err;
+}
+
+MQTT_CMD_DEFINE(deadband, cmd_deadband,
+	MQTT_CMD_ARG("field", STR, false),
+	MQTT_CMD_ARG("abs", INT, false),
+	MQTT_CMD_ARG("rel", INT, false),
+	MQTT_CMD_ARG("max_silence", INT, false)
+);
+#endif /* CONFIG_APP_CUSTOM_MQTT_DEADBAND */
+
+/* Check a record against the dead-band filter. Only called from the I/O thread when a record is
+ * taken from the queue. The record does not become the reference for later records until it has
+ * been published or stored, so a record the budget holds back or that fails to send is not
+ * mistaken for the last sent value.
+ */
+static bool record_suppressed(const struct mqtt_record *record)
+{
+#if defined(CONFIG_APP_CUSTOM_MQTT_DEADBAND)
+	k_spinlock_key_t key = k_spin_lock(&mqtt_ctx.deadband_lock);
+	bool send = mqtt_deadband_check(&mqtt_ctx.deadband, record);
+
+	k_spin_unlock(&mqtt_ctx.deadband_lock, key);
+
+	if (!send) {
+		LOG_DBG("No significant change, %s record suppressed",
+			record_type_str(record->type));
+	}
+
+	return !send;
+#else
+	return false;
+#endif
+}
+
+/* Make a record the dead-band reference once it has been published or stored */
+static void record_sent(const struct mqtt_record *record)
+{
+#if defined(CONFIG_APP_CUSTOM_MQTT_DEADBAND)
+	k_spinlock_key_t key = k_spin_lock(&mqtt_ctx.deadband_lock);
+
+	mqtt_deadband_sent(&mqtt_ctx.deadband, record);
+
+	k_spin_unlock(&mqtt_ctx.deadband_lock, key);
+#else
+	ARG_UNUSED(record);
+#endif
+}
+
+void custom_mqtt_stats_get(struct custom_mqtt_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_DEADBAND)
+	k_spinlock_key_t key = k_spin_lock(&mqtt_ctx.deadband_lock);
+
+	stats->suppressed_environmental =
+		mqtt_ctx.deadband.suppressed[MQTT_DEADBAND_CHANNEL_ENVIRONMENTAL];
+	stats->suppressed_power = mqtt_ctx.deadband.suppressed[MQTT_DEADBAND_CHANNEL_POWER];
+
+	k_spin_unlock(&mqtt_ctx.deadband_lock, key);
+#endif
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_PSM_AWARE)
+	k_spinlock_key_t sched_key = k_spin_lock(&mqtt_ctx.sched_lock);
+
+	stats->keepalive = mqtt_ctx.sched.keepalive;
+	stats->heartbeat_interval = mqtt_ctx.sched.heartbeat;
+	stats->suppressed_heartbeats = mqtt_ctx.suppressed_heartbeats;
+
+	k_spin_unlock(&mqtt_ctx.sched_lock, sched_key);
+#else
+	stats->keepalive = CONFIG_APP_CUSTOM_MQTT_KEEPALIVE_SECONDS;
+	stats->heartbeat_interval = MQTT_HEARTBEAT_INTERVAL_SEC;
+#endif
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_ON_DEMAND)
+	stats->sessions = mqtt_ctx.sessions;
+#endif
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_ENERGY_ESTIMATE)
+	k_spinlock_key_t energy_key = k_spin_lock(&mqtt_ctx.energy_lock);
+
+	stats->cycle_duration_ms = mqtt_ctx.energy_cycle.duration_ms;
+	stats->cycle_wakeups = mqtt_ctx.energy_cycle.wakeups;
+	stats->cycle_active_ms = mqtt_ctx.energy_cycle.active_ms;
+	stats->cycle_energy_mj = mqtt_ctx.energy_cycle.energy_mj;
+
+	k_spin_unlock(&mqtt_ctx.energy_lock, energy_key);
+#endif
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_FAILOVER)
+	stats->broker = mqtt_ctx.brokers.active;
+	stats->broker_switches = mqtt_ctx.brokers.switches;
+#endif
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET)
+	k_spinlock_key_t budget_key = k_spin_lock(&mqtt_ctx.budget_lock);
+
+	stats->budget = mqtt_ctx.budget.usage;
+	stats->budget_daily_limit = mqtt_ctx.budget.config.daily_limit;
+	stats->budget_monthly_limit = mqtt_ctx.budget.config.monthly_limit;
+	memcpy(stats->budget_limited, mqtt_ctx.budget.limited, sizeof(stats->budget_limited));
+
+	k_spin_unlock(&mqtt_ctx.budget_lock, budget_key);
+#endif
+
+	for (size_t i = 0; i < CUSTOM_MQTT_PRIO_COUNT; i++) {
+		stats->queued[i] = mqtt_ring_count(record_rings[i]);
+		stats->dropped[i] = (uint32_t)atomic_get(&record_rings[i]->dropped);
+	}
+}
+
+/* A packet was sent or received. Only called from the I/O thread. */
+static void io_activity(int64_t now)
+{
+#if defined(CONFIG_APP_CUSTOM_MQTT_ON_DEMAND)
+	mqtt_ctx.session.activity = now;
+#endif
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_ENERGY_ESTIMATE)
+	mqtt_energy_activity(&mqtt_ctx.energy, now);
+#endif
+}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_FAILOVER)
+static void broker_init(void)
+{
+	const struct mqtt_broker_config config = {
+		.connect_failures = CONFIG_APP_CUSTOM_MQTT_FAILOVER_CONNECT_FAILURES,
+		.fail_rate = CONFIG_APP_CUSTOM_MQTT_FAILOVER_FAILURE_RATE *
+			     MQTT_BROKER_FAIL_RATE_MAX / 100,
+		.hold_ms = CONFIG_APP_CUSTOM_MQTT_FAILOVER_HOLD_SEC * MSEC_PER_SEC,
+		.probes = CONFIG_APP_CUSTOM_MQTT_FAILOVER_PROBES,
+	};
+
+	/* The transport knows the brokers once it has been initialized */
+	mqtt_broker_list_init(&mqtt_ctx.brokers, mqtt_transport_broker_count(), &config);
+}
+
+/* Probe the primary broker while connected to a fallback. The probe runs on probe_work_q, its
+ * result is handled by broker_probe_done().
+ */
+static void broker_probe(void)
+{
+	if (mqtt_ctx.state != MQTT_STATE_CONNECTED || mqtt_ctx.brokers.active == 0 ||
+	    mqtt_ctx.probe_busy) {
+		return;
+	}
+
+	if (mqtt_broker_probe_due(&mqtt_ctx.brokers, k_uptime_get())) {
+		mqtt_ctx.probe_busy = true;
+		(void)k_work_submit_to_queue(&probe_work_q, &mqtt_ctx.probe_run_work);
+		return;
+	}
+
+	k_work_reschedule(&mqtt_ctx.probe_work,
+			  K_SECONDS(CONFIG_APP_CUSTOM_MQTT_FAILOVER_PROBE_INTERVAL_SEC));
+}
+
+/* Move back to the primary broker once it answers. A result that arrives after the connection
+ * to the fallback was lost is dropped.
+ */
+static void broker_probe_done(void)
+{
+	int ret = (int)atomic_get(&mqtt_ctx.probe_ret);
+	uint32_t rtt_ms = (uint32_t)atomic_get(&mqtt_ctx.probe_rtt);
+
+	mqtt_ctx.probe_busy = false;
+
+	if (mqtt_ctx.state != MQTT_STATE_CONNECTED || mqtt_ctx.brokers.active == 0) {
+		return;
+	}
+
+	if (ret) {
+		LOG_DBG("Primary broker probe failed: %d", ret);
+	}
+
+	if (mqtt_broker_probe_result(&mqtt_ctx.brokers, ret, rtt_ms, k_uptime_get())) {
+		LOG_INF("Primary broker answers again (%u ms), moving back to it", rtt_ms);
+		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_DISCONNECTING]);
+		return;
+	}
+
+	k_work_reschedule(&mqtt_ctx.probe_work,
+			  K_SECONDS(CONFIG_APP_CUSTOM_MQTT_FAILOVER_PROBE_INTERVAL_SEC));
+}
+#endif /* CONFIG_APP_CUSTOM_MQTT_FAILOVER */
+
+/* Select the broker for a connection attempt. Only called from the I/O thread. */
+static void broker_select(void)
+{
+#if defined(CONFIG_APP_CUSTOM_MQTT_FAILOVER)
+	size_t previous = mqtt_ctx.brokers.active;
+	size_t index;
+
+	mqtt_ctx.connect_start = k_uptime_get();
+	index = mqtt_broker_select(&mqtt_ctx.brokers, mqtt_ctx.connect_start);
+
+	if (index != previous) {
+		LOG_WRN("Switching from broker %s to %s", mqtt_transport_broker_name(previous),
+			mqtt_transport_broker_name(index));
+	}
+
+	(void)mqtt_transport_broker_set(index);
+#endif
+}
+
+/* The connection to the selected broker is up. Only called from the I/O thread. */
+static void broker_connected(void)
+{
+#if defined(CONFIG_APP_CUSTOM_MQTT_FAILOVER)
+	mqtt_broker_connected(&mqtt_ctx.brokers,
+			      (uint32_t)(k_uptime_get() - mqtt_ctx.connect_start));
+
+	if (mqtt_ctx.brokers.active != 0) {
+		k_work_reschedule(&mqtt_ctx.probe_work,
+				  K_SECONDS(CONFIG_APP_CUSTOM_MQTT_FAILOVER_PROBE_INTERVAL_SEC));
+	}
+#endif
+}
+
+/* A connection attempt failed. Only called from the I/O thread.
+ *
+ * Returns true if another broker is tried right away instead of waiting for the backoff.
+ */
+static bool broker_connect_failed(void)
+{
+#if defined(CONFIG_APP_CUSTOM_MQTT_FAILOVER)
+	return mqtt_broker_connect_failed(&mqtt_ctx.brokers, k_uptime_get());
+#else
+	return false;
+#endif
+}
+
+/* A publish was acknowledged or failed. Only called from the I/O thread. */
+static void broker_publish_result(bool ok)
+{
+#if defined(CONFIG_APP_CUSTOM_MQTT_FAILOVER)
+	if (mqtt_broker_publish_result(&mqtt_ctx.brokers, ok, k_uptime_get())) {
+		LOG_WRN("Too many publishes to %s failed",
+			mqtt_transport_broker_name(mqtt_ctx.brokers.active));
+		mqtt_io_signal(MQTT_IO_EVT_BROKER_SWITCH);
+	}
+#else
+	ARG_UNUSED(ok);
+#endif
+}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_ENERGY_ESTIMATE)
+/* Close the radio activity of the previous sampling cycle */
+static void energy_cycle_end(void)
+{
+	struct mqtt_energy_cycle cycle;
+	k_spinlock_key_t key;
+
+	mqtt_energy_cycle_end(&mqtt_ctx.energy, k_uptime_get(), &cycle);
+
+	key = k_spin_lock(&mqtt_ctx.energy_lock);
+	mqtt_ctx.energy_cycle = cycle;
+	k_spin_unlock(&mqtt_ctx.energy_lock, key);
+
+	LOG_INF("Last cycle: %u s, %u radio wakeups, %u ms connected, about %u mJ",
+		cycle.duration_ms / MSEC_PER_SEC, cycle.wakeups, cycle.active_ms,
+		cycle.energy_mj);
+}
+#endif /* CONFIG_APP_CUSTOM_MQTT_ENERGY_ESTIMATE */
+
+/* May be called from any thread */
+static void hist_add(enum custom_mqtt_hist_type type, uint32_t value)
+{
+#if defined(CONFIG_APP_CUSTOM_MQTT_STATS)
+	k_spinlock_key_t key = k_spin_lock(&mqtt_ctx.hist_lock);
+
+	mqtt_hist_add(&mqtt_ctx.hist[type], value);
+
+	k_spin_unlock(&mqtt_ctx.hist_lock, key);
+#else
+	ARG_UNUSED(type);
+	ARG_UNUSED(value);
+#endif
+}
+
+/* Records were published, they waited in the queue or the batch since they were created */
+static void hist_queued(const struct mqtt_record *records, size_t count)
+{
+#if defined(CONFIG_APP_CUSTOM_MQTT_STATS)
+	int64_t now = k_uptime_get();
+	k_spinlock_key_t key = k_spin_lock(&mqtt_ctx.hist_lock);
+
+	for (size_t i = 0; i < count; i++) {
+		mqtt_hist_add(&mqtt_ctx.hist[CUSTOM_MQTT_HIST_QUEUE_MS],
+			      (uint32_t)CLAMP(now - records[i].timestamp, 0, UINT32_MAX));
+	}
+
+	k_spin_unlock(&mqtt_ctx.hist_lock, key);
+#else
+	ARG_UNUSED(records);
+	ARG_UNUSED(count);
+#endif
+}
+
+/* A message was handed to the transport */
+static void hist_published(size_t len, int64_t now)
+{
+#if defined(CONFIG_APP_CUSTOM_MQTT_STATS)
+	k_spinlock_key_t key = k_spin_lock(&mqtt_ctx.hist_lock);
+
+	mqtt_hist_add(&mqtt_ctx.hist[CUSTOM_MQTT_HIST_MSG_BYTES], (uint32_t)len);
+	mqtt_hist_rate_add(&mqtt_ctx.publish_rate, now);
+
+	k_spin_unlock(&mqtt_ctx.hist_lock, key);
+#else
+	ARG_UNUSED(len);
+	ARG_UNUSED(now);
+#endif
+}
+
+int custom_mqtt_hist_get(enum custom_mqtt_hist_type type, struct mqtt_hist *hist)
+{
+#if defined(CONFIG_APP_CUSTOM_MQTT_STATS)
+	k_spinlock_key_t key;
+
+	if ((unsigned int)type >= CUSTOM_MQTT_HIST_COUNT) {
+		return -EINVAL;
+	}
+
+	key = k_spin_lock(&mqtt_ctx.hist_lock);
+
+	if (type == CUSTOM_MQTT_HIST_MSGS_PER_MIN) {
+		mqtt_hist_rate_update(&mqtt_ctx.publish_rate, k_uptime_get());
+		*hist = mqtt_ctx.publish_rate.hist;
+	} else {
+		*hist = mqtt_ctx.hist[type];
+	}
+
+	k_spin_unlock(&mqtt_ctx.hist_lock, key);
+
+	return 0;
+#else
+	ARG_UNUSED(type);
+	ARG_UNUSED(hist);
+
+	return -ENOTSUP;
+#endif
+}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_STATS_HEARTBEAT)
+/* The histograms of the module internals are only shown by the shell */
+BUILD_ASSERT(MQTT_RECORD_STATS_COUNT <= CUSTOM_MQTT_HIST_COUNT,
+	     "The heartbeat carries the first histograms");
+
+static void hist_summary_get(struct mqtt_record_stats *stats)
+{
+	struct mqtt_hist hist;
+
+	for (size_t i = 0; i < MQTT_RECORD_STATS_COUNT; i++) {
+		(void)custom_mqtt_hist_get(i, &hist);
+
+		stats[i].count = hist.count;
+		stats[i].p50 = mqtt_hist_percentile(&hist, 50);
+		stats[i].p90 = mqtt_hist_percentile(&hist, 90);
+		stats[i].max = hist.max;
+	}
+}
+#endif /* CONFIG_APP_CUSTOM_MQTT_STATS_HEARTBEAT */
+
+/* Time without any publish after which a heartbeat is sent, in seconds */
+static uint32_t heartbeat_interval(void)
+{
+#if defined(CONFIG_APP_CUSTOM_MQTT_PSM_AWARE)
+	return mqtt_ctx.sched.heartbeat;
+#else
+	return MQTT_HEARTBEAT_INTERVAL_SEC;
+#endif
+}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_PSM_AWARE)
+/* Every uplink wakes the modem up. A heartbeat is not needed when another message was published
+ * during the interval, it is then postponed until the interval has passed without a publish.
+ */
+static bool heartbeat_postpone(void)
+{
+	int64_t interval_ms = (int64_t)heartbeat_interval() * MSEC_PER_SEC;
+	int64_t quiet_ms = k_uptime_get() - mqtt_ctx.last_publish_time;
+	k_spinlock_key_t key;
+
+	if (mqtt_ctx.last_publish_time == 0 || quiet_ms >= interval_ms) {
+		return false;
+	}
+
+	key = k_spin_lock(&mqtt_ctx.sched_lock);
+	mqtt_ctx.suppressed_heartbeats++;
+	k_spin_unlock(&mqtt_ctx.sched_lock, key);
+
+	LOG_DBG("Published %lld ms ago, heartbeat postponed", quiet_ms);
+
+	k_work_schedule(&mqtt_ctx.data_send_work, K_MSEC(interval_ms - quiet_ms));
+
+	return true;
+}
+
+/* Apply new power saving parameters. Only called from the I/O thread. */
+static void sched_update(void)
+{
+	static const struct mqtt_sched defaults = {
+		.keepalive = CONFIG_APP_CUSTOM_MQTT_KEEPALIVE_SECONDS,
+		.heartbeat = MQTT_HEARTBEAT_INTERVAL_SEC,
+	};
+	struct mqtt_sched_params params;
+	struct mqtt_sched sched;
+	k_spinlock_key_t key;
+	int ret;
+
+	key = k_spin_lock(&mqtt_ctx.sched_lock);
+	params = mqtt_ctx.sched_params;
+	k_spin_unlock(&mqtt_ctx.sched_lock, key);
+
+	mqtt_sched_get(&params, &defaults, CONFIG_APP_CUSTOM_MQTT_PSM_MARGIN_SEC, &sched);
+
+	if (sched.keepalive == mqtt_ctx.sched.keepalive &&
+	    sched.heartbeat == mqtt_ctx.sched.heartbeat) {
+		return;
+	}
+
+	LOG_INF("Keepalive: %u s, heartbeat interval: %u s", sched.keepalive, sched.heartbeat);
+
+	key = k_spin_lock(&mqtt_ctx.sched_lock);
+	mqtt_ctx.sched = sched;
+	k_spin_unlock(&mqtt_ctx.sched_lock, key);
+
+	if (k_work_delayable_is_pending(&mqtt_ctx.data_send_work)) {
+		k_work_reschedule(&mqtt_ctx.data_send_work, K_SECONDS(sched.heartbeat));
+	}
+
+	ret = mqtt_transport_keepalive_set(sched.keepalive);
+	if (ret) {
+		LOG_DBG("Keepalive not changed: %d", ret);
+		return;
+	}
+
+	/* The broker only takes the keepalive from the CONNECT packet. The disconnect ends in
+	 * idle, which connects again right away while the network is up. On-demand sessions are
+	 * short, the next one uses the new keepalive.
+	 */
+	if (!IS_ENABLED(CONFIG_APP_CUSTOM_MQTT_ON_DEMAND) &&
+	    mqtt_ctx.state == MQTT_STATE_CONNECTED &&
+	    sched.keepalive != mqtt_ctx.session_keepalive) {
+		LOG_INF("Reconnecting to apply the new keepalive");
+		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_DISCONNECTING]);
+	}
+}
+#endif /* CONFIG_APP_CUSTOM_MQTT_PSM_AWARE */
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET)
+#define BUDGET_SETTINGS_SUBTREE "custom_mqtt_budget"
+#define BUDGET_SETTINGS_NAME "usage"
+
+#define BUDGET_MSEC_PER_DAY ((int64_t)MSEC_PER_SEC * SEC_PER_HOUR * HOUR_PER_DAY)
+
+#define BUDGET_RATE(_class)								\
+	{										\
+		.rate = CONFIG_APP_CUSTOM_MQTT_BUDGET_##_class##_RATE,			\
+		.burst = CONFIG_APP_CUSTOM_MQTT_BUDGET_##_class##_RATE *		\
+			 CONFIG_APP_CUSTOM_MQTT_BUDGET_BURST_MIN,			\
+	}
+
+static enum mqtt_budget_class record_budget_class(enum mqtt_record_type type)
+{
+	switch (type) {
+	case MQTT_RECORD_ENVIRONMENTAL:
+	case MQTT_RECORD_POWER:
+		return MQTT_BUDGET_TELEMETRY;
+	case MQTT_RECORD_LOCATION:
+		return MQTT_BUDGET_LOCATION;
+	case MQTT_RECORD_UART_SENSOR:
+		return MQTT_BUDGET_PROBE;
+	default:
+		return MQTT_BUDGET_DIAGNOSTICS;
+	}
+}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET_PERSIST)
+static int budget_settings_set(const char *key, size_t len, settings_read_cb read_cb,
+			       void *cb_arg)
+{
+	struct mqtt_budget_usage usage;
+	int ret;
+
+	if (strcmp(key, BUDGET_SETTINGS_NAME) != 0) {
+		return -ENOENT;
+	}
+
+	if (len != sizeof(usage)) {
+		return -EINVAL;
+	}
+
+	ret = read_cb(cb_arg, &usage, sizeof(usage));
+	if (ret < 0) {
+		return ret;
+	}
+
+	k_spinlock_key_t lock_key = k_spin_lock(&mqtt_ctx.budget_lock);
+
+	mqtt_ctx.budget.usage = usage;
+
+	k_spin_unlock(&mqtt_ctx.budget_lock, lock_key);
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(custom_mqtt_budget, BUDGET_SETTINGS_SUBTREE, NULL,
+			       budget_settings_set, NULL, NULL);
+
+static void budget_save(void)
+{
+	struct mqtt_budget_usage usage;
+	int ret;
+
+	k_spinlock_key_t key = k_spin_lock(&mqtt_ctx.budget_lock);
+
+	usage = mqtt_ctx.budget.usage;
+
+	k_spin_unlock(&mqtt_ctx.budget_lock, key);
+
+	ret = settings_save_one(BUDGET_SETTINGS_SUBTREE "/" BUDGET_SETTINGS_NAME, &usage,
+				sizeof(usage));
+	if (ret) {
+		LOG_WRN("Failed to store byte counts: %d", ret);
+	}
+}
+#endif /* CONFIG_APP_CUSTOM_MQTT_BUDGET_PERSIST */
+
+/* Start with full buckets and the byte counts stored before the last reset */
+static void budget_init(void)
+{
+	const struct mqtt_budget_config config = {
+		.rates = {
+			[MQTT_BUDGET_TELEMETRY] = BUDGET_RATE(TELEMETRY),
+			[MQTT_BUDGET_LOCATION] = BUDGET_RATE(LOCATION),
+			[MQTT_BUDGET_PROBE] = BUDGET_RATE(PROBE),
+			[MQTT_BUDGET_DIAGNOSTICS] = BUDGET_RATE(DIAGNOSTICS),
+		},
+		.daily_limit = CONFIG_APP_CUSTOM_MQTT_BUDGET_DAILY_KB * 1024U,
+		.monthly_limit = CONFIG_APP_CUSTOM_MQTT_BUDGET_MONTHLY_KB * 1024U,
+	};
+
+	k_spinlock_key_t key = k_spin_lock(&mqtt_ctx.budget_lock);
+
+	mqtt_budget_init(&mqtt_ctx.budget, &config, k_uptime_get());
+
+	k_spin_unlock(&mqtt_ctx.budget_lock, key);
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET_PERSIST)
+	int ret = settings_subsys_init();
+
+	if (ret) {
+		LOG_WRN("Failed to initialize settings: %d", ret);
+		return;
+	}
+
+	ret = settings_load_subtree(BUDGET_SETTINGS_SUBTREE);
+	if (ret) {
+		LOG_WRN("Failed to load stored byte counts: %d", ret);
+	}
+#endif
+}
+#endif /* CONFIG_APP_CUSTOM_MQTT_BUDGET */
+
+/* Whether a record of this type may be sent now */
+static bool budget_allow(enum mqtt_record_type type)
+{
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET)
+	bool allow;
+
+	k_spinlock_key_t key = k_spin_lock(&mqtt_ctx.budget_lock);
+
+	allow = mqtt_budget_allow(&mqtt_ctx.budget, record_budget_class(type), k_uptime_get());
+
+	k_spin_unlock(&mqtt_ctx.budget_lock, key);
+
+	return allow;
+#else
+	ARG_UNUSED(type);
+	return true;
+#endif
+}
+
+/* Whether a record may be sent within the budget of its class. Otherwise it replaces the record
+ * the class already holds back, which is sent once the budget allows, and diagnostics are
+ * dropped.
+ */
+static bool budget_admit(const struct mqtt_record *record)
+{
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET)
+	enum mqtt_budget_class cls = record_budget_class(record->type);
+
+	if (budget_allow(record->type)) {
+		return true;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&mqtt_ctx.budget_lock);
+
+	mqtt_ctx.budget.limited[cls]++;
+
+	k_spin_unlock(&mqtt_ctx.budget_lock, key);
+
+	if (cls == MQTT_BUDGET_DIAGNOSTICS) {
+		LOG_DBG("Budget exhausted, dropped %s record", record_type_str(record->type));
+		return false;
+	}
+
+	LOG_DBG("Budget exhausted, holding back %s record", record_type_str(record->type));
+
+	mqtt_ctx.budget_held[cls] = *record;
+	mqtt_ctx.budget_held_mask |= BIT(cls);
+
+	return false;
+#else
+	ARG_UNUSED(record);
+	return true;
+#endif
+}
+
+/* Count a published message of @p bytes against the budget of a record type */
+static void budget_spend(enum mqtt_record_type type, uint32_t bytes)
+{
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET)
+	k_spinlock_key_t key = k_spin_lock(&mqtt_ctx.budget_lock);
+
+	mqtt_budget_spend(&mqtt_ctx.budget, record_budget_class(type), bytes, k_uptime_get());
+
+	k_spin_unlock(&mqtt_ctx.budget_lock, key);
+
+	mqtt_ctx.budget_dirty = true;
+#else
+	ARG_UNUSED(type);
+	ARG_UNUSED(bytes);
+#endif
+}
+
+/* Bytes a publish with a payload of @p len takes, with the MQTT framing */
+static uint32_t publish_bytes(size_t len)
+{
+	return len + strlen(MQTT_PUB_TOPIC) + MQTT_PUBLISH_HEADER_SIZE;
+}
+
+/* Queue a heartbeat with low priority. Unless it was requested, it is postponed while other
+ * messages are published.
+ */
+static void heartbeat_send(bool requested)
+{
+	struct mqtt_record record;
+	struct custom_mqtt_stats stats;
+	int ret;
+
+	if (mqtt_ctx.state != MQTT_STATE_CONNECTED) {
+		return;
+	}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_PSM_AWARE)
+	if (!requested && heartbeat_postpone()) {
+		return;
+	}
+#else
+	ARG_UNUSED(requested);
+#endif
+
+	record_init(&record, MQTT_RECORD_HEARTBEAT);
+
+	/* Add diagnostic information */
+	record.heartbeat.uptime_ms = k_uptime_get();
+	record.heartbeat.publish_failures = mqtt_ctx.publish_failures;
+	record.heartbeat.total_publishes = mqtt_ctx.publish_sequence;
+	record.heartbeat.network_connected = mqtt_ctx.network_connected;
+	record.heartbeat.mqtt_state = mqtt_ctx.state;
+
+	custom_mqtt_stats_get(&stats);
+	record.heartbeat.suppressed_records = stats.suppressed_environmental +
+					      stats.suppressed_power;
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_STATS_HEARTBEAT)
+	hist_summary_get(record.heartbeat.stats);
+#endif
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET)
+	record.heartbeat.daily_bytes = stats.budget.daily_bytes;
+	record.heartbeat.monthly_bytes = stats.budget.monthly_bytes;
+
+	for (size_t i = 0; i < MQTT_BUDGET_CLASS_COUNT; i++) {
+		record.heartbeat.budget_limited += stats.budget_limited[i];
+	}
+#endif
+
+	ret = record_submit(&record);
+	if (ret == 0) {
+		LOG_INF("Heartbeat message queued (seq: %u, failures: %u)",
+			mqtt_ctx.publish_sequence, mqtt_ctx.publish_failures);
+	}
+
+	/* Schedule next heartbeat */
+	k_work_schedule(&mqtt_ctx.data_send_work, K_SECONDS(heartbeat_interval()));
+}
+
+/* Only called from the I/O thread, which owns the MQTT socket */
+static int mqtt_publish_data(const char *data, size_t len)
+{
+	uint16_t message_id;
+	int ret;
+
+	if (!data || len == 0) {
+		LOG_ERR("Invalid data parameters");
+		return -EINVAL;
+	}
+
+	if (mqtt_ctx.state != MQTT_STATE_CONNECTED) {
+		LOG_WRN("MQTT not connected, cannot publish");
+		return -ENOTCONN;
+	}
+
+	/* Callers keep the message and try again after the next PUBACK */
+	if (mqtt_inflight_full(&mqtt_ctx.inflight)) {
+		LOG_DBG("In-flight window full, publish deferred");
+		return -EBUSY;
+	}
+
+	message_id = mqtt_inflight_next_id(&mqtt_ctx.inflight);
+
+	mqtt_ctx.publish_sequence++;
+
+	LOG_DBG("Publishing %zu bytes to topic %s (seq: %u, message_id: %u)", len, MQTT_PUB_TOPIC,
+		mqtt_ctx.publish_sequence, message_id);
+
+	ret = mqtt_transport_publish(message_id, false, (const uint8_t *)data, len);
+
+	if (ret == 0) {
+		io_activity(k_uptime_get());
+		hist_published(len, k_uptime_get());
+#if defined(CONFIG_APP_CUSTOM_MQTT_PSM_AWARE)
+		mqtt_ctx.last_publish_time = k_uptime_get();
+#endif
+	}
+
+	if (ret) {
+		mqtt_ctx.publish_failures++;
+		LOG_ERR("Failed to publish data: %d (failures: %u)", ret, mqtt_ctx.publish_failures);
+		broker_publish_result(false);
+	} else if (!mqtt_transport_reports_acks()) {
+		/* The transport retransmits on its own and does not report PUBACKs */
+	} else if (mqtt_inflight_add(&mqtt_ctx.inflight, message_id,
+				     (const uint8_t *)data, len, k_uptime_get())) {
+		LOG_WRN("Message %u too large to be resent, not tracked", message_id);
+	}
+
+	return ret;
+}
+
+/* Send all unacknowledged publishes again with the DUP flag, oldest first */
+static void inflight_resend(void)
+{
+	struct mqtt_inflight_entry *entry;
+	size_t i;
+	int ret;
+
+	for (i = 0; (entry = mqtt_inflight_get(&mqtt_ctx.inflight, i)) != NULL; i++) {
+		ret = mqtt_transport_publish(entry->message_id, true, entry->payload, entry->len);
+		if (ret) {
+			LOG_ERR("Failed to resend message %u: %d", entry->message_id, ret);
+			break;
+		}
+
+		entry->resends++;
+	}
+
+	if (i > 0) {
+		LOG_INF("Resent %zu unacknowledged messages", i);
+	}
+}
+
+/* Data validation and helper functions */
+static bool validate_sensor_data(double value, double min, double max)
+{
+	if (!isfinite(value)) {
+		LOG_WRN("Invalid sensor value: not finite");
+		return false;
+	}
+	
+	if (value < min || value > max) {
+		LOG_WRN("Sensor value %.2f out of range [%.2f, %.2f]", value, min, max);
+		return false;
+	}
+	
+	return true;
+}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_JSON_VALIDATE)
+/* Debug only: the JSON writer guarantees well-formed output, so a full re-parse of every
+ * uplink only doubles heap usage and CPU time. Kept to cross-check the encoder.
+ */
+static bool validate_json_string(const char *json_str)
+{
+	if (!json_str) {
+		return false;
+	}
+	
+	/* Basic validation - check if it's a valid JSON */
+	cJSON *test = cJSON_Parse(json_str);
+	if (!test) {
+		LOG_ERR("Invalid JSON string");
+		return false;
+	}
+	
+	cJSON_Delete(test);
+	return true;
+}
+#endif /* CONFIG_APP_CUSTOM_MQTT_JSON_VALIDATE */
+
+static const char *record_type_str(enum mqtt_record_type type)
+{
+	switch (type) {
+	case MQTT_RECORD_ENVIRONMENTAL:
+		return "environmental";
+	case MQTT_RECORD_POWER:
+		return "power";
+	case MQTT_RECORD_LOCATION:
+		return "location";
+	case MQTT_RECORD_UART_SENSOR:
+		return "uart_sensor";
+	case MQTT_RECORD_HEARTBEAT:
+		return "heartbeat";
+	case MQTT_RECORD_STATUS:
+		return "status";
+	case MQTT_RECORD_ACK:
+		return "ack";
+	default:
+		return "unknown";
+	}
+}
+
+/* Priority class of a record. There is no alarm record yet, location is the most urgent. The
+ * status message goes ahead of the telemetry that queued up while the connection was down.
+ */
+static enum custom_mqtt_prio record_prio(enum mqtt_record_type type)
+{
+	switch (type) {
+	case MQTT_RECORD_LOCATION:
+	case MQTT_RECORD_STATUS:
+		return CUSTOM_MQTT_PRIO_HIGH;
+	case MQTT_RECORD_HEARTBEAT:
+		return CUSTOM_MQTT_PRIO_LOW;
+	default:
+		return CUSTOM_MQTT_PRIO_NORMAL;
+	}
+}
+
+/* Date a record of this boot that was created before the time was known. Its UNIX time is
+ * derived from the uptime it was created at, once date_time has a valid time.
+ */
+static void record_time_set(struct mqtt_record *record)
+{
+	int64_t now;
+
+	if (record->time != 0 || date_time_now(&now)) {
+		return;
+	}
+
+	record->time = now - (k_uptime_get() - record->timestamp);
+}
+
+/* Initialize an uplink record with the fields common to all message types */
+static void record_init(struct mqtt_record *record, enum mqtt_record_type type)
+{
+	memset(record, 0, sizeof(*record));
+
+	record->type = type;
+	record->timestamp = k_uptime_get();
+	record_time_set(record);
+}
+
+/* Hand a record over to the I/O thread through the ring of its priority class. Only the I/O
+ * thread removes records from the rings, so a record that does not fit is dropped instead of
+ * the oldest one.
+ */
+static int record_submit(const struct mqtt_record *record)
+{
+	enum custom_mqtt_prio prio = record_prio(record->type);
+	struct mqtt_ring *ring = record_rings[prio];
+	uint32_t start = k_cycle_get_32();
+	int ret;
+
+	ret = mqtt_ring_put(ring, record);
+
+	hist_add(CUSTOM_MQTT_HIST_SUBMIT_US, k_cyc_to_us_floor32(k_cycle_get_32() - start));
+
+	if (ret) {
+		LOG_WRN("Record queue full, dropped %s record (%u dropped)",
+			record_type_str(record->type), (uint32_t)atomic_get(&ring->dropped));
+		return ret;
+	}
+
+	/* Wake up the I/O thread */
+	if (prio == CUSTOM_MQTT_PRIO_HIGH) {
+		mqtt_io_signal(MQTT_IO_EVT_URGENT);
+	} else {
+		(void)eventfd_write(mqtt_ctx.wake_fd, 1);
+	}
+
+	return 0;
+}
+
+/* Encode a record into the payload buffer and publish it. Only called from the I/O thread,
+ * which owns the payload buffer.
+ */
+static int safe_publish_record(struct mqtt_record *record)
+{
+	int ret;
+	int len;
+	const char *data_type = record_type_str(record->type);
+
+	if (mqtt_ctx.state != MQTT_STATE_CONNECTED) {
+		LOG_WRN("MQTT not connected, cannot publish %s data", data_type);
+		return -ENOTCONN;
+	}
+
+	/* Sequence numbers are assigned in publish order */
+	record->sequence = mqtt_ctx.publish_sequence + 1;
+
+	len = mqtt_codec_encode(record, mqtt_ctx.payload_buf, sizeof(mqtt_ctx.payload_buf));
+
+	/* The encoder validates structure and values while encoding, any error is reported here.
+	 * -ENOMEM means the message did not fit in the payload buffer, -EINVAL that a value could
+	 * not be represented.
+	 */
+	if (len < 0) {
+		LOG_ERR("Failed to encode %s data: %d", data_type, len);
+		return len;
+	}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_JSON_VALIDATE)
+	if (!validate_json_string((const char *)mqtt_ctx.payload_buf)) {
+		LOG_ERR("JSON validation failed for %s data", data_type);
+		return -EINVAL;
+	}
+#endif /* CONFIG_APP_CUSTOM_MQTT_JSON_VALIDATE */
+
+	ret = mqtt_publish_data((const char *)mqtt_ctx.payload_buf, len);
+	if (ret == 0) {
+		LOG_DBG("Successfully published %s data", data_type);
+		budget_spend(record->type, publish_bytes(len));
+	} else {
+		LOG_ERR("Failed to publish %s data: %d", data_type, ret);
+	}
+
+	return ret;
+}
+
+/* State machine implementations */
+static void idle_entry(void *obj)
+{
+	LOG_DBG("Entering MQTT idle state");
+	mqtt_ctx.state = MQTT_STATE_IDLE;
+}
+
+static void idle_run(void *obj)
+{
+	/* In on-demand mode sessions are opened by mqtt_io_on_demand() */
+	if (IS_ENABLED(CONFIG_APP_CUSTOM_MQTT_ON_DEMAND)) {
+		return;
+	}
+
+	/* Check network status and attempt connection */
+	if (mqtt_ctx.network_connected) {
+		LOG_INF("Network available, transitioning to connecting state");
+		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_CONNECTING]);
+	} else {
+		LOG_DBG("Waiting for network connection");
+	}
+}
+
+static void connecting_entry(void *obj)
+{
+	LOG_INF("Entering MQTT connecting state");
+	mqtt_ctx.state = MQTT_STATE_CONNECTING;
+
+	io_activity(k_uptime_get());
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_ON_DEMAND)
+	mqtt_ctx.session.start = k_uptime_get();
+#endif
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_PSM_AWARE)
+	mqtt_ctx.session_keepalive = mqtt_ctx.sched.keepalive;
+#endif
+
+	broker_select();
+	
+	int ret = mqtt_transport_connect();
+	if (ret != 0) {
+		LOG_ERR("MQTT connection failed with error: %d", ret);
+		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_ERROR]);
+	} else {
+		LOG_INF("MQTT connection initiated, waiting for response");
+	}
+}
+
+static void connecting_run(void *obj)
+{
+	/* Poll MQTT client for events - this is crucial for processing CONNACK */
+	int ret = mqtt_transport_input();
+	if (ret) {
+		LOG_ERR("MQTT input error during connection: %d", ret);
+		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_ERROR]);
+	}
+}
+
+static void connected_entry(void *obj)
+{
+	LOG_INF("Entering MQTT connected state");
+	mqtt_ctx.state = MQTT_STATE_CONNECTED;
+
+	/* Messages that were not acknowledged before the connection was lost */
+	inflight_resend();
+}
+
+static void connected_exit(void *obj)
+{
+	(void)mqtt_sub_cancel(&mqtt_ctx.sub);
+	k_work_cancel_delayable(&mqtt_ctx.suback_timeout_work);
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_FAILOVER)
+	k_work_cancel_delayable(&mqtt_ctx.probe_work);
+#endif
+}
+
+/* Uplink records are published while the subscription is pending, only the status message
+ * waits for the SUBACK.
+ */
+static void subscribing_entry(void *obj)
+{
+	LOG_DBG("Entering MQTT subscribing state");
+
+	/* Packet identifiers are shared with publishes that are still in flight */
+	mqtt_sub_start(&mqtt_ctx.sub, mqtt_inflight_next_id(&mqtt_ctx.inflight));
+
+	int ret = mqtt_transport_subscribe(mqtt_ctx.sub.message_id);
+	if (ret) {
+		LOG_ERR("Failed to subscribe to topic: %d", ret);
+		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_ERROR]);
+		return;
+	}
+
+	LOG_INF("Subscribing to topic: %s", MQTT_SUB_TOPIC);
+
+	/* The MQTT-SN library does not report SUBACK, it retries the subscription on its own */
+	if (!mqtt_transport_reports_acks()) {
+		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_READY]);
+		return;
+	}
+
+	atomic_clear_bit(&mqtt_ctx.io_events, MQTT_IO_EVT_SUBACK_TIMEOUT);
+	k_work_schedule(&mqtt_ctx.suback_timeout_work, K_SECONDS(MQTT_SUBACK_TIMEOUT_SEC));
+}
+
+static void ready_entry(void *obj)
+{
+	struct mqtt_record record;
+
+	LOG_INF("Entering MQTT ready state");
+
+	(void)mqtt_sub_cancel(&mqtt_ctx.sub);
+	k_work_cancel_delayable(&mqtt_ctx.suback_timeout_work);
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_ON_DEMAND)
+	/* Sessions only carry the data of a sampling cycle. The status message is sent once after
+	 * boot, and the cycles themselves show that the device is alive.
+	 */
+	if (mqtt_ctx.sessions++ > 0) {
+		return;
+	}
+#endif
+
+	/* Queue the initial connection message. The in-flight window may still be full with the
+	 * messages resent on connect, the message is then published once a PUBACK frees it up.
+	 */
+	record_init(&record, MQTT_RECORD_STATUS);
+
+	if (record_submit(&record) == 0) {
+		LOG_INF("Initial connection message queued");
+	}
+
+	if (IS_ENABLED(CONFIG_APP_CUSTOM_MQTT_ON_DEMAND)) {
+		return;
+	}
+
+	/* Start periodic data sending */
+	k_work_schedule(&mqtt_ctx.data_send_work, K_SECONDS(10));
+}
+
+static void connected_run(void *obj)
+{
+	/* Process incoming data and maintain the connection */
+	int ret = mqtt_transport_input();
+	if (ret) {
+		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_ERROR]);
+		return;
+	}
+	
+	if (!mqtt_ctx.network_connected) {
+		LOG_INF("Network disconnected, transitioning to disconnecting state");
+		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_DISCONNECTING]);
+	}
+}
+
+static void disconnecting_entry(void *obj)
+{
+	LOG_DBG("Entering MQTT disconnecting state");
+	mqtt_ctx.state = MQTT_STATE_DISCONNECTING;
+
+	io_activity(k_uptime_get());
+
+	/* If the DISCONNECT packet cannot be sent, close the socket to reach idle anyway */
+	if (mqtt_transport_disconnect()) {
+		mqtt_transport_abort();
+	}
+}
+
+static void disconnecting_run(void *obj)
+{
+	/* State transition handled in MQTT event handler */
+}
+
+static void error_entry(void *obj)
+{
+	bool connect_failed = (mqtt_ctx.state == MQTT_STATE_CONNECTING);
+
+	LOG_DBG("Entering MQTT error state");
+	mqtt_ctx.state = MQTT_STATE_ERROR;
+
+	/* Make sure the socket is closed before the next connection attempt */
+	mqtt_transport_abort();
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_STATS)
+	/* Reconnects are timed from the first failure, retries are part of them */
+	if (mqtt_ctx.down_since == 0) {
+		mqtt_ctx.down_since = k_uptime_get();
+	}
+#endif
+
+	/* Cancel any pending work */
+	k_work_cancel_delayable(&mqtt_ctx.data_send_work);
+
+	if (connect_failed && broker_connect_failed()) {
+		LOG_WRN("MQTT error state, trying the next broker");
+		k_work_schedule(&mqtt_ctx.connect_work, K_NO_WAIT);
+		return;
+	}
+	
+	/* Reset failure counters for exponential backoff */
+	static uint32_t reconnect_delay = MQTT_RECONNECT_BASE_DELAY_SEC;
+	
+	if (mqtt_ctx.publish_failures > MQTT_MAX_PUBLISH_FAILURES) {
+		/* Exponential backoff for repeated failures */
+		reconnect_delay = MIN(reconnect_delay * 2, MQTT_RECONNECT_MAX_DELAY_SEC);
+	} else {
+		reconnect_delay = MQTT_RECONNECT_BASE_DELAY_SEC; /* Reset on success */
+	}
+	
+	LOG_WRN("MQTT error state, will retry connection in %u seconds", reconnect_delay);
+	
+	/* Schedule reconnection attempt */
+	k_work_schedule(&mqtt_ctx.connect_work, K_SECONDS(reconnect_delay));
+}
+
+static void error_run(void *obj)
+{
+	/* Wait for reconnection attempt */
+}
+
+/* Message processing functions */
+#if defined(CONFIG_APP_LOCATION)
+static void process_location_data(const struct location_msg *msg)
+{
+	struct mqtt_record record;
+
+	if (msg->type != LOCATION_GNSS_DATA) {
+		return;
+	}
+
+	/* Validate location data */
+	if (msg->gnss_data.latitude < -90.0 || msg->gnss_data.latitude > 90.0 ||
+	    msg->gnss_data.longitude < -180.0 || msg->gnss_data.longitude > 180.0) {
+		LOG_WRN("Invalid GPS coordinates: lat=%.6f, lng=%.6f, skipping",
+			msg->gnss_data.latitude, msg->gnss_data.longitude);
+		return;
+	}
+
+	if (msg->gnss_data.accuracy > MQTT_GPS_ACCURACY_MAX_METERS) {
+		LOG_WRN("GPS accuracy too low: %.2f m, skipping", msg->gnss_data.accuracy);
+		return;
+	}
+
+	record_init(&record, MQTT_RECORD_LOCATION);
+
+	/* Add location data */
+	record.location.latitude = msg->gnss_data.latitude;
+	record.location.longitude = msg->gnss_data.longitude;
+	record.location.accuracy = msg->gnss_data.accuracy;
+
+	int ret = record_submit(&record);
+	if (ret == 0) {
+		LOG_INF("Location data queued: lat=%.6f, lng=%.6f, acc=%.2f",
+			msg->gnss_data.latitude, msg->gnss_data.longitude,
+			msg->gnss_data.accuracy);
+	}
+}
+#endif
+
+#if defined(CONFIG_APP_ENVIRONMENTAL)
+static void process_environmental_data(const struct environmental_msg *msg)
+{
+	if (msg->type != ENVIRONMENTAL_SENSOR_SAMPLE_RESPONSE) {
+		return;
+	}
+
+	/* Enhanced validation using helper functions */
+	if (!validate_sensor_data(msg->temperature, MQTT_TEMP_MIN_CELSIUS, MQTT_TEMP_MAX_CELSIUS)) {
+		return;
+	}
+	
+	if (!validate_sensor_data(msg->humidity, MQTT_HUMIDITY_MIN_PERCENT, MQTT_HUMIDITY_MAX_PERCENT)) {
+		return;
+	}
+
+	if (!validate_sensor_data(msg->pressure, MQTT_PRESSURE_MIN_PA, MQTT_PRESSURE_MAX_PA)) {
+		return;
+	}
+	
+	struct mqtt_record record;
+
+	record_init(&record, MQTT_RECORD_ENVIRONMENTAL);
+
+	/* Precision is limited by the encoder to reduce noise */
+	record.environmental.temperature = msg->temperature;
+	record.environmental.humidity = msg->humidity;
+	record.environmental.pressure = msg->pressure;
+
+#if defined(CONFIG_APP_ENVIRONMENTAL_TIMESTAMP)
+	record.environmental.sample_time = MAX(msg->timestamp, 0);
+#endif
+
+	int ret = record_submit(&record);
+	if (ret == 0) {
+		LOG_INF("Environmental data queued: T=%.2f°C, H=%.2f%%, P=%.1fPa",
+			msg->temperature, msg->humidity, msg->pressure);
+	}
+}
+#endif
+
+#if defined(CONFIG_APP_POWER)
+static void process_power_data(const struct power_msg *msg)
+{
+	if (msg->type != POWER_BATTERY_PERCENTAGE_SAMPLE_RESPONSE) {
+		return;
+	}
+
+	/* Validate power data using helper function */
+	if (!validate_sensor_data(msg->percentage, MQTT_BATTERY_MIN_PERCENT, MQTT_BATTERY_MAX_PERCENT)) {
+		return;
+	}
+	
+	struct mqtt_record record;
+
+	record_init(&record, MQTT_RECORD_POWER);
+
+	/* Add comprehensive power data */
+	record.power.percentage = msg->percentage;
+	record.power.voltage = msg->voltage;
+	record.power.current_ma = msg->current_ma;
+	record.power.temperature = msg->temperature;
+
+#if defined(CONFIG_APP_POWER_TIMESTAMP)
+	record.power.sample_time = MAX(msg->timestamp, 0);
+#endif
+
+	int ret = record_submit(&record);
+	if (ret == 0) {
+		LOG_INF("Power data queued: %.1f%%, %.3fV, %.1fmA, %.1f°C",
+			msg->percentage, msg->voltage, msg->current_ma, msg->temperature);
+	}
+}
+#endif
+
+#if defined(CONFIG_APP_UART_SENSOR)
+static void process_uart_sensor_data(const struct uart_sensor_msg *msg)
+{
+	struct mqtt_record record;
+
+	if (!msg) {
+		LOG_ERR("Invalid UART sensor message");
+		return;
+	}
+	
+	/* Validate sensor data ranges */
+	if (!SENSOR_VALUE_IN_RANGE(msg->temperature, UART_SENSOR_TEMP_MIN, UART_SENSOR_TEMP_MAX)) {
+		LOG_WRN("Temperature %.2f out of range [%.2f, %.2f]", 
+			msg->temperature, UART_SENSOR_TEMP_MIN, UART_SENSOR_TEMP_MAX);
+	}
+	
+	if (!SENSOR_VALUE_IN_RANGE(msg->humidity, UART_SENSOR_HUMIDITY_MIN, UART_SENSOR_HUMIDITY_MAX)) {
+		LOG_WRN("Humidity %.2f out of range [%.2f, %.2f]", 
+			msg->humidity, UART_SENSOR_HUMIDITY_MIN, UART_SENSOR_HUMIDITY_MAX);
+	}
+	
+	if (!SENSOR_VALUE_IN_RANGE(msg->probe_battery, UART_SENSOR_BATTERY_MIN, UART_SENSOR_BATTERY_MAX)) {
+		LOG_WRN("Probe battery %.2f out of range [%.2f, %.2f]", 
+			msg->probe_battery, UART_SENSOR_BATTERY_MIN, UART_SENSOR_BATTERY_MAX);
+	}
+	
+	record_init(&record, MQTT_RECORD_UART_SENSOR);
+
+	/* Add UART sensor data, precision is limited by the encoder */
+	record.uart_sensor.temperature = msg->temperature;
+	record.uart_sensor.humidity = msg->humidity;
+	strncpy(record.uart_sensor.probe_id, msg->probe_id,
+		sizeof(record.uart_sensor.probe_id) - 1);
+	record.uart_sensor.probe_battery = msg->probe_battery;
+
+#if defined(CONFIG_APP_UART_SENSOR_TIMESTAMP)
+	record.uart_sensor.sample_time = MAX(msg->timestamp, 0);
+#endif
+
+	int ret = record_submit(&record);
+	if (ret == 0) {
+		LOG_INF("UART sensor data queued: %s, T=%.1f°C, H=%.1f%%, Bat=%.1f%%",
+			msg->probe_id, msg->temperature, msg->humidity, msg->probe_battery);
+	}
+}
+#endif
+
+#if defined(CONFIG_APP_BUTTON) && defined(MQTT_BUTTON_POWER_MEASUREMENT_ENABLED)
+static void process_button_msg(const struct button_msg *msg)
+{
+	LOG_INF("Button %d %s detected", msg->button_number, 
+		msg->type == BUTTON_PRESS_SHORT ? "short press" : "long press");
+	
+	/* Only handle button 1 short press for power measurement trigger */
+	if (msg->button_number == 1 && msg->type == BUTTON_PRESS_SHORT) {
+		LOG_INF("Requesting power measurement via button press");
+		
+		/* Request power measurement directly */
+		int ret = power_sample_request();
+		if (ret != 0) {
+			LOG_ERR("Failed to request power measurement: %d", ret);
+			return;
+		}
+		
+		/* Get the power data and publish it */
+		struct power_msg power_data;
+		ret = power_get_current_data(&power_data);
+		if (ret == 0) {
+			process_power_data(&power_data);
+			LOG_INF("Button-triggered power data queued: %.1f%%", power_data.percentage);
+		} else {
+			LOG_ERR("Failed to get power data: %d", ret);
+		}
+
+#if defined(CONFIG_APP_UART_SENSOR)
+		/* Also trigger UART sensor data generation */
+		LOG_INF("Requesting UART sensor data via button press");
+		ret = uart_sensor_sample_request();
+		if (ret == -ENODATA) {
+			LOG_INF("No fresh UART sensor data available - skipping");
+		} else if (ret != 0) {
+			LOG_ERR("Failed to request UART sensor data: %d", ret);
+		} else {
+			LOG_INF("UART sensor data published successfully");
+		}
+#endif
+	}
+}
+#endif
+
+static void process_network_msg(const struct network_msg *msg)
+{
+	switch (msg->type) {
+	case NETWORK_CONNECTED:
+		LOG_INF("Network connected");
+		mqtt_ctx.network_connected = true;
+		mqtt_io_signal(MQTT_IO_EVT_NETWORK);
+		break;
+		
+	case NETWORK_DISCONNECTED:
+		LOG_INF("Network disconnected");
+		mqtt_ctx.network_connected = false;
+		mqtt_io_signal(MQTT_IO_EVT_NETWORK);
+		break;
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_PSM_AWARE) && defined(CONFIG_LTE_LC_PSM_MODULE)
+	case NETWORK_PSM_PARAMS: {
+		k_spinlock_key_t key = k_spin_lock(&mqtt_ctx.sched_lock);
+
+		mqtt_ctx.sched_params.tau = msg->psm_cfg.tau;
+		mqtt_ctx.sched_params.active_time = msg->psm_cfg.active_time;
+
+		k_spin_unlock(&mqtt_ctx.sched_lock, key);
+
+		LOG_INF("PSM parameters: TAU %d s, active time %d s", msg->psm_cfg.tau,
+			msg->psm_cfg.active_time);
+		mqtt_io_signal(MQTT_IO_EVT_POWER_SAVING);
+		break;
+	}
+#endif
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_PSM_AWARE) && defined(CONFIG_LTE_LC_EDRX_MODULE)
+	case NETWORK_EDRX_PARAMS: {
+		k_spinlock_key_t key = k_spin_lock(&mqtt_ctx.sched_lock);
+
+		mqtt_ctx.sched_params.edrx = (msg->edrx_cfg.mode == LTE_LC_LTE_MODE_NONE) ?
+					     0.0f : msg->edrx_cfg.edrx;
+
+		k_spin_unlock(&mqtt_ctx.sched_lock, key);
+
+		LOG_INF("eDRX parameters: mode %d, cycle %.2f s", msg->edrx_cfg.mode,
+			(double)msg->edrx_cfg.edrx);
+		mqtt_io_signal(MQTT_IO_EVT_POWER_SAVING);
+		break;
+	}
+#endif
+
+	default:
+		break;
+	}
+}
+
+/* Signal an event to the I/O thread and wake it up from poll() */
+static void mqtt_io_signal(enum mqtt_io_event event)
+{
+	atomic_set_bit(&mqtt_ctx.io_events, event);
+	(void)eventfd_write(mqtt_ctx.wake_fd, 1);
+}
+
+/* The transport has events queued from another thread, they are delivered from
+ * mqtt_transport_input() when the state machine runs.
+ */
+static void transport_wake_handler(void)
+{
+	mqtt_io_signal(MQTT_IO_EVT_TRANSPORT);
+}
+
+/* Socket to poll, or -1 if the client has no open connection */
+static int mqtt_socket_fd(void)
+{
+	if (mqtt_ctx.state != MQTT_STATE_CONNECTING && mqtt_ctx.state != MQTT_STATE_CONNECTED) {
+		return -1;
+	}
+
+	return mqtt_transport_socket();
+}
+
+static void mqtt_io_handle_events(void)
+{
+	if (atomic_test_and_clear_bit(&mqtt_ctx.io_events, MQTT_IO_EVT_NETWORK)) {
+		if (!mqtt_ctx.network_connected && mqtt_ctx.state == MQTT_STATE_CONNECTED) {
+			LOG_INF("Network disconnected, transitioning to disconnecting state");
+			smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_DISCONNECTING]);
+		}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_ON_DEMAND)
+		/* Between sessions there is no connection to lose, report it anyway */
+		if (!mqtt_ctx.network_connected && mqtt_ctx.state == MQTT_STATE_IDLE) {
+			connection_announce(false);
+		}
+#endif
+	}
+
+	if (atomic_test_and_clear_bit(&mqtt_ctx.io_events, MQTT_IO_EVT_CONNECT)) {
+		if (mqtt_ctx.state == MQTT_STATE_IDLE || mqtt_ctx.state == MQTT_STATE_ERROR) {
+			LOG_INF("Connection work triggered, attempting MQTT connection");
+			/* Try to connect regardless of network_connected flag */
+			smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_CONNECTING]);
+		} else {
+			LOG_DBG("Connection work triggered but MQTT busy (%d)", mqtt_ctx.state);
+		}
+	}
+
+	if (atomic_test_and_clear_bit(&mqtt_ctx.io_events, MQTT_IO_EVT_SUBACK_TIMEOUT)) {
+		/* Uplink works without the subscription, downlink commands may be missing */
+		if (mqtt_sub_cancel(&mqtt_ctx.sub)) {
+			LOG_WRN("No SUBACK within %d seconds, continuing without it",
+				MQTT_SUBACK_TIMEOUT_SEC);
+			smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_READY]);
+		}
+	}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_PSM_AWARE)
+	if (atomic_test_and_clear_bit(&mqtt_ctx.io_events, MQTT_IO_EVT_POWER_SAVING)) {
+		sched_update();
+	}
+#endif
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_FAILOVER)
+	if (atomic_test_and_clear_bit(&mqtt_ctx.io_events, MQTT_IO_EVT_BROKER_PROBE)) {
+		broker_probe();
+	}
+
+	if (atomic_test_and_clear_bit(&mqtt_ctx.io_events, MQTT_IO_EVT_BROKER_PROBE_DONE)) {
+		broker_probe_done();
+	}
+
+	/* Disconnecting ends in idle, from where the next broker is connected to */
+	if (atomic_test_and_clear_bit(&mqtt_ctx.io_events, MQTT_IO_EVT_BROKER_SWITCH) &&
+	    mqtt_ctx.state == MQTT_STATE_CONNECTED) {
+		LOG_INF("Moving the connection to another broker");
+		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_DISCONNECTING]);
+	}
+#endif
+
+	if (atomic_test_and_clear_bit(&mqtt_ctx.io_events, MQTT_IO_EVT_URGENT) &&
+	    mqtt_ctx.state == MQTT_STATE_ERROR) {
+		LOG_INF("High priority record queued, reconnecting now");
+		k_work_reschedule(&mqtt_ctx.connect_work, K_NO_WAIT);
+	}
+
+	if (atomic_test_and_clear_bit(&mqtt_ctx.io_events, MQTT_IO_EVT_HEARTBEAT_NOW)) {
+		atomic_clear_bit(&mqtt_ctx.io_events, MQTT_IO_EVT_HEARTBEAT);
+		heartbeat_send(true);
+	}
+
+	if (atomic_test_and_clear_bit(&mqtt_ctx.io_events, MQTT_IO_EVT_HEARTBEAT)) {
+		heartbeat_send(false);
+	}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_BATCH)
+	if (atomic_test_and_clear_bit(&mqtt_ctx.io_events, MQTT_IO_EVT_CYCLE_START)) {
+		LOG_DBG("Sampling cycle started");
+#if defined(CONFIG_APP_CUSTOM_MQTT_ENERGY_ESTIMATE)
+		energy_cycle_end();
+#endif
+		mqtt_batch_cycle_start(&mqtt_ctx.batch);
+	}
+#endif
+
+	/* Handled by the state machine, which always calls into the transport */
+	atomic_clear_bit(&mqtt_ctx.io_events, MQTT_IO_EVT_TRANSPORT);
+}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_STORE)
+/* Wall clock time for the store TTL, 0 if not known yet */
+static int64_t store_time_now(void)
 {
-	LOG_INF("Entering MQTT connected state");
-	mqtt_ctx.state = MQTT_STATE_CONNECTED;
-	
-	/* Subscribe to command topic */
-	struct mqtt_subscription_list subscription_list;
-	struct mqtt_topic subscribe_topic;
-	
-	subscribe_topic.topic.utf8 = MQTT_SUB_TOPIC;
-	subscribe_topic.topic.size = strlen(MQTT_SUB_TOPIC);
-	subscribe_topic.qos = MQTT_QOS_1_AT_LEAST_ONCE;
-	
-	subscription_list.list = &subscribe_topic;
-	subscription_list.list_count = 1;
-	subscription_list.message_id = 1;
-	
-	int ret = mqtt_subscribe(&mqtt_ctx.client, &subscription_list);
-	if (ret) {
-		LOG_ERR("Failed to subscribe to topic: %d", ret);
-	} else {
-		LOG_INF("Subscribed to topic: %s", MQTT_SUB_TOPIC);
+	int64_t now;
+
+	if (date_time_now(&now)) {
+		return 0;
 	}
-	
-	/* Send initial connection message */
-	k_sleep(K_MSEC(1000)); /* Give subscription time to complete */
-	
-	cJSON *json = cJSON_CreateObject();
-	if (json) {
-		cJSON_AddStringToObject(json, "device_id", MQTT_CLIENT_ID);
-		cJSON_AddStringToObject(json, "status", "connected");
-		cJSON_AddNumberToObject(json, "timestamp", k_uptime_get());
-		cJSON_AddStringToObject(json, "message", "Device connected to MQTT broker");
-		
-		char *json_string = cJSON_Print(json);
-		if (json_string) {
-			ret = mqtt_publish_data(json_string, strlen(json_string));
-			if (ret == 0) {
-				LOG_INF("Initial connection message sent");
-			} else {
-				LOG_ERR("Failed to send initial message: %d", ret);
-			}
-			cJSON_free(json_string);
-		}
-		cJSON_Delete(json);
+
+	return now;
+}
+
+/* Records are dated before they are stored, their uptime means nothing after a reboot.
+ * A stored record is sent later, so it becomes the dead-band reference.
+ */
+static int store_record(struct mqtt_record *record)
+{
+	int ret;
+
+	record_time_set(record);
+
+	ret = mqtt_store_put(record, store_time_now());
+	if (ret) {
+		LOG_ERR("Failed to store %s record: %d", record_type_str(record->type), ret);
+		return ret;
 	}
-	
-	/* Start periodic data sending */
-	k_work_schedule(&mqtt_ctx.data_send_work, K_SECONDS(10));
+
+	LOG_DBG("Stored %s record, %u pending", record_type_str(record->type), mqtt_store_count());
+	record_sent(record);
+
+	return 0;
 }
 
-static void connected_run(void *obj)
+/* Publish the oldest stored record, at most one per replay interval */
+static void mqtt_io_replay_stored(void)
 {
-	/* Poll MQTT client for events */
-	int ret = mqtt_input(&mqtt_ctx.client);
-	if (ret < 0 && ret != -EAGAIN) {
-		LOG_ERR("MQTT input error: %d", ret);
-		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_ERROR]);
+	struct mqtt_record record;
+	int ret;
+
+	if (!mqtt_ctx.store_ready || mqtt_ctx.state != MQTT_STATE_CONNECTED ||
+	    mqtt_inflight_full(&mqtt_ctx.inflight) ||
+	    mqtt_store_count() == 0 || k_uptime_get() < mqtt_ctx.replay_time) {
 		return;
 	}
-	
-	/* Maintain MQTT connection */
-	ret = mqtt_live(&mqtt_ctx.client);
-	if (ret < 0 && ret != -EAGAIN) {
-		LOG_ERR("MQTT live error: %d", ret);
-		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_ERROR]);
+
+	mqtt_ctx.replay_time = k_uptime_get() + CONFIG_APP_CUSTOM_MQTT_STORE_REPLAY_INTERVAL_MS;
+
+	ret = mqtt_store_peek(&record, store_time_now());
+	if (ret == -ENODATA) {
+		return;
+	} else if (ret) {
+		LOG_ERR("Failed to read stored record: %d", ret);
 		return;
 	}
-	
-	if (!mqtt_ctx.network_connected) {
-		LOG_INF("Network disconnected, transitioning to disconnecting state");
-		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_DISCONNECTING]);
+
+	/* The oldest records are dropped first when the store is full or they expire */
+	mqtt_ctx.store_old = MIN(mqtt_ctx.store_old, mqtt_store_count());
+
+	if (mqtt_ctx.store_old == 0) {
+		record_time_set(&record);
+	}
+
+	/* Stored records stay in flash until their class has budget again */
+	if (!budget_allow(record.type)) {
+		return;
+	}
+
+	ret = safe_publish_record(&record);
+
+	/* Records that cannot be encoded will never be sent, drop them as well */
+	if (ret == 0 || ret == -EINVAL || ret == -ENOMEM) {
+		(void)mqtt_store_pop();
+
+		if (mqtt_ctx.store_old > 0) {
+			mqtt_ctx.store_old--;
+		}
+
+		if (mqtt_store_count() == 0) {
+			LOG_INF("All stored records replayed");
+		}
 	}
 }
+#endif /* CONFIG_APP_CUSTOM_MQTT_STORE */
 
-static void disconnecting_entry(void *obj)
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET)
+/* Hand held back records to the I/O thread again once their class has budget */
+static void budget_release(void)
 {
-	LOG_DBG("Entering MQTT disconnecting state");
-	mqtt_ctx.state = MQTT_STATE_DISCONNECTING;
-	custom_mqtt_disconnect();
+	for (size_t cls = 0; cls < MQTT_BUDGET_CLASS_COUNT; cls++) {
+		struct mqtt_record *record = &mqtt_ctx.budget_held[cls];
+
+		if (!(mqtt_ctx.budget_held_mask & BIT(cls)) || !budget_allow(record->type)) {
+			continue;
+		}
+
+		mqtt_ctx.budget_held_mask &= ~BIT(cls);
+
+		if (mqtt_ring_put(record_rings[record_prio(record->type)], record)) {
+			LOG_WRN("Record queue full, dropped held back %s record",
+				record_type_str(record->type));
+		}
+	}
 }
 
-static void disconnecting_run(void *obj)
+/* Time until a held back record can be sent, -1 if there is none or only the next day helps */
+static int budget_timeout(void)
 {
-	/* State transition handled in MQTT event handler */
+	int64_t now = k_uptime_get();
+	int64_t timeout = -1;
+
+	for (size_t cls = 0; cls < MQTT_BUDGET_CLASS_COUNT; cls++) {
+		int64_t wait;
+
+		if (!(mqtt_ctx.budget_held_mask & BIT(cls))) {
+			continue;
+		}
+
+		k_spinlock_key_t key = k_spin_lock(&mqtt_ctx.budget_lock);
+
+		wait = mqtt_budget_wait(&mqtt_ctx.budget, cls, now);
+
+		k_spin_unlock(&mqtt_ctx.budget_lock, key);
+
+		if (wait >= 0) {
+			timeout = (timeout < 0) ? wait : MIN(timeout, wait);
+		}
+	}
+
+	return (int)timeout;
 }
 
-static void error_entry(void *obj)
+/* Move the byte counts to the current day, store them and release held back records */
+static void mqtt_io_budget(void)
 {
-	LOG_DBG("Entering MQTT error state");
-	mqtt_ctx.state = MQTT_STATE_ERROR;
-	
-	/* Cancel any pending work */
-	k_work_cancel_delayable(&mqtt_ctx.data_send_work);
-	
-	/* Reset failure counters for exponential backoff */
-	static uint32_t reconnect_delay = MQTT_RECONNECT_BASE_DELAY_SEC;
-	
-	if (mqtt_ctx.publish_failures > MQTT_MAX_PUBLISH_FAILURES) {
-		/* Exponential backoff for repeated failures */
-		reconnect_delay = MIN(reconnect_delay * 2, MQTT_RECONNECT_MAX_DELAY_SEC);
-	} else {
-		reconnect_delay = MQTT_RECONNECT_BASE_DELAY_SEC; /* Reset on success */
+	int64_t now_ms;
+	bool changed = false;
+
+	if (date_time_now(&now_ms) == 0) {
+		uint32_t day = (uint32_t)(now_ms / BUDGET_MSEC_PER_DAY);
+		k_spinlock_key_t key = k_spin_lock(&mqtt_ctx.budget_lock);
+
+		changed = mqtt_budget_period(&mqtt_ctx.budget, day);
+
+		k_spin_unlock(&mqtt_ctx.budget_lock, key);
 	}
-	
-	LOG_WRN("MQTT error state, will retry connection in %u seconds", reconnect_delay);
-	
-	/* Schedule reconnection attempt */
-	k_work_schedule(&mqtt_ctx.connect_work, K_SECONDS(reconnect_delay));
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET_PERSIST)
+	int64_t now = k_uptime_get();
+
+	/* A new day is stored right away, a reset must not bring back the old counts */
+	if (changed || (mqtt_ctx.budget_dirty && now >= mqtt_ctx.budget_save_time)) {
+		budget_save();
+		mqtt_ctx.budget_dirty = false;
+		mqtt_ctx.budget_save_time = now +
+			(int64_t)CONFIG_APP_CUSTOM_MQTT_BUDGET_SAVE_INTERVAL_SEC * MSEC_PER_SEC;
+	}
+#else
+	ARG_UNUSED(changed);
+#endif
+
+	budget_release();
 }
+#endif /* CONFIG_APP_CUSTOM_MQTT_BUDGET */
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_BATCH)
+/* Encode records as one batch and publish it. A batch that cannot be encoded is split in halves
+ * until it fits the payload buffer, single records that cannot be encoded are dropped.
+ * @p done is increased by the number of records that were published or dropped, only the
+ * published ones become the dead-band reference.
+ * The payload buffer is only used by the I/O thread.
+ */
+static int publish_batch(const struct mqtt_record *records, size_t count, size_t *done)
+{
+	size_t half = count / 2;
+	int len;
+	int ret;
 
-static void error_run(void *obj)
+	if (count == 1) {
+		struct mqtt_record record = records[0];
+
+		ret = safe_publish_record(&record);
+		if (ret == 0) {
+			hist_queued(records, 1);
+			record_sent(records);
+		}
+
+		if (ret == 0 || ret == -EINVAL || ret == -ENOMEM) {
+			*done += 1;
+			return 0;
+		}
+
+		return ret;
+	}
+
+	len = mqtt_codec_encode_batch(mqtt_ctx.publish_sequence + 1, records, count,
+				      mqtt_ctx.payload_buf, sizeof(mqtt_ctx.payload_buf));
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_JSON_VALIDATE)
+	if (len > 0 && !validate_json_string((const char *)mqtt_ctx.payload_buf)) {
+		LOG_ERR("JSON validation failed for batch");
+		len = -EINVAL;
+	}
+#endif /* CONFIG_APP_CUSTOM_MQTT_JSON_VALIDATE */
+
+	if (len == -ENOMEM || len == -EINVAL) {
+		LOG_DBG("Batch of %zu records could not be encoded (%d), splitting", count, len);
+
+		ret = publish_batch(records, half, done);
+		if (ret) {
+			return ret;
+		}
+
+		return publish_batch(&records[half], count - half, done);
+	} else if (len < 0) {
+		return len;
+	}
+
+	ret = mqtt_publish_data((const char *)mqtt_ctx.payload_buf, len);
+	if (ret) {
+		LOG_ERR("Failed to publish batch: %d", ret);
+		return ret;
+	}
+
+	LOG_DBG("Published batch of %zu records, %d bytes", count, len);
+	hist_queued(records, count);
+
+	/* Every record carries an equal share of the message */
+	for (size_t i = 0; i < count; i++) {
+		uint32_t bytes = publish_bytes(len);
+
+		record_sent(&records[i]);
+		budget_spend(records[i].type, bytes / count + ((i == 0) ? bytes % count : 0));
+	}
+
+	*done += count;
+
+	return 0;
+}
+
+/* Whether a due batch can be handled now, either published or moved to the flash store */
+static bool batch_can_flush(void)
 {
-	/* Wait for reconnection attempt */
+	if (mqtt_ctx.state == MQTT_STATE_CONNECTED) {
+		/* A full window is freed up by the next PUBACK */
+		return !mqtt_inflight_full(&mqtt_ctx.inflight);
+	}
+
+	/* Between on-demand sessions the batch waits for the session it opens */
+	if (IS_ENABLED(CONFIG_APP_CUSTOM_MQTT_ON_DEMAND) && mqtt_ctx.network_connected &&
+	    mqtt_ctx.state == MQTT_STATE_IDLE) {
+		return false;
+	}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_STORE)
+	/* While a connection attempt is ongoing, wait for its outcome before using flash */
+	return mqtt_ctx.store_ready && mqtt_ctx.state != MQTT_STATE_CONNECTING;
+#else
+	return false;
+#endif
 }
 
-/* Message processing functions */
-#if defined(CONFIG_APP_LOCATION)
-static void process_location_data(const struct location_msg *msg)
+/* Move queued records into the batch and publish it when it is due. While disconnected a due
+ * batch is moved to the flash store if enabled, otherwise it waits for the connection and new
+ * records stay queued.
+ */
+static void mqtt_io_publish_batch(void)
 {
-	cJSON *json = cJSON_CreateObject();
-	cJSON *location = cJSON_CreateObject();
-	
-	if (json == NULL || location == NULL) {
-		LOG_ERR("Failed to create JSON objects");
-		goto cleanup;
+	struct mqtt_batch *batch = &mqtt_ctx.batch;
+	struct mqtt_record record;
+	int64_t now = k_uptime_get();
+	size_t done = 0;
+	int ret;
+
+	while (batch->count < ARRAY_SIZE(batch->records) &&
+	       mqtt_ring_get(&mqtt_normal_ring, &record) == 0) {
+		if (record_suppressed(&record) || !budget_admit(&record)) {
+			mqtt_batch_skip(batch, record.type);
+			continue;
+		}
+
+		(void)mqtt_batch_add(batch, &record, now);
 	}
 
-	/* Validate location data */
-	if (msg->gnss_data.latitude < -90.0 || msg->gnss_data.latitude > 90.0 ||
-	    msg->gnss_data.longitude < -180.0 || msg->gnss_data.longitude > 180.0) {
-		LOG_WRN("Invalid GPS coordinates: lat=%.6f, lng=%.6f, skipping",
-			msg->gnss_data.latitude, msg->gnss_data.longitude);
-		goto cleanup;
+	if (!mqtt_batch_due(batch, now) || !batch_can_flush()) {
+		return;
 	}
 
-	if (msg->gnss_data.accuracy > MQTT_GPS_ACCURACY_MAX_METERS) {
-		LOG_WRN("GPS accuracy too low: %.2f m, skipping", msg->gnss_data.accuracy);
-		goto cleanup;
+	/* Records that waited for the time sync share one UNIX time base once it arrived */
+	for (size_t i = 0; i < batch->count; i++) {
+		record_time_set(&batch->records[i]);
 	}
 
-	/* Add device info and type */
-	cJSON_AddStringToObject(json, "device_id", MQTT_CLIENT_ID);
-	cJSON_AddStringToObject(json, "type", "location");
-	cJSON_AddNumberToObject(json, "timestamp", k_uptime_get());
-	cJSON_AddNumberToObject(json, "sequence", mqtt_ctx.publish_sequence + 1);
-	
-	/* Add location data */
-	cJSON_AddNumberToObject(location, "lat", msg->gnss_data.latitude);
-	cJSON_AddNumberToObject(location, "lng", msg->gnss_data.longitude);
-	cJSON_AddNumberToObject(location, "acc", msg->gnss_data.accuracy);
-	cJSON_AddItemToObject(json, "data", location);
-	
-	char *json_string = cJSON_Print(json);
-	if (json_string != NULL) {
+	if (mqtt_ctx.state == MQTT_STATE_CONNECTED) {
+		ret = publish_batch(batch->records, batch->count, &done);
+
+		mqtt_batch_consume(batch, done);
+
+		/* The rest of the batch is published when the window opens again */
+		if (ret == 0 || ret == -EBUSY) {
+			return;
+		}
+	}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_STORE)
+	/* Keep records that failed to send */
+	if (mqtt_ctx.store_ready) {
+		for (size_t i = 0; i < batch->count; i++) {
+			(void)store_record(&batch->records[i]);
+		}
+	}
+#endif
+
+	if (batch->count > 0) {
+		LOG_WRN("Batch of %zu records not published", batch->count);
+	}
+
+	mqtt_batch_consume(batch, batch->count);
+}
+#endif /* CONFIG_APP_CUSTOM_MQTT_BATCH */
+
+/* Publish the records of one ring in order. While disconnected they are moved to the flash store
+ * if enabled, otherwise they stay queued.
+ *
+ * Returns the number of records that were published.
+ */
+static size_t mqtt_io_publish_ring(struct mqtt_ring *ring)
+{
+	struct mqtt_record record;
+	size_t published = 0;
+	int ret;
+
+	while (mqtt_ring_peek(ring, &record) == 0) {
 		if (mqtt_ctx.state == MQTT_STATE_CONNECTED) {
-			int ret = mqtt_publish_data(json_string, strlen(json_string));
+			/* Wait for a PUBACK to free up the window */
+			if (mqtt_inflight_full(&mqtt_ctx.inflight)) {
+				break;
+			}
+
+			(void)mqtt_ring_get(ring, &record);
+
+			if (record_suppressed(&record) || !budget_admit(&record)) {
+				continue;
+			}
+
+			record_time_set(&record);
+
+			ret = safe_publish_record(&record);
+
 			if (ret == 0) {
-				LOG_INF("Location data published: lat=%.6f, lng=%.6f, acc=%.2f",
-					msg->gnss_data.latitude, msg->gnss_data.longitude, 
-					msg->gnss_data.accuracy);
+				hist_queued(&record, 1);
+				record_sent(&record);
+				published++;
+			}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_STORE)
+			/* Keep records that failed to send, unless they can never be encoded */
+			if (ret && ret != -EINVAL && ret != -ENOMEM && mqtt_ctx.store_ready) {
+				(void)store_record(&record);
 			}
+#endif
+			continue;
 		}
-		cJSON_free(json_string);
-	}
 
-cleanup:
-	if (json) {
-		cJSON_Delete(json);
+#if defined(CONFIG_APP_CUSTOM_MQTT_STORE)
+		/* While a connection attempt is ongoing, wait for its outcome before using flash */
+		if (mqtt_ctx.store_ready && mqtt_ctx.state != MQTT_STATE_CONNECTING) {
+			(void)mqtt_ring_get(ring, &record);
+
+			if (!record_suppressed(&record)) {
+				(void)store_record(&record);
+			}
+			continue;
+		}
+#endif
+		break;
 	}
+
+	return published;
 }
+
+/* Whether records of a higher priority class than low are waiting to be published */
+static bool mqtt_io_backlog(void)
+{
+	if (mqtt_ring_count(&mqtt_high_ring) > 0 || mqtt_ring_count(&mqtt_normal_ring) > 0) {
+		return true;
+	}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_BATCH)
+	return mqtt_batch_due(&mqtt_ctx.batch, k_uptime_get());
+#else
+	return false;
 #endif
+}
 
-#if defined(CONFIG_APP_ENVIRONMENTAL)
-static void process_environmental_data(const struct environmental_msg *msg)
+/* Publish low priority records once nothing else is waiting. They are dropped instead of being
+ * stored while disconnected, a heartbeat is only useful while it is current.
+ */
+static void mqtt_io_publish_low(void)
 {
-	/* Enhanced validation using helper functions */
-	if (!validate_sensor_data(msg->temperature, MQTT_TEMP_MIN_CELSIUS, MQTT_TEMP_MAX_CELSIUS)) {
-		return;
+	struct mqtt_record record;
+	int ret;
+
+	while (mqtt_ring_peek(&mqtt_low_ring, &record) == 0) {
+		if (mqtt_ctx.state == MQTT_STATE_CONNECTING) {
+			break;
+		}
+
+		if (mqtt_ctx.state != MQTT_STATE_CONNECTED) {
+			(void)mqtt_ring_get(&mqtt_low_ring, &record);
+			atomic_inc(&mqtt_low_ring.dropped);
+			LOG_DBG("Dropped %s record while disconnected",
+				record_type_str(record.type));
+			continue;
+		}
+
+		if (mqtt_inflight_full(&mqtt_ctx.inflight) || mqtt_io_backlog()) {
+			break;
+		}
+
+		(void)mqtt_ring_get(&mqtt_low_ring, &record);
+
+		if (!budget_admit(&record)) {
+			continue;
+		}
+
+		record_time_set(&record);
+
+		ret = safe_publish_record(&record);
+
+		if (ret) {
+			LOG_WRN("Failed to send %s record: %d", record_type_str(record.type), ret);
+		} else {
+			hist_queued(&record, 1);
+		}
 	}
-	
-	if (!validate_sensor_data(msg->humidity, MQTT_HUMIDITY_MIN_PERCENT, MQTT_HUMIDITY_MAX_PERCENT)) {
-		return;
+}
+
+/* Publish queued records by priority class. High priority records bypass the batch and flush
+ * it, since the connection is used for them anyway.
+ */
+static void mqtt_io_publish_records(void)
+{
+	size_t urgent = mqtt_io_publish_ring(&mqtt_high_ring);
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_BATCH)
+	if (urgent > 0) {
+		mqtt_batch_flush(&mqtt_ctx.batch);
+	}
+
+	mqtt_io_publish_batch();
+#else
+	ARG_UNUSED(urgent);
+
+	(void)mqtt_io_publish_ring(&mqtt_normal_ring);
+#endif
+
+	mqtt_io_publish_low();
+}
+
+/* Publish command acknowledgments ahead of queued records. They wait while disconnected, the
+ * sender may still be subscribed when the connection is back.
+ */
+static void mqtt_io_publish_acks(void)
+{
+	struct mqtt_record record;
+	int ret;
+
+	while (mqtt_ctx.state == MQTT_STATE_CONNECTED && !mqtt_inflight_full(&mqtt_ctx.inflight) &&
+	       k_msgq_get(&mqtt_ack_msgq, &record, K_NO_WAIT) == 0) {
+		ret = safe_publish_record(&record);
+
+		if (ret) {
+			LOG_WRN("Acknowledgment for \"%s\" not sent: %d", record.ack.command, ret);
+		} else {
+			hist_queued(&record, 1);
+		}
 	}
+}
 
-	if (!validate_sensor_data(msg->pressure, MQTT_PRESSURE_MIN_PA, MQTT_PRESSURE_MAX_PA)) {
-		return;
-	}
-	
-	cJSON *json = cJSON_CreateObject();
-	cJSON *env_data = cJSON_CreateObject();
-	
-	if (json == NULL || env_data == NULL) {
-		LOG_ERR("Failed to create JSON objects for environmental data");
-		goto cleanup;
+#if defined(CONFIG_APP_CUSTOM_MQTT_ON_DEMAND)
+/* Whether new messages are waiting for a session */
+static bool session_needed(int64_t now)
+{
+	return mqtt_batch_due(&mqtt_ctx.batch, now) || k_msgq_num_used_get(&mqtt_ack_msgq) > 0 ||
+	       mqtt_ring_count(&mqtt_high_ring) > 0;
+}
+
+/* Whether the open session still has work. Unacknowledged and stored messages keep a session
+ * open but do not open one, they are sent along with the next sampling cycle.
+ */
+static bool session_busy(int64_t now)
+{
+	if (session_needed(now) || mqtt_ctx.inflight.count > 0 ||
+	    k_msgq_num_used_get(&mqtt_cmd_msgq) > 0 || k_work_is_pending(&mqtt_ctx.cmd_work)) {
+		return true;
 	}
-	
-	cJSON_AddStringToObject(json, "type", "environmental");
-	cJSON_AddNumberToObject(json, "sequence", mqtt_ctx.publish_sequence + 1);
-	
-	/* Add environmental data with limited precision to reduce noise */
-	cJSON_AddNumberToObject(env_data, "temperature", round(msg->temperature * 100) / 100.0);
-	cJSON_AddNumberToObject(env_data, "humidity", round(msg->humidity * 100) / 100.0);
-	cJSON_AddNumberToObject(env_data, "pressure", round(msg->pressure * 10) / 10.0);
-	
-#if defined(CONFIG_APP_ENVIRONMENTAL_TIMESTAMP)
-	if (msg->timestamp > 0) {
-		cJSON_AddNumberToObject(env_data, "timestamp", msg->timestamp);
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_STORE)
+	if (mqtt_ctx.store_ready && mqtt_store_count() > 0) {
+		return true;
 	}
 #endif
-	
-	cJSON_AddItemToObject(json, "data", env_data);
-	
-	/* Use safe publish function */
-	int ret = safe_publish_json(json, "environmental");
-	if (ret == 0) {
-		LOG_INF("Environmental data published: T=%.2f°C, H=%.2f%%, P=%.1fPa",
-			msg->temperature, msg->humidity, msg->pressure);
-	}
 
-cleanup:
-	if (json) {
-		cJSON_Delete(json);
-	}
+	return false;
 }
-#endif
 
-#if defined(CONFIG_APP_POWER)
-static void process_power_data(const struct power_msg *msg)
+static const struct mqtt_session_limits session_limits = {
+	.linger_ms = CONFIG_APP_CUSTOM_MQTT_ON_DEMAND_LINGER_MS,
+	.timeout_ms = CONFIG_APP_CUSTOM_MQTT_ON_DEMAND_TIMEOUT_SEC * MSEC_PER_SEC,
+};
+
+/* Whether the current session can be closed. Commands that are still running may send an
+ * acknowledgment, and the broker may still deliver queued commands during the linger time.
+ */
+static bool session_done(int64_t now)
 {
-	/* Validate power data using helper function */
-	if (!validate_sensor_data(msg->percentage, MQTT_BATTERY_MIN_PERCENT, MQTT_BATTERY_MAX_PERCENT)) {
-		return;
-	}
-	
-	cJSON *json = cJSON_CreateObject();
-	cJSON *power_data = cJSON_CreateObject();
-	
-	if (json == NULL || power_data == NULL) {
-		LOG_ERR("Failed to create JSON objects for power data");
-		goto cleanup;
-	}
-	
-	cJSON_AddStringToObject(json, "type", "power");
-	cJSON_AddNumberToObject(json, "sequence", mqtt_ctx.publish_sequence + 1);
-	
-	/* Add comprehensive power data */
-	cJSON_AddNumberToObject(power_data, "percentage", round(msg->percentage * 10) / 10.0);
-	cJSON_AddNumberToObject(power_data, "voltage", round(msg->voltage * 1000) / 1000.0);
-	cJSON_AddNumberToObject(power_data, "current_ma", round(msg->current_ma * 10) / 10.0);
-	cJSON_AddNumberToObject(power_data, "temperature", round(msg->temperature * 10) / 10.0);
-	
-#if defined(CONFIG_APP_POWER_TIMESTAMP)
-	if (msg->timestamp > 0) {
-		cJSON_AddNumberToObject(power_data, "timestamp", msg->timestamp);
+	bool busy;
+
+	/* Still subscribing */
+	if (mqtt_sub_pending(&mqtt_ctx.sub)) {
+		return false;
 	}
-#endif
-	
-	cJSON_AddItemToObject(json, "data", power_data);
-	
-	/* Use safe publish function */
-	int ret = safe_publish_json(json, "power");
-	if (ret == 0) {
-		LOG_INF("Power data published: %.1f%%, %.3fV, %.1fmA, %.1f°C", 
-			msg->percentage, msg->voltage, msg->current_ma, msg->temperature);
+
+	busy = session_busy(now);
+
+	if (!mqtt_session_done(&mqtt_ctx.session, &session_limits, busy, now)) {
+		return false;
 	}
 
-cleanup:
-	if (json) {
-		cJSON_Delete(json);
+	if (busy) {
+		LOG_WRN("Session timed out, %zu messages not acknowledged",
+			mqtt_ctx.inflight.count);
 	}
+
+	return true;
 }
-#endif
 
-#if defined(CONFIG_APP_UART_SENSOR)
-static void process_uart_sensor_data(const struct uart_sensor_msg *msg)
+/* Open a session when a sampling cycle is ready to be sent, and close it once everything has
+ * been acknowledged. Until the first session has been announced the module connects as soon as
+ * the network is up, the main module only starts sampling after that.
+ */
+static void mqtt_io_on_demand(void)
 {
-	cJSON *json = NULL;
-	cJSON *sensor_data = NULL;
-	
-	if (!msg) {
-		LOG_ERR("Invalid UART sensor message");
-		return;
-	}
-	
-	/* Validate sensor data ranges */
-	if (!SENSOR_VALUE_IN_RANGE(msg->temperature, UART_SENSOR_TEMP_MIN, UART_SENSOR_TEMP_MAX)) {
-		LOG_WRN("Temperature %.2f out of range [%.2f, %.2f]", 
-			msg->temperature, UART_SENSOR_TEMP_MIN, UART_SENSOR_TEMP_MAX);
-	}
-	
-	if (!SENSOR_VALUE_IN_RANGE(msg->humidity, UART_SENSOR_HUMIDITY_MIN, UART_SENSOR_HUMIDITY_MAX)) {
-		LOG_WRN("Humidity %.2f out of range [%.2f, %.2f]", 
-			msg->humidity, UART_SENSOR_HUMIDITY_MIN, UART_SENSOR_HUMIDITY_MAX);
+	int64_t now = k_uptime_get();
+
+	if (mqtt_ctx.state == MQTT_STATE_IDLE) {
+		if (mqtt_ctx.network_connected && (!mqtt_ctx.online || session_needed(now))) {
+			LOG_DBG("Opening session");
+			smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_CONNECTING]);
+		}
+	} else if (mqtt_ctx.state == MQTT_STATE_CONNECTED && session_done(now)) {
+		LOG_INF("Session complete after %lld ms, disconnecting",
+			now - mqtt_ctx.session.start);
+		mqtt_ctx.session_closing = true;
+		smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_DISCONNECTING]);
 	}
-	
-	if (!SENSOR_VALUE_IN_RANGE(msg->probe_battery, UART_SENSOR_BATTERY_MIN, UART_SENSOR_BATTERY_MAX)) {
-		LOG_WRN("Probe battery %.2f out of range [%.2f, %.2f]", 
-			msg->probe_battery, UART_SENSOR_BATTERY_MIN, UART_SENSOR_BATTERY_MAX);
+}
+
+/* Time until the on-demand session has to be opened or closed, -1 for no limit */
+static int on_demand_timeout(void)
+{
+	int64_t now = k_uptime_get();
+	int64_t left;
+
+	if (mqtt_ctx.state == MQTT_STATE_IDLE && mqtt_ctx.network_connected) {
+		/* Wakes up when an incomplete batch times out */
+		left = mqtt_batch_time_left(&mqtt_ctx.batch, now);
+	} else if (mqtt_ctx.state == MQTT_STATE_CONNECTED && !mqtt_sub_pending(&mqtt_ctx.sub)) {
+		/* A busy session is woken up by the PUBACKs, acknowledgments and replays it waits
+		 * for, the linger time only counts once it is idle.
+		 */
+		left = mqtt_session_time_left(&mqtt_ctx.session, &session_limits,
+					      session_busy(now), now);
+	} else {
+		left = -1;
 	}
-	
-	/* Create JSON payload */
-	json = cJSON_CreateObject();
-	sensor_data = cJSON_CreateObject();
-	
-	if (!json || !sensor_data) {
-		LOG_ERR("Failed to create JSON objects");
-		goto cleanup;
+
+	return (int)left;
+}
+#endif /* CONFIG_APP_CUSTOM_MQTT_ON_DEMAND */
+
+/* Time until the I/O thread has to run again without being woken up, -1 for no limit */
+static int mqtt_io_timeout(void)
+{
+	int timeout = -1;
+
+	if (mqtt_socket_fd() >= 0) {
+		timeout = mqtt_transport_timeout();
 	}
-	
-	cJSON_AddItemToObject(json, "sensor_data", sensor_data);
-	cJSON_AddStringToObject(json, "type", "uart_sensor");
-	cJSON_AddNumberToObject(json, "sequence", mqtt_ctx.publish_sequence + 1);
-	
-	/* Add UART sensor data with proper precision */
-	cJSON_AddNumberToObject(sensor_data, "temperature", round(msg->temperature * 100) / 100.0);
-	cJSON_AddNumberToObject(sensor_data, "humidity", round(msg->humidity * 100) / 100.0);
-	cJSON_AddStringToObject(sensor_data, "probe_id", msg->probe_id);
-	cJSON_AddNumberToObject(sensor_data, "probe_battery", round(msg->probe_battery * 10) / 10.0);
-	
-#if defined(CONFIG_APP_UART_SENSOR_TIMESTAMP)
-	if (msg->timestamp > 0) {
-		cJSON_AddNumberToObject(sensor_data, "timestamp", msg->timestamp);
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_BATCH)
+	if (mqtt_ctx.batch.count > 0 && batch_can_flush()) {
+		int64_t now = k_uptime_get();
+		int64_t batch_left = mqtt_batch_due(&mqtt_ctx.batch, now) ?
+				     0 : mqtt_batch_time_left(&mqtt_ctx.batch, now);
+
+		timeout = (timeout < 0) ? (int)batch_left : MIN(timeout, (int)batch_left);
 	}
 #endif
-	
-	/* Convert to string and publish */
-	int ret = safe_publish_json(json, "uart_sensor");
-	if (ret == 0) {
-		LOG_INF("UART sensor data published: %s, T=%.1f°C, H=%.1f%%, Bat=%.1f%%", 
-			msg->probe_id, msg->temperature, msg->humidity, msg->probe_battery);
-	}
 
-cleanup:
-	if (json) {
-		cJSON_Delete(json);
+#if defined(CONFIG_APP_CUSTOM_MQTT_STORE)
+	if (mqtt_ctx.store_ready && mqtt_ctx.state == MQTT_STATE_CONNECTED &&
+	    !mqtt_inflight_full(&mqtt_ctx.inflight) && mqtt_store_count() > 0) {
+		int replay = (int)MAX(mqtt_ctx.replay_time - k_uptime_get(), 0);
+
+		timeout = (timeout < 0) ? replay : MIN(timeout, replay);
 	}
-}
 #endif
 
-#if defined(CONFIG_APP_BUTTON) && defined(MQTT_BUTTON_POWER_MEASUREMENT_ENABLED)
-static void process_button_msg(const struct button_msg *msg)
-{
-	LOG_INF("Button %d %s detected", msg->button_number, 
-		msg->type == BUTTON_PRESS_SHORT ? "short press" : "long press");
-	
-	/* Only handle button 1 short press for power measurement trigger */
-	if (msg->button_number == 1 && msg->type == BUTTON_PRESS_SHORT) {
-		LOG_INF("Requesting power measurement via button press");
-		
-		/* Request power measurement directly */
-		int ret = power_sample_request();
-		if (ret != 0) {
-			LOG_ERR("Failed to request power measurement: %d", ret);
-			return;
-		}
-		
-		/* Get the power data and publish it */
-		struct power_msg power_data;
-		ret = power_get_current_data(&power_data);
-		if (ret == 0) {
-			k_mutex_lock(&mqtt_ctx.data_mutex, K_FOREVER);
-			process_power_data(&power_data);
-			k_mutex_unlock(&mqtt_ctx.data_mutex);
-			LOG_INF("Button-triggered power data published: %.1f%%", power_data.percentage);
-		} else {
-			LOG_ERR("Failed to get power data: %d", ret);
-		}
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET)
+	int budget = budget_timeout();
 
-#if defined(CONFIG_APP_UART_SENSOR)
-		/* Also trigger UART sensor data generation */
-		LOG_INF("Requesting UART sensor data via button press");
-		ret = uart_sensor_sample_request();
-		if (ret == -ENODATA) {
-			LOG_INF("No fresh UART sensor data available - skipping");
-		} else if (ret != 0) {
-			LOG_ERR("Failed to request UART sensor data: %d", ret);
-		} else {
-			LOG_INF("UART sensor data published successfully");
-		}
-#endif
+	if (budget >= 0) {
+		timeout = (timeout < 0) ? budget : MIN(timeout, budget);
 	}
-}
 #endif
 
-static void process_network_msg(const struct network_msg *msg)
-{
-	switch (msg->type) {
-	case NETWORK_CONNECTED:
-		LOG_INF("Network connected");
-		mqtt_ctx.network_connected = true;
-		k_work_schedule(&mqtt_ctx.connect_work, K_SECONDS(2));
-		break;
-		
-	case NETWORK_DISCONNECTED:
-		LOG_INF("Network disconnected");
-		mqtt_ctx.network_connected = false;
-		if (mqtt_ctx.state == MQTT_STATE_CONNECTED) {
-			smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_DISCONNECTING]);
-		}
-		break;
-		
-	default:
-		break;
+#if defined(CONFIG_APP_CUSTOM_MQTT_ON_DEMAND)
+	int on_demand = on_demand_timeout();
+
+	if (on_demand >= 0) {
+		timeout = (timeout < 0) ? on_demand : MIN(timeout, on_demand);
 	}
+#endif
+
+	return timeout;
 }
 
-/* Main thread function */
-static void custom_mqtt_thread(void)
+/* I/O thread. Owns the MQTT client: all socket reads, writes and state machine transitions
+ * happen here. It sleeps in poll() on the MQTT socket and the wake-up eventfd, bounded by the
+ * time left until the next keepalive ping.
+ */
+static void custom_mqtt_io_thread(void)
 {
-	const struct zbus_channel *chan;
+	struct pollfd fds[2];
+	int timeout;
 	int ret;
 
-	LOG_INF("Custom MQTT module started");
-	LOG_INF("MQTT Broker: %s:%d", MQTT_BROKER_HOSTNAME, MQTT_BROKER_PORT);
-	LOG_INF("MQTT Username: %s", MQTT_USERNAME);
-	LOG_INF("MQTT Topics - Publish: %s, Subscribe: %s", MQTT_PUB_TOPIC, MQTT_SUB_TOPIC);
+#if defined(CONFIG_APP_CUSTOM_MQTT_STORE)
+	ret = mqtt_store_init();
+	if (ret) {
+		LOG_ERR("Failed to initialize record store, offline records will be lost: %d", ret);
+	} else {
+		mqtt_ctx.store_ready = true;
+		mqtt_ctx.store_old = mqtt_store_count();
+	}
+#endif
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET)
+	budget_init();
+#endif
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_BATCH)
+	mqtt_batch_init(&mqtt_ctx.batch,
+			(IS_ENABLED(CONFIG_APP_ENVIRONMENTAL) ? BIT(MQTT_RECORD_ENVIRONMENTAL) : 0) |
+			(IS_ENABLED(CONFIG_APP_POWER) ? BIT(MQTT_RECORD_POWER) : 0));
+#endif
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_ENERGY_ESTIMATE)
+	const struct mqtt_energy_model energy_model = {
+		.tail_ms = CONFIG_APP_CUSTOM_MQTT_ENERGY_RRC_TAIL_MS,
+		.active_mw = CONFIG_APP_CUSTOM_MQTT_ENERGY_ACTIVE_MW,
+	};
+
+	mqtt_energy_init(&mqtt_ctx.energy, &energy_model, k_uptime_get());
+#endif
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_STATS)
+	mqtt_hist_rate_init(&mqtt_ctx.publish_rate, SEC_PER_MIN * MSEC_PER_SEC, k_uptime_get());
+#endif
 
 	/* Initialize state machine */
 	smf_set_initial(&sm_ctx, &mqtt_states[MQTT_STATE_IDLE]);
@@ -1060,111 +2964,139 @@ static void custom_mqtt_thread(void)
 	}
 
 	while (1) {
-		/* Wait for messages on subscribed channels */
-		const void *msg_data;
-		ret = zbus_sub_wait_msg(&custom_mqtt_subscriber, &chan, &msg_data, K_MSEC(1000));
-		if (ret == 0) {
-			/* Process messages with proper synchronization and retry logic */
-			if (chan == &NETWORK_CHAN) {
-				struct network_msg msg;
-				ret = zbus_chan_read(&NETWORK_CHAN, &msg, K_MSEC(100));
-				if (ret == 0) {
-					k_mutex_lock(&mqtt_ctx.data_mutex, K_FOREVER);
-					process_network_msg(&msg);
-					k_mutex_unlock(&mqtt_ctx.data_mutex);
-				} else {
-					LOG_WRN("Failed to read NETWORK_CHAN: %d", ret);
-				}
-			}
+		fds[0].fd = mqtt_ctx.wake_fd;
+		fds[0].events = POLLIN;
+		fds[0].revents = 0;
+		fds[1].fd = mqtt_socket_fd();
+		fds[1].events = POLLIN;
+		fds[1].revents = 0;
+
+		/* Negative file descriptors are ignored by poll() */
+		timeout = mqtt_io_timeout();
+
+		ret = poll(fds, ARRAY_SIZE(fds), timeout);
+		if (ret < 0) {
+			LOG_ERR("poll() failed: %d", -errno);
+			k_sleep(K_MSEC(100));
+			continue;
+		}
+
+		if (fds[0].revents & POLLIN) {
+			eventfd_t value;
+
+			(void)eventfd_read(mqtt_ctx.wake_fd, &value);
+		}
+
+		if (fds[1].revents & POLLIN) {
+			mqtt_ctx.rx_ready_time = k_uptime_get();
+			io_activity(mqtt_ctx.rx_ready_time);
+		}
+
+		if (fds[1].revents & (POLLERR | POLLNVAL)) {
+			LOG_ERR("MQTT socket error (revents: 0x%x)", fds[1].revents);
+			smf_set_state(&sm_ctx, &mqtt_states[MQTT_STATE_ERROR]);
+		}
+
+		mqtt_io_handle_events();
+
+		/* Run state machine, reads incoming data and maintains the connection */
+		smf_run_state(&sm_ctx);
+
+		mqtt_io_publish_acks();
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET)
+		mqtt_io_budget();
+#endif
+
+		mqtt_io_publish_records();
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_STORE)
+		mqtt_io_replay_stored();
+#endif
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_ON_DEMAND)
+		mqtt_io_on_demand();
+#endif
+	}
+}
+
+/* Main thread function, converts zbus messages into records for the I/O thread */
+static void custom_mqtt_thread(void)
+{
+	const struct zbus_channel *chan;
+	/* Large enough for any message on the subscribed channels */
+	static uint8_t msg_buf[MAX_MSG_SIZE] __aligned(sizeof(void *));
+	int ret;
+
+	LOG_INF("Custom MQTT module started");
+#if defined(CONFIG_APP_CUSTOM_MQTT_TRANSPORT_MQTT_SN)
+	LOG_INF("MQTT-SN Gateway: %s:%d", CONFIG_APP_CUSTOM_MQTT_SN_GATEWAY_HOSTNAME,
+		CONFIG_APP_CUSTOM_MQTT_SN_GATEWAY_PORT);
+#else
+	LOG_INF("MQTT Broker: %s:%d", CONFIG_APP_CUSTOM_MQTT_BROKER_HOSTNAME,
+		CONFIG_APP_CUSTOM_MQTT_BROKER_PORT);
+	LOG_INF("MQTT Username: %s", CONFIG_APP_CUSTOM_MQTT_USERNAME);
+#endif
+	LOG_INF("MQTT Topics - Publish: %s, Subscribe: %s", MQTT_PUB_TOPIC, MQTT_SUB_TOPIC);
+
+	while (1) {
+		/* Wait for messages on subscribed channels. The message is copied into
+		 * msg_buf when it is published, so it is processed from there without
+		 * reading the channel again.
+		 */
+		ret = zbus_sub_wait_msg(&custom_mqtt_subscriber, &chan, msg_buf, K_FOREVER);
+		if (ret) {
+			LOG_ERR("zbus_sub_wait_msg, error: %d", ret);
+			continue;
+		}
+
+		/* Records are handed over through a lock-free ring, this thread never
+		 * waits for the I/O thread.
+		 */
+		if (chan == &NETWORK_CHAN) {
+			process_network_msg(&MSG_TO_NETWORK_MSG(msg_buf));
+		}
 #if defined(CONFIG_APP_LOCATION)
-			else if (chan == &LOCATION_CHAN) {
-				struct location_msg msg;
-				ret = zbus_chan_read(&LOCATION_CHAN, &msg, K_MSEC(100));
-				if (ret == 0) {
-					k_mutex_lock(&mqtt_ctx.data_mutex, K_FOREVER);
-					process_location_data(&msg);
-					k_mutex_unlock(&mqtt_ctx.data_mutex);
-				} else {
-					LOG_WRN("Failed to read LOCATION_CHAN: %d", ret);
-				}
-			}
+		else if (chan == &LOCATION_CHAN) {
+			process_location_data(MSG_TO_LOCATION_MSG_PTR(msg_buf));
+		}
 #endif
 #if defined(CONFIG_APP_ENVIRONMENTAL)
-			else if (chan == &ENVIRONMENTAL_CHAN) {
-				struct environmental_msg msg;
-				ret = zbus_chan_read(&ENVIRONMENTAL_CHAN, &msg, K_MSEC(100));
-				if (ret == 0) {
-					k_mutex_lock(&mqtt_ctx.data_mutex, K_FOREVER);
-					process_environmental_data(&msg);
-					k_mutex_unlock(&mqtt_ctx.data_mutex);
-				} else {
-					/* Channel busy is common, only warn on other errors */
-					if (ret != -EBUSY) {
-						LOG_WRN("Failed to read ENVIRONMENTAL_CHAN: %d", ret);
-					} else {
-						LOG_DBG("ENVIRONMENTAL_CHAN busy, will retry");
-					}
-				}
-			}
+		else if (chan == &ENVIRONMENTAL_CHAN) {
+			process_environmental_data(&MSG_TO_ENVIRONMENTAL_MSG(msg_buf));
+		}
 #endif
 #if defined(CONFIG_APP_POWER)
-			else if (chan == &POWER_CHAN) {
-				struct power_msg msg;
-				ret = zbus_chan_read(&POWER_CHAN, &msg, K_MSEC(100));
-				if (ret == 0) {
-					k_mutex_lock(&mqtt_ctx.data_mutex, K_FOREVER);
-					process_power_data(&msg);
-					k_mutex_unlock(&mqtt_ctx.data_mutex);
-					LOG_DBG("ZBUS power data processed: %.1f%%", msg.percentage);
-				} else {
-					if (ret != -EBUSY) {
-						LOG_WRN("Failed to read POWER_CHAN: %d", ret);
-					} else {
-						LOG_DBG("POWER_CHAN busy, will retry");
-					}
-				}
-			}
+		else if (chan == &POWER_CHAN) {
+			const struct power_msg *msg = &MSG_TO_POWER_MSG(msg_buf);
+
+			process_power_data(msg);
+			LOG_DBG("ZBUS power data processed: %.1f%%", msg->percentage);
+		}
 #endif
 #if defined(CONFIG_APP_UART_SENSOR)
-			else if (chan == &UART_SENSOR_CHAN) {
-				struct uart_sensor_msg msg;
-				ret = zbus_chan_read(&UART_SENSOR_CHAN, &msg, K_MSEC(100));
-				if (ret == 0) {
-					k_mutex_lock(&mqtt_ctx.data_mutex, K_FOREVER);
-					process_uart_sensor_data(&msg);
-					k_mutex_unlock(&mqtt_ctx.data_mutex);
-					LOG_DBG("ZBUS UART sensor data processed: %s, T=%.1f°C", 
-						msg.probe_id, msg.temperature);
-				} else {
-					if (ret != -EBUSY) {
-						LOG_WRN("Failed to read UART_SENSOR_CHAN: %d", ret);
-					} else {
-						LOG_DBG("UART_SENSOR_CHAN busy, will retry");
-					}
-				}
-			}
+		else if (chan == &UART_SENSOR_CHAN) {
+			const struct uart_sensor_msg *msg = &MSG_TO_UART_SENSOR_MSG(msg_buf);
+
+			process_uart_sensor_data(msg);
+			LOG_DBG("ZBUS UART sensor data processed: %s, T=%.1f°C",
+				msg->probe_id, msg->temperature);
+		}
 #endif
-#if defined(CONFIG_APP_BUTTON) && defined(MQTT_BUTTON_POWER_MEASUREMENT_ENABLED)
-			else if (chan == &BUTTON_CHAN) {
-				struct button_msg msg;
-				ret = zbus_chan_read(&BUTTON_CHAN, &msg, K_MSEC(100));
-				if (ret == 0) {
-					k_mutex_lock(&mqtt_ctx.data_mutex, K_FOREVER);
-					process_button_msg(&msg);
-					k_mutex_unlock(&mqtt_ctx.data_mutex);
-				} else {
-					if (ret != -EBUSY) {
-						LOG_WRN("Failed to read BUTTON_CHAN: %d", ret);
-					} else {
-						LOG_DBG("BUTTON_CHAN busy, will retry");
-					}
-				}
+#if defined(CONFIG_APP_CUSTOM_MQTT_BATCH)
+		else if (chan == &CUSTOM_MQTT_CHAN) {
+			const struct custom_mqtt_msg *msg = (const struct custom_mqtt_msg *)msg_buf;
+
+			if (msg->type == CUSTOM_MQTT_EVT_DATA_SEND) {
+				mqtt_io_signal(MQTT_IO_EVT_CYCLE_START);
 			}
+		}
 #endif
+#if defined(CONFIG_APP_BUTTON) && defined(MQTT_BUTTON_POWER_MEASUREMENT_ENABLED)
+		else if (chan == &BUTTON_CHAN) {
+			process_button_msg(&MSG_TO_BUTTON_MSG(msg_buf));
 		}
-
-		/* Run state machine */
-		smf_run_state(&sm_ctx);
+#endif
 	}
 }
 
@@ -1175,20 +3107,73 @@ K_THREAD_DEFINE(custom_mqtt_thread_id,
 		NULL, NULL, NULL, 
 		K_PRIO_COOP(7), 0, 0);
 
+K_THREAD_DEFINE(custom_mqtt_io_thread_id,
+		CONFIG_APP_CUSTOM_MQTT_IO_THREAD_STACK_SIZE,
+		custom_mqtt_io_thread,
+		NULL, NULL, NULL,
+		K_PRIO_COOP(7), 0, 0);
+
 /* Subscribe to channels */
 static int custom_mqtt_init(void)
 {
-	/* Initialize mutex for thread safety */
-	k_mutex_init(&mqtt_ctx.data_mutex);
+	int ret;
+
+	for (size_t i = 0; i < CUSTOM_MQTT_PRIO_COUNT; i++) {
+		mqtt_ring_init(record_rings[i]);
+	}
 	
 	/* Initialize work queue */
 	k_work_init_delayable(&mqtt_ctx.connect_work, connect_work_handler);
 	k_work_init_delayable(&mqtt_ctx.data_send_work, data_send_work_handler);
+	k_work_init_delayable(&mqtt_ctx.suback_timeout_work, suback_timeout_work_handler);
+	k_work_init(&mqtt_ctx.cmd_work, cmd_work_handler);
+#if defined(CONFIG_APP_CUSTOM_MQTT_FAILOVER)
+	k_work_init_delayable(&mqtt_ctx.probe_work, probe_work_handler);
+	k_work_init(&mqtt_ctx.probe_run_work, probe_run_work_handler);
+
+	const struct k_work_queue_config probe_work_q_config = {
+		.name = "custom_mqtt_probe",
+	};
+
+	k_work_queue_start(&probe_work_q, probe_work_q_stack,
+			   K_THREAD_STACK_SIZEOF(probe_work_q_stack),
+			   K_LOWEST_APPLICATION_THREAD_PRIO, &probe_work_q_config);
+#endif
 	
+	mqtt_inflight_init(&mqtt_ctx.inflight);
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_DEADBAND)
+	deadband_init();
+#endif
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_PSM_AWARE)
+	/* Defaults until the network reports its power saving parameters */
+	mqtt_sched_params_init(&mqtt_ctx.sched_params);
+	mqtt_ctx.sched.keepalive = CONFIG_APP_CUSTOM_MQTT_KEEPALIVE_SECONDS;
+	mqtt_ctx.sched.heartbeat = MQTT_HEARTBEAT_INTERVAL_SEC;
+#endif
+
+	ret = mqtt_transport_init(transport_evt_handler, transport_wake_handler);
+	if (ret) {
+		LOG_ERR("Failed to initialize MQTT transport: %d", ret);
+		return ret;
+	}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_FAILOVER)
+	broker_init();
+#endif
+
 	/* Initialize counters */
 	mqtt_ctx.publish_sequence = 0;
 	mqtt_ctx.publish_failures = 0;
 	mqtt_ctx.data_validation_enabled = true;
+
+	/* Non-blocking, the I/O thread drains it after every wake-up */
+	mqtt_ctx.wake_fd = eventfd(0, EFD_NONBLOCK);
+	if (mqtt_ctx.wake_fd < 0) {
+		LOG_ERR("Failed to create eventfd: %d", -errno);
+		return -errno;
+	}
 	
 	LOG_INF("Custom MQTT module initialized");
 	
@@ -10,6 +10,9 @@
 #include <zephyr/kernel.h>
 #include <zephyr/zbus/zbus.h>
 
+#include "custom_mqtt_budget.h"
+#include "custom_mqtt_hist.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -56,6 +59,120 @@ struct custom_mqtt_msg {
 	};
 };
 
+/**
+ * @brief Uplink priority classes. Each class has its own queue.
+ */
+enum custom_mqtt_prio {
+	/** Location, alarms and the status message. Published ahead of everything else and never
+	 *  batched.
+	 */
+	CUSTOM_MQTT_PRIO_HIGH,
+	/** Sensor telemetry. */
+	CUSTOM_MQTT_PRIO_NORMAL,
+	/** Heartbeats and diagnostics. Dropped while disconnected or behind other classes. */
+	CUSTOM_MQTT_PRIO_LOW,
+	CUSTOM_MQTT_PRIO_COUNT,
+};
+
+/**
+ * @brief Custom MQTT module statistics.
+ */
+struct custom_mqtt_stats {
+	/** Environmental records not sent because no value left its dead-band. */
+	uint32_t suppressed_environmental;
+
+	/** Power records not sent because no value left its dead-band. */
+	uint32_t suppressed_power;
+
+	/** MQTT keepalive requested at the next connection, in seconds. */
+	uint32_t keepalive;
+
+	/** Time without any publish after which a heartbeat is sent, in seconds. */
+	uint32_t heartbeat_interval;
+
+	/** Heartbeats not sent because other messages were published. */
+	uint32_t suppressed_heartbeats;
+
+	/** Sessions opened in on-demand mode. */
+	uint32_t sessions;
+
+	/** Length of the last sampling cycle, in milliseconds. */
+	uint32_t cycle_duration_ms;
+
+	/** Radio wakeups in the last sampling cycle. */
+	uint32_t cycle_wakeups;
+
+	/** Estimated radio connected time in the last sampling cycle, in milliseconds. */
+	uint32_t cycle_active_ms;
+
+	/** Estimated radio energy of the last sampling cycle, in millijoules. */
+	uint32_t cycle_energy_mj;
+
+	/** Broker of the current or last connection, 0 is the primary. */
+	uint32_t broker;
+
+	/** Number of times the connection was moved to another broker. */
+	uint32_t broker_switches;
+
+	/** Records waiting in the queue of each priority class. */
+	uint32_t queued[CUSTOM_MQTT_PRIO_COUNT];
+
+	/** Records of each priority class dropped because they could not be queued or sent. */
+	uint32_t dropped[CUSTOM_MQTT_PRIO_COUNT];
+
+	/** Uplink bytes of the current day and month, see CONFIG_APP_CUSTOM_MQTT_BUDGET. */
+	struct mqtt_budget_usage budget;
+
+	/** Daily and monthly byte limits, 0 for no limit. */
+	uint32_t budget_daily_limit;
+	uint32_t budget_monthly_limit;
+
+	/** Records of each data class held back or dropped because their budget was exhausted. */
+	uint32_t budget_limited[MQTT_BUDGET_CLASS_COUNT];
+};
+
+/**
+ * @brief Get module statistics. May be called from any thread.
+ *
+ * @param[out] stats Statistics since boot.
+ */
+void custom_mqtt_stats_get(struct custom_mqtt_stats *stats);
+
+/**
+ * @brief Custom MQTT module histograms.
+ */
+enum custom_mqtt_hist_type {
+	/** Time from record creation until it was published, in milliseconds. */
+	CUSTOM_MQTT_HIST_QUEUE_MS,
+	/** Time from the first transmission of a publish until its PUBACK, in milliseconds. */
+	CUSTOM_MQTT_HIST_ACK_MS,
+	/** Size of published messages, in bytes. */
+	CUSTOM_MQTT_HIST_MSG_BYTES,
+	/** Messages published per minute. */
+	CUSTOM_MQTT_HIST_MSGS_PER_MIN,
+	/** Time from losing the connection until the next CONNACK, in milliseconds. */
+	CUSTOM_MQTT_HIST_RECONNECT_MS,
+	/**
+	 * Time producers took to put a record into its ring, in microseconds. Records that did
+	 * not fit are counted in custom_mqtt_stats::dropped.
+	 */
+	CUSTOM_MQTT_HIST_SUBMIT_US,
+	CUSTOM_MQTT_HIST_COUNT,
+};
+
+/**
+ * @brief Get a histogram since boot. May be called from any thread.
+ *
+ * @param[in]  type Histogram to get.
+ * @param[out] hist Copy of the histogram.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -EINVAL if @p type is not a histogram.
+ * @retval -ENOTSUP if the histograms are disabled.
+ */
+int custom_mqtt_hist_get(enum custom_mqtt_hist_type type, struct mqtt_hist *hist);
+
 /* Declare zbus channel for custom MQTT */
 ZBUS_CHAN_DECLARE(CUSTOM_MQTT_CHAN);
 
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <errno.h>
+#include <string.h>
+
+#include "custom_mqtt_batch.h"
+
+static void batch_cycle_open(struct mqtt_batch *batch)
+{
+	batch->cycle_open = true;
+	batch->next_cycle = false;
+	batch->missing = batch->expected;
+	batch->cycle_complete = (batch->missing == 0);
+}
+
+static void batch_cycle_close(struct mqtt_batch *batch)
+{
+	batch->cycle_open = false;
+	batch->cycle_complete = false;
+	batch->missing = 0;
+}
+
+void mqtt_batch_init(struct mqtt_batch *batch, uint32_t expected)
+{
+	memset(batch, 0, sizeof(*batch));
+
+	batch->expected = expected;
+}
+
+void mqtt_batch_cycle_start(struct mqtt_batch *batch)
+{
+	if (batch->cycle_open && batch->count > 0) {
+		/* Responses of the previous cycle are missing, publish what was received and open
+		 * the new cycle once the batch has been consumed.
+		 */
+		batch->cycle_complete = true;
+		batch->next_cycle = true;
+
+		return;
+	}
+
+	batch_cycle_open(batch);
+}
+
+int mqtt_batch_add(struct mqtt_batch *batch, const struct mqtt_record *record, int64_t now)
+{
+	if (batch->count >= ARRAY_SIZE(batch->records)) {
+		return -ENOMEM;
+	}
+
+	if (batch->count == 0) {
+		batch->first_time = now;
+	}
+
+	batch->records[batch->count++] = *record;
+
+	if (batch->cycle_open) {
+		batch->missing &= ~BIT(record->type);
+		batch->cycle_complete = (batch->missing == 0);
+	}
+
+	return 0;
+}
+
+bool mqtt_batch_due(const struct mqtt_batch *batch, int64_t now)
+{
+	if (batch->count == 0) {
+		return false;
+	}
+
+	return batch->cycle_complete || batch->flush ||
+	       batch->count >= ARRAY_SIZE(batch->records) ||
+	       mqtt_batch_time_left(batch, now) == 0;
+}
+
+int64_t mqtt_batch_time_left(const struct mqtt_batch *batch, int64_t now)
+{
+	int64_t elapsed;
+
+	if (batch->count == 0) {
+		return -1;
+	}
+
+	if (batch->flush) {
+		return 0;
+	}
+
+	elapsed = now - batch->first_time;
+
+	if (elapsed >= CONFIG_APP_CUSTOM_MQTT_BATCH_TIMEOUT_MS) {
+		return 0;
+	}
+
+	return CONFIG_APP_CUSTOM_MQTT_BATCH_TIMEOUT_MS - elapsed;
+}
+
+void mqtt_batch_flush(struct mqtt_batch *batch)
+{
+	batch->flush = (batch->count > 0);
+}
+
+void mqtt_batch_consume(struct mqtt_batch *batch, size_t count)
+{
+	bool flushed;
+
+	count = MIN(count, batch->count);
+
+	memmove(&batch->records[0], &batch->records[count],
+		(batch->count - count) * sizeof(batch->records[0]));
+
+	batch->count -= count;
+
+	if (batch->count > 0) {
+		return;
+	}
+
+	flushed = batch->flush;
+	batch->flush = false;
+
+	if (batch->next_cycle) {
+		batch_cycle_open(batch);
+	} else if (flushed && batch->cycle_open && !batch->cycle_complete) {
+		/* The rest of the cycle is still to come */
+	} else {
+		batch_cycle_close(batch);
+	}
+}
+
+void mqtt_batch_skip(struct mqtt_batch *batch, enum mqtt_record_type type)
+{
+	if (!batch->cycle_open) {
+		return;
+	}
+
+	batch->missing &= ~BIT(type);
+	batch->cycle_complete = (batch->missing == 0);
+
+	/* Every response of the cycle was skipped, there is nothing to publish */
+	if (batch->cycle_complete && batch->count == 0) {
+		batch_cycle_close(batch);
+	}
+}
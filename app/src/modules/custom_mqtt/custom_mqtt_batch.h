@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CUSTOM_MQTT_BATCH_H_
+#define CUSTOM_MQTT_BATCH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "custom_mqtt_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Collector for the records of one sampling cycle.
+ *
+ * A sampling cycle starts when the main module requests a data send and ends when a response
+ * has been received for every record type in the expected set. Records received outside of a
+ * cycle, for example a location fix that completes just before the cycle starts or UART sensor
+ * readings, are added to the open batch as well.
+ *
+ * The batch is due for publishing when the cycle is complete, when it holds
+ * CONFIG_APP_CUSTOM_MQTT_BATCH_MAX_RECORDS records or when the oldest record has waited for
+ * CONFIG_APP_CUSTOM_MQTT_BATCH_TIMEOUT_MS.
+ *
+ * The batch is not thread safe, it is only used from the MQTT I/O thread.
+ */
+struct mqtt_batch {
+	struct mqtt_record records[CONFIG_APP_CUSTOM_MQTT_BATCH_MAX_RECORDS];
+	size_t count;
+
+	/* Uptime when the first record was added */
+	int64_t first_time;
+
+	/* Bit mask of record types that complete a cycle */
+	uint32_t expected;
+
+	/* Record types still missing in the current cycle */
+	uint32_t missing;
+
+	bool cycle_open;
+	bool cycle_complete;
+
+	/* A new cycle was started before the previous one was published */
+	bool next_cycle;
+
+	/* Publish the batch without waiting for the cycle to complete */
+	bool flush;
+};
+
+/**
+ * @brief Initialize an empty batch.
+ *
+ * @param[out] batch    Batch to initialize.
+ * @param[in]  expected Bit mask of record types, BIT(enum mqtt_record_type), that are received
+ *			once per sampling cycle.
+ */
+void mqtt_batch_init(struct mqtt_batch *batch, uint32_t expected);
+
+/**
+ * @brief Start a new sampling cycle.
+ *
+ * An unfinished cycle is marked complete so that its records are published first, the new
+ * cycle is opened when they have been consumed.
+ *
+ * @param[in,out] batch Batch.
+ */
+void mqtt_batch_cycle_start(struct mqtt_batch *batch);
+
+/**
+ * @brief Add a record to the batch.
+ *
+ * @param[in,out] batch  Batch.
+ * @param[in]     record Record to add.
+ * @param[in]     now    Current uptime in milliseconds.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -ENOMEM if the batch is full.
+ */
+int mqtt_batch_add(struct mqtt_batch *batch, const struct mqtt_record *record, int64_t now);
+
+/**
+ * @brief Check if the batch should be published.
+ *
+ * @param[in] batch Batch.
+ * @param[in] now   Current uptime in milliseconds.
+ *
+ * @returns true if the batch is due.
+ */
+bool mqtt_batch_due(const struct mqtt_batch *batch, int64_t now);
+
+/**
+ * @brief Get the time left until the batch times out.
+ *
+ * @param[in] batch Batch.
+ * @param[in] now   Current uptime in milliseconds.
+ *
+ * @returns Time left in milliseconds, 0 if the batch is due, -1 if the batch is empty.
+ */
+int64_t mqtt_batch_time_left(const struct mqtt_batch *batch, int64_t now);
+
+/**
+ * @brief Make the batch due right away, typically because the connection is used anyway.
+ *
+ * Records of the current cycle that arrive after the batch was published are collected into the
+ * next batch, which completes the cycle. Has no effect on an empty batch.
+ *
+ * @param[in,out] batch Batch.
+ */
+void mqtt_batch_flush(struct mqtt_batch *batch);
+
+/**
+ * @brief Remove the first records from the batch, typically after they have been published.
+ *
+ * The cycle is closed when the batch becomes empty.
+ *
+ * @param[in,out] batch Batch.
+ * @param[in]     count Number of records to remove.
+ */
+void mqtt_batch_consume(struct mqtt_batch *batch, size_t count);
+
+/**
+ * @brief Count a response of the current cycle that is not added to the batch.
+ *
+ * Used for records that are suppressed, so that the cycle still completes without waiting for
+ * the timeout.
+ *
+ * @param[in,out] batch Batch.
+ * @param[in]     type  Type of the skipped record.
+ */
+void mqtt_batch_skip(struct mqtt_batch *batch, enum mqtt_record_type type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUSTOM_MQTT_BATCH_H_ */
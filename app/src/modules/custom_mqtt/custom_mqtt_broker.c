@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <string.h>
+
+#include "custom_mqtt_broker.h"
+
+/* Score added for every failed connection attempt in a row, in milliseconds */
+#define CONNECT_FAILURE_PENALTY_MS 10000
+
+static void mark_down(struct mqtt_broker_list *list, size_t index, int64_t now)
+{
+	struct mqtt_broker_health *health = &list->health[index];
+
+	health->down_until = now + list->config.hold_ms;
+
+	/* Failures before the hold time do not count against the broker afterwards */
+	health->fail_rate = 0;
+
+	if (index == 0) {
+		list->probes = 0;
+	}
+}
+
+/* Another broker than the active one can be connected to */
+static bool other_up(const struct mqtt_broker_list *list, int64_t now)
+{
+	for (size_t i = 0; i < list->count; i++) {
+		if (i != list->active && !mqtt_broker_is_down(list, i, now)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void mqtt_broker_list_init(struct mqtt_broker_list *list, size_t count,
+			   const struct mqtt_broker_config *config)
+{
+	memset(list, 0, sizeof(*list));
+
+	list->config = *config;
+	list->count = (uint8_t)CLAMP(count, 1, MQTT_BROKER_MAX);
+}
+
+uint32_t mqtt_broker_score(const struct mqtt_broker_health *health)
+{
+	return health->connect_ms + health->fail_rate +
+	       health->connect_failures * CONNECT_FAILURE_PENALTY_MS;
+}
+
+bool mqtt_broker_is_down(const struct mqtt_broker_list *list, size_t index, int64_t now)
+{
+	const struct mqtt_broker_health *health = &list->health[index];
+
+	return health->down_until != 0 && now < health->down_until;
+}
+
+size_t mqtt_broker_select(struct mqtt_broker_list *list, int64_t now)
+{
+	size_t selected = 0;
+
+	if (mqtt_broker_is_down(list, 0, now)) {
+		bool found = false;
+
+		for (size_t i = 1; i < list->count; i++) {
+			if (mqtt_broker_is_down(list, i, now)) {
+				continue;
+			}
+
+			if (!found || mqtt_broker_score(&list->health[i]) <
+				      mqtt_broker_score(&list->health[selected])) {
+				selected = i;
+				found = true;
+			}
+		}
+
+		/* Everything is down, use the broker that comes back first */
+		for (size_t i = 1; !found && i < list->count; i++) {
+			if (list->health[i].down_until < list->health[selected].down_until) {
+				selected = i;
+			}
+		}
+	}
+
+	if (selected != list->active) {
+		list->active = (uint8_t)selected;
+		list->switches++;
+	}
+
+	return selected;
+}
+
+void mqtt_broker_connected(struct mqtt_broker_list *list, uint32_t connect_ms)
+{
+	struct mqtt_broker_health *health = &list->health[list->active];
+
+	health->connect_ms = (health->connect_ms == 0) ? connect_ms :
+			     (health->connect_ms * 3 + connect_ms) / 4;
+	health->connect_failures = 0;
+	health->down_until = 0;
+}
+
+bool mqtt_broker_connect_failed(struct mqtt_broker_list *list, int64_t now)
+{
+	struct mqtt_broker_health *health = &list->health[list->active];
+
+	if (health->connect_failures < UINT8_MAX) {
+		health->connect_failures++;
+	}
+
+	if (health->connect_failures < list->config.connect_failures) {
+		return false;
+	}
+
+	mark_down(list, list->active, now);
+
+	return other_up(list, now);
+}
+
+bool mqtt_broker_publish_result(struct mqtt_broker_list *list, bool ok, int64_t now)
+{
+	struct mqtt_broker_health *health = &list->health[list->active];
+
+	health->fail_rate = (health->fail_rate * 7 + (ok ? 0 : MQTT_BROKER_FAIL_RATE_MAX)) / 8;
+
+	if (health->fail_rate < list->config.fail_rate) {
+		return false;
+	}
+
+	mark_down(list, list->active, now);
+
+	return other_up(list, now);
+}
+
+bool mqtt_broker_probe_due(const struct mqtt_broker_list *list, int64_t now)
+{
+	return list->active != 0 && !mqtt_broker_is_down(list, 0, now);
+}
+
+bool mqtt_broker_probe_result(struct mqtt_broker_list *list, int result, uint32_t rtt_ms,
+			      int64_t now)
+{
+	struct mqtt_broker_health *primary = &list->health[0];
+
+	if (result) {
+		mark_down(list, 0, now);
+		return false;
+	}
+
+	primary->probe_rtt_ms = rtt_ms;
+
+	if (++list->probes < list->config.probes) {
+		return false;
+	}
+
+	list->probes = 0;
+	primary->connect_failures = 0;
+	primary->down_until = 0;
+
+	return true;
+}
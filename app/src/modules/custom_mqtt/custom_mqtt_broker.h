@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CUSTOM_MQTT_BROKER_H_
+#define CUSTOM_MQTT_BROKER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Health of an ordered list of brokers.
+ *
+ * The first broker is the primary, the others are fallbacks in order of preference. A broker
+ * is marked down after a number of failed connection attempts in a row, or when its publish
+ * failure rate gets too high, and is then skipped for a hold time. The primary is used whenever
+ * it is not marked down. Among the fallbacks, the one with the lowest score is used.
+ *
+ * While connected to a fallback, the primary is probed. Once enough probes in a row have
+ * succeeded, the primary is marked up again and the caller moves back to it.
+ *
+ * The list is not thread safe, it is only used from the MQTT I/O thread.
+ */
+
+/** Maximum number of brokers, the primary included. */
+#define MQTT_BROKER_MAX 4
+
+/** Publish failure rate of a broker where every publish failed, see mqtt_broker_health. */
+#define MQTT_BROKER_FAIL_RATE_MAX 1000
+
+/** @brief Failover parameters. */
+struct mqtt_broker_config {
+	/** Failed connection attempts in a row after which a broker is marked down. */
+	uint8_t connect_failures;
+
+	/** Publish failure rate in 1/1000 at which a broker is marked down. */
+	uint16_t fail_rate;
+
+	/** Time a broker that was marked down is skipped, in milliseconds. */
+	uint32_t hold_ms;
+
+	/** Successful probes in a row after which the primary is marked up again. */
+	uint8_t probes;
+};
+
+/** @brief Health of one broker. */
+struct mqtt_broker_health {
+	/** Smoothed time from connecting until the CONNACK in milliseconds, 0 if unknown. */
+	uint32_t connect_ms;
+
+	/** Smoothed publish failure rate in 1/1000. */
+	uint16_t fail_rate;
+
+	/** Failed connection attempts since the last successful one. */
+	uint8_t connect_failures;
+
+	/** Round trip time of the last successful probe in milliseconds, 0 if none. */
+	uint32_t probe_rtt_ms;
+
+	/** Uptime in milliseconds until which the broker is marked down, 0 if it is up. */
+	int64_t down_until;
+};
+
+/** @brief Broker list. */
+struct mqtt_broker_list {
+	struct mqtt_broker_health health[MQTT_BROKER_MAX];
+
+	/** Failover parameters. */
+	struct mqtt_broker_config config;
+
+	/** Number of brokers, at least 1. */
+	uint8_t count;
+
+	/** Broker of the current or the last connection attempt. */
+	uint8_t active;
+
+	/** Successful probes of the primary in a row. */
+	uint8_t probes;
+
+	/** Number of times another broker than the active one was selected. */
+	uint32_t switches;
+};
+
+/**
+ * @brief Initialize a list with all brokers up and no history.
+ *
+ * @param[out] list   List to initialize.
+ * @param[in]  count  Number of brokers, clamped to 1 ... MQTT_BROKER_MAX.
+ * @param[in]  config Failover parameters.
+ */
+void mqtt_broker_list_init(struct mqtt_broker_list *list, size_t count,
+			   const struct mqtt_broker_config *config);
+
+/**
+ * @brief Get the score of a broker. Brokers with a lower score are preferred.
+ *
+ * The score is the smoothed connect time, plus one millisecond for every 1/1000 of publish
+ * failure rate, plus 10 seconds for every failed connection attempt in a row.
+ *
+ * @param[in] health Broker health.
+ *
+ * @returns Score of the broker.
+ */
+uint32_t mqtt_broker_score(const struct mqtt_broker_health *health);
+
+/**
+ * @brief Check if a broker is marked down.
+ *
+ * @param[in] list  Broker list.
+ * @param[in] index Broker.
+ * @param[in] now   Current uptime in milliseconds.
+ *
+ * @returns true if the broker is skipped until its hold time has passed.
+ */
+bool mqtt_broker_is_down(const struct mqtt_broker_list *list, size_t index, int64_t now);
+
+/**
+ * @brief Select the broker for the next connection attempt and make it the active one.
+ *
+ * The primary is selected if it is up, otherwise the fallback with the lowest score that is up.
+ * If all brokers are down, the one whose hold time ends first is selected.
+ *
+ * @param[in,out] list Broker list.
+ * @param[in]     now  Current uptime in milliseconds.
+ *
+ * @returns Index of the selected broker.
+ */
+size_t mqtt_broker_select(struct mqtt_broker_list *list, int64_t now);
+
+/**
+ * @brief Record a successful connection to the active broker.
+ *
+ * @param[in,out] list       Broker list.
+ * @param[in]     connect_ms Time from connecting until the CONNACK in milliseconds.
+ */
+void mqtt_broker_connected(struct mqtt_broker_list *list, uint32_t connect_ms);
+
+/**
+ * @brief Record a failed connection attempt to the active broker.
+ *
+ * @param[in,out] list Broker list.
+ * @param[in]     now  Current uptime in milliseconds.
+ *
+ * @returns true if the broker has been marked down and another broker is up, the next attempt
+ *	    can be made right away.
+ */
+bool mqtt_broker_connect_failed(struct mqtt_broker_list *list, int64_t now);
+
+/**
+ * @brief Record the outcome of a publish to the active broker.
+ *
+ * @param[in,out] list Broker list.
+ * @param[in]     ok   The publish was acknowledged, false if it failed.
+ * @param[in]     now  Current uptime in milliseconds.
+ *
+ * @returns true if the broker has been marked down and another broker is up, the connection
+ *	    should be moved to it.
+ */
+bool mqtt_broker_publish_result(struct mqtt_broker_list *list, bool ok, int64_t now);
+
+/**
+ * @brief Check if the primary should be probed.
+ *
+ * @param[in] list Broker list.
+ * @param[in] now  Current uptime in milliseconds.
+ *
+ * @returns true if a fallback is active and the hold time of the primary has passed.
+ */
+bool mqtt_broker_probe_due(const struct mqtt_broker_list *list, int64_t now);
+
+/**
+ * @brief Record the outcome of a probe of the primary.
+ *
+ * A failed probe marks the primary down for another hold time.
+ *
+ * @param[in,out] list   Broker list.
+ * @param[in]     result 0 if the primary could be reached, otherwise a (negative) error code.
+ * @param[in]     rtt_ms Round trip time of the probe in milliseconds.
+ * @param[in]     now    Current uptime in milliseconds.
+ *
+ * @returns true if the primary is healthy again and the connection should be moved to it.
+ */
+bool mqtt_broker_probe_result(struct mqtt_broker_list *list, int result, uint32_t rtt_ms,
+			      int64_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUSTOM_MQTT_BROKER_H_ */
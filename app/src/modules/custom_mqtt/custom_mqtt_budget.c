@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <string.h>
+
+#include "custom_mqtt_budget.h"
+
+/* Tokens per byte, a rate in bytes per minute adds this many tokens per byte and millisecond */
+#define TOKENS_PER_BYTE ((int64_t)SEC_PER_MIN * MSEC_PER_SEC)
+
+static void refill(struct mqtt_budget *budget, int64_t now)
+{
+	int64_t elapsed = now - budget->refill_time;
+
+	if (elapsed <= 0) {
+		return;
+	}
+
+	budget->refill_time = now;
+
+	for (size_t i = 0; i < MQTT_BUDGET_CLASS_COUNT; i++) {
+		const struct mqtt_budget_rate *rate = &budget->config.rates[i];
+
+		budget->tokens[i] = MIN(budget->tokens[i] + elapsed * rate->rate,
+					(int64_t)rate->burst * TOKENS_PER_BYTE);
+	}
+}
+
+static bool limit_reached(const struct mqtt_budget *budget)
+{
+	const struct mqtt_budget_config *config = &budget->config;
+	const struct mqtt_budget_usage *usage = &budget->usage;
+
+	return (config->daily_limit != 0 && usage->daily_bytes >= config->daily_limit) ||
+	       (config->monthly_limit != 0 && usage->monthly_bytes >= config->monthly_limit);
+}
+
+static void count_add(uint32_t *count, uint32_t bytes)
+{
+	*count = (*count > UINT32_MAX - bytes) ? UINT32_MAX : *count + bytes;
+}
+
+void mqtt_budget_init(struct mqtt_budget *budget, const struct mqtt_budget_config *config,
+		      int64_t now)
+{
+	memset(budget, 0, sizeof(*budget));
+
+	budget->config = *config;
+	budget->refill_time = now;
+
+	for (size_t i = 0; i < MQTT_BUDGET_CLASS_COUNT; i++) {
+		budget->tokens[i] = (int64_t)config->rates[i].burst * TOKENS_PER_BYTE;
+	}
+}
+
+uint32_t mqtt_budget_month(uint32_t day)
+{
+	/* Civil date from days since the epoch, with years starting in March */
+	uint32_t z = day + 719468;
+	uint32_t era = z / 146097;
+	uint32_t doe = z - era * 146097;
+	uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	uint32_t mp = (5 * doy + 2) / 153;
+	uint32_t month = (mp < 10) ? mp + 2 : mp - 10;
+	uint32_t year = yoe + era * 400 + ((month < 2) ? 1 : 0);
+
+	return (year - 1970) * 12 + month;
+}
+
+bool mqtt_budget_period(struct mqtt_budget *budget, uint32_t day)
+{
+	struct mqtt_budget_usage *usage = &budget->usage;
+	uint32_t month = mqtt_budget_month(day);
+
+	if (usage->day == day) {
+		return false;
+	}
+
+	if (usage->day != 0) {
+		usage->daily_bytes = 0;
+
+		if (usage->month != month) {
+			usage->monthly_bytes = 0;
+			memset(usage->class_bytes, 0, sizeof(usage->class_bytes));
+		}
+	}
+
+	usage->day = day;
+	usage->month = month;
+
+	return true;
+}
+
+bool mqtt_budget_allow(struct mqtt_budget *budget, enum mqtt_budget_class cls, int64_t now)
+{
+	return mqtt_budget_wait(budget, cls, now) == 0;
+}
+
+void mqtt_budget_spend(struct mqtt_budget *budget, enum mqtt_budget_class cls,
+		       uint32_t bytes, int64_t now)
+{
+	struct mqtt_budget_usage *usage = &budget->usage;
+
+	refill(budget, now);
+
+	if (budget->config.rates[cls].rate != 0) {
+		budget->tokens[cls] -= (int64_t)bytes * TOKENS_PER_BYTE;
+	}
+
+	count_add(&usage->daily_bytes, bytes);
+	count_add(&usage->monthly_bytes, bytes);
+	count_add(&usage->class_bytes[cls], bytes);
+}
+
+int64_t mqtt_budget_wait(struct mqtt_budget *budget, enum mqtt_budget_class cls, int64_t now)
+{
+	uint32_t rate = budget->config.rates[cls].rate;
+
+	if (limit_reached(budget)) {
+		return -1;
+	}
+
+	if (rate == 0) {
+		return 0;
+	}
+
+	refill(budget, now);
+
+	if (budget->tokens[cls] > 0) {
+		return 0;
+	}
+
+	/* Until the bucket holds more than nothing again */
+	return -budget->tokens[cls] / rate + 1;
+}
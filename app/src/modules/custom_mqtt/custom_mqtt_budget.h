@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CUSTOM_MQTT_BUDGET_H_
+#define CUSTOM_MQTT_BUDGET_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Uplink byte budget.
+ *
+ * Every data class has a token bucket that is refilled at a fixed rate up to a burst size. A
+ * message is allowed while its class has tokens left, and its size is taken from the bucket
+ * once it has been sent. The bucket may go negative after a message that was larger than the
+ * tokens left, the class then waits until the debt has been refilled.
+ *
+ * On top of that, the bytes sent by all classes are counted per calendar day and month (UTC) and
+ * checked against daily and monthly limits. The counts are meant to be stored across reboots.
+ *
+ * The budget is not thread safe, callers serialize access.
+ */
+
+/** @brief Data classes with their own token bucket. */
+enum mqtt_budget_class {
+	/** Environmental and power records. */
+	MQTT_BUDGET_TELEMETRY,
+	/** Location records. */
+	MQTT_BUDGET_LOCATION,
+	/** UART sensor probe records. */
+	MQTT_BUDGET_PROBE,
+	/** Heartbeats, status messages and command acknowledgments. */
+	MQTT_BUDGET_DIAGNOSTICS,
+	MQTT_BUDGET_CLASS_COUNT,
+};
+
+/** @brief Token bucket parameters of a class. */
+struct mqtt_budget_rate {
+	/** Refill rate in bytes per minute, 0 for no rate limit. */
+	uint32_t rate;
+
+	/** Bucket size in bytes, the most a class can send at once after being idle. */
+	uint32_t burst;
+};
+
+/** @brief Budget parameters. */
+struct mqtt_budget_config {
+	struct mqtt_budget_rate rates[MQTT_BUDGET_CLASS_COUNT];
+
+	/** Bytes per day for all classes together, 0 for no limit. */
+	uint32_t daily_limit;
+
+	/** Bytes per month for all classes together, 0 for no limit. */
+	uint32_t monthly_limit;
+};
+
+/** @brief Byte counts of the current day and month, stored across reboots. */
+struct mqtt_budget_usage {
+	/** Day of the daily count in days since 1970-01-01, 0 while the date is not known. */
+	uint32_t day;
+
+	/** Month of the monthly count in months since January 1970. */
+	uint32_t month;
+
+	uint32_t daily_bytes;
+	uint32_t monthly_bytes;
+
+	/** Bytes sent by each class this month. */
+	uint32_t class_bytes[MQTT_BUDGET_CLASS_COUNT];
+};
+
+/** @brief Budget state. */
+struct mqtt_budget {
+	struct mqtt_budget_config config;
+	struct mqtt_budget_usage usage;
+
+	/* Tokens of each class in 1/60000 bytes, so that a millisecond at a rate in bytes per
+	 * minute adds a whole number of them.
+	 */
+	int64_t tokens[MQTT_BUDGET_CLASS_COUNT];
+
+	/* Uptime of the last refill in milliseconds */
+	int64_t refill_time;
+
+	/** Records of each class that were aggregated or dropped because of the budget. */
+	uint32_t limited[MQTT_BUDGET_CLASS_COUNT];
+};
+
+/**
+ * @brief Initialize a budget with full buckets and no bytes counted.
+ *
+ * @param[out] budget Budget to initialize.
+ * @param[in]  config Budget parameters.
+ * @param[in]  now    Current uptime in milliseconds.
+ */
+void mqtt_budget_init(struct mqtt_budget *budget, const struct mqtt_budget_config *config,
+		      int64_t now);
+
+/**
+ * @brief Get the month of a day.
+ *
+ * @param[in] day Days since 1970-01-01.
+ *
+ * @returns Months since January 1970.
+ */
+uint32_t mqtt_budget_month(uint32_t day);
+
+/**
+ * @brief Move the byte counts to the current day.
+ *
+ * The daily count is reset when the day has changed, the monthly counts when the month has
+ * changed. Bytes counted while the date was not known are kept, they count towards the current
+ * day.
+ *
+ * @param[in,out] budget Budget.
+ * @param[in]     day    Current day in days since 1970-01-01.
+ *
+ * @returns true if the usage has changed and should be stored.
+ */
+bool mqtt_budget_period(struct mqtt_budget *budget, uint32_t day);
+
+/**
+ * @brief Check if a class may send now.
+ *
+ * @param[in,out] budget Budget, its buckets are refilled.
+ * @param[in]     cls    Data class.
+ * @param[in]     now    Current uptime in milliseconds.
+ *
+ * @returns true if the class has tokens left and the daily and monthly limits are not reached.
+ */
+bool mqtt_budget_allow(struct mqtt_budget *budget, enum mqtt_budget_class cls, int64_t now);
+
+/**
+ * @brief Take the size of a sent message from the bucket of its class and count it.
+ *
+ * @param[in,out] budget Budget.
+ * @param[in]     cls    Data class.
+ * @param[in]     bytes  Size of the message.
+ * @param[in]     now    Current uptime in milliseconds.
+ */
+void mqtt_budget_spend(struct mqtt_budget *budget, enum mqtt_budget_class cls,
+		       uint32_t bytes, int64_t now);
+
+/**
+ * @brief Get the time until a class may send again.
+ *
+ * @param[in,out] budget Budget, its buckets are refilled.
+ * @param[in]     cls    Data class.
+ * @param[in]     now    Current uptime in milliseconds.
+ *
+ * @returns Time in milliseconds, 0 if the class may send now, -1 if a daily or monthly limit is
+ *	    reached.
+ */
+int64_t mqtt_budget_wait(struct mqtt_budget *budget, enum mqtt_budget_class cls, int64_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUSTOM_MQTT_BUDGET_H_ */
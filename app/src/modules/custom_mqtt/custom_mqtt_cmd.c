@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "custom_mqtt_cmd.h"
+#include "custom_mqtt_json.h"
+
+/* Kept out of the stack of the dispatching thread, see mqtt_cmd_dispatch() */
+static struct mqtt_json_tok toks[MQTT_CMD_MAX_TOKENS];
+
+/* Copy a token into a NULL terminated string */
+static int tok_copy(const char *json, const struct mqtt_json_tok *tok, char *buf, size_t size)
+{
+	size_t len = tok->end - tok->start;
+
+	if (len >= size) {
+		return -EINVAL;
+	}
+
+	memcpy(buf, &json[tok->start], len);
+	buf[len] = '\0';
+
+	return 0;
+}
+
+static const struct mqtt_cmd *cmd_find(const char *json, const struct mqtt_json_tok *tok)
+{
+	STRUCT_SECTION_FOREACH(mqtt_cmd, cmd) {
+		if (mqtt_json_tok_eq(json, tok, cmd->name)) {
+			return cmd;
+		}
+	}
+
+	return NULL;
+}
+
+static int arg_parse(const char *json, const struct mqtt_json_tok *tok,
+		     const struct mqtt_cmd_arg_desc *desc, struct mqtt_cmd_arg *arg)
+{
+	int err = 0;
+
+	switch (desc->type) {
+	case MQTT_CMD_ARG_INT:
+		err = mqtt_json_tok_int(json, tok, &arg->i);
+		break;
+	case MQTT_CMD_ARG_BOOL:
+		err = mqtt_json_tok_bool(json, tok, &arg->b);
+		break;
+	case MQTT_CMD_ARG_STR:
+		if (tok->type != MQTT_JSON_TOK_STRING) {
+			return -EINVAL;
+		}
+
+		arg->str.ptr = &json[tok->start];
+		arg->str.len = tok->end - tok->start;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (err) {
+		/* Out of range values are invalid arguments as far as the sender is concerned */
+		return -EINVAL;
+	}
+
+	arg->present = true;
+
+	return 0;
+}
+
+/* Fill the arguments of a command from the members of the message object */
+static int args_parse(const char *json, size_t count, const struct mqtt_cmd *cmd,
+		      struct mqtt_cmd_arg *args)
+{
+	int index;
+	int err;
+
+	for (size_t i = 0; i < cmd->arg_count; i++) {
+		const struct mqtt_cmd_arg_desc *desc = &cmd->args[i];
+
+		index = mqtt_json_obj_get(json, toks, count, 0, desc->name);
+		if (index == -ENOENT) {
+			if (desc->required) {
+				return -EINVAL;
+			}
+
+			continue;
+		} else if (index < 0) {
+			return index;
+		}
+
+		err = arg_parse(json, &toks[index], desc, &args[i]);
+		if (err) {
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+static int dispatch(const char *payload, size_t len, struct mqtt_record_ack *ack)
+{
+	struct mqtt_cmd_arg args[MQTT_CMD_MAX_ARGS] = { 0 };
+	const struct mqtt_cmd *cmd;
+	int count;
+	int index;
+	int err;
+
+	count = mqtt_json_tokenize(payload, len, toks, ARRAY_SIZE(toks));
+	if (count < 0 || toks[0].type != MQTT_JSON_TOK_OBJECT) {
+		return -EBADMSG;
+	}
+
+	/* The ID is copied first so that even a rejected command can be correlated */
+	index = mqtt_json_obj_get(payload, toks, count, 0, "id");
+	if (index >= 0 && (toks[index].type == MQTT_JSON_TOK_OBJECT ||
+			   toks[index].type == MQTT_JSON_TOK_ARRAY ||
+			   tok_copy(payload, &toks[index], ack->id, sizeof(ack->id)))) {
+		return -EINVAL;
+	}
+
+	index = mqtt_json_obj_get(payload, toks, count, 0, "command");
+	if (index < 0 || toks[index].type != MQTT_JSON_TOK_STRING) {
+		return -EBADMSG;
+	}
+
+	/* A name too long for the acknowledgment cannot be registered either */
+	if (tok_copy(payload, &toks[index], ack->command, sizeof(ack->command))) {
+		return -ENOENT;
+	}
+
+	cmd = cmd_find(payload, &toks[index]);
+	if (cmd == NULL) {
+		return -ENOENT;
+	}
+
+	err = args_parse(payload, count, cmd, args);
+	if (err) {
+		return err;
+	}
+
+	return cmd->handler(args);
+}
+
+int mqtt_cmd_dispatch(const char *payload, size_t len, struct mqtt_record_ack *ack)
+{
+	memset(ack, 0, sizeof(*ack));
+
+	ack->result = dispatch(payload, len, ack);
+
+	return ack->result;
+}
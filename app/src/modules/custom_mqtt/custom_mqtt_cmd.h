@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CUSTOM_MQTT_CMD_H_
+#define CUSTOM_MQTT_CMD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/sys/iterable_sections.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/toolchain.h>
+
+#include "custom_mqtt_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Downlink command router.
+ *
+ * Commands are received as a flat JSON object on the subscribe topic:
+ *
+ *	{"command":"<name>","id":"<optional ID>","<argument>":<value>,...}
+ *
+ * Each command is registered with MQTT_CMD_DEFINE() in an iterable linker section, in the same
+ * way as shell commands, so modules can add commands without a central table. Arguments are
+ * checked against the schema of the command before its handler is called, and the outcome is
+ * reported in an acknowledgment record.
+ */
+
+/** Maximum number of arguments of a command. */
+#define MQTT_CMD_MAX_ARGS 4
+
+/** Maximum number of JSON tokens in a command message. */
+#define MQTT_CMD_MAX_TOKENS 32
+
+/** @brief Argument types. */
+enum mqtt_cmd_arg_type {
+	/** JSON integer that fits in 32 bits. */
+	MQTT_CMD_ARG_INT,
+	/** JSON true or false. */
+	MQTT_CMD_ARG_BOOL,
+	/** JSON string, passed without decoding escape sequences. */
+	MQTT_CMD_ARG_STR,
+};
+
+/** @brief Argument schema entry. */
+struct mqtt_cmd_arg_desc {
+	/** Member name in the command message. */
+	const char *name;
+	enum mqtt_cmd_arg_type type;
+	/** The command is rejected if the argument is missing. */
+	bool required;
+};
+
+/** @brief Parsed argument, in the order of the schema. */
+struct mqtt_cmd_arg {
+	/** The argument was present in the message. */
+	bool present;
+
+	union {
+		/** MQTT_CMD_ARG_INT */
+		int32_t i;
+
+		/** MQTT_CMD_ARG_BOOL */
+		bool b;
+
+		/** MQTT_CMD_ARG_STR, points into the received message, not NULL terminated. */
+		struct {
+			const char *ptr;
+			size_t len;
+		} str;
+	};
+};
+
+/**
+ * @brief Command handler.
+ *
+ * @param[in] args Arguments in schema order, only valid during the call.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned, it is sent in the acknowledgment.
+ */
+typedef int (*mqtt_cmd_handler_t)(const struct mqtt_cmd_arg *args);
+
+/** @brief Registered command. */
+struct mqtt_cmd {
+	const char *name;
+	mqtt_cmd_handler_t handler;
+	const struct mqtt_cmd_arg_desc *args;
+	size_t arg_count;
+};
+
+/**
+ * @brief Argument schema entry, for use in MQTT_CMD_DEFINE().
+ *
+ * @param _name     Member name.
+ * @param _type     Argument type, INT, BOOL or STR.
+ * @param _required The command is rejected if the argument is missing.
+ */
+#define MQTT_CMD_ARG(_name, _type, _required)						\
+	{ .name = (_name), .type = _CONCAT(MQTT_CMD_ARG_, _type), .required = (_required) }
+
+/**
+ * @brief Register a downlink command.
+ *
+ * @param _name    Command name, a C identifier that is matched with the "command" member.
+ * @param _handler Handler, see mqtt_cmd_handler_t.
+ * @param ...      Argument schema, MQTT_CMD_ARG() entries. May be empty.
+ */
+#define MQTT_CMD_DEFINE(_name, _handler, ...)						\
+	static const struct mqtt_cmd_arg_desc _CONCAT(mqtt_cmd_args_, _name)[] = {	\
+		__VA_ARGS__								\
+	};										\
+	BUILD_ASSERT(ARRAY_SIZE(_CONCAT(mqtt_cmd_args_, _name)) <= MQTT_CMD_MAX_ARGS,	\
+		     "Too many arguments for command " #_name);				\
+	BUILD_ASSERT(sizeof(#_name) <= MQTT_RECORD_COMMAND_SIZE,			\
+		     "Command name " #_name " is too long");				\
+	static const STRUCT_SECTION_ITERABLE(mqtt_cmd, _CONCAT(mqtt_cmd_, _name)) = {	\
+		.name = #_name,								\
+		.handler = (_handler),							\
+		.args = _CONCAT(mqtt_cmd_args_, _name),					\
+		.arg_count = ARRAY_SIZE(_CONCAT(mqtt_cmd_args_, _name)),		\
+	}
+
+/**
+ * @brief Parse a command message and run the command handler in the calling thread.
+ *
+ * Not reentrant, commands are expected to be dispatched from a single thread.
+ *
+ * @param[in]  payload Command message, does not need to be NULL terminated.
+ * @param[in]  len     Length of the message.
+ * @param[out] ack     Command name, ID and result to acknowledge.
+ *
+ * @returns 0 if the command was executed successfully.
+ *	    Otherwise, a (negative) error code is returned, the same as in the acknowledgment.
+ * @retval -EBADMSG if the message is not a JSON object with a "command" string.
+ * @retval -ENOENT if no command with that name is registered.
+ * @retval -EINVAL if an argument is missing or has the wrong type, or the ID is too long.
+ */
+int mqtt_cmd_dispatch(const char *payload, size_t len, struct mqtt_record_ack *ack);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUSTOM_MQTT_CMD_H_ */
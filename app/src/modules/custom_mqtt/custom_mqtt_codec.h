@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CUSTOM_MQTT_CODEC_H_
+#define CUSTOM_MQTT_CODEC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum length of a UART sensor probe identifier, including the NULL terminator. */
+#define MQTT_RECORD_PROBE_ID_SIZE 32
+
+/** Maximum length of a downlink command name, including the NULL terminator. */
+#define MQTT_RECORD_COMMAND_SIZE 16
+
+/** Maximum length of a downlink command ID, including the NULL terminator. */
+#define MQTT_RECORD_COMMAND_ID_SIZE 24
+
+/** Number of histogram summaries in a heartbeat, the first ones of enum custom_mqtt_hist_type. */
+#define MQTT_RECORD_STATS_COUNT 5
+
+/**
+ * @brief Uplink record types.
+ *
+ * The values are part of the CBOR wire format defined in telemetry.cddl and must not change.
+ */
+enum mqtt_record_type {
+	MQTT_RECORD_ENVIRONMENTAL = 1,
+	MQTT_RECORD_POWER = 2,
+	MQTT_RECORD_LOCATION = 3,
+	MQTT_RECORD_UART_SENSOR = 4,
+	MQTT_RECORD_HEARTBEAT = 5,
+	MQTT_RECORD_STATUS = 6,
+	/** Several records published together, only used on the wire. */
+	MQTT_RECORD_BATCH = 7,
+	MQTT_RECORD_ACK = 8,
+};
+
+/** @brief Acknowledgment of a downlink command. */
+struct mqtt_record_ack {
+	/** Command name, empty if the message did not name a command. */
+	char command[MQTT_RECORD_COMMAND_SIZE];
+
+	/** ID copied from the command message, empty if it had none. */
+	char id[MQTT_RECORD_COMMAND_ID_SIZE];
+
+	/** 0 if the command was executed, otherwise a (negative) error code. */
+	int32_t result;
+};
+
+/** @brief Summary of a histogram. */
+struct mqtt_record_stats {
+	/** Number of values. */
+	uint32_t count;
+
+	/** Upper bounds of the 50th and 90th percentile. */
+	uint32_t p50;
+	uint32_t p90;
+
+	/** Largest value. */
+	uint32_t max;
+};
+
+/**
+ * @brief Typed uplink record.
+ *
+ * Holds validated values of a single uplink message independently of the payload format that
+ * is selected at build time.
+ */
+struct mqtt_record {
+	enum mqtt_record_type type;
+
+	/** Publish sequence number. */
+	uint32_t sequence;
+
+	/** Uptime when the record was created, in milliseconds. */
+	int64_t timestamp;
+
+	/** UNIX time when the record was created, in milliseconds. 0 while the time is not known,
+	 *  records created before the time sync are corrected from their uptime later on.
+	 */
+	int64_t time;
+
+	union {
+		/** MQTT_RECORD_ENVIRONMENTAL */
+		struct {
+			double temperature;
+			double humidity;
+			double pressure;
+			/** Sample time reported by the sensor module, 0 if not available. */
+			int64_t sample_time;
+		} environmental;
+
+		/** MQTT_RECORD_POWER */
+		struct {
+			double percentage;
+			double voltage;
+			double current_ma;
+			double temperature;
+			/** Sample time reported by the power module, 0 if not available. */
+			int64_t sample_time;
+		} power;
+
+		/** MQTT_RECORD_LOCATION */
+		struct {
+			double latitude;
+			double longitude;
+			double accuracy;
+		} location;
+
+		/** MQTT_RECORD_UART_SENSOR */
+		struct {
+			float temperature;
+			float humidity;
+			float probe_battery;
+			char probe_id[MQTT_RECORD_PROBE_ID_SIZE];
+			/** Sample time reported by the UART sensor module, 0 if not available. */
+			int64_t sample_time;
+		} uart_sensor;
+
+		/** MQTT_RECORD_HEARTBEAT */
+		struct {
+			int64_t uptime_ms;
+			uint32_t publish_failures;
+			uint32_t total_publishes;
+			bool network_connected;
+			int32_t mqtt_state;
+			/** Records not sent because their values did not change significantly. */
+			uint32_t suppressed_records;
+#if defined(CONFIG_APP_CUSTOM_MQTT_STATS_HEARTBEAT)
+			/** Histogram summaries since boot. */
+			struct mqtt_record_stats stats[MQTT_RECORD_STATS_COUNT];
+#endif
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET)
+			/** Uplink bytes of the current day and month. */
+			uint32_t daily_bytes;
+			uint32_t monthly_bytes;
+			/** Records held back or dropped because their budget was exhausted. */
+			uint32_t budget_limited;
+#endif
+		} heartbeat;
+
+		/** MQTT_RECORD_ACK */
+		struct mqtt_record_ack ack;
+	};
+};
+
+/**
+ * @brief Encode an uplink record in the payload format selected at build time.
+ *
+ * @param[in]  record Record to encode.
+ * @param[out] buf    Output buffer.
+ * @param[in]  size   Size of the output buffer.
+ *
+ * @returns Length of the encoded record on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -ENOMEM if the encoded record did not fit in the buffer.
+ * @retval -EINVAL if the record contained a value that cannot be encoded.
+ */
+int mqtt_codec_encode(const struct mqtt_record *record, uint8_t *buf, size_t size);
+
+/**
+ * @brief Get the time base of a batch.
+ *
+ * A batch carries the time of its oldest record once, the records only carry their offset from
+ * it. The base is a UNIX time if all records have one, otherwise the batch falls back to uptime.
+ *
+ * @param[in]  records Records of the batch.
+ * @param[in]  count   Number of records, at least one.
+ * @param[out] base    Time base in milliseconds.
+ *
+ * @returns true if the base is a UNIX time, false if it is an uptime.
+ */
+static inline bool mqtt_codec_batch_base(const struct mqtt_record *records, size_t count,
+					 int64_t *base)
+{
+	bool epoch = true;
+
+	for (size_t i = 0; i < count; i++) {
+		epoch = epoch && (records[i].time != 0);
+	}
+
+	*base = epoch ? records[0].time : records[0].timestamp;
+
+	for (size_t i = 1; i < count; i++) {
+		int64_t time = epoch ? records[i].time : records[i].timestamp;
+
+		*base = (time < *base) ? time : *base;
+	}
+
+	return epoch;
+}
+
+/**
+ * @brief Get the offset of a record from the time base of its batch.
+ *
+ * @param[in] record Record of the batch.
+ * @param[in] epoch  Whether the base is a UNIX time, see mqtt_codec_batch_base().
+ * @param[in] base   Time base in milliseconds.
+ *
+ * @returns Offset in milliseconds, never negative.
+ */
+static inline int64_t mqtt_codec_batch_offset(const struct mqtt_record *record, bool epoch,
+					      int64_t base)
+{
+	return (epoch ? record->time : record->timestamp) - base;
+}
+
+/**
+ * @brief Encode several records as one batch message.
+ *
+ * The device ID, sequence number and time base are only sent once for the whole batch, records
+ * keep their type and carry their time as an offset from the base, see mqtt_codec_batch_base().
+ *
+ * @param[in]  sequence Publish sequence number of the batch.
+ * @param[in]  records  Records to encode.
+ * @param[in]  count    Number of records, at least one.
+ * @param[out] buf      Output buffer.
+ * @param[in]  size     Size of the output buffer.
+ *
+ * @returns Length of the encoded batch on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -ENOMEM if the encoded batch did not fit in the buffer.
+ * @retval -EINVAL if a record contained a value that cannot be encoded.
+ */
+int mqtt_codec_encode_batch(uint32_t sequence, const struct mqtt_record *records, size_t count,
+			    uint8_t *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUSTOM_MQTT_CODEC_H_ */
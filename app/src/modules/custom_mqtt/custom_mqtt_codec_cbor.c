@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zcbor_encode.h>
+#include <zephyr/sys/util.h>
+
+#include "custom_mqtt_codec.h"
+#include "custom_mqtt_config.h"
+#include "telemetry_encode.h"
+
+/* Largest encoded record inside a batch, the UART sensor record with a full probe ID */
+#define BATCH_ENTRY_MAX_SIZE	128
+
+/* Fill the header fields that are common to all records in telemetry.cddl */
+#define RECORD_HEADER_SET(_out, _record, _device_id) do {			\
+	(_out).device_id.value = (const uint8_t *)(_device_id);			\
+	(_out).device_id.len = strlen(_device_id);				\
+	(_out).timestamp = (_record)->timestamp;				\
+	(_out).sequence = (_record)->sequence;					\
+} while (0)
+
+static int encode_environmental(const struct mqtt_record *record, const char *device_id,
+				uint8_t *buf, size_t size, size_t *len)
+{
+	struct environmental_record out = {
+		.temperature = (float)record->environmental.temperature,
+		.humidity = (float)record->environmental.humidity,
+		.pressure = (float)record->environmental.pressure,
+		.sample_time = record->environmental.sample_time,
+	};
+
+	RECORD_HEADER_SET(out, record, device_id);
+
+	return cbor_encode_environmental_record(buf, size, &out, len);
+}
+
+static int encode_power(const struct mqtt_record *record, const char *device_id,
+			uint8_t *buf, size_t size, size_t *len)
+{
+	struct power_record out = {
+		.percentage = (float)record->power.percentage,
+		.voltage = (float)record->power.voltage,
+		.current_ma = (float)record->power.current_ma,
+		.temperature = (float)record->power.temperature,
+		.sample_time = record->power.sample_time,
+	};
+
+	RECORD_HEADER_SET(out, record, device_id);
+
+	return cbor_encode_power_record(buf, size, &out, len);
+}
+
+static int encode_location(const struct mqtt_record *record, const char *device_id,
+			   uint8_t *buf, size_t size, size_t *len)
+{
+	struct location_record out = {
+		.lat = record->location.latitude,
+		.lng = record->location.longitude,
+		.acc = (float)record->location.accuracy,
+	};
+
+	RECORD_HEADER_SET(out, record, device_id);
+
+	return cbor_encode_location_record(buf, size, &out, len);
+}
+
+static int encode_uart_sensor(const struct mqtt_record *record, const char *device_id,
+			      uint8_t *buf, size_t size, size_t *len)
+{
+	struct uart_sensor_record out = {
+		.temperature = record->uart_sensor.temperature,
+		.humidity = record->uart_sensor.humidity,
+		.probe_id.value = (const uint8_t *)record->uart_sensor.probe_id,
+		.probe_id.len = strnlen(record->uart_sensor.probe_id,
+					sizeof(record->uart_sensor.probe_id)),
+		.probe_battery = record->uart_sensor.probe_battery,
+		.sample_time = record->uart_sensor.sample_time,
+	};
+
+	RECORD_HEADER_SET(out, record, device_id);
+
+	return cbor_encode_uart_sensor_record(buf, size, &out, len);
+}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_STATS_HEARTBEAT) || defined(CONFIG_APP_CUSTOM_MQTT_BUDGET)
+/* Number of elements in the heartbeat-record, with the optional stats and budget */
+#define HEARTBEAT_ELEMENTS (10 + IS_ENABLED(CONFIG_APP_CUSTOM_MQTT_STATS_HEARTBEAT) + \
+			    IS_ENABLED(CONFIG_APP_CUSTOM_MQTT_BUDGET))
+
+/* heartbeat-record with the optional stats and budget in telemetry.cddl, built from zcbor
+ * primitives like the batch. Returns a ZCBOR_ERR_* code like the generated functions.
+ */
+static int encode_heartbeat(const struct mqtt_record *record, const char *device_id,
+			    uint8_t *buf, size_t size, size_t *len)
+{
+	ZCBOR_STATE_E(state, 3, buf, size, 1);
+	bool ok;
+
+	ok = zcbor_list_start_encode(state, HEARTBEAT_ELEMENTS) &&
+	     zcbor_uint32_put(state, MQTT_RECORD_HEARTBEAT) &&
+	     zcbor_tstr_encode_ptr(state, device_id, strlen(device_id)) &&
+	     zcbor_int64_put(state, record->timestamp) &&
+	     zcbor_uint32_put(state, record->sequence) &&
+	     zcbor_int64_put(state, record->heartbeat.uptime_ms) &&
+	     zcbor_uint32_put(state, record->heartbeat.publish_failures) &&
+	     zcbor_uint32_put(state, record->heartbeat.total_publishes) &&
+	     zcbor_bool_put(state, record->heartbeat.network_connected) &&
+	     zcbor_int32_put(state, record->heartbeat.mqtt_state) &&
+	     zcbor_uint32_put(state, record->heartbeat.suppressed_records);
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_STATS_HEARTBEAT)
+	ok = ok && zcbor_list_start_encode(state, MQTT_RECORD_STATS_COUNT);
+
+	for (size_t i = 0; ok && i < MQTT_RECORD_STATS_COUNT; i++) {
+		const struct mqtt_record_stats *stats = &record->heartbeat.stats[i];
+
+		ok = zcbor_list_start_encode(state, 4) &&
+		     zcbor_uint32_put(state, stats->count) &&
+		     zcbor_uint32_put(state, stats->p50) &&
+		     zcbor_uint32_put(state, stats->p90) &&
+		     zcbor_uint32_put(state, stats->max) &&
+		     zcbor_list_end_encode(state, 4);
+	}
+
+	ok = ok && zcbor_list_end_encode(state, MQTT_RECORD_STATS_COUNT);
+#endif
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET)
+	ok = ok && zcbor_list_start_encode(state, 3) &&
+	     zcbor_uint32_put(state, record->heartbeat.daily_bytes) &&
+	     zcbor_uint32_put(state, record->heartbeat.monthly_bytes) &&
+	     zcbor_uint32_put(state, record->heartbeat.budget_limited) &&
+	     zcbor_list_end_encode(state, 3);
+#endif
+
+	ok = ok && zcbor_list_end_encode(state, HEARTBEAT_ELEMENTS);
+	if (!ok) {
+		return zcbor_peek_error(state) ? zcbor_peek_error(state) : ZCBOR_ERR_UNKNOWN;
+	}
+
+	*len = state->payload - buf;
+
+	return 0;
+}
+#else
+static int encode_heartbeat(const struct mqtt_record *record, const char *device_id,
+			    uint8_t *buf, size_t size, size_t *len)
+{
+	struct heartbeat_record out = {
+		.uptime_ms = record->heartbeat.uptime_ms,
+		.publish_failures = record->heartbeat.publish_failures,
+		.total_publishes = record->heartbeat.total_publishes,
+		.network_connected = record->heartbeat.network_connected,
+		.mqtt_state = record->heartbeat.mqtt_state,
+		.suppressed_records = record->heartbeat.suppressed_records,
+	};
+
+	RECORD_HEADER_SET(out, record, device_id);
+
+	return cbor_encode_heartbeat_record(buf, size, &out, len);
+}
+#endif /* CONFIG_APP_CUSTOM_MQTT_STATS_HEARTBEAT || CONFIG_APP_CUSTOM_MQTT_BUDGET */
+
+static int encode_status(const struct mqtt_record *record, const char *device_id,
+			 uint8_t *buf, size_t size, size_t *len)
+{
+	struct status_record out;
+
+	RECORD_HEADER_SET(out, record, device_id);
+
+	return cbor_encode_status_record(buf, size, &out, len);
+}
+
+static int encode_ack(const struct mqtt_record *record, const char *device_id,
+		      uint8_t *buf, size_t size, size_t *len)
+{
+	struct ack_record out = {
+		.command.value = (const uint8_t *)record->ack.command,
+		.command.len = strlen(record->ack.command),
+		.id.value = (const uint8_t *)record->ack.id,
+		.id.len = strlen(record->ack.id),
+		.result = record->ack.result,
+	};
+
+	RECORD_HEADER_SET(out, record, device_id);
+
+	return cbor_encode_ack_record(buf, size, &out, len);
+}
+
+/* Encode a single record, an empty device ID is used for records inside a batch */
+static int encode_record(const struct mqtt_record *record, const char *device_id,
+			 uint8_t *buf, size_t size, size_t *len)
+{
+	int err;
+
+	switch (record->type) {
+	case MQTT_RECORD_ENVIRONMENTAL:
+		err = encode_environmental(record, device_id, buf, size, len);
+		break;
+	case MQTT_RECORD_POWER:
+		err = encode_power(record, device_id, buf, size, len);
+		break;
+	case MQTT_RECORD_LOCATION:
+		err = encode_location(record, device_id, buf, size, len);
+		break;
+	case MQTT_RECORD_UART_SENSOR:
+		err = encode_uart_sensor(record, device_id, buf, size, len);
+		break;
+	case MQTT_RECORD_HEARTBEAT:
+		err = encode_heartbeat(record, device_id, buf, size, len);
+		break;
+	case MQTT_RECORD_STATUS:
+		err = encode_status(record, device_id, buf, size, len);
+		break;
+	case MQTT_RECORD_ACK:
+		err = encode_ack(record, device_id, buf, size, len);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	/* zcbor reports a failed encoding with a ZCBOR_ERR_* code */
+	if (err == ZCBOR_ERR_NO_PAYLOAD) {
+		return -ENOMEM;
+	} else if (err) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int mqtt_codec_encode(const struct mqtt_record *record, uint8_t *buf, size_t size)
+{
+	int err;
+	size_t len = 0;
+
+	err = encode_record(record, MQTT_CLIENT_ID, buf, size, &len);
+	if (err) {
+		return err;
+	}
+
+	return (int)len;
+}
+
+int mqtt_codec_encode_batch(uint32_t sequence, const struct mqtt_record *records, size_t count,
+			    uint8_t *buf, size_t size)
+{
+	ZCBOR_STATE_E(state, 2, buf, size, 1);
+	uint8_t entry[BATCH_ENTRY_MAX_SIZE];
+	int64_t base;
+	bool epoch = mqtt_codec_batch_base(records, count, &base);
+	bool ok;
+
+	/* batch-record in telemetry.cddl, built from zcbor primitives since the records are
+	 * embedded as byte strings that are encoded with the generated functions.
+	 */
+	ok = zcbor_list_start_encode(state, 6) &&
+	     zcbor_uint32_put(state, MQTT_RECORD_BATCH) &&
+	     zcbor_tstr_encode_ptr(state, MQTT_CLIENT_ID, sizeof(MQTT_CLIENT_ID) - 1) &&
+	     zcbor_int64_put(state, base) &&
+	     zcbor_bool_put(state, epoch) &&
+	     zcbor_uint32_put(state, sequence) &&
+	     zcbor_list_start_encode(state, count);
+
+	for (size_t i = 0; ok && i < count; i++) {
+		struct mqtt_record record = records[i];
+		size_t len = 0;
+		int err;
+
+		/* Sequence numbers are per publish, inside a batch it holds the index. The timestamp
+		 * holds the offset from the time base, CBOR encodes it in as few bytes as it needs.
+		 */
+		record.sequence = i;
+		record.timestamp = mqtt_codec_batch_offset(&records[i], epoch, base);
+
+		err = encode_record(&record, "", entry, sizeof(entry), &len);
+		if (err) {
+			return err;
+		}
+
+		ok = zcbor_bstr_encode_ptr(state, (const char *)entry, len);
+	}
+
+	ok = ok && zcbor_list_end_encode(state, count) && zcbor_list_end_encode(state, 6);
+	if (!ok) {
+		return (zcbor_peek_error(state) == ZCBOR_ERR_NO_PAYLOAD) ? -ENOMEM : -EINVAL;
+	}
+
+	return (int)(state->payload - buf);
+}
@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+
+#include "custom_mqtt_codec.h"
+#include "custom_mqtt_config.h"
+#include "custom_mqtt_json.h"
+
+static const char *record_type_name(enum mqtt_record_type type)
+{
+	switch (type) {
+	case MQTT_RECORD_ENVIRONMENTAL:
+		return "environmental";
+	case MQTT_RECORD_POWER:
+		return "power";
+	case MQTT_RECORD_LOCATION:
+		return "location";
+	case MQTT_RECORD_UART_SENSOR:
+		return "uart_sensor";
+	case MQTT_RECORD_HEARTBEAT:
+		return "heartbeat";
+	case MQTT_RECORD_ACK:
+		return "ack";
+	default:
+		return NULL;
+	}
+}
+
+static void encode_environmental(struct mqtt_json_writer *writer,
+				 const struct mqtt_record *record)
+{
+	mqtt_json_obj_start(writer, "data");
+	mqtt_json_add_double(writer, "temperature", record->environmental.temperature,
+			     MQTT_TEMP_PRECISION_DECIMALS);
+	mqtt_json_add_double(writer, "humidity", record->environmental.humidity,
+			     MQTT_HUMIDITY_PRECISION_DECIMALS);
+	mqtt_json_add_double(writer, "pressure", record->environmental.pressure,
+			     MQTT_PRESSURE_PRECISION_DECIMALS);
+
+	if (record->environmental.sample_time > 0) {
+		mqtt_json_add_int(writer, "timestamp", record->environmental.sample_time);
+	}
+
+	mqtt_json_obj_end(writer);
+}
+
+static void encode_power(struct mqtt_json_writer *writer, const struct mqtt_record *record)
+{
+	mqtt_json_obj_start(writer, "data");
+	mqtt_json_add_double(writer, "percentage", record->power.percentage,
+			     MQTT_BATTERY_PRECISION_DECIMALS);
+	mqtt_json_add_double(writer, "voltage", record->power.voltage,
+			     MQTT_VOLTAGE_PRECISION_DECIMALS);
+	mqtt_json_add_double(writer, "current_ma", record->power.current_ma,
+			     MQTT_CURRENT_PRECISION_DECIMALS);
+	mqtt_json_add_double(writer, "temperature", record->power.temperature,
+			     MQTT_BATTERY_TEMP_PRECISION_DECIMALS);
+
+	if (record->power.sample_time > 0) {
+		mqtt_json_add_int(writer, "timestamp", record->power.sample_time);
+	}
+
+	mqtt_json_obj_end(writer);
+}
+
+static void encode_location(struct mqtt_json_writer *writer, const struct mqtt_record *record)
+{
+	mqtt_json_obj_start(writer, "data");
+	mqtt_json_add_double(writer, "lat", record->location.latitude,
+			     MQTT_GPS_PRECISION_DECIMALS);
+	mqtt_json_add_double(writer, "lng", record->location.longitude,
+			     MQTT_GPS_PRECISION_DECIMALS);
+	mqtt_json_add_double(writer, "acc", record->location.accuracy,
+			     MQTT_GPS_ACCURACY_PRECISION_DECIMALS);
+	mqtt_json_obj_end(writer);
+}
+
+static void encode_uart_sensor(struct mqtt_json_writer *writer,
+			       const struct mqtt_record *record)
+{
+	mqtt_json_obj_start(writer, "sensor_data");
+	mqtt_json_add_double(writer, "temperature", record->uart_sensor.temperature,
+			     MQTT_TEMP_PRECISION_DECIMALS);
+	mqtt_json_add_double(writer, "humidity", record->uart_sensor.humidity,
+			     MQTT_HUMIDITY_PRECISION_DECIMALS);
+	mqtt_json_add_str(writer, "probe_id", record->uart_sensor.probe_id);
+	mqtt_json_add_double(writer, "probe_battery", record->uart_sensor.probe_battery,
+			     MQTT_BATTERY_PRECISION_DECIMALS);
+
+	if (record->uart_sensor.sample_time > 0) {
+		mqtt_json_add_int(writer, "timestamp", record->uart_sensor.sample_time);
+	}
+
+	mqtt_json_obj_end(writer);
+}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_STATS_HEARTBEAT)
+/* Keys of the heartbeat histogram summaries, in enum custom_mqtt_hist_type order */
+static const char *const stats_names[MQTT_RECORD_STATS_COUNT] = {
+	"queue_ms", "ack_ms", "msg_bytes", "msgs_per_min", "reconnect_ms",
+};
+
+static void encode_stats(struct mqtt_json_writer *writer, const struct mqtt_record *record)
+{
+	mqtt_json_obj_start(writer, "stats");
+
+	for (size_t i = 0; i < MQTT_RECORD_STATS_COUNT; i++) {
+		const struct mqtt_record_stats *stats = &record->heartbeat.stats[i];
+
+		mqtt_json_obj_start(writer, stats_names[i]);
+		mqtt_json_add_int(writer, "count", stats->count);
+		mqtt_json_add_int(writer, "p50", stats->p50);
+		mqtt_json_add_int(writer, "p90", stats->p90);
+		mqtt_json_add_int(writer, "max", stats->max);
+		mqtt_json_obj_end(writer);
+	}
+
+	mqtt_json_obj_end(writer);
+}
+#endif /* CONFIG_APP_CUSTOM_MQTT_STATS_HEARTBEAT */
+
+static void encode_heartbeat(struct mqtt_json_writer *writer, const struct mqtt_record *record)
+{
+	mqtt_json_add_int(writer, "uptime_ms", record->heartbeat.uptime_ms);
+	mqtt_json_add_str(writer, "firmware_version", MQTT_FIRMWARE_VERSION);
+
+	/* Add diagnostic information */
+	mqtt_json_obj_start(writer, "diagnostics");
+	mqtt_json_add_int(writer, "publish_failures", record->heartbeat.publish_failures);
+	mqtt_json_add_int(writer, "total_publishes", record->heartbeat.total_publishes);
+	mqtt_json_add_bool(writer, "network_connected", record->heartbeat.network_connected);
+	mqtt_json_add_int(writer, "mqtt_state", record->heartbeat.mqtt_state);
+	mqtt_json_add_int(writer, "suppressed_records", record->heartbeat.suppressed_records);
+#if defined(CONFIG_APP_CUSTOM_MQTT_STATS_HEARTBEAT)
+	encode_stats(writer, record);
+#endif
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET)
+	mqtt_json_obj_start(writer, "budget");
+	mqtt_json_add_int(writer, "daily_bytes", record->heartbeat.daily_bytes);
+	mqtt_json_add_int(writer, "monthly_bytes", record->heartbeat.monthly_bytes);
+	mqtt_json_add_int(writer, "limited", record->heartbeat.budget_limited);
+	mqtt_json_obj_end(writer);
+#endif
+	mqtt_json_obj_end(writer);
+}
+
+static void encode_ack(struct mqtt_json_writer *writer, const struct mqtt_record *record)
+{
+	mqtt_json_add_str(writer, "command", record->ack.command);
+
+	if (record->ack.id[0] != '\0') {
+		mqtt_json_add_str(writer, "id", record->ack.id);
+	}
+
+	mqtt_json_add_int(writer, "result", record->ack.result);
+}
+
+/* The connection status message predates the typed records and keeps its own layout */
+static void encode_status(struct mqtt_json_writer *writer, const struct mqtt_record *record)
+{
+	mqtt_json_obj_start(writer, NULL);
+	mqtt_json_add_str(writer, "device_id", MQTT_CLIENT_ID);
+	mqtt_json_add_str(writer, "status", "connected");
+	mqtt_json_add_int(writer, "timestamp", record->timestamp);
+	mqtt_json_add_str(writer, "message", "Device connected to MQTT broker");
+	mqtt_json_obj_end(writer);
+}
+
+/* Type specific members of a record */
+static void encode_body(struct mqtt_json_writer *writer, const struct mqtt_record *record)
+{
+	switch (record->type) {
+	case MQTT_RECORD_ENVIRONMENTAL:
+		encode_environmental(writer, record);
+		break;
+	case MQTT_RECORD_POWER:
+		encode_power(writer, record);
+		break;
+	case MQTT_RECORD_LOCATION:
+		encode_location(writer, record);
+		break;
+	case MQTT_RECORD_UART_SENSOR:
+		encode_uart_sensor(writer, record);
+		break;
+	case MQTT_RECORD_HEARTBEAT:
+		encode_heartbeat(writer, record);
+		break;
+	case MQTT_RECORD_ACK:
+		encode_ack(writer, record);
+		break;
+	default:
+		break;
+	}
+}
+
+int mqtt_codec_encode(const struct mqtt_record *record, uint8_t *buf, size_t size)
+{
+	struct mqtt_json_writer writer;
+
+	mqtt_json_init(&writer, (char *)buf, size);
+
+	if (record->type == MQTT_RECORD_STATUS) {
+		encode_status(&writer, record);
+
+		return mqtt_json_finish(&writer);
+	}
+
+	if (record_type_name(record->type) == NULL) {
+		return -EINVAL;
+	}
+
+	/* Fields common to all message types */
+	mqtt_json_obj_start(&writer, NULL);
+	mqtt_json_add_str(&writer, "device_id", MQTT_CLIENT_ID);
+	mqtt_json_add_str(&writer, "type", record_type_name(record->type));
+	mqtt_json_add_int(&writer, "timestamp", record->timestamp);
+
+	if (record->time != 0) {
+		mqtt_json_add_int(&writer, "time", record->time);
+	}
+
+	mqtt_json_add_int(&writer, "sequence", record->sequence);
+
+	encode_body(&writer, record);
+
+	mqtt_json_obj_end(&writer);
+
+	return mqtt_json_finish(&writer);
+}
+
+int mqtt_codec_encode_batch(uint32_t sequence, const struct mqtt_record *records, size_t count,
+			    uint8_t *buf, size_t size)
+{
+	struct mqtt_json_writer writer;
+	int64_t base;
+	bool epoch = mqtt_codec_batch_base(records, count, &base);
+
+	mqtt_json_init(&writer, (char *)buf, size);
+
+	mqtt_json_obj_start(&writer, NULL);
+	mqtt_json_add_str(&writer, "device_id", MQTT_CLIENT_ID);
+	mqtt_json_add_str(&writer, "type", "batch");
+	mqtt_json_add_int(&writer, epoch ? "time" : "uptime", base);
+	mqtt_json_add_int(&writer, "sequence", sequence);
+	mqtt_json_arr_start(&writer, "records");
+
+	for (size_t i = 0; i < count; i++) {
+		if (record_type_name(records[i].type) == NULL) {
+			return -EINVAL;
+		}
+
+		/* Milliseconds since the time base of the batch */
+		mqtt_json_obj_start(&writer, NULL);
+		mqtt_json_add_str(&writer, "type", record_type_name(records[i].type));
+		mqtt_json_add_int(&writer, "dt", mqtt_codec_batch_offset(&records[i], epoch, base));
+		encode_body(&writer, &records[i]);
+		mqtt_json_obj_end(&writer);
+	}
+
+	mqtt_json_arr_end(&writer);
+	mqtt_json_obj_end(&writer);
+
+	return mqtt_json_finish(&writer);
+}
@@ -13,6 +13,10 @@ extern "C" {
 
 /* Production configuration constants */
 
+/* Device identity, used as MQTT client ID and in every uplink message */
+#define MQTT_CLIENT_ID                  "thingy91x-asset-tracker"
+#define MQTT_FIRMWARE_VERSION           "v0.0.0-dev"
+
 /* Data validation thresholds */
 #define MQTT_TEMP_MIN_CELSIUS           -50.0
 #define MQTT_TEMP_MAX_CELSIUS           100.0
@@ -31,6 +35,11 @@ extern "C" {
 #define MQTT_MAX_PUBLISH_FAILURES       10
 #define MQTT_HEARTBEAT_INTERVAL_SEC     30
 #define MQTT_CONNECTION_TIMEOUT_SEC     30
+#define MQTT_SUBACK_TIMEOUT_SEC         10
+#define MQTT_BROKER_PROBE_TIMEOUT_SEC   5
+
+/* MQTT framing of a publish besides the topic: fixed header, topic length and packet ID */
+#define MQTT_PUBLISH_HEADER_SIZE        8
 
 /* Data precision limits (to reduce JSON size and noise) */
 #define MQTT_TEMP_PRECISION_DECIMALS    2
@@ -38,6 +47,10 @@ extern "C" {
 #define MQTT_PRESSURE_PRECISION_DECIMALS 1
 #define MQTT_BATTERY_PRECISION_DECIMALS 1
 #define MQTT_GPS_PRECISION_DECIMALS     6
+#define MQTT_GPS_ACCURACY_PRECISION_DECIMALS 1
+#define MQTT_VOLTAGE_PRECISION_DECIMALS 3
+#define MQTT_CURRENT_PRECISION_DECIMALS 1
+#define MQTT_BATTERY_TEMP_PRECISION_DECIMALS 1
 
 /* Message validation */
 #define MQTT_MIN_MESSAGE_SIZE           10
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/sys/util.h>
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+
+#include "custom_mqtt_deadband.h"
+
+static const char *const field_names[] = {
+	[MQTT_DEADBAND_TEMPERATURE] = "temperature",
+	[MQTT_DEADBAND_HUMIDITY] = "humidity",
+	[MQTT_DEADBAND_PRESSURE] = "pressure",
+	[MQTT_DEADBAND_BATTERY] = "battery",
+	[MQTT_DEADBAND_VOLTAGE] = "voltage",
+};
+
+BUILD_ASSERT(ARRAY_SIZE(field_names) == MQTT_DEADBAND_FIELD_COUNT);
+
+/* Fields of a record with a dead-band, in enum mqtt_deadband_field order starting at first */
+struct record_fields {
+	enum mqtt_deadband_channel channel;
+	enum mqtt_deadband_field first;
+	size_t count;
+	double values[3];
+};
+
+static bool record_fields_get(const struct mqtt_record *record, struct record_fields *fields)
+{
+	switch (record->type) {
+	case MQTT_RECORD_ENVIRONMENTAL:
+		fields->channel = MQTT_DEADBAND_CHANNEL_ENVIRONMENTAL;
+		fields->first = MQTT_DEADBAND_TEMPERATURE;
+		fields->count = 3;
+		fields->values[0] = record->environmental.temperature;
+		fields->values[1] = record->environmental.humidity;
+		fields->values[2] = record->environmental.pressure;
+		return true;
+	case MQTT_RECORD_POWER:
+		fields->channel = MQTT_DEADBAND_CHANNEL_POWER;
+		fields->first = MQTT_DEADBAND_BATTERY;
+		fields->count = 2;
+		fields->values[0] = record->power.percentage;
+		fields->values[1] = record->power.voltage;
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool value_changed(const struct mqtt_deadband_band *band, double last, double value)
+{
+	double limit = MAX(band->abs, band->rel * fabs(last));
+
+	if (limit == 0.0) {
+		return value != last;
+	}
+
+	return fabs(value - last) > limit;
+}
+
+void mqtt_deadband_init(struct mqtt_deadband *deadband, int64_t max_silence_ms)
+{
+	memset(deadband, 0, sizeof(*deadband));
+
+	deadband->max_silence_ms = max_silence_ms;
+}
+
+int mqtt_deadband_band_set(struct mqtt_deadband *deadband, enum mqtt_deadband_field field,
+			   const struct mqtt_deadband_band *band)
+{
+	if (field < 0 || field >= MQTT_DEADBAND_FIELD_COUNT) {
+		return -EINVAL;
+	}
+
+	/* Also rejects NaN */
+	if (!(band->abs >= 0.0) || !(band->rel >= 0.0)) {
+		return -EINVAL;
+	}
+
+	deadband->bands[field] = *band;
+
+	return 0;
+}
+
+int mqtt_deadband_field_get(const char *name, size_t len)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(field_names); i++) {
+		if (strlen(field_names[i]) == len && memcmp(field_names[i], name, len) == 0) {
+			return (int)i;
+		}
+	}
+
+	return -ENOENT;
+}
+
+bool mqtt_deadband_check(struct mqtt_deadband *deadband, const struct mqtt_record *record)
+{
+	struct record_fields fields;
+	bool send;
+
+	if (!record_fields_get(record, &fields)) {
+		return true;
+	}
+
+	/* The first record of a type is always sent */
+	send = !deadband->sent[fields.channel];
+
+	if (!send && deadband->max_silence_ms > 0) {
+		send = (record->timestamp - deadband->last_time[fields.channel]) >=
+		       deadband->max_silence_ms;
+	}
+
+	for (size_t i = 0; !send && i < fields.count; i++) {
+		enum mqtt_deadband_field field = fields.first + i;
+
+		send = value_changed(&deadband->bands[field], deadband->last[field],
+				     fields.values[i]);
+	}
+
+	if (!send) {
+		deadband->suppressed[fields.channel]++;
+	}
+
+	return send;
+}
+
+void mqtt_deadband_sent(struct mqtt_deadband *deadband, const struct mqtt_record *record)
+{
+	struct record_fields fields;
+
+	if (!record_fields_get(record, &fields)) {
+		return;
+	}
+
+	/* All fields are sent, so all of them become the new reference */
+	for (size_t i = 0; i < fields.count; i++) {
+		deadband->last[fields.first + i] = fields.values[i];
+	}
+
+	deadband->last_time[fields.channel] = record->timestamp;
+	deadband->sent[fields.channel] = true;
+}
+
+bool mqtt_deadband_filter(struct mqtt_deadband *deadband, const struct mqtt_record *record)
+{
+	if (!mqtt_deadband_check(deadband, record)) {
+		return false;
+	}
+
+	mqtt_deadband_sent(deadband, record);
+
+	return true;
+}
+
+uint32_t mqtt_deadband_suppressed(const struct mqtt_deadband *deadband)
+{
+	uint32_t total = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(deadband->suppressed); i++) {
+		total += deadband->suppressed[i];
+	}
+
+	return total;
+}
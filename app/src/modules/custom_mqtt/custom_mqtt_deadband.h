@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CUSTOM_MQTT_DEADBAND_H_
+#define CUSTOM_MQTT_DEADBAND_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "custom_mqtt_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Record fields with a dead-band. */
+enum mqtt_deadband_field {
+	/** Environmental temperature, in degrees Celsius. */
+	MQTT_DEADBAND_TEMPERATURE,
+	/** Environmental relative humidity, in percent. */
+	MQTT_DEADBAND_HUMIDITY,
+	/** Environmental pressure, in kPa. */
+	MQTT_DEADBAND_PRESSURE,
+	/** Battery state of charge, in percent. */
+	MQTT_DEADBAND_BATTERY,
+	/** Battery voltage, in volts. */
+	MQTT_DEADBAND_VOLTAGE,
+
+	MQTT_DEADBAND_FIELD_COUNT,
+};
+
+/** @brief Record types that are filtered. */
+enum mqtt_deadband_channel {
+	MQTT_DEADBAND_CHANNEL_ENVIRONMENTAL,
+	MQTT_DEADBAND_CHANNEL_POWER,
+
+	MQTT_DEADBAND_CHANNEL_COUNT,
+};
+
+/**
+ * @brief Dead-band of a field.
+ *
+ * A value is significant when it differs from the last sent value by more than the larger of
+ * @ref abs and @ref rel times the last sent value. With both set to 0 every change is significant.
+ */
+struct mqtt_deadband_band {
+	/** Absolute dead-band, in the unit of the field. */
+	double abs;
+
+	/** Relative dead-band, as a fraction of the last sent value. */
+	double rel;
+};
+
+/**
+ * @brief Change-based filter for periodic telemetry records.
+ *
+ * A record is only sent when at least one of its fields left its dead-band around the last sent
+ * value, or when no record of the same type was sent for @ref max_silence_ms. Fields without a
+ * dead-band, such as the battery current, do not cause a record to be sent but are sent along
+ * with it. Record types that are not filtered are always sent.
+ *
+ * The filter is not thread safe.
+ */
+struct mqtt_deadband {
+	struct mqtt_deadband_band bands[MQTT_DEADBAND_FIELD_COUNT];
+
+	/** Time after which a record is sent even without a significant change, 0 for never. */
+	int64_t max_silence_ms;
+
+	/** Last sent value of each field. */
+	double last[MQTT_DEADBAND_FIELD_COUNT];
+
+	/** Timestamp of the last sent record of each channel. */
+	int64_t last_time[MQTT_DEADBAND_CHANNEL_COUNT];
+
+	/** A record of the channel has been sent since the filter was initialized. */
+	bool sent[MQTT_DEADBAND_CHANNEL_COUNT];
+
+	/** Number of records that were suppressed, per channel. */
+	uint32_t suppressed[MQTT_DEADBAND_CHANNEL_COUNT];
+};
+
+/**
+ * @brief Initialize a filter. All dead-bands are 0 until they are set.
+ *
+ * @param[out] deadband       Filter to initialize.
+ * @param[in]  max_silence_ms Longest time without a record of a type, 0 for no limit.
+ */
+void mqtt_deadband_init(struct mqtt_deadband *deadband, int64_t max_silence_ms);
+
+/**
+ * @brief Set the dead-band of a field.
+ *
+ * @param[in,out] deadband Filter.
+ * @param[in]     field    Field.
+ * @param[in]     band     Dead-band, both limits must not be negative.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -EINVAL if the field is unknown or a limit is negative.
+ */
+int mqtt_deadband_band_set(struct mqtt_deadband *deadband, enum mqtt_deadband_field field,
+			   const struct mqtt_deadband_band *band);
+
+/**
+ * @brief Look up a field by name.
+ *
+ * @param[in] name Field name, "temperature", "humidity", "pressure", "battery" or "voltage".
+ * @param[in] len  Length of the name, it does not need to be NULL terminated.
+ *
+ * @returns Field on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -ENOENT if there is no field with that name.
+ */
+int mqtt_deadband_field_get(const char *name, size_t len);
+
+/**
+ * @brief Check whether a record is significant.
+ *
+ * The suppressed counter is updated when it is not. The last sent values are left as they are,
+ * a record only becomes the reference once it is passed to mqtt_deadband_sent(). A record that
+ * is held back after the check is checked again with the same outcome.
+ *
+ * @param[in,out] deadband Filter.
+ * @param[in]     record   Record, its timestamp is used as the current time.
+ *
+ * @returns true if the record is to be sent, false if it is suppressed.
+ */
+bool mqtt_deadband_check(struct mqtt_deadband *deadband, const struct mqtt_record *record);
+
+/**
+ * @brief Make a record the reference for the records after it.
+ *
+ * @param[in,out] deadband Filter.
+ * @param[in]     record   Record that is sent.
+ */
+void mqtt_deadband_sent(struct mqtt_deadband *deadband, const struct mqtt_record *record);
+
+/**
+ * @brief Decide whether a record is sent.
+ *
+ * Combines mqtt_deadband_check() and mqtt_deadband_sent(). The last sent values are updated
+ * when the record is sent, the suppressed counter otherwise.
+ *
+ * @param[in,out] deadband Filter.
+ * @param[in]     record   Record, its timestamp is used as the current time.
+ *
+ * @returns true if the record is to be sent, false if it is suppressed.
+ */
+bool mqtt_deadband_filter(struct mqtt_deadband *deadband, const struct mqtt_record *record);
+
+/**
+ * @brief Get the total number of suppressed records.
+ *
+ * @param[in] deadband Filter.
+ *
+ * @returns Number of suppressed records of all types.
+ */
+uint32_t mqtt_deadband_suppressed(const struct mqtt_deadband *deadband);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUSTOM_MQTT_DEADBAND_H_ */
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <errno.h>
+
+#include "custom_mqtt_dns.h"
+
+void mqtt_dns_cache_init(struct mqtt_dns_cache *cache)
+{
+	cache->addr = 0;
+	cache->expires = 0;
+	cache->valid = false;
+}
+
+int mqtt_dns_cache_get(const struct mqtt_dns_cache *cache, int64_t now, uint32_t *addr)
+{
+	if (!cache->valid) {
+		return -ENOENT;
+	}
+
+	*addr = cache->addr;
+
+	return (now < cache->expires) ? 0 : -ESTALE;
+}
+
+bool mqtt_dns_cache_put(struct mqtt_dns_cache *cache, uint32_t addr, int64_t now,
+			uint32_t ttl_ms)
+{
+	bool changed = !cache->valid || cache->addr != addr;
+
+	cache->addr = addr;
+	cache->expires = now + ttl_ms;
+	cache->valid = true;
+
+	return changed;
+}
+
+void mqtt_dns_cache_expire(struct mqtt_dns_cache *cache)
+{
+	cache->expires = 0;
+}
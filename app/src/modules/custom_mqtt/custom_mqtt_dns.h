@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CUSTOM_MQTT_DNS_H_
+#define CUSTOM_MQTT_DNS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Cached result of the broker hostname lookup.
+ *
+ * A fresh entry is used instead of a DNS query. Once it expires a new lookup is made, and the
+ * expired address stays available as last-known-good in case the lookup fails.
+ *
+ * The cache is not thread safe, it is only used from the MQTT I/O thread.
+ */
+
+/** @brief Cache entry. */
+struct mqtt_dns_cache {
+	/** IPv4 address in network byte order. */
+	uint32_t addr;
+
+	/** Uptime in milliseconds after which the address has to be looked up again. */
+	int64_t expires;
+
+	/** An address has been stored. */
+	bool valid;
+};
+
+/**
+ * @brief Initialize an empty cache.
+ *
+ * @param[out] cache Cache to initialize.
+ */
+void mqtt_dns_cache_init(struct mqtt_dns_cache *cache);
+
+/**
+ * @brief Get the cached address.
+ *
+ * @param[in]  cache Cache.
+ * @param[in]  now   Current uptime in milliseconds.
+ * @param[out] addr  Cached address, also set when the entry has expired.
+ *
+ * @returns 0 if the address is fresh.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -ESTALE if the address has expired and is only good as a fallback.
+ * @retval -ENOENT if no address has been stored.
+ */
+int mqtt_dns_cache_get(const struct mqtt_dns_cache *cache, int64_t now, uint32_t *addr);
+
+/**
+ * @brief Store the result of a successful lookup.
+ *
+ * @param[in,out] cache  Cache.
+ * @param[in]     addr   Resolved address in network byte order.
+ * @param[in]     now    Current uptime in milliseconds.
+ * @param[in]     ttl_ms Time the address may be used without a new lookup.
+ *
+ * @returns true if the address differs from the one stored before.
+ */
+bool mqtt_dns_cache_put(struct mqtt_dns_cache *cache, uint32_t addr, int64_t now,
+			uint32_t ttl_ms);
+
+/**
+ * @brief Force a new lookup on the next connection attempt, keeping the address as fallback.
+ *
+ * @param[in,out] cache Cache.
+ */
+void mqtt_dns_cache_expire(struct mqtt_dns_cache *cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUSTOM_MQTT_DNS_H_ */
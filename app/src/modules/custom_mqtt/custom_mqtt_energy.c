@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/sys/util.h>
+#include <string.h>
+
+#include "custom_mqtt_energy.h"
+
+/* Count a radio connection that ended with its tail */
+static void burst_close(struct mqtt_energy *energy)
+{
+	energy->active_ms += (uint64_t)(energy->last_activity + energy->model.tail_ms -
+					energy->burst_start);
+	energy->in_burst = false;
+}
+
+void mqtt_energy_init(struct mqtt_energy *energy, const struct mqtt_energy_model *model,
+		      int64_t now)
+{
+	memset(energy, 0, sizeof(*energy));
+
+	energy->model = *model;
+	energy->cycle_start = now;
+}
+
+void mqtt_energy_activity(struct mqtt_energy *energy, int64_t now)
+{
+	if (energy->in_burst) {
+		if (now - energy->last_activity <= energy->model.tail_ms) {
+			energy->last_activity = now;
+			return;
+		}
+
+		burst_close(energy);
+	}
+
+	energy->in_burst = true;
+	energy->burst_start = now;
+	energy->last_activity = now;
+	energy->wakeups++;
+}
+
+void mqtt_energy_cycle_end(struct mqtt_energy *energy, int64_t now,
+			   struct mqtt_energy_cycle *cycle)
+{
+	if (energy->in_burst) {
+		if (energy->last_activity + energy->model.tail_ms <= now) {
+			burst_close(energy);
+		} else {
+			energy->active_ms += (uint64_t)(now - energy->burst_start);
+			energy->burst_start = now;
+		}
+	}
+
+	cycle->duration_ms = (uint32_t)(now - energy->cycle_start);
+	cycle->wakeups = energy->wakeups;
+	cycle->active_ms = (uint32_t)MIN(energy->active_ms, UINT32_MAX);
+	cycle->energy_mj = (uint32_t)MIN(energy->active_ms * energy->model.active_mw / 1000,
+					 UINT32_MAX);
+
+	energy->cycle_start = now;
+	energy->wakeups = 0;
+	energy->active_ms = 0;
+}
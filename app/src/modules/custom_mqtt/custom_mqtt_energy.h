@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CUSTOM_MQTT_ENERGY_H_
+#define CUSTOM_MQTT_ENERGY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Radio energy model.
+ *
+ * The modem stays in RRC connected mode for @ref tail_ms after the last packet before the network
+ * releases the connection. Activity within the tail extends the same connection, activity after
+ * it wakes the radio up again.
+ */
+struct mqtt_energy_model {
+	/** RRC inactivity time until the connection is released, in milliseconds. */
+	uint32_t tail_ms;
+
+	/** Average power while RRC connected, in milliwatts. */
+	uint32_t active_mw;
+};
+
+/**
+ * @brief Radio activity of one sampling cycle.
+ */
+struct mqtt_energy_cycle {
+	/** Length of the cycle, in milliseconds. */
+	uint32_t duration_ms;
+
+	/** Number of times the radio was woken up. */
+	uint32_t wakeups;
+
+	/** Time in RRC connected mode, including the tails, in milliseconds. */
+	uint32_t active_ms;
+
+	/** Estimated radio energy, in millijoules. */
+	uint32_t energy_mj;
+};
+
+/**
+ * @brief Radio energy estimator.
+ *
+ * Every packet sent or received is reported as activity, the estimator merges them into radio
+ * wakeups with the tail of the model. The estimate does not include the sleep current, which is
+ * the same in all operating modes.
+ *
+ * The estimator is not thread safe.
+ */
+struct mqtt_energy {
+	struct mqtt_energy_model model;
+
+	/** The radio is (estimated to be) connected since @ref burst_start. */
+	bool in_burst;
+	int64_t burst_start;
+	int64_t last_activity;
+
+	/** Current cycle. */
+	int64_t cycle_start;
+	uint32_t wakeups;
+	uint64_t active_ms;
+};
+
+/**
+ * @brief Initialize an estimator and start the first cycle.
+ *
+ * @param[out] energy Estimator to initialize.
+ * @param[in]  model  Energy model.
+ * @param[in]  now    Current time in milliseconds.
+ */
+void mqtt_energy_init(struct mqtt_energy *energy, const struct mqtt_energy_model *model,
+		      int64_t now);
+
+/**
+ * @brief Report that a packet was sent or received.
+ *
+ * @param[in,out] energy Estimator.
+ * @param[in]     now    Current time in milliseconds.
+ */
+void mqtt_energy_activity(struct mqtt_energy *energy, int64_t now);
+
+/**
+ * @brief End the current cycle and start the next one.
+ *
+ * A radio connection that is still open at @p now is split, the rest of it belongs to the next
+ * cycle without counting as another wakeup.
+ *
+ * @param[in,out] energy Estimator.
+ * @param[in]     now    Current time in milliseconds.
+ * @param[out]    cycle  Activity of the cycle that ended.
+ */
+void mqtt_energy_cycle_end(struct mqtt_energy *energy, int64_t now,
+			   struct mqtt_energy_cycle *cycle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUSTOM_MQTT_ENERGY_H_ */
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/sys/util.h>
+#include <string.h>
+
+#include "custom_mqtt_hist.h"
+
+static size_t bucket_get(uint32_t value)
+{
+	size_t bucket = 0;
+
+	while (value > 0 && bucket < MQTT_HIST_BUCKETS - 1) {
+		value >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+static void hist_add_n(struct mqtt_hist *hist, uint32_t value, uint32_t n)
+{
+	size_t bucket = bucket_get(value);
+
+	if (n == 0) {
+		return;
+	}
+
+	if (hist->count == 0 || value < hist->min) {
+		hist->min = value;
+	}
+
+	hist->max = MAX(hist->max, value);
+	hist->sum += (uint64_t)value * n;
+
+	/* Saturate instead of wrapping around after a very long uptime */
+	hist->count = (uint32_t)MIN((uint64_t)hist->count + n, UINT32_MAX);
+	hist->buckets[bucket] = (uint32_t)MIN((uint64_t)hist->buckets[bucket] + n, UINT32_MAX);
+}
+
+void mqtt_hist_reset(struct mqtt_hist *hist)
+{
+	memset(hist, 0, sizeof(*hist));
+}
+
+void mqtt_hist_add(struct mqtt_hist *hist, uint32_t value)
+{
+	hist_add_n(hist, value, 1);
+}
+
+uint32_t mqtt_hist_bucket_max(size_t bucket)
+{
+	if (bucket >= MQTT_HIST_BUCKETS - 1) {
+		return UINT32_MAX;
+	}
+
+	return (uint32_t)((1ULL << bucket) - 1);
+}
+
+uint32_t mqtt_hist_percentile(const struct mqtt_hist *hist, uint8_t percent)
+{
+	uint64_t rank;
+	uint64_t seen = 0;
+
+	if (hist->count == 0) {
+		return 0;
+	}
+
+	/* Nearest rank, the smallest value with at least percent % of the values at or below it */
+	rank = MAX(DIV_ROUND_UP((uint64_t)hist->count * MIN(percent, 100), 100), 1);
+
+	for (size_t i = 0; i < MQTT_HIST_BUCKETS; i++) {
+		seen += hist->buckets[i];
+
+		if (seen >= rank) {
+			return MIN(mqtt_hist_bucket_max(i), hist->max);
+		}
+	}
+
+	return hist->max;
+}
+
+void mqtt_hist_rate_init(struct mqtt_hist_rate *rate, uint32_t window_ms, int64_t now)
+{
+	mqtt_hist_reset(&rate->hist);
+
+	rate->window_ms = window_ms;
+	rate->window_start = now;
+	rate->window_count = 0;
+}
+
+void mqtt_hist_rate_update(struct mqtt_hist_rate *rate, int64_t now)
+{
+	int64_t windows;
+
+	if (now - rate->window_start < rate->window_ms) {
+		return;
+	}
+
+	windows = (now - rate->window_start) / rate->window_ms;
+
+	mqtt_hist_add(&rate->hist, rate->window_count);
+	hist_add_n(&rate->hist, 0, (uint32_t)MIN(windows - 1, UINT32_MAX));
+
+	rate->window_start += windows * rate->window_ms;
+	rate->window_count = 0;
+}
+
+void mqtt_hist_rate_add(struct mqtt_hist_rate *rate, int64_t now)
+{
+	mqtt_hist_rate_update(rate, now);
+
+	rate->window_count++;
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CUSTOM_MQTT_HIST_H_
+#define CUSTOM_MQTT_HIST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of histogram buckets. */
+#define MQTT_HIST_BUCKETS 20
+
+/**
+ * @brief Histogram with logarithmic buckets.
+ *
+ * Bucket 0 counts the value 0, bucket n counts values from 2^(n-1) to 2^n - 1. The last bucket
+ * also counts all larger values. The exact minimum, maximum and sum are kept as well.
+ *
+ * The histogram is not thread safe.
+ */
+struct mqtt_hist {
+	uint32_t buckets[MQTT_HIST_BUCKETS];
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t sum;
+};
+
+/**
+ * @brief Events per time window, counted into a histogram.
+ *
+ * Every window adds one value to @ref hist, windows without any event add 0.
+ */
+struct mqtt_hist_rate {
+	struct mqtt_hist hist;
+
+	/** Length of a window, in milliseconds. */
+	uint32_t window_ms;
+
+	/** Start of the current window and its events. */
+	int64_t window_start;
+	uint32_t window_count;
+};
+
+/**
+ * @brief Clear a histogram.
+ *
+ * @param[out] hist Histogram to clear.
+ */
+void mqtt_hist_reset(struct mqtt_hist *hist);
+
+/**
+ * @brief Add a value to a histogram.
+ *
+ * @param[in,out] hist  Histogram.
+ * @param[in]     value Value to add.
+ */
+void mqtt_hist_add(struct mqtt_hist *hist, uint32_t value);
+
+/**
+ * @brief Get the largest value that is counted in a bucket.
+ *
+ * @param[in] bucket Bucket index.
+ *
+ * @returns Largest value of the bucket, UINT32_MAX for the last bucket.
+ */
+uint32_t mqtt_hist_bucket_max(size_t bucket);
+
+/**
+ * @brief Get an upper bound of a percentile.
+ *
+ * @param[in] hist    Histogram.
+ * @param[in] percent Percentile, 1 to 100.
+ *
+ * @returns Largest value of the bucket that holds the percentile, limited to the maximum value.
+ *	    0 if the histogram is empty.
+ */
+uint32_t mqtt_hist_percentile(const struct mqtt_hist *hist, uint8_t percent);
+
+/**
+ * @brief Clear a rate histogram and start the first window.
+ *
+ * @param[out] rate      Rate histogram to initialize.
+ * @param[in]  window_ms Length of a window, in milliseconds.
+ * @param[in]  now       Current time in milliseconds.
+ */
+void mqtt_hist_rate_init(struct mqtt_hist_rate *rate, uint32_t window_ms, int64_t now);
+
+/**
+ * @brief Count an event.
+ *
+ * @param[in,out] rate Rate histogram.
+ * @param[in]     now  Current time in milliseconds.
+ */
+void mqtt_hist_rate_add(struct mqtt_hist_rate *rate, int64_t now);
+
+/**
+ * @brief Add the windows that have ended to the histogram.
+ *
+ * Windows are otherwise only closed by the next event, call this before reading @ref hist.
+ *
+ * @param[in,out] rate Rate histogram.
+ * @param[in]     now  Current time in milliseconds.
+ */
+void mqtt_hist_rate_update(struct mqtt_hist_rate *rate, int64_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUSTOM_MQTT_HIST_H_ */
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <errno.h>
+#include <string.h>
+
+#include "custom_mqtt_inflight.h"
+
+static struct mqtt_inflight_entry *entry_find(struct mqtt_inflight *inflight,
+					      uint16_t message_id)
+{
+	for (size_t i = 0; i < inflight->count; i++) {
+		if (inflight->entries[i].message_id == message_id) {
+			return &inflight->entries[i];
+		}
+	}
+
+	return NULL;
+}
+
+void mqtt_inflight_init(struct mqtt_inflight *inflight)
+{
+	inflight->count = 0;
+	inflight->last_id = 0;
+}
+
+uint16_t mqtt_inflight_next_id(struct mqtt_inflight *inflight)
+{
+	do {
+		/* 0 is not a valid packet identifier */
+		inflight->last_id = (inflight->last_id == UINT16_MAX) ? 1 : inflight->last_id + 1;
+	} while (entry_find(inflight, inflight->last_id) != NULL);
+
+	return inflight->last_id;
+}
+
+bool mqtt_inflight_full(const struct mqtt_inflight *inflight)
+{
+	return inflight->count >= ARRAY_SIZE(inflight->entries);
+}
+
+int mqtt_inflight_add(struct mqtt_inflight *inflight, uint16_t message_id,
+		      const uint8_t *payload, size_t len, int64_t now)
+{
+	struct mqtt_inflight_entry *entry;
+
+	if (mqtt_inflight_full(inflight)) {
+		return -ENOMEM;
+	}
+
+	if (len > sizeof(entry->payload)) {
+		return -EMSGSIZE;
+	}
+
+	entry = &inflight->entries[inflight->count++];
+
+	entry->message_id = message_id;
+	entry->len = len;
+	entry->resends = 0;
+	entry->sent_time = now;
+	memcpy(entry->payload, payload, len);
+
+	return 0;
+}
+
+int mqtt_inflight_ack(struct mqtt_inflight *inflight, uint16_t message_id, int64_t now,
+		      uint32_t *latency_ms)
+{
+	struct mqtt_inflight_entry *entry = entry_find(inflight, message_id);
+	size_t index;
+
+	if (entry == NULL) {
+		return -ENOENT;
+	}
+
+	*latency_ms = (uint32_t)MAX(now - entry->sent_time, 0);
+
+	/* Keep the remaining entries in send order */
+	index = entry - inflight->entries;
+
+	memmove(entry, entry + 1, (inflight->count - index - 1) * sizeof(*entry));
+
+	inflight->count--;
+
+	return 0;
+}
+
+struct mqtt_inflight_entry *mqtt_inflight_get(struct mqtt_inflight *inflight, size_t index)
+{
+	if (index >= inflight->count) {
+		return NULL;
+	}
+
+	return &inflight->entries[index];
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CUSTOM_MQTT_INFLIGHT_H_
+#define CUSTOM_MQTT_INFLIGHT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Table of QoS 1 publishes that have not been acknowledged yet.
+ *
+ * Each entry keeps a copy of the payload so that the message can be sent again with the DUP
+ * flag after a reconnect. The number of entries is the in-flight window: when it is full, no new
+ * messages are published until a PUBACK frees an entry.
+ *
+ * Entries are kept in the order they were added, which is the order they are resent in.
+ *
+ * The table is not thread safe, it is only used from the MQTT I/O thread.
+ */
+
+/** @brief Unacknowledged publish. */
+struct mqtt_inflight_entry {
+	/** MQTT packet identifier, never 0. */
+	uint16_t message_id;
+
+	/** Payload length. */
+	uint16_t len;
+
+	/** Number of times the message was sent again. */
+	uint16_t resends;
+
+	/** Uptime when the message was first sent, in milliseconds. */
+	int64_t sent_time;
+
+	/** Copy of the payload. */
+	uint8_t payload[CONFIG_APP_CUSTOM_MQTT_PAYLOAD_BUFFER_MAX_SIZE];
+};
+
+/** @brief In-flight table. */
+struct mqtt_inflight {
+	struct mqtt_inflight_entry entries[CONFIG_APP_CUSTOM_MQTT_INFLIGHT_WINDOW];
+	size_t count;
+
+	/* Last packet identifier handed out */
+	uint16_t last_id;
+};
+
+/**
+ * @brief Initialize an empty table.
+ *
+ * @param[out] inflight Table to initialize.
+ */
+void mqtt_inflight_init(struct mqtt_inflight *inflight);
+
+/**
+ * @brief Get a packet identifier for a new publish.
+ *
+ * Identifiers count up from 1, wrap around after 65535 and skip identifiers that are still in
+ * flight.
+ *
+ * @param[in,out] inflight Table.
+ *
+ * @returns Packet identifier, never 0.
+ */
+uint16_t mqtt_inflight_next_id(struct mqtt_inflight *inflight);
+
+/**
+ * @brief Check if the in-flight window is full.
+ *
+ * @param[in] inflight Table.
+ *
+ * @returns true if no more messages can be added.
+ */
+bool mqtt_inflight_full(const struct mqtt_inflight *inflight);
+
+/**
+ * @brief Add a message that has been sent.
+ *
+ * @param[in,out] inflight   Table.
+ * @param[in]     message_id Packet identifier the message was sent with.
+ * @param[in]     payload    Payload of the message.
+ * @param[in]     len        Payload length.
+ * @param[in]     now        Current uptime in milliseconds.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -ENOMEM if the window is full.
+ * @retval -EMSGSIZE if the payload is larger than the payload buffer.
+ */
+int mqtt_inflight_add(struct mqtt_inflight *inflight, uint16_t message_id,
+		      const uint8_t *payload, size_t len, int64_t now);
+
+/**
+ * @brief Remove an acknowledged message.
+ *
+ * @param[in,out] inflight   Table.
+ * @param[in]     message_id Packet identifier from the PUBACK.
+ * @param[in]     now        Current uptime in milliseconds.
+ * @param[out]    latency_ms Time from the first transmission until the acknowledgment.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -ENOENT if no message with this identifier is in flight.
+ */
+int mqtt_inflight_ack(struct mqtt_inflight *inflight, uint16_t message_id, int64_t now,
+		      uint32_t *latency_ms);
+
+/**
+ * @brief Get an entry, oldest first.
+ *
+ * @param[in] inflight Table.
+ * @param[in] index    Index of the entry, 0 is the oldest.
+ *
+ * @returns Pointer to the entry, or NULL if @p index is out of range.
+ */
+struct mqtt_inflight_entry *mqtt_inflight_get(struct mqtt_inflight *inflight, size_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUSTOM_MQTT_INFLIGHT_H_ */
@@ -0,0 +1,761 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+#include <zephyr/sys/util.h>
+
+#include "custom_mqtt_json.h"
+
+#define MQTT_JSON_MAX_DECIMALS 9
+
+/* Largest magnitude that can be scaled to a 64-bit integer for any supported precision */
+#define MQTT_JSON_MAX_SCALED 9.0e18
+
+static void set_error(struct mqtt_json_writer *writer, int err)
+{
+	if (writer->err == 0) {
+		writer->err = err;
+	}
+}
+
+static void put_raw(struct mqtt_json_writer *writer, const char *data, size_t len)
+{
+	if (writer->err) {
+		return;
+	}
+
+	/* Always keep one byte for the NULL terminator */
+	if (len >= writer->size - writer->len) {
+		set_error(writer, -ENOMEM);
+		return;
+	}
+
+	memcpy(&writer->buf[writer->len], data, len);
+	writer->len += len;
+}
+
+static void put_char(struct mqtt_json_writer *writer, char c)
+{
+	put_raw(writer, &c, 1);
+}
+
+static void put_uint(struct mqtt_json_writer *writer, uint64_t value)
+{
+	char digits[20];
+	size_t i = sizeof(digits);
+
+	do {
+		digits[--i] = '0' + (value % 10);
+		value /= 10;
+	} while (value > 0);
+
+	put_raw(writer, &digits[i], sizeof(digits) - i);
+}
+
+static void put_escaped(struct mqtt_json_writer *writer, const char *str)
+{
+	static const char hex[] = "0123456789abcdef";
+	const char *run = str;
+
+	put_char(writer, '"');
+
+	for (; *str != '\0'; str++) {
+		char esc;
+		unsigned char c = (unsigned char)*str;
+
+		switch (c) {
+		case '"':
+			esc = '"';
+			break;
+		case '\\':
+			esc = '\\';
+			break;
+		case '\n':
+			esc = 'n';
+			break;
+		case '\r':
+			esc = 'r';
+			break;
+		case '\t':
+			esc = 't';
+			break;
+		default:
+			esc = (c < 0x20) ? 'u' : 0;
+			break;
+		}
+
+		if (esc == 0) {
+			continue;
+		}
+
+		/* Flush the unescaped run preceding this character */
+		put_raw(writer, run, str - run);
+		put_char(writer, '\\');
+		put_char(writer, esc);
+
+		if (esc == 'u') {
+			char code[4] = { '0', '0', hex[c >> 4], hex[c & 0xf] };
+
+			put_raw(writer, code, sizeof(code));
+		}
+
+		run = str + 1;
+	}
+
+	put_raw(writer, run, str - run);
+	put_char(writer, '"');
+}
+
+/* Emit separator and member name ahead of a value in the current container */
+static void put_prefix(struct mqtt_json_writer *writer, const char *key)
+{
+	uint32_t bit = BIT(writer->depth);
+	bool in_array = (writer->in_array & bit) != 0;
+
+	if (writer->err) {
+		return;
+	}
+
+	if (writer->has_member & bit) {
+		/* Only a single value is allowed at root level */
+		if (writer->depth == 0) {
+			set_error(writer, -EINVAL);
+			return;
+		}
+
+		put_char(writer, ',');
+	}
+
+	writer->has_member |= bit;
+
+	/* Members of objects must be named, array elements and the root value must not */
+	if ((writer->depth > 0 && !in_array) != (key != NULL)) {
+		set_error(writer, -EINVAL);
+		return;
+	}
+
+	if (key) {
+		put_escaped(writer, key);
+		put_char(writer, ':');
+	}
+}
+
+static void container_start(struct mqtt_json_writer *writer, const char *key, bool array)
+{
+	uint32_t bit;
+
+	put_prefix(writer, key);
+
+	if (writer->err) {
+		return;
+	}
+
+	if (writer->depth + 1 >= MQTT_JSON_MAX_DEPTH) {
+		set_error(writer, -EINVAL);
+		return;
+	}
+
+	writer->depth++;
+	bit = BIT(writer->depth);
+
+	writer->has_member &= ~bit;
+
+	if (array) {
+		writer->in_array |= bit;
+	} else {
+		writer->in_array &= ~bit;
+	}
+
+	put_char(writer, array ? '[' : '{');
+}
+
+static void container_end(struct mqtt_json_writer *writer, bool array)
+{
+	if (writer->err) {
+		return;
+	}
+
+	if (writer->depth == 0 ||
+	    ((writer->in_array & BIT(writer->depth)) != 0) != array) {
+		set_error(writer, -EINVAL);
+		return;
+	}
+
+	writer->depth--;
+
+	put_char(writer, array ? ']' : '}');
+}
+
+void mqtt_json_init(struct mqtt_json_writer *writer, char *buf, size_t size)
+{
+	memset(writer, 0, sizeof(*writer));
+
+	writer->buf = buf;
+	writer->size = size;
+
+	if (buf == NULL || size == 0) {
+		writer->err = -ENOMEM;
+	}
+}
+
+void mqtt_json_obj_start(struct mqtt_json_writer *writer, const char *key)
+{
+	container_start(writer, key, false);
+}
+
+void mqtt_json_obj_end(struct mqtt_json_writer *writer)
+{
+	container_end(writer, false);
+}
+
+void mqtt_json_arr_start(struct mqtt_json_writer *writer, const char *key)
+{
+	container_start(writer, key, true);
+}
+
+void mqtt_json_arr_end(struct mqtt_json_writer *writer)
+{
+	container_end(writer, true);
+}
+
+void mqtt_json_add_str(struct mqtt_json_writer *writer, const char *key, const char *value)
+{
+	put_prefix(writer, key);
+
+	if (value == NULL) {
+		put_raw(writer, "null", 4);
+		return;
+	}
+
+	put_escaped(writer, value);
+}
+
+void mqtt_json_add_int(struct mqtt_json_writer *writer, const char *key, int64_t value)
+{
+	put_prefix(writer, key);
+
+	if (value < 0) {
+		put_char(writer, '-');
+		/* Negate in unsigned space so that INT64_MIN is handled */
+		put_uint(writer, (uint64_t)0 - (uint64_t)value);
+		return;
+	}
+
+	put_uint(writer, (uint64_t)value);
+}
+
+void mqtt_json_add_double(struct mqtt_json_writer *writer, const char *key, double value,
+			  uint8_t decimals)
+{
+	uint64_t scale = 1;
+	uint64_t scaled;
+	uint64_t frac;
+	char frac_digits[MQTT_JSON_MAX_DECIMALS];
+	size_t frac_len = decimals;
+
+	put_prefix(writer, key);
+
+	if (writer->err) {
+		return;
+	}
+
+	if (!isfinite(value) || decimals > MQTT_JSON_MAX_DECIMALS) {
+		set_error(writer, -EINVAL);
+		return;
+	}
+
+	for (uint8_t i = 0; i < decimals; i++) {
+		scale *= 10;
+	}
+
+	if (fabs(value) * (double)scale >= MQTT_JSON_MAX_SCALED) {
+		set_error(writer, -EINVAL);
+		return;
+	}
+
+	scaled = (uint64_t)llround(fabs(value) * (double)scale);
+
+	/* Do not emit "-0" for values that round to zero */
+	if (value < 0 && scaled != 0) {
+		put_char(writer, '-');
+	}
+
+	put_uint(writer, scaled / scale);
+
+	frac = scaled % scale;
+
+	/* Drop trailing zeros, "12.50" is written as "12.5" and "3.00" as "3" */
+	while (frac_len > 0 && (frac % 10) == 0) {
+		frac /= 10;
+		frac_len--;
+	}
+
+	if (frac_len == 0) {
+		return;
+	}
+
+	for (size_t i = frac_len; i > 0; i--) {
+		frac_digits[i - 1] = '0' + (frac % 10);
+		frac /= 10;
+	}
+
+	put_char(writer, '.');
+	put_raw(writer, frac_digits, frac_len);
+}
+
+void mqtt_json_add_bool(struct mqtt_json_writer *writer, const char *key, bool value)
+{
+	put_prefix(writer, key);
+
+	if (value) {
+		put_raw(writer, "true", 4);
+	} else {
+		put_raw(writer, "false", 5);
+	}
+}
+
+int mqtt_json_finish(struct mqtt_json_writer *writer)
+{
+	if (writer->err == 0 && writer->depth != 0) {
+		set_error(writer, -EINVAL);
+	}
+
+	if (writer->err) {
+		if (writer->buf != NULL && writer->size > 0) {
+			writer->buf[0] = '\0';
+		}
+
+		return writer->err;
+	}
+
+	writer->buf[writer->len] = '\0';
+
+	return (int)writer->len;
+}
+
+/* Tokenizer state, see mqtt_json_tokenize() */
+struct json_tokenizer {
+	const char *json;
+	size_t len;
+	size_t pos;
+	struct mqtt_json_tok *toks;
+	size_t max_toks;
+	size_t count;
+};
+
+static int parse_value(struct json_tokenizer *t, uint8_t depth);
+
+static void skip_whitespace(struct json_tokenizer *t)
+{
+	while (t->pos < t->len) {
+		char c = t->json[t->pos];
+
+		if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+			break;
+		}
+
+		t->pos++;
+	}
+}
+
+static int tok_alloc(struct json_tokenizer *t, enum mqtt_json_tok_type type, size_t start)
+{
+	struct mqtt_json_tok *tok;
+
+	if (t->count >= t->max_toks) {
+		return -ENOMEM;
+	}
+
+	tok = &t->toks[t->count];
+	tok->type = type;
+	tok->start = (uint16_t)start;
+	tok->end = (uint16_t)start;
+	tok->size = 0;
+
+	return (int)t->count++;
+}
+
+static bool is_hex(char c)
+{
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static bool is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static int parse_string(struct json_tokenizer *t)
+{
+	int index;
+
+	/* Skip the opening quote */
+	t->pos++;
+
+	index = tok_alloc(t, MQTT_JSON_TOK_STRING, t->pos);
+	if (index < 0) {
+		return index;
+	}
+
+	while (t->pos < t->len) {
+		char c = t->json[t->pos];
+
+		if (c == '"') {
+			t->toks[index].end = (uint16_t)t->pos;
+			t->pos++;
+
+			return 0;
+		}
+
+		/* Control characters must be escaped */
+		if ((unsigned char)c < 0x20) {
+			return -EINVAL;
+		}
+
+		if (c != '\\') {
+			t->pos++;
+			continue;
+		}
+
+		if (t->pos + 1 >= t->len) {
+			return -EINVAL;
+		}
+
+		c = t->json[t->pos + 1];
+
+		if (c == 'u') {
+			if (t->pos + 6 > t->len) {
+				return -EINVAL;
+			}
+
+			for (size_t i = 2; i < 6; i++) {
+				if (!is_hex(t->json[t->pos + i])) {
+					return -EINVAL;
+				}
+			}
+
+			t->pos += 6;
+		} else if (c != '\0' && strchr("\"\\/bfnrt", c) != NULL) {
+			t->pos += 2;
+		} else {
+			return -EINVAL;
+		}
+	}
+
+	/* Missing closing quote */
+	return -EINVAL;
+}
+
+static size_t skip_digits(struct json_tokenizer *t)
+{
+	size_t start = t->pos;
+
+	while (t->pos < t->len && is_digit(t->json[t->pos])) {
+		t->pos++;
+	}
+
+	return t->pos - start;
+}
+
+static int parse_number(struct json_tokenizer *t)
+{
+	if (t->json[t->pos] == '-') {
+		t->pos++;
+	}
+
+	/* No leading zeros */
+	if (t->pos < t->len && t->json[t->pos] == '0') {
+		t->pos++;
+	} else if (skip_digits(t) == 0) {
+		return -EINVAL;
+	}
+
+	if (t->pos < t->len && t->json[t->pos] == '.') {
+		t->pos++;
+
+		if (skip_digits(t) == 0) {
+			return -EINVAL;
+		}
+	}
+
+	if (t->pos < t->len && (t->json[t->pos] == 'e' || t->json[t->pos] == 'E')) {
+		t->pos++;
+
+		if (t->pos < t->len && (t->json[t->pos] == '+' || t->json[t->pos] == '-')) {
+			t->pos++;
+		}
+
+		if (skip_digits(t) == 0) {
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static int parse_primitive(struct json_tokenizer *t)
+{
+	static const char *const literals[] = { "true", "false", "null" };
+	size_t start = t->pos;
+	int index;
+	int err = -EINVAL;
+
+	index = tok_alloc(t, MQTT_JSON_TOK_PRIMITIVE, start);
+	if (index < 0) {
+		return index;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(literals); i++) {
+		size_t literal_len = strlen(literals[i]);
+
+		if (t->len - start >= literal_len &&
+		    memcmp(&t->json[start], literals[i], literal_len) == 0) {
+			t->pos += literal_len;
+			err = 0;
+			break;
+		}
+	}
+
+	if (err) {
+		err = parse_number(t);
+		if (err) {
+			return err;
+		}
+	}
+
+	t->toks[index].end = (uint16_t)t->pos;
+
+	return 0;
+}
+
+/* Parse the members of an object or the elements of an array */
+static int parse_container(struct json_tokenizer *t, uint8_t depth)
+{
+	bool object = (t->json[t->pos] == '{');
+	char close = object ? '}' : ']';
+	int index;
+	int err;
+
+	if (depth >= MQTT_JSON_MAX_DEPTH) {
+		return -EINVAL;
+	}
+
+	index = tok_alloc(t, object ? MQTT_JSON_TOK_OBJECT : MQTT_JSON_TOK_ARRAY, t->pos);
+	if (index < 0) {
+		return index;
+	}
+
+	t->pos++;
+	skip_whitespace(t);
+
+	if (t->pos < t->len && t->json[t->pos] == close) {
+		t->pos++;
+		t->toks[index].end = (uint16_t)t->pos;
+
+		return 0;
+	}
+
+	while (true) {
+		if (object) {
+			if (t->pos >= t->len || t->json[t->pos] != '"') {
+				return -EINVAL;
+			}
+
+			err = parse_string(t);
+			if (err) {
+				return err;
+			}
+
+			skip_whitespace(t);
+
+			if (t->pos >= t->len || t->json[t->pos] != ':') {
+				return -EINVAL;
+			}
+
+			t->pos++;
+			skip_whitespace(t);
+		}
+
+		err = parse_value(t, depth + 1);
+		if (err) {
+			return err;
+		}
+
+		t->toks[index].size++;
+
+		skip_whitespace(t);
+
+		if (t->pos >= t->len) {
+			return -EINVAL;
+		}
+
+		if (t->json[t->pos] == close) {
+			t->pos++;
+			t->toks[index].end = (uint16_t)t->pos;
+
+			return 0;
+		}
+
+		if (t->json[t->pos] != ',') {
+			return -EINVAL;
+		}
+
+		t->pos++;
+		skip_whitespace(t);
+	}
+}
+
+static int parse_value(struct json_tokenizer *t, uint8_t depth)
+{
+	if (t->pos >= t->len) {
+		return -EINVAL;
+	}
+
+	switch (t->json[t->pos]) {
+	case '{':
+	case '[':
+		return parse_container(t, depth);
+	case '"':
+		return parse_string(t);
+	default:
+		return parse_primitive(t);
+	}
+}
+
+int mqtt_json_tokenize(const char *json, size_t len, struct mqtt_json_tok *toks, size_t count)
+{
+	struct json_tokenizer t = {
+		.json = json,
+		.len = len,
+		.toks = toks,
+		.max_toks = count,
+	};
+	int err;
+
+	/* Offsets are stored in 16 bits */
+	if (len > UINT16_MAX) {
+		return -EMSGSIZE;
+	}
+
+	skip_whitespace(&t);
+
+	err = parse_value(&t, 0);
+	if (err) {
+		return err;
+	}
+
+	/* Nothing but whitespace may follow the value */
+	skip_whitespace(&t);
+
+	if (t.pos != t.len) {
+		return -EINVAL;
+	}
+
+	return (int)t.count;
+}
+
+size_t mqtt_json_tok_skip(const struct mqtt_json_tok *toks, size_t count, size_t index)
+{
+	size_t next = index + 1;
+
+	/* Members lie within the span of their container */
+	while (next < count && toks[next].start < toks[index].end) {
+		next++;
+	}
+
+	return next;
+}
+
+int mqtt_json_obj_get(const char *json, const struct mqtt_json_tok *toks, size_t count,
+		      size_t obj, const char *key)
+{
+	size_t index = obj + 1;
+
+	if (obj >= count || toks[obj].type != MQTT_JSON_TOK_OBJECT) {
+		return -EINVAL;
+	}
+
+	for (uint16_t i = 0; i < toks[obj].size && index + 1 < count; i++) {
+		if (mqtt_json_tok_eq(json, &toks[index], key)) {
+			return (int)(index + 1);
+		}
+
+		index = mqtt_json_tok_skip(toks, count, index + 1);
+	}
+
+	return -ENOENT;
+}
+
+bool mqtt_json_tok_eq(const char *json, const struct mqtt_json_tok *tok, const char *str)
+{
+	size_t len = tok->end - tok->start;
+
+	return tok->type == MQTT_JSON_TOK_STRING && strlen(str) == len &&
+	       memcmp(&json[tok->start], str, len) == 0;
+}
+
+int mqtt_json_tok_int(const char *json, const struct mqtt_json_tok *tok, int32_t *value)
+{
+	const char *c = &json[tok->start];
+	const char *end = &json[tok->end];
+	bool negative = false;
+	int64_t result = 0;
+
+	if (tok->type != MQTT_JSON_TOK_PRIMITIVE || c == end) {
+		return -EINVAL;
+	}
+
+	if (*c == '-') {
+		negative = true;
+		c++;
+	}
+
+	/* The tokenizer has validated the number, anything but digits is a fraction or exponent */
+	for (; c < end; c++) {
+		if (!is_digit(*c)) {
+			return -EINVAL;
+		}
+
+		result = result * 10 + (*c - '0');
+
+		if (result > (int64_t)INT32_MAX + 1) {
+			return -ERANGE;
+		}
+	}
+
+	if (negative) {
+		result = -result;
+	}
+
+	if (result > INT32_MAX || result < INT32_MIN) {
+		return -ERANGE;
+	}
+
+	*value = (int32_t)result;
+
+	return 0;
+}
+
+int mqtt_json_tok_bool(const char *json, const struct mqtt_json_tok *tok, bool *value)
+{
+	size_t len = tok->end - tok->start;
+
+	if (tok->type != MQTT_JSON_TOK_PRIMITIVE) {
+		return -EINVAL;
+	}
+
+	if (len == 4 && memcmp(&json[tok->start], "true", 4) == 0) {
+		*value = true;
+	} else if (len == 5 && memcmp(&json[tok->start], "false", 5) == 0) {
+		*value = false;
+	} else {
+		return -EINVAL;
+	}
+
+	return 0;
+}
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CUSTOM_MQTT_JSON_H_
+#define CUSTOM_MQTT_JSON_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum nesting depth of objects and arrays supported by the writer. */
+#define MQTT_JSON_MAX_DEPTH 8
+
+/**
+ * @brief Streaming JSON writer.
+ *
+ * Serializes compact JSON directly into a caller-provided buffer without any heap usage.
+ * The first error (buffer overflow or invalid nesting) is latched in @ref err and all
+ * subsequent calls become no-ops, so a message can be built without checking every call
+ * and validated once with mqtt_json_finish().
+ */
+struct mqtt_json_writer {
+	/** Output buffer. */
+	char *buf;
+
+	/** Size of the output buffer, including room for the NULL terminator. */
+	size_t size;
+
+	/** Number of bytes written, excluding the NULL terminator. */
+	size_t len;
+
+	/** First error encountered, 0 if none. */
+	int err;
+
+	/** Current nesting depth. */
+	uint8_t depth;
+
+	/** Bit n is set when the container at depth n already holds a member. */
+	uint32_t has_member;
+
+	/** Bit n is set when the container at depth n is an array. */
+	uint32_t in_array;
+};
+
+/**
+ * @brief Initialize a writer on top of a buffer.
+ *
+ * @param[out] writer Writer to initialize.
+ * @param[in]  buf    Output buffer.
+ * @param[in]  size   Size of the output buffer.
+ */
+void mqtt_json_init(struct mqtt_json_writer *writer, char *buf, size_t size);
+
+/**
+ * @brief Open an object.
+ *
+ * @param[in] writer Writer.
+ * @param[in] key    Member name, or NULL for the root object and array elements.
+ */
+void mqtt_json_obj_start(struct mqtt_json_writer *writer, const char *key);
+
+/**
+ * @brief Close the innermost object.
+ *
+ * @param[in] writer Writer.
+ */
+void mqtt_json_obj_end(struct mqtt_json_writer *writer);
+
+/**
+ * @brief Open an array.
+ *
+ * @param[in] writer Writer.
+ * @param[in] key    Member name, or NULL for the root array and array elements.
+ */
+void mqtt_json_arr_start(struct mqtt_json_writer *writer, const char *key);
+
+/**
+ * @brief Close the innermost array.
+ *
+ * @param[in] writer Writer.
+ */
+void mqtt_json_arr_end(struct mqtt_json_writer *writer);
+
+/**
+ * @brief Add an escaped string value.
+ *
+ * @param[in] writer Writer.
+ * @param[in] key    Member name, or NULL inside arrays.
+ * @param[in] value  NULL terminated string.
+ */
+void mqtt_json_add_str(struct mqtt_json_writer *writer, const char *key, const char *value);
+
+/**
+ * @brief Add an integer value.
+ *
+ * @param[in] writer Writer.
+ * @param[in] key    Member name, or NULL inside arrays.
+ * @param[in] value  Value.
+ */
+void mqtt_json_add_int(struct mqtt_json_writer *writer, const char *key, int64_t value);
+
+/**
+ * @brief Add a fixed-point number value.
+ *
+ * The value is rounded to the given number of decimals and trailing zeros are omitted.
+ * Non-finite values cannot be represented in JSON and set -EINVAL.
+ *
+ * @param[in] writer   Writer.
+ * @param[in] key      Member name, or NULL inside arrays.
+ * @param[in] value    Value.
+ * @param[in] decimals Number of decimals to keep, at most 9.
+ */
+void mqtt_json_add_double(struct mqtt_json_writer *writer, const char *key, double value,
+			  uint8_t decimals);
+
+/**
+ * @brief Add a boolean value.
+ *
+ * @param[in] writer Writer.
+ * @param[in] key    Member name, or NULL inside arrays.
+ * @param[in] value  Value.
+ */
+void mqtt_json_add_bool(struct mqtt_json_writer *writer, const char *key, bool value);
+
+/**
+ * @brief Terminate the output and report the result.
+ *
+ * @param[in] writer Writer.
+ *
+ * @returns Length of the NULL terminated JSON string on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -ENOMEM if the output did not fit in the buffer.
+ * @retval -EINVAL if a value was invalid or objects and arrays were not balanced.
+ */
+int mqtt_json_finish(struct mqtt_json_writer *writer);
+
+/** @brief Token types reported by mqtt_json_tokenize(). */
+enum mqtt_json_tok_type {
+	MQTT_JSON_TOK_OBJECT,
+	MQTT_JSON_TOK_ARRAY,
+	MQTT_JSON_TOK_STRING,
+	/** Number, true, false or null. */
+	MQTT_JSON_TOK_PRIMITIVE,
+};
+
+/**
+ * @brief Token of a JSON document.
+ *
+ * Tokens only hold offsets into the tokenized input, which is neither copied nor modified.
+ * Tokens are stored in document order, the members of an object or array follow it directly
+ * and each object member is a key token followed by its value.
+ */
+struct mqtt_json_tok {
+	enum mqtt_json_tok_type type;
+
+	/** Offset of the first character. Strings start after the opening quote. */
+	uint16_t start;
+
+	/** Offset after the last character. Strings end at the closing quote. */
+	uint16_t end;
+
+	/** Number of members of an object or elements of an array, 0 otherwise. */
+	uint16_t size;
+};
+
+/**
+ * @brief Split a JSON document into tokens without copying it or using the heap.
+ *
+ * The whole input must be a single valid JSON value. String escape sequences are validated but
+ * not decoded, string tokens refer to the escaped text.
+ *
+ * @param[in]  json   JSON document, does not need to be NULL terminated.
+ * @param[in]  len    Length of the document.
+ * @param[out] toks   Token array.
+ * @param[in]  count  Number of entries in the token array.
+ *
+ * @returns Number of tokens on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -ENOMEM if the document has more tokens than fit in the array.
+ * @retval -EINVAL if the document is not valid JSON or nested deeper than MQTT_JSON_MAX_DEPTH.
+ * @retval -EMSGSIZE if the document is longer than UINT16_MAX.
+ */
+int mqtt_json_tokenize(const char *json, size_t len, struct mqtt_json_tok *toks, size_t count);
+
+/**
+ * @brief Get the index of the token after a token and all its members.
+ *
+ * @param[in] toks  Tokens returned by mqtt_json_tokenize().
+ * @param[in] count Number of tokens.
+ * @param[in] index Index of the token to skip.
+ *
+ * @returns Index of the next sibling, or count if there is none.
+ */
+size_t mqtt_json_tok_skip(const struct mqtt_json_tok *toks, size_t count, size_t index);
+
+/**
+ * @brief Look up an object member by name.
+ *
+ * @param[in] json  Tokenized JSON document.
+ * @param[in] toks  Tokens returned by mqtt_json_tokenize().
+ * @param[in] count Number of tokens.
+ * @param[in] obj   Index of the object token.
+ * @param[in] key   Member name.
+ *
+ * @returns Index of the member value on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -ENOENT if the object has no member with that name.
+ * @retval -EINVAL if the token is not an object.
+ */
+int mqtt_json_obj_get(const char *json, const struct mqtt_json_tok *toks, size_t count,
+		      size_t obj, const char *key);
+
+/**
+ * @brief Compare a string token with a NULL terminated string.
+ *
+ * @param[in] json JSON document.
+ * @param[in] tok  Token.
+ * @param[in] str  String to compare with.
+ *
+ * @returns true if the token is a string with exactly the same (escaped) text.
+ */
+bool mqtt_json_tok_eq(const char *json, const struct mqtt_json_tok *tok, const char *str);
+
+/**
+ * @brief Read an integer token.
+ *
+ * @param[in]  json  JSON document.
+ * @param[in]  tok   Token.
+ * @param[out] value Value.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -EINVAL if the token is not an integer number.
+ * @retval -ERANGE if the value does not fit in 32 bits.
+ */
+int mqtt_json_tok_int(const char *json, const struct mqtt_json_tok *tok, int32_t *value);
+
+/**
+ * @brief Read a boolean token.
+ *
+ * @param[in]  json  JSON document.
+ * @param[in]  tok   Token.
+ * @param[out] value Value.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -EINVAL if the token is not true or false.
+ */
+int mqtt_json_tok_bool(const char *json, const struct mqtt_json_tok *tok, bool *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUSTOM_MQTT_JSON_H_ */
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "custom_mqtt_ring.h"
+
+/* Positions are kept modulo 2^32 on all platforms, also where atomic_t is 64 bits wide */
+static uint32_t pos_get(atomic_t *target)
+{
+	return (uint32_t)atomic_get(target);
+}
+
+/* Distance from a position to a sequence number, valid across the wrap-around */
+static int32_t seq_diff(uint32_t seq, uint32_t pos)
+{
+	return (int32_t)(seq - pos);
+}
+
+static uint8_t *slot_get(struct mqtt_ring *ring, uint32_t pos)
+{
+	return &ring->buf[(pos & (ring->size - 1)) * ring->item_size];
+}
+
+void mqtt_ring_init(struct mqtt_ring *ring)
+{
+	/* A free slot holds the position of the next item that is written to it */
+	for (uint32_t i = 0; i < ring->size; i++) {
+		atomic_set(&ring->seq[i], i);
+	}
+
+	atomic_set(&ring->head, 0);
+	atomic_set(&ring->dropped, 0);
+	ring->tail = 0;
+}
+
+int mqtt_ring_put(struct mqtt_ring *ring, const void *item)
+{
+	uint32_t pos = pos_get(&ring->head);
+	atomic_t *seq;
+
+	while (true) {
+		int32_t diff;
+
+		seq = &ring->seq[pos & (ring->size - 1)];
+		diff = seq_diff(pos_get(seq), pos);
+
+		if (diff == 0) {
+			/* The slot is free, reserve it unless another producer was faster */
+			if (atomic_cas(&ring->head, (atomic_val_t)pos, (atomic_val_t)(pos + 1))) {
+				break;
+			}
+		} else if (diff < 0) {
+			/* The slot still holds the item from one lap earlier */
+			atomic_inc(&ring->dropped);
+			return -ENOMEM;
+		}
+
+		pos = pos_get(&ring->head);
+	}
+
+	memcpy(slot_get(ring, pos), item, ring->item_size);
+
+	/* Hand the slot over to the consumer */
+	atomic_set(seq, (atomic_val_t)(pos + 1));
+
+	return 0;
+}
+
+int mqtt_ring_peek(struct mqtt_ring *ring, void *item)
+{
+	uint32_t pos = ring->tail;
+
+	if (seq_diff(pos_get(&ring->seq[pos & (ring->size - 1)]), pos + 1) < 0) {
+		return -ENODATA;
+	}
+
+	memcpy(item, slot_get(ring, pos), ring->item_size);
+
+	return 0;
+}
+
+int mqtt_ring_get(struct mqtt_ring *ring, void *item)
+{
+	uint32_t pos = ring->tail;
+	int ret;
+
+	ret = mqtt_ring_peek(ring, item);
+	if (ret) {
+		return ret;
+	}
+
+	/* Free the slot for the producer one lap later */
+	atomic_set(&ring->seq[pos & (ring->size - 1)], (atomic_val_t)(pos + ring->size));
+	ring->tail = pos + 1;
+
+	return 0;
+}
+
+uint32_t mqtt_ring_count(struct mqtt_ring *ring)
+{
+	return pos_get(&ring->head) - ring->tail;
+}
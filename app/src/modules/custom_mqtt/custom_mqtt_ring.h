@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CUSTOM_MQTT_RING_H_
+#define CUSTOM_MQTT_RING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/toolchain.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Lock-free ring of fixed-size items with several producers and a single consumer.
+ *
+ * Every slot has a sequence number that tells whether it is free for the producer at a given
+ * position or holds the item for the consumer at that position. Producers reserve a position
+ * with a compare-and-swap on @ref head and publish the item by advancing the sequence number of
+ * its slot, so neither side ever waits for the other. Positions wrap around at 2^32, which is
+ * why the number of slots must be a power of two.
+ */
+struct mqtt_ring {
+	uint8_t *buf;
+	atomic_t *seq;
+	size_t item_size;
+	uint32_t size;
+
+	/** Next position to write, shared by the producers. */
+	atomic_t head;
+
+	/** Next position to read, only used by the consumer. */
+	uint32_t tail;
+
+	/** Items rejected because the ring was full. */
+	atomic_t dropped;
+};
+
+/**
+ * @brief Statically define a ring. It must be initialized with mqtt_ring_init() before use.
+ *
+ * @param _name      Name of the ring.
+ * @param _item_size Size of an item in bytes.
+ * @param _size      Number of slots, a power of two.
+ */
+#define MQTT_RING_DEFINE(_name, _item_size, _size)						\
+	BUILD_ASSERT(IS_POWER_OF_TWO(_size), "The ring size must be a power of two");		\
+	static uint8_t __aligned(8) _name##_buf[(_item_size) * (_size)];			\
+	static atomic_t _name##_seq[(_size)];							\
+	static struct mqtt_ring _name = {							\
+		.buf = _name##_buf,								\
+		.seq = _name##_seq,								\
+		.item_size = (_item_size),							\
+		.size = (_size),								\
+	}
+
+/**
+ * @brief Initialize a ring. Must not be called while the ring is in use.
+ *
+ * @param[out] ring Ring to initialize.
+ */
+void mqtt_ring_init(struct mqtt_ring *ring);
+
+/**
+ * @brief Add an item. May be called from any thread or interrupt, never blocks.
+ *
+ * @param[in,out] ring Ring.
+ * @param[in]     item Item to copy into the ring.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -ENOMEM if the ring is full, the item is counted in @ref dropped.
+ */
+int mqtt_ring_put(struct mqtt_ring *ring, const void *item);
+
+/**
+ * @brief Copy the oldest item without removing it. Only called by the consumer.
+ *
+ * @param[in]  ring Ring.
+ * @param[out] item Copy of the item.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -ENODATA if the ring is empty or the oldest item is still being written.
+ */
+int mqtt_ring_peek(struct mqtt_ring *ring, void *item);
+
+/**
+ * @brief Remove the oldest item. Only called by the consumer.
+ *
+ * @param[in,out] ring Ring.
+ * @param[out]    item Copy of the item.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -ENODATA if the ring is empty or the oldest item is still being written.
+ */
+int mqtt_ring_get(struct mqtt_ring *ring, void *item);
+
+/**
+ * @brief Get the number of items in the ring, including items that are still being written.
+ *
+ * @param[in] ring Ring.
+ *
+ * @returns Number of items. Only exact when no producer is active.
+ */
+uint32_t mqtt_ring_count(struct mqtt_ring *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUSTOM_MQTT_RING_H_ */
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/sys/util.h>
+#include <math.h>
+
+#include "custom_mqtt_sched.h"
+
+/* Round up to a whole number of eDRX cycles, the result is in whole seconds */
+static uint32_t edrx_round_up(uint32_t interval, float cycle)
+{
+	float cycles = ceilf((float)interval / cycle);
+
+	return (uint32_t)ceilf(cycles * cycle);
+}
+
+void mqtt_sched_params_init(struct mqtt_sched_params *params)
+{
+	params->tau = -1;
+	params->active_time = -1;
+	params->edrx = 0.0f;
+}
+
+void mqtt_sched_get(const struct mqtt_sched_params *params, const struct mqtt_sched *defaults,
+		    uint32_t margin, struct mqtt_sched *sched)
+{
+	uint32_t heartbeat = defaults->heartbeat;
+	uint32_t keepalive = defaults->keepalive;
+
+	if (params->tau > 0 && params->active_time >= 0) {
+		uint32_t tau = (uint32_t)params->tau;
+
+		/* Very short TAU values leave no room for the margin */
+		heartbeat = MAX(heartbeat, tau > 2 * margin ? tau - margin : tau);
+	} else if (params->edrx > 0.0f) {
+		heartbeat = edrx_round_up(heartbeat, params->edrx);
+		keepalive = edrx_round_up(keepalive, params->edrx);
+	} else {
+		*sched = *defaults;
+		return;
+	}
+
+	/* The keepalive ping is only a fallback for a heartbeat that could not be sent */
+	heartbeat = MIN(heartbeat, MQTT_SCHED_KEEPALIVE_MAX - margin);
+	keepalive = MAX(keepalive, heartbeat + margin);
+
+	sched->heartbeat = heartbeat;
+	sched->keepalive = (uint16_t)MIN(keepalive, MQTT_SCHED_KEEPALIVE_MAX);
+}
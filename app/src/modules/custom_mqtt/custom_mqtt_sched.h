@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CUSTOM_MQTT_SCHED_H_
+#define CUSTOM_MQTT_SCHED_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Largest MQTT keepalive interval, the CONNECT packet has a 16 bit field. */
+#define MQTT_SCHED_KEEPALIVE_MAX UINT16_MAX
+
+/**
+ * @brief Power saving parameters granted by the network.
+ */
+struct mqtt_sched_params {
+	/** Periodic TAU in seconds, -1 if PSM is not in use. */
+	int32_t tau;
+
+	/** Active time in seconds, -1 if PSM is not in use. */
+	int32_t active_time;
+
+	/** eDRX cycle in seconds, 0 if eDRX is not in use. */
+	float edrx;
+};
+
+/**
+ * @brief Keepalive and heartbeat intervals.
+ *
+ * Every uplink wakes the modem up, so the heartbeat is only sent when nothing else has been
+ * published for @ref heartbeat seconds, and the keepalive is long enough that the broker is
+ * never pinged in between.
+ */
+struct mqtt_sched {
+	/** MQTT keepalive in seconds, requested in the CONNECT packet. */
+	uint16_t keepalive;
+
+	/** Time without any publish after which a heartbeat is sent, in seconds. */
+	uint32_t heartbeat;
+};
+
+/**
+ * @brief Initialize the parameters to "no power saving".
+ *
+ * @param[out] params Parameters to initialize.
+ */
+void mqtt_sched_params_init(struct mqtt_sched_params *params);
+
+/**
+ * @brief Derive the keepalive and heartbeat intervals from the power saving parameters.
+ *
+ * With PSM, the heartbeat is sent @p margin seconds before the periodic TAU expires. The uplink
+ * restarts the TAU timer, so the device wakes up once per TAU period instead of once for the TAU
+ * update and again for every keepalive ping. Without PSM but with eDRX, both intervals are
+ * rounded up to a whole number of eDRX cycles. The keepalive is then at least @p margin seconds
+ * longer than the heartbeat, and neither interval is shorter than its default. Without power
+ * saving the defaults are used.
+ *
+ * @param[in]  params   Power saving parameters granted by the network.
+ * @param[in]  defaults Intervals without power saving.
+ * @param[in]  margin   Safety margin in seconds.
+ * @param[out] sched    Derived intervals.
+ */
+void mqtt_sched_get(const struct mqtt_sched_params *params, const struct mqtt_sched *defaults,
+		    uint32_t margin, struct mqtt_sched *sched);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUSTOM_MQTT_SCHED_H_ */
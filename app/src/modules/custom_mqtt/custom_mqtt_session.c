@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/sys/util.h>
+
+#include "custom_mqtt_session.h"
+
+bool mqtt_session_done(const struct mqtt_session *session, const struct mqtt_session_limits *limits,
+		       bool busy, int64_t now)
+{
+	return mqtt_session_time_left(session, limits, busy, now) == 0;
+}
+
+int64_t mqtt_session_time_left(const struct mqtt_session *session,
+			       const struct mqtt_session_limits *limits, bool busy, int64_t now)
+{
+	int64_t end = session->start + limits->timeout_ms;
+
+	if (!busy) {
+		end = MIN(end, session->activity + limits->linger_ms);
+	}
+
+	return MAX(end - now, 0);
+}
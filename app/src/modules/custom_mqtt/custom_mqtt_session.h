@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CUSTOM_MQTT_SESSION_H_
+#define CUSTOM_MQTT_SESSION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Lifetime of an on-demand MQTT session.
+ *
+ * A session is closed once it has been idle for @ref linger_ms after its last packet, or after
+ * @ref timeout_ms even while it still has work, such as publishes that are not acknowledged.
+ */
+struct mqtt_session_limits {
+	/** Time an idle session stays open after the last packet, in milliseconds. */
+	uint32_t linger_ms;
+
+	/** Longest session, in milliseconds. */
+	uint32_t timeout_ms;
+};
+
+/** @brief Session state, uptimes in milliseconds. */
+struct mqtt_session {
+	/** Uptime when the session was opened. */
+	int64_t start;
+
+	/** Uptime of the last packet sent or received. */
+	int64_t activity;
+};
+
+/**
+ * @brief Check whether a session has to be closed.
+ *
+ * @param[in] session Session.
+ * @param[in] limits  Session limits.
+ * @param[in] busy    The session still has work.
+ * @param[in] now     Current uptime in milliseconds.
+ *
+ * @returns true if the session timed out, or is idle and the linger time has passed.
+ */
+bool mqtt_session_done(const struct mqtt_session *session, const struct mqtt_session_limits *limits,
+		       bool busy, int64_t now);
+
+/**
+ * @brief Get the time until a session has to be closed if nothing changes.
+ *
+ * While the session is busy only the timeout applies, the linger time starts once it is idle.
+ *
+ * @param[in] session Session.
+ * @param[in] limits  Session limits.
+ * @param[in] busy    The session still has work.
+ * @param[in] now     Current uptime in milliseconds.
+ *
+ * @returns Time in milliseconds, 0 if the session has to be closed now.
+ */
+int64_t mqtt_session_time_left(const struct mqtt_session *session,
+			       const struct mqtt_session_limits *limits, bool busy, int64_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUSTOM_MQTT_SESSION_H_ */
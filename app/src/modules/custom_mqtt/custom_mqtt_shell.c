@@ -9,12 +9,15 @@
 #include <zephyr/zbus/zbus.h>
 
 #include "custom_mqtt.h"
+#include "custom_mqtt_transport.h"
 
 LOG_MODULE_REGISTER(custom_mqtt_shell, CONFIG_APP_CUSTOM_MQTT_LOG_LEVEL);
 
 static int cmd_mqtt_status(const struct shell *shctx, size_t argc, char **argv)
 {
 	struct custom_mqtt_msg msg;
+	struct mqtt_transport_stats stats;
+	struct custom_mqtt_stats mqtt_stats;
 	int ret;
 
 	ret = zbus_chan_read(&CUSTOM_MQTT_CHAN, &msg, K_NO_WAIT);
@@ -38,8 +41,159 @@ static int cmd_mqtt_status(const struct shell *shctx, size_t argc, char **argv)
 		break;
 	}
 
+	mqtt_transport_stats_get(&stats);
+
+	shell_print(shctx, "Connection setups: %u (last: %u ms, max: %u ms, avg: %u ms)",
+		    stats.setups, stats.setup_ms, stats.setup_max_ms,
+		    stats.setups ? (uint32_t)(stats.setup_total_ms / stats.setups) : 0);
+
+	custom_mqtt_stats_get(&mqtt_stats);
+
+	shell_print(shctx, "Suppressed records: environmental %u, power %u",
+		    mqtt_stats.suppressed_environmental, mqtt_stats.suppressed_power);
+
+	shell_print(shctx, "Queued records: high %u, normal %u, low %u",
+		    mqtt_stats.queued[CUSTOM_MQTT_PRIO_HIGH],
+		    mqtt_stats.queued[CUSTOM_MQTT_PRIO_NORMAL],
+		    mqtt_stats.queued[CUSTOM_MQTT_PRIO_LOW]);
+
+	shell_print(shctx, "Dropped records: high %u, normal %u, low %u",
+		    mqtt_stats.dropped[CUSTOM_MQTT_PRIO_HIGH],
+		    mqtt_stats.dropped[CUSTOM_MQTT_PRIO_NORMAL],
+		    mqtt_stats.dropped[CUSTOM_MQTT_PRIO_LOW]);
+
+	shell_print(shctx, "Keepalive: %u s, heartbeat interval: %u s (suppressed: %u)",
+		    mqtt_stats.keepalive, mqtt_stats.heartbeat_interval,
+		    mqtt_stats.suppressed_heartbeats);
+
+	if (IS_ENABLED(CONFIG_APP_CUSTOM_MQTT_FAILOVER)) {
+		shell_print(shctx, "Broker: %s (%u of %zu, %u switches)",
+			    mqtt_transport_broker_name(mqtt_stats.broker), mqtt_stats.broker + 1,
+			    mqtt_transport_broker_count(), mqtt_stats.broker_switches);
+	}
+
+	if (IS_ENABLED(CONFIG_APP_CUSTOM_MQTT_ON_DEMAND)) {
+		shell_print(shctx, "On-demand sessions: %u", mqtt_stats.sessions);
+	}
+
+	if (IS_ENABLED(CONFIG_APP_CUSTOM_MQTT_ENERGY_ESTIMATE)) {
+		shell_print(shctx,
+			    "Last cycle: %u s, %u radio wakeups, %u ms connected, about %u mJ",
+			    mqtt_stats.cycle_duration_ms / MSEC_PER_SEC, mqtt_stats.cycle_wakeups,
+			    mqtt_stats.cycle_active_ms, mqtt_stats.cycle_energy_mj);
+	}
+
+	return 0;
+}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_STATS)
+static const char *const hist_names[CUSTOM_MQTT_HIST_COUNT] = {
+	[CUSTOM_MQTT_HIST_QUEUE_MS] = "Enqueue to publish (ms)",
+	[CUSTOM_MQTT_HIST_ACK_MS] = "Publish to PUBACK (ms)",
+	[CUSTOM_MQTT_HIST_MSG_BYTES] = "Message size (bytes)",
+	[CUSTOM_MQTT_HIST_MSGS_PER_MIN] = "Messages per minute",
+	[CUSTOM_MQTT_HIST_RECONNECT_MS] = "Reconnect (ms)",
+	[CUSTOM_MQTT_HIST_SUBMIT_US] = "Record queue put (us)",
+};
+
+static void hist_print(const struct shell *shctx, const char *name, const struct mqtt_hist *hist)
+{
+	uint32_t low = 0;
+
+	shell_print(shctx, "%s: %u values", name, hist->count);
+
+	if (hist->count == 0) {
+		return;
+	}
+
+	shell_print(shctx, "  min %u, avg %u, max %u, p50 <= %u, p90 <= %u, p99 <= %u",
+		    hist->min, (uint32_t)(hist->sum / hist->count), hist->max,
+		    mqtt_hist_percentile(hist, 50), mqtt_hist_percentile(hist, 90),
+		    mqtt_hist_percentile(hist, 99));
+
+	for (size_t i = 0; i < MQTT_HIST_BUCKETS; i++) {
+		uint32_t high = mqtt_hist_bucket_max(i);
+
+		if (hist->buckets[i] == 0) {
+			/* Empty buckets are skipped */
+		} else if (high == UINT32_MAX) {
+			shell_print(shctx, "  %10u - ...       : %u", low, hist->buckets[i]);
+		} else {
+			shell_print(shctx, "  %10u - %-10u: %u", low, high, hist->buckets[i]);
+		}
+
+		low = high + 1;
+	}
+}
+
+static int cmd_mqtt_stats(const struct shell *shctx, size_t argc, char **argv)
+{
+	struct custom_mqtt_stats mqtt_stats;
+	struct mqtt_hist hist;
+	int ret;
+
+	for (size_t i = 0; i < CUSTOM_MQTT_HIST_COUNT; i++) {
+		ret = custom_mqtt_hist_get(i, &hist);
+		if (ret) {
+			shell_error(shctx, "Failed to read histogram: %d", ret);
+			return ret;
+		}
+
+		hist_print(shctx, hist_names[i], &hist);
+	}
+
+	/* Producers never wait, a record that does not fit in its ring is dropped instead */
+	custom_mqtt_stats_get(&mqtt_stats);
+
+	shell_print(shctx, "Dropped records: high %u, normal %u, low %u",
+		    mqtt_stats.dropped[CUSTOM_MQTT_PRIO_HIGH],
+		    mqtt_stats.dropped[CUSTOM_MQTT_PRIO_NORMAL],
+		    mqtt_stats.dropped[CUSTOM_MQTT_PRIO_LOW]);
+
+	return 0;
+}
+#endif /* CONFIG_APP_CUSTOM_MQTT_STATS */
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_BUDGET)
+static const char *const budget_names[MQTT_BUDGET_CLASS_COUNT] = {
+	[MQTT_BUDGET_TELEMETRY] = "Telemetry",
+	[MQTT_BUDGET_LOCATION] = "Location",
+	[MQTT_BUDGET_PROBE] = "UART probe",
+	[MQTT_BUDGET_DIAGNOSTICS] = "Diagnostics",
+};
+
+static void budget_print(const struct shell *shctx, const char *name, uint32_t bytes,
+			 uint32_t limit)
+{
+	if (limit == 0) {
+		shell_print(shctx, "%s: %u bytes (no limit)", name, bytes);
+	} else {
+		shell_print(shctx, "%s: %u of %u bytes (%u%%)", name, bytes, limit,
+			    (uint32_t)((uint64_t)bytes * 100 / limit));
+	}
+}
+
+static int cmd_mqtt_budget(const struct shell *shctx, size_t argc, char **argv)
+{
+	struct custom_mqtt_stats stats;
+
+	custom_mqtt_stats_get(&stats);
+
+	if (stats.budget.day == 0) {
+		shell_print(shctx, "Date not known yet, counting towards the first day");
+	}
+
+	budget_print(shctx, "Today", stats.budget.daily_bytes, stats.budget_daily_limit);
+	budget_print(shctx, "This month", stats.budget.monthly_bytes, stats.budget_monthly_limit);
+
+	for (size_t i = 0; i < MQTT_BUDGET_CLASS_COUNT; i++) {
+		shell_print(shctx, "  %-12s %u bytes this month, %u records held back or dropped",
+			    budget_names[i], stats.budget.class_bytes[i], stats.budget_limited[i]);
+	}
+
 	return 0;
 }
+#endif /* CONFIG_APP_CUSTOM_MQTT_BUDGET */
 
 static int cmd_mqtt_send(const struct shell *shctx, size_t argc, char **argv)
 {
@@ -67,6 +221,10 @@ static int cmd_mqtt_send(const struct shell *shctx, size_t argc, char **argv)
 SHELL_STATIC_SUBCMD_SET_CREATE(mqtt_cmds,
 	SHELL_CMD_ARG(status, NULL, "Show MQTT connection status", cmd_mqtt_status, 1, 0),
 	SHELL_CMD_ARG(send, NULL, "Send message to MQTT broker", cmd_mqtt_send, 2, 0),
+	SHELL_COND_CMD_ARG(CONFIG_APP_CUSTOM_MQTT_STATS, stats, NULL,
+			   "Show latency and throughput histograms", cmd_mqtt_stats, 1, 0),
+	SHELL_COND_CMD_ARG(CONFIG_APP_CUSTOM_MQTT_BUDGET, budget, NULL,
+			   "Show uplink byte budget consumption", cmd_mqtt_budget, 1, 0),
 	SHELL_SUBCMD_SET_END
 );
 
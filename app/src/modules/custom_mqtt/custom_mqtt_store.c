@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/fs/fcb.h>
+#include <zephyr/storage/flash_map.h>
+#include <errno.h>
+#include <string.h>
+
+#include "custom_mqtt_store.h"
+
+LOG_MODULE_REGISTER(custom_mqtt_store, CONFIG_APP_CUSTOM_MQTT_LOG_LEVEL);
+
+#define STORE_PARTITION_ID	FIXED_PARTITION_ID(custom_mqtt_storage)
+#define STORE_MAGIC		0x4d515454 /* "MQTT" */
+
+/* Bump when struct store_entry or struct mqtt_record changes, old stores are then erased */
+#define STORE_VERSION		2
+
+/* Rough FCB overhead per entry: length, CRC and alignment */
+#define STORE_ENTRY_OVERHEAD	4
+
+/* Stored entry. The size is a multiple of 8, which satisfies the write block size of the
+ * supported flash devices.
+ */
+struct store_entry {
+	/* UNIX time in milliseconds when the record was stored, 0 if not known */
+	int64_t stored_at;
+	struct mqtt_record record;
+};
+
+static struct flash_sector sectors[CONFIG_APP_CUSTOM_MQTT_STORE_MAX_SECTORS];
+static struct fcb fcb;
+
+/* Last entry that has been read, fe_sector is NULL when reading starts at the oldest entry */
+static struct fcb_entry read_loc;
+
+/* Number of entries after read_loc */
+static uint32_t pending;
+
+static int store_fcb_init(uint32_t sector_cnt)
+{
+	memset(&fcb, 0, sizeof(fcb));
+
+	fcb.f_magic = STORE_MAGIC;
+	fcb.f_version = STORE_VERSION;
+	fcb.f_sector_cnt = sector_cnt;
+	fcb.f_scratch_cnt = 0;
+	fcb.f_sectors = sectors;
+
+	return fcb_init(STORE_PARTITION_ID, &fcb);
+}
+
+static int store_erase(void)
+{
+	const struct flash_area *fa;
+	int err;
+
+	err = flash_area_open(STORE_PARTITION_ID, &fa);
+	if (err) {
+		return err;
+	}
+
+	err = flash_area_erase(fa, 0, fa->fa_size);
+
+	flash_area_close(fa);
+
+	return err;
+}
+
+/* Mark an entry as read and erase the sectors that have been read completely */
+static void store_consume(const struct fcb_entry *loc)
+{
+	read_loc = *loc;
+
+	if (pending > 0) {
+		pending--;
+	}
+
+	while (fcb.f_oldest != read_loc.fe_sector) {
+		if (fcb_rotate(&fcb)) {
+			break;
+		}
+	}
+}
+
+/* Erase the oldest sector to make room, dropping the unread entries in it */
+static int store_drop_oldest(void)
+{
+	struct flash_sector *oldest = fcb.f_oldest;
+	struct fcb_entry loc = { 0 };
+	uint32_t dropped = 0;
+	int err;
+
+	while (fcb_getnext(&fcb, &loc) == 0 && loc.fe_sector == oldest) {
+		if (read_loc.fe_sector != oldest || loc.fe_elem_off > read_loc.fe_elem_off) {
+			dropped++;
+		}
+	}
+
+	err = fcb_rotate(&fcb);
+	if (err) {
+		return err;
+	}
+
+	if (read_loc.fe_sector == oldest) {
+		memset(&read_loc, 0, sizeof(read_loc));
+	}
+
+	pending -= MIN(pending, dropped);
+
+	if (dropped > 0) {
+		LOG_WRN("Store full, dropped %u oldest records", dropped);
+	}
+
+	return 0;
+}
+
+int mqtt_store_init(void)
+{
+	uint32_t sector_cnt = ARRAY_SIZE(sectors);
+	struct fcb_entry loc = { 0 };
+	size_t per_sector;
+	int err;
+
+	err = flash_area_get_sectors(STORE_PARTITION_ID, &sector_cnt, sectors);
+	if (err == -ENOMEM) {
+		LOG_ERR("Store partition has more than %d sectors, increase "
+			"CONFIG_APP_CUSTOM_MQTT_STORE_MAX_SECTORS", CONFIG_APP_CUSTOM_MQTT_STORE_MAX_SECTORS);
+		return err;
+	} else if (err) {
+		LOG_ERR("flash_area_get_sectors, error: %d", err);
+		return err;
+	}
+
+	if (sector_cnt < 2) {
+		LOG_ERR("Store partition needs at least 2 sectors");
+		return -EINVAL;
+	}
+
+	err = store_fcb_init(sector_cnt);
+	if (err) {
+		LOG_WRN("No valid store found (%d), erasing partition", err);
+
+		err = store_erase();
+		if (err) {
+			LOG_ERR("store_erase, error: %d", err);
+			return err;
+		}
+
+		err = store_fcb_init(sector_cnt);
+		if (err) {
+			LOG_ERR("fcb_init, error: %d", err);
+			return err;
+		}
+	}
+
+	memset(&read_loc, 0, sizeof(read_loc));
+	pending = 0;
+
+	while (fcb_getnext(&fcb, &loc) == 0) {
+		pending++;
+	}
+
+	/* The active sector is never erased to make room, so one sector is kept as headroom */
+	per_sector = sectors[0].fs_size / (sizeof(struct store_entry) + STORE_ENTRY_OVERHEAD);
+
+	LOG_INF("Store: %u sectors of %zu bytes, capacity ~%zu records, %u pending",
+		sector_cnt, sectors[0].fs_size, (sector_cnt - 1) * per_sector, pending);
+
+	return 0;
+}
+
+int mqtt_store_put(const struct mqtt_record *record, int64_t now)
+{
+	struct store_entry entry = {
+		.stored_at = now,
+		.record = *record,
+	};
+	struct fcb_entry loc;
+	int err;
+
+	err = fcb_append(&fcb, sizeof(entry), &loc);
+	if (err == -ENOSPC) {
+		err = store_drop_oldest();
+		if (err) {
+			LOG_ERR("store_drop_oldest, error: %d", err);
+			return err;
+		}
+
+		err = fcb_append(&fcb, sizeof(entry), &loc);
+	}
+
+	if (err) {
+		LOG_ERR("fcb_append, error: %d", err);
+		return err;
+	}
+
+	err = flash_area_write(fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc), &entry, sizeof(entry));
+	if (err) {
+		LOG_ERR("flash_area_write, error: %d", err);
+		return err;
+	}
+
+	err = fcb_append_finish(&fcb, &loc);
+	if (err) {
+		LOG_ERR("fcb_append_finish, error: %d", err);
+		return err;
+	}
+
+	pending++;
+
+	return 0;
+}
+
+static bool entry_expired(const struct store_entry *entry, int64_t now)
+{
+	if (CONFIG_APP_CUSTOM_MQTT_STORE_TTL_SECONDS == 0 || now == 0 || entry->stored_at == 0) {
+		return false;
+	}
+
+	return (now - entry->stored_at) > (CONFIG_APP_CUSTOM_MQTT_STORE_TTL_SECONDS * 1000LL);
+}
+
+int mqtt_store_peek(struct mqtt_record *record, int64_t now)
+{
+	struct store_entry entry;
+	struct fcb_entry loc;
+	int err;
+
+	while (true) {
+		loc = read_loc;
+
+		if (fcb_getnext(&fcb, &loc)) {
+			return -ENODATA;
+		}
+
+		if (loc.fe_data_len != sizeof(entry)) {
+			LOG_WRN("Skipping stored entry with unexpected length %u", loc.fe_data_len);
+			store_consume(&loc);
+			continue;
+		}
+
+		err = flash_area_read(fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc), &entry, sizeof(entry));
+		if (err) {
+			LOG_ERR("flash_area_read, error: %d", err);
+			return err;
+		}
+
+		if (entry_expired(&entry, now)) {
+			LOG_DBG("Dropping expired record, stored at %lld", entry.stored_at);
+			store_consume(&loc);
+			continue;
+		}
+
+		*record = entry.record;
+
+		return 0;
+	}
+}
+
+int mqtt_store_pop(void)
+{
+	struct fcb_entry loc = read_loc;
+
+	if (fcb_getnext(&fcb, &loc)) {
+		return -ENODATA;
+	}
+
+	store_consume(&loc);
+
+	return 0;
+}
+
+int mqtt_store_clear(void)
+{
+	int err;
+
+	err = fcb_clear(&fcb);
+	if (err) {
+		LOG_ERR("fcb_clear, error: %d", err);
+		return err;
+	}
+
+	memset(&read_loc, 0, sizeof(read_loc));
+	pending = 0;
+
+	return 0;
+}
+
+uint32_t mqtt_store_count(void)
+{
+	return pending;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CUSTOM_MQTT_STORE_H_
+#define CUSTOM_MQTT_STORE_H_
+
+#include <stdint.h>
+
+#include "custom_mqtt_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Persistent FIFO of uplink records.
+ *
+ * Records that cannot be published are appended to a flash circular buffer (FCB) on the
+ * custom_mqtt_storage partition and replayed in order when the connection is back.
+ *
+ * Flash sectors are only erased when the ring wraps around or when all records in the oldest
+ * sector have been read, so wear is spread evenly over the partition. A record that has been
+ * read but whose sector has not been erased yet is replayed again after a reboot, the store
+ * gives at-least-once delivery.
+ *
+ * The store is not thread safe, it is only used from the MQTT I/O thread.
+ */
+
+/**
+ * @brief Initialize the store and count the records left from a previous boot.
+ *
+ * The partition is erased if it does not contain a store with the current layout.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ */
+int mqtt_store_init(void);
+
+/**
+ * @brief Append a record to the store.
+ *
+ * If the store is full, the oldest flash sector is erased and the records in it are dropped.
+ *
+ * @param[in] record Record to store.
+ * @param[in] now    Current UNIX time in milliseconds, 0 if not known.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ */
+int mqtt_store_put(const struct mqtt_record *record, int64_t now);
+
+/**
+ * @brief Read the oldest record without removing it.
+ *
+ * Records older than CONFIG_APP_CUSTOM_MQTT_STORE_TTL_SECONDS are removed on the way. The age
+ * of a record can only be checked if both the time it was stored and @p now are known.
+ *
+ * @param[out] record Oldest record.
+ * @param[in]  now    Current UNIX time in milliseconds, 0 if not known.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -ENODATA if the store is empty.
+ */
+int mqtt_store_peek(struct mqtt_record *record, int64_t now);
+
+/**
+ * @brief Remove the oldest record, typically after it has been published.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -ENODATA if the store is empty.
+ */
+int mqtt_store_pop(void);
+
+/**
+ * @brief Remove all records and erase the partition.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ */
+int mqtt_store_clear(void);
+
+/**
+ * @brief Get the number of records waiting in the store.
+ *
+ * @returns Number of records.
+ */
+uint32_t mqtt_store_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUSTOM_MQTT_STORE_H_ */
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+
+#include "custom_mqtt_sub.h"
+
+void mqtt_sub_start(struct mqtt_sub *sub, uint16_t message_id)
+{
+	sub->message_id = message_id;
+	sub->granted = false;
+}
+
+bool mqtt_sub_pending(const struct mqtt_sub *sub)
+{
+	return sub->message_id != 0;
+}
+
+int mqtt_sub_ack(struct mqtt_sub *sub, uint16_t message_id, int result)
+{
+	if (!mqtt_sub_pending(sub) || message_id != sub->message_id) {
+		return -ENOENT;
+	}
+
+	sub->message_id = 0;
+	sub->granted = (result == 0);
+
+	return sub->granted ? 0 : -EACCES;
+}
+
+bool mqtt_sub_cancel(struct mqtt_sub *sub)
+{
+	bool pending = mqtt_sub_pending(sub);
+
+	sub->message_id = 0;
+
+	return pending;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CUSTOM_MQTT_SUB_H_
+#define CUSTOM_MQTT_SUB_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Subscription to the command topic.
+ *
+ * Tracks the SUBSCRIBE that waits for its SUBACK. The ready state is entered once the SUBACK
+ * arrives, whether the broker granted the subscription or not, or when it times out. Without the
+ * subscription uplink still works, only downlink commands are missing.
+ */
+struct mqtt_sub {
+	/** Packet identifier of the pending SUBSCRIBE, 0 if none is pending. */
+	uint16_t message_id;
+
+	/** The broker granted the last subscription. */
+	bool granted;
+};
+
+/**
+ * @brief Start waiting for the SUBACK of a subscription.
+ *
+ * @param[out] sub        Subscription.
+ * @param[in]  message_id Packet identifier of the SUBSCRIBE, not 0.
+ */
+void mqtt_sub_start(struct mqtt_sub *sub, uint16_t message_id);
+
+/**
+ * @brief Check whether a SUBACK is still expected.
+ *
+ * @param[in] sub Subscription.
+ *
+ * @returns true if a subscription waits for its SUBACK.
+ */
+bool mqtt_sub_pending(const struct mqtt_sub *sub);
+
+/**
+ * @brief Handle a SUBACK.
+ *
+ * @param[in,out] sub        Subscription.
+ * @param[in]     message_id Packet identifier of the SUBACK.
+ * @param[in]     result     0 if the subscription was granted, otherwise the SUBACK return code
+ *			     0x80 or a (negative) error code.
+ *
+ * @returns 0 if the subscription was granted.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -EACCES if the broker rejected the subscription, it is no longer pending.
+ * @retval -ENOENT if no subscription with that packet identifier is pending, the SUBACK is
+ *	   ignored.
+ */
+int mqtt_sub_ack(struct mqtt_sub *sub, uint16_t message_id, int result);
+
+/**
+ * @brief Stop waiting for the SUBACK, after a timeout or when the connection is closed.
+ *
+ * @param[in,out] sub Subscription.
+ *
+ * @returns true if a subscription was pending.
+ */
+bool mqtt_sub_cancel(struct mqtt_sub *sub);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUSTOM_MQTT_SUB_H_ */
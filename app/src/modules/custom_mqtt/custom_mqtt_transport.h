@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef CUSTOM_MQTT_TRANSPORT_H_
+#define CUSTOM_MQTT_TRANSPORT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Connection to the broker used by the custom MQTT module.
+ *
+ * One implementation is built, selected with the APP_CUSTOM_MQTT_TRANSPORT choice:
+ * MQTT 3.1.1 over TCP and TLS, or MQTT-SN over UDP or DTLS. The module state machine, record
+ * queue, batching and store are the same for both.
+ *
+ * All functions are called from the MQTT I/O thread. Events are delivered from
+ * mqtt_transport_input(), or from the function that caused them, in the same thread.
+ */
+
+/** @brief Transport event types. */
+enum mqtt_transport_evt_type {
+	/** Connection attempt finished, result is 0 on success. */
+	MQTT_TRANSPORT_EVT_CONNACK,
+	/** Connection closed. */
+	MQTT_TRANSPORT_EVT_DISCONNECT,
+	/** Publish acknowledged by the broker. */
+	MQTT_TRANSPORT_EVT_PUBACK,
+	/** Subscription acknowledged by the broker. */
+	MQTT_TRANSPORT_EVT_SUBACK,
+	/** Downlink message received on the subscribe topic. */
+	MQTT_TRANSPORT_EVT_PUBLISH,
+};
+
+/** @brief Transport event. */
+struct mqtt_transport_evt {
+	enum mqtt_transport_evt_type type;
+
+	/**
+	 * 0 on success, otherwise a protocol return code or a (negative) error code. For SUBACK,
+	 * the return code 0x80 if the broker rejected the subscription.
+	 */
+	int result;
+
+	/** CONNACK: the broker had a session for this client. */
+	bool session_present;
+
+	/** PUBACK and SUBACK: packet identifier. */
+	uint16_t message_id;
+
+	/** PUBLISH: payload, only valid during the callback. */
+	const uint8_t *data;
+
+	/** PUBLISH: payload length. */
+	size_t len;
+};
+
+/** @brief Connection statistics. */
+struct mqtt_transport_stats {
+	/**
+	 * Number of completed connection setups. Over TCP, a setup is the TCP connection, the
+	 * TLS handshake, full or resumed, and sending CONNECT. With MQTT-SN over DTLS, it is
+	 * the DTLS handshake.
+	 */
+	uint32_t setups;
+
+	/** Duration of the last connection setup in milliseconds. */
+	uint32_t setup_ms;
+
+	/** Longest connection setup in milliseconds. */
+	uint32_t setup_max_ms;
+
+	/** Sum of all connection setup durations in milliseconds. */
+	uint64_t setup_total_ms;
+};
+
+/** @brief Event handler. */
+typedef void (*mqtt_transport_evt_cb_t)(const struct mqtt_transport_evt *evt);
+
+/** @brief Called when an event is pending and mqtt_transport_input() must be called. */
+typedef void (*mqtt_transport_wake_cb_t)(void);
+
+/**
+ * @brief Initialize the transport.
+ *
+ * @param[in] evt_cb  Event handler.
+ * @param[in] wake_cb Wake-up handler, called from other threads.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ */
+int mqtt_transport_init(mqtt_transport_evt_cb_t evt_cb, mqtt_transport_wake_cb_t wake_cb);
+
+/**
+ * @brief Set the keepalive requested at the next connection.
+ *
+ * @param[in] keepalive Keepalive interval in seconds.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -ENOTSUP if the keepalive is fixed at build time.
+ */
+int mqtt_transport_keepalive_set(uint16_t keepalive);
+
+/**
+ * @brief Get the number of brokers that can be connected to, the primary included.
+ *
+ * @returns Number of brokers, at least 1.
+ */
+size_t mqtt_transport_broker_count(void);
+
+/**
+ * @brief Select the broker used by the next connection. The primary has index 0.
+ *
+ * @param[in] index Broker.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -EINVAL if there is no broker with this index.
+ */
+int mqtt_transport_broker_set(size_t index);
+
+/**
+ * @brief Get the hostname of a broker.
+ *
+ * @param[in] index Broker.
+ *
+ * @returns Hostname, or NULL if there is no broker with this index.
+ */
+const char *mqtt_transport_broker_name(size_t index);
+
+/**
+ * @brief Measure the round trip time to a broker without an MQTT connection.
+ *
+ * Blocks for the DNS lookup and then at most MQTT_BROKER_PROBE_TIMEOUT_SEC, so it is called from
+ * a thread other than the I/O thread. The current connection is not affected.
+ *
+ * @param[in]  index  Broker.
+ * @param[out] rtt_ms Round trip time in milliseconds.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ * @retval -EINVAL if there is no broker with this index.
+ * @retval -ETIMEDOUT if the broker did not answer in time.
+ * @retval -ENOTSUP if the transport cannot probe a broker.
+ */
+int mqtt_transport_probe(size_t index, uint32_t *rtt_ms);
+
+/**
+ * @brief Start connecting to the broker. The outcome is reported with MQTT_TRANSPORT_EVT_CONNACK.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ */
+int mqtt_transport_connect(void);
+
+/**
+ * @brief Disconnect gracefully. MQTT_TRANSPORT_EVT_DISCONNECT follows.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ */
+int mqtt_transport_disconnect(void);
+
+/**
+ * @brief Close the connection without notifying the broker.
+ */
+void mqtt_transport_abort(void);
+
+/**
+ * @brief Publish a QoS 1 message on the publish topic.
+ *
+ * @param[in] message_id Packet identifier, never 0.
+ * @param[in] dup        The message may have been sent before.
+ * @param[in] data       Payload.
+ * @param[in] len        Payload length.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ */
+int mqtt_transport_publish(uint16_t message_id, bool dup, const uint8_t *data, size_t len);
+
+/**
+ * @brief Subscribe to the subscribe topic with QoS 1.
+ *
+ * @param[in] message_id Packet identifier, never 0.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ */
+int mqtt_transport_subscribe(uint16_t message_id);
+
+/**
+ * @brief Process received data and maintain the connection.
+ *
+ * @returns 0 on success.
+ *	    Otherwise, a (negative) error code is returned.
+ */
+int mqtt_transport_input(void);
+
+/**
+ * @brief Get the socket to poll for received data.
+ *
+ * @returns Socket file descriptor, or -1 if there is no open socket.
+ */
+int mqtt_transport_socket(void);
+
+/**
+ * @brief Get the time until mqtt_transport_input() must be called even without received data.
+ *
+ * @returns Time in milliseconds, or -1 if there is no limit.
+ */
+int mqtt_transport_timeout(void);
+
+/**
+ * @brief Check if the transport reports MQTT_TRANSPORT_EVT_PUBACK for every publish.
+ *
+ * @returns true if publishes have to be tracked until their PUBACK, false if the transport
+ *	    retransmits them on its own.
+ */
+bool mqtt_transport_reports_acks(void);
+
+/**
+ * @brief Get connection statistics. May be called from any thread.
+ *
+ * @param[out] stats Statistics since boot.
+ */
+void mqtt_transport_stats_get(struct mqtt_transport_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CUSTOM_MQTT_TRANSPORT_H_ */
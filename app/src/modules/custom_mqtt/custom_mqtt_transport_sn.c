@@ -0,0 +1,585 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/mqtt_sn.h>
+#include <zephyr/net/socket.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <errno.h>
+#include <string.h>
+
+#include "custom_mqtt_config.h"
+#include "custom_mqtt_transport.h"
+
+LOG_MODULE_DECLARE(custom_mqtt, CONFIG_APP_CUSTOM_MQTT_LOG_LEVEL);
+
+#define MQTT_SN_GATEWAY_HOSTNAME CONFIG_APP_CUSTOM_MQTT_SN_GATEWAY_HOSTNAME
+#define MQTT_SN_GATEWAY_PORT CONFIG_APP_CUSTOM_MQTT_SN_GATEWAY_PORT
+#define MQTT_SN_GATEWAY_ID 1
+#define MQTT_PUB_TOPIC CONFIG_APP_CUSTOM_MQTT_PUBLISH_TOPIC
+#define MQTT_SUB_TOPIC CONFIG_APP_CUSTOM_MQTT_SUBSCRIBE_TOPIC
+
+/* A datagram carries one MQTT-SN message, the payload plus at most 7 bytes of header */
+#define MQTT_SN_BUF_SIZE (CONFIG_APP_CUSTOM_MQTT_PAYLOAD_BUFFER_MAX_SIZE + 16)
+#define MQTT_DOWNLINK_BUF_SIZE CONFIG_APP_CUSTOM_MQTT_PAYLOAD_BUFFER_MAX_SIZE
+
+/* Connection events raised by the library's retransmission work, see sn_evt_handler() */
+#define MQTT_SN_DEFERRED_EVT_COUNT 4
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_SN_DTLS)
+/* MQTT-SN over a connected DTLS socket. The library only sees a datagram transport. */
+struct mqtt_sn_transport_dtls {
+	struct mqtt_sn_transport tp;
+	int sock;
+};
+#endif
+
+/* MQTT-SN over UDP or DTLS */
+static struct {
+	struct mqtt_sn_client client;
+#if defined(CONFIG_APP_CUSTOM_MQTT_SN_DTLS)
+	struct mqtt_sn_transport_dtls transport;
+#else
+	struct mqtt_sn_transport_udp transport;
+#endif
+	struct sockaddr_storage gw_addr;
+	socklen_t gw_addr_len;
+	bool initialized;
+	uint8_t tx_buffer[MQTT_SN_BUF_SIZE];
+	uint8_t rx_buffer[MQTT_SN_BUF_SIZE];
+	uint8_t downlink_buf[MQTT_DOWNLINK_BUF_SIZE];
+	/* Thread that calls the transport API, events from other threads are deferred */
+	k_tid_t owner;
+	mqtt_transport_evt_cb_t evt_cb;
+	mqtt_transport_wake_cb_t wake_cb;
+} sn;
+
+K_MSGQ_DEFINE(sn_evt_msgq, sizeof(struct mqtt_transport_evt), MQTT_SN_DEFERRED_EVT_COUNT, 4);
+
+static uint8_t client_id[] = MQTT_CLIENT_ID;
+
+/* Connection setup statistics, read by the shell */
+static struct mqtt_transport_stats stats;
+static struct k_spinlock stats_lock;
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_SN_DTLS)
+static void setup_record(int64_t start)
+{
+	uint32_t duration = (uint32_t)(k_uptime_get() - start);
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	stats.setups++;
+	stats.setup_ms = duration;
+	stats.setup_max_ms = MAX(stats.setup_max_ms, duration);
+	stats.setup_total_ms += duration;
+
+	k_spin_unlock(&stats_lock, key);
+
+	LOG_INF("Connection setup (DTLS handshake) took %u ms", duration);
+}
+
+static sec_tag_t sec_tag_list[] = { CONFIG_APP_CUSTOM_MQTT_SEC_TAG };
+
+static int dtls_init(struct mqtt_sn_transport *transport)
+{
+	struct mqtt_sn_transport_dtls *dtls = CONTAINER_OF(transport,
+							   struct mqtt_sn_transport_dtls, tp);
+	int verify = TLS_PEER_VERIFY_NONE;
+	int cache = IS_ENABLED(CONFIG_APP_CUSTOM_MQTT_TLS_SESSION_CACHE) ?
+		    TLS_SESSION_CACHE_ENABLED : TLS_SESSION_CACHE_DISABLED;
+	int64_t start;
+	int ret;
+
+	dtls->sock = socket(sn.gw_addr.ss_family, SOCK_DGRAM, IPPROTO_DTLS_1_2);
+	if (dtls->sock < 0) {
+		LOG_ERR("Failed to create DTLS socket: %d", -errno);
+		return -errno;
+	}
+
+	ret = setsockopt(dtls->sock, SOL_TLS, TLS_SEC_TAG_LIST, sec_tag_list,
+			 sizeof(sec_tag_list));
+	if (ret) {
+		goto error;
+	}
+
+	ret = setsockopt(dtls->sock, SOL_TLS, TLS_HOSTNAME, MQTT_SN_GATEWAY_HOSTNAME,
+			 strlen(MQTT_SN_GATEWAY_HOSTNAME));
+	if (ret) {
+		goto error;
+	}
+
+	ret = setsockopt(dtls->sock, SOL_TLS, TLS_PEER_VERIFY, &verify, sizeof(verify));
+	if (ret) {
+		goto error;
+	}
+
+	/* Resume the previous session when the gateway still knows it */
+	ret = setsockopt(dtls->sock, SOL_TLS, TLS_SESSION_CACHE, &cache, sizeof(cache));
+	if (ret) {
+		goto error;
+	}
+
+	/* Performs the DTLS handshake */
+	start = k_uptime_get();
+
+	ret = connect(dtls->sock, (struct sockaddr *)&sn.gw_addr, sn.gw_addr_len);
+	if (ret) {
+		goto error;
+	}
+
+	setup_record(start);
+
+	return 0;
+
+error:
+	ret = -errno;
+	LOG_ERR("Failed to set up DTLS socket: %d", ret);
+	close(dtls->sock);
+	dtls->sock = -1;
+
+	return ret;
+}
+
+static void dtls_deinit(struct mqtt_sn_transport *transport)
+{
+	struct mqtt_sn_transport_dtls *dtls = CONTAINER_OF(transport,
+							   struct mqtt_sn_transport_dtls, tp);
+
+	if (dtls->sock >= 0) {
+		close(dtls->sock);
+		dtls->sock = -1;
+	}
+}
+
+static int dtls_sendto(struct mqtt_sn_client *client, void *buf, size_t sz,
+		       const void *dest_addr, size_t addrlen)
+{
+	struct mqtt_sn_transport_dtls *dtls = CONTAINER_OF(client->transport,
+							   struct mqtt_sn_transport_dtls, tp);
+	ssize_t ret;
+
+	/* The socket is connected to the only gateway */
+	ARG_UNUSED(dest_addr);
+	ARG_UNUSED(addrlen);
+
+	ret = send(dtls->sock, buf, sz, 0);
+	if (ret < 0) {
+		return -errno;
+	}
+
+	return 0;
+}
+
+static ssize_t dtls_recvfrom(struct mqtt_sn_client *client, void *rx_buf, size_t rx_len,
+			     void *src_addr, size_t *addrlen)
+{
+	struct mqtt_sn_transport_dtls *dtls = CONTAINER_OF(client->transport,
+							   struct mqtt_sn_transport_dtls, tp);
+	ssize_t ret;
+
+	ret = recv(dtls->sock, rx_buf, rx_len, ZSOCK_MSG_DONTWAIT);
+	if (ret < 0) {
+		return -errno;
+	}
+
+	if (src_addr && addrlen) {
+		*addrlen = MIN(*addrlen, sn.gw_addr_len);
+		memcpy(src_addr, &sn.gw_addr, *addrlen);
+	}
+
+	return ret;
+}
+
+static int dtls_poll(struct mqtt_sn_client *client)
+{
+	struct mqtt_sn_transport_dtls *dtls = CONTAINER_OF(client->transport,
+							   struct mqtt_sn_transport_dtls, tp);
+	struct pollfd fds = {
+		.fd = dtls->sock,
+		.events = POLLIN,
+	};
+	int ret;
+
+	ret = poll(&fds, 1, 0);
+	if (ret < 0) {
+		return -errno;
+	}
+
+	return (fds.revents & POLLIN) ? 1 : 0;
+}
+#endif /* CONFIG_APP_CUSTOM_MQTT_SN_DTLS */
+
+static void evt_deliver(const struct mqtt_transport_evt *evt)
+{
+	/* Events raised by calls from the owner thread are delivered right away */
+	if (k_current_get() == sn.owner) {
+		sn.evt_cb(evt);
+		return;
+	}
+
+	if (evt->type == MQTT_TRANSPORT_EVT_PUBLISH) {
+		LOG_WRN("Downlink message outside of input processing dropped");
+		return;
+	}
+
+	if (k_msgq_put(&sn_evt_msgq, evt, K_NO_WAIT)) {
+		LOG_WRN("Deferred event queue full, event %d dropped", evt->type);
+		return;
+	}
+
+	sn.wake_cb();
+}
+
+static void sn_evt_handler(struct mqtt_sn_client *client, const struct mqtt_sn_evt *evt)
+{
+	struct mqtt_transport_evt out = { 0 };
+
+	switch (evt->type) {
+	case MQTT_SN_EVT_CONNECTED:
+		out.type = MQTT_TRANSPORT_EVT_CONNACK;
+		break;
+
+	case MQTT_SN_EVT_DISCONNECTED:
+		out.type = MQTT_TRANSPORT_EVT_DISCONNECT;
+		break;
+
+	case MQTT_SN_EVT_PUBLISH: {
+		const struct mqtt_sn_data *data = &evt->param.publish.data;
+
+		out.type = MQTT_TRANSPORT_EVT_PUBLISH;
+		out.len = MIN(data->size, sizeof(sn.downlink_buf));
+
+		if (data->size > out.len) {
+			LOG_WRN("Downlink message too large: %zu bytes, truncated to %zu",
+				data->size, out.len);
+		}
+
+		memcpy(sn.downlink_buf, data->data, out.len);
+		out.data = sn.downlink_buf;
+		break;
+	}
+
+	case MQTT_SN_EVT_PINGRESP:
+		LOG_DBG("MQTT-SN ping response received");
+		return;
+
+	default:
+		LOG_DBG("Unhandled MQTT-SN event: %d", evt->type);
+		return;
+	}
+
+	evt_deliver(&out);
+}
+
+static int gateway_resolve(void)
+{
+	struct sockaddr_in *gw4 = (struct sockaddr_in *)&sn.gw_addr;
+	struct addrinfo hints = {
+		.ai_family = AF_INET,
+		.ai_socktype = SOCK_DGRAM,
+	};
+	struct addrinfo *result;
+	int ret;
+
+	gw4->sin_family = AF_INET;
+	gw4->sin_port = htons(MQTT_SN_GATEWAY_PORT);
+	sn.gw_addr_len = sizeof(struct sockaddr_in);
+
+	/* Gateways are often addressed by IP, no lookup needed then */
+	if (inet_pton(AF_INET, MQTT_SN_GATEWAY_HOSTNAME, &gw4->sin_addr) == 1) {
+		return 0;
+	}
+
+	LOG_INF("Starting DNS resolution for %s", MQTT_SN_GATEWAY_HOSTNAME);
+
+	ret = getaddrinfo(MQTT_SN_GATEWAY_HOSTNAME, NULL, &hints, &result);
+	if (ret != 0) {
+		LOG_ERR("Failed to resolve hostname %s: %d", MQTT_SN_GATEWAY_HOSTNAME, ret);
+		return -EHOSTUNREACH;
+	}
+
+	gw4->sin_addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr;
+	freeaddrinfo(result);
+
+	return 0;
+}
+
+/* Register the topics with their IDs agreed with the gateway, so that no REGISTER exchange
+ * is needed after connecting and every PUBLISH carries a 2 byte topic ID instead of the name.
+ */
+static int topics_predefine(void)
+{
+	struct mqtt_sn_data pub_topic = {
+		.data = MQTT_PUB_TOPIC,
+		.size = strlen(MQTT_PUB_TOPIC),
+	};
+	struct mqtt_sn_data sub_topic = {
+		.data = MQTT_SUB_TOPIC,
+		.size = strlen(MQTT_SUB_TOPIC),
+	};
+	int ret;
+
+	ret = mqtt_sn_predefine_topic(&sn.client, CONFIG_APP_CUSTOM_MQTT_SN_PUBLISH_TOPIC_ID,
+				      &pub_topic);
+	if (ret) {
+		return ret;
+	}
+
+	return mqtt_sn_predefine_topic(&sn.client, CONFIG_APP_CUSTOM_MQTT_SN_SUBSCRIBE_TOPIC_ID,
+				       &sub_topic);
+}
+
+static int client_setup(void)
+{
+	struct mqtt_sn_data id = {
+		.data = client_id,
+		.size = strlen(client_id),
+	};
+	struct mqtt_sn_data gw = {
+		.data = (const uint8_t *)&sn.gw_addr,
+		.size = sn.gw_addr_len,
+	};
+	int ret;
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_SN_DTLS)
+	sn.transport = (struct mqtt_sn_transport_dtls) {
+		.tp = {
+			.init = dtls_init,
+			.deinit = dtls_deinit,
+			.sendto = dtls_sendto,
+			.recvfrom = dtls_recvfrom,
+			.poll = dtls_poll,
+		},
+		.sock = -1,
+	};
+#else
+	ret = mqtt_sn_transport_udp_init(&sn.transport, (struct sockaddr *)&sn.gw_addr,
+					 sn.gw_addr_len);
+	if (ret) {
+		LOG_ERR("Failed to initialize UDP transport: %d", ret);
+		return ret;
+	}
+#endif
+
+	ret = mqtt_sn_client_init(&sn.client, &id, &sn.transport.tp, sn_evt_handler,
+				  sn.tx_buffer, sizeof(sn.tx_buffer),
+				  sn.rx_buffer, sizeof(sn.rx_buffer));
+	if (ret) {
+		LOG_ERR("Failed to initialize MQTT-SN client: %d", ret);
+		return ret;
+	}
+
+	sn.initialized = true;
+
+	ret = mqtt_sn_add_gw(&sn.client, MQTT_SN_GATEWAY_ID, gw);
+	if (ret) {
+		LOG_ERR("Failed to add gateway: %d", ret);
+		return ret;
+	}
+
+	ret = topics_predefine();
+	if (ret) {
+		LOG_ERR("Failed to predefine topics: %d", ret);
+		return ret;
+	}
+
+	return 0;
+}
+
+static void client_teardown(void)
+{
+	if (sn.initialized) {
+		mqtt_sn_client_deinit(&sn.client);
+		sn.initialized = false;
+	}
+
+	k_msgq_purge(&sn_evt_msgq);
+}
+
+int mqtt_transport_init(mqtt_transport_evt_cb_t evt_cb, mqtt_transport_wake_cb_t wake_cb)
+{
+	sn.evt_cb = evt_cb;
+	sn.wake_cb = wake_cb;
+
+	return 0;
+}
+
+int mqtt_transport_keepalive_set(uint16_t keepalive)
+{
+	/* The library sends CONFIG_MQTT_SN_KEEPALIVE in every CONNECT */
+	ARG_UNUSED(keepalive);
+
+	return -ENOTSUP;
+}
+
+size_t mqtt_transport_broker_count(void)
+{
+	/* A single gateway, it keeps the connections to the brokers itself */
+	return 1;
+}
+
+int mqtt_transport_broker_set(size_t index)
+{
+	return (index == 0) ? 0 : -EINVAL;
+}
+
+const char *mqtt_transport_broker_name(size_t index)
+{
+	return (index == 0) ? MQTT_SN_GATEWAY_HOSTNAME : NULL;
+}
+
+int mqtt_transport_probe(size_t index, uint32_t *rtt_ms)
+{
+	ARG_UNUSED(index);
+	ARG_UNUSED(rtt_ms);
+
+	return -ENOTSUP;
+}
+
+int mqtt_transport_connect(void)
+{
+	int ret;
+
+	sn.owner = k_current_get();
+
+	/* A previous connection may have been lost without a DISCONNECT */
+	client_teardown();
+
+	ret = gateway_resolve();
+	if (ret) {
+		return ret;
+	}
+
+	ret = client_setup();
+	if (ret) {
+		client_teardown();
+		return ret;
+	}
+
+	LOG_INF("Starting MQTT-SN connection to %s:%d", MQTT_SN_GATEWAY_HOSTNAME,
+		MQTT_SN_GATEWAY_PORT);
+
+	/* The library retransmits CONNECT until CONNACK arrives or the retries run out */
+	ret = mqtt_sn_connect(&sn.client, false,
+			      !IS_ENABLED(CONFIG_APP_CUSTOM_MQTT_PERSISTENT_SESSION));
+	if (ret) {
+		LOG_ERR("Failed to connect to MQTT-SN gateway: %d", ret);
+		client_teardown();
+		return ret;
+	}
+
+	return 0;
+}
+
+int mqtt_transport_disconnect(void)
+{
+	if (!sn.initialized) {
+		return -ENOTCONN;
+	}
+
+	LOG_INF("Disconnecting from MQTT-SN gateway");
+
+	return mqtt_sn_disconnect(&sn.client);
+}
+
+void mqtt_transport_abort(void)
+{
+	struct mqtt_transport_evt evt = {
+		.type = MQTT_TRANSPORT_EVT_DISCONNECT,
+	};
+	bool was_initialized = sn.initialized;
+
+	client_teardown();
+
+	/* Closing a datagram socket is silent, report it like the TCP transport does */
+	if (was_initialized) {
+		sn.evt_cb(&evt);
+	}
+}
+
+int mqtt_transport_publish(uint16_t message_id, bool dup, const uint8_t *data, size_t len)
+{
+	struct mqtt_sn_data topic = {
+		.data = MQTT_PUB_TOPIC,
+		.size = strlen(MQTT_PUB_TOPIC),
+	};
+	struct mqtt_sn_data payload = {
+		.data = data,
+		.size = len,
+	};
+
+	/* The library assigns its own message IDs and retransmits until PUBACK, nothing is
+	 * tracked by the module, so messages are never sent again with dup set.
+	 */
+	ARG_UNUSED(message_id);
+	ARG_UNUSED(dup);
+
+	return mqtt_sn_publish(&sn.client, MQTT_SN_QOS_1, &topic, false, &payload);
+}
+
+int mqtt_transport_subscribe(uint16_t message_id)
+{
+	struct mqtt_sn_data topic = {
+		.data = MQTT_SUB_TOPIC,
+		.size = strlen(MQTT_SUB_TOPIC),
+	};
+
+	ARG_UNUSED(message_id);
+
+	return mqtt_sn_subscribe(&sn.client, MQTT_SN_QOS_1, &topic);
+}
+
+int mqtt_transport_input(void)
+{
+	struct mqtt_transport_evt evt;
+	int ret = 0;
+
+	if (sn.initialized) {
+		ret = mqtt_sn_input(&sn.client);
+		if (ret < 0 && ret != -EAGAIN) {
+			LOG_ERR("MQTT-SN input error: %d", ret);
+		} else {
+			ret = 0;
+		}
+	}
+
+	while (k_msgq_get(&sn_evt_msgq, &evt, K_NO_WAIT) == 0) {
+		sn.evt_cb(&evt);
+	}
+
+	return ret;
+}
+
+int mqtt_transport_socket(void)
+{
+	if (!sn.initialized) {
+		return -1;
+	}
+
+	return sn.transport.sock;
+}
+
+int mqtt_transport_timeout(void)
+{
+	/* Keepalive and retransmissions run on the library's own delayed work */
+	return -1;
+}
+
+bool mqtt_transport_reports_acks(void)
+{
+	return false;
+}
+
+void mqtt_transport_stats_get(struct mqtt_transport_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	*out = stats;
+
+	k_spin_unlock(&stats_lock, key);
+}
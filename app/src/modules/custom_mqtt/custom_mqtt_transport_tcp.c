@@ -0,0 +1,768 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/mqtt.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/crc.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "custom_mqtt_config.h"
+#include "custom_mqtt_transport.h"
+#if defined(CONFIG_APP_CUSTOM_MQTT_DNS_CACHE)
+#include "custom_mqtt_dns.h"
+#endif
+#if defined(CONFIG_APP_CUSTOM_MQTT_FAILOVER)
+#include "custom_mqtt_broker.h"
+#endif
+
+LOG_MODULE_DECLARE(custom_mqtt, CONFIG_APP_CUSTOM_MQTT_LOG_LEVEL);
+
+/* MQTT client configuration */
+#define MQTT_BROKER_HOSTNAME CONFIG_APP_CUSTOM_MQTT_BROKER_HOSTNAME
+#define MQTT_BROKER_PORT CONFIG_APP_CUSTOM_MQTT_BROKER_PORT
+#define MQTT_USERNAME CONFIG_APP_CUSTOM_MQTT_USERNAME
+#define MQTT_PASSWORD CONFIG_APP_CUSTOM_MQTT_PASSWORD
+#define MQTT_PUB_TOPIC CONFIG_APP_CUSTOM_MQTT_PUBLISH_TOPIC
+#define MQTT_SUB_TOPIC CONFIG_APP_CUSTOM_MQTT_SUBSCRIBE_TOPIC
+#define MQTT_KEEPALIVE CONFIG_APP_CUSTOM_MQTT_KEEPALIVE_SECONDS
+
+/* Buffer sizes */
+#define MQTT_RX_BUF_SIZE 512
+#define MQTT_TX_BUF_SIZE 512
+#define MQTT_DOWNLINK_BUF_SIZE CONFIG_APP_CUSTOM_MQTT_PAYLOAD_BUFFER_MAX_SIZE
+
+/* MQTT 3.1.1 over TCP and TLS */
+static struct {
+	struct mqtt_client client;
+	struct sockaddr_storage broker_addr;
+	uint8_t rx_buffer[MQTT_RX_BUF_SIZE];
+	uint8_t tx_buffer[MQTT_TX_BUF_SIZE];
+	/* Payload of the last downlink message */
+	uint8_t downlink_buf[MQTT_DOWNLINK_BUF_SIZE];
+	struct mqtt_utf8 username;
+	struct mqtt_utf8 password;
+	mqtt_transport_evt_cb_t evt_cb;
+	/* Keepalive requested in the next CONNECT packet */
+	uint16_t keepalive;
+	/* Broker used by the next connection, index into brokers */
+	size_t broker;
+} tcp;
+
+/* Brokers in order of preference, the primary first */
+struct broker {
+	const char *hostname;
+	uint16_t port;
+};
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_FAILOVER)
+#define BROKER_MAX MQTT_BROKER_MAX
+
+/* Fallback brokers, split in place by brokers_parse() */
+static char fallback_brokers[] = CONFIG_APP_CUSTOM_MQTT_FAILOVER_BROKERS;
+#else
+#define BROKER_MAX 1
+#endif
+
+static struct broker brokers[BROKER_MAX] = {
+	{ .hostname = MQTT_BROKER_HOSTNAME, .port = MQTT_BROKER_PORT },
+};
+static size_t broker_count = 1;
+
+/* MQTT client buffers */
+static uint8_t client_id[] = MQTT_CLIENT_ID;
+
+/* Security tag for TLS */
+static sec_tag_t sec_tag_list[] = { CONFIG_APP_CUSTOM_MQTT_SEC_TAG };
+
+/* Connection setup statistics, read by the shell */
+static struct mqtt_transport_stats stats;
+static struct k_spinlock stats_lock;
+
+static void setup_record(int64_t start)
+{
+	uint32_t duration = (uint32_t)(k_uptime_get() - start);
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	stats.setups++;
+	stats.setup_ms = duration;
+	stats.setup_max_ms = MAX(stats.setup_max_ms, duration);
+	stats.setup_total_ms += duration;
+
+	k_spin_unlock(&stats_lock, key);
+
+	LOG_INF("Connection setup (TCP, TLS and CONNECT) took %u ms", duration);
+}
+
+static int broker_lookup(const char *hostname, uint32_t *addr)
+{
+	struct addrinfo hints = {
+		.ai_family = AF_INET,
+		.ai_socktype = SOCK_STREAM,
+	};
+	struct addrinfo *result;
+	char ip_str[INET_ADDRSTRLEN];
+	int ret;
+
+	LOG_INF("Starting DNS resolution for %s", hostname);
+
+	ret = getaddrinfo(hostname, NULL, &hints, &result);
+	if (ret != 0) {
+		LOG_ERR("Failed to resolve hostname %s: %d", hostname, ret);
+		return -EHOSTUNREACH;
+	}
+
+	*addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr.s_addr;
+	freeaddrinfo(result);
+
+	inet_ntop(AF_INET, addr, ip_str, sizeof(ip_str));
+	LOG_INF("DNS resolved %s to %s", hostname, ip_str);
+
+	return 0;
+}
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_DNS_CACHE)
+#define DNS_CACHE_TTL_MS (CONFIG_APP_CUSTOM_MQTT_DNS_CACHE_TTL_SECONDS * MSEC_PER_SEC)
+
+/* One entry per broker, only the address of the primary is stored in settings. The I/O thread
+ * and the broker probe use it, the lookup itself runs without the lock.
+ */
+static struct mqtt_dns_cache dns_cache[BROKER_MAX];
+static K_MUTEX_DEFINE(dns_lock);
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_DNS_CACHE_PERSIST)
+#define DNS_SETTINGS_SUBTREE "custom_mqtt"
+#define DNS_SETTINGS_NAME "broker_addr"
+
+/* Stored broker address, with a checksum of the hostname it was resolved from */
+struct dns_settings_record {
+	uint32_t addr;
+	uint32_t host_crc;
+};
+
+static uint32_t host_crc(void)
+{
+	return crc32_ieee(MQTT_BROKER_HOSTNAME, strlen(MQTT_BROKER_HOSTNAME));
+}
+
+static int dns_settings_set(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+	struct dns_settings_record record;
+	int ret;
+
+	if (strcmp(key, DNS_SETTINGS_NAME) != 0) {
+		return -ENOENT;
+	}
+
+	if (len != sizeof(record)) {
+		return -EINVAL;
+	}
+
+	ret = read_cb(cb_arg, &record, sizeof(record));
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (record.host_crc != host_crc()) {
+		LOG_DBG("Stored broker address belongs to another hostname, ignored");
+		return 0;
+	}
+
+	/* Used for the first connection after boot without a lookup. If connecting to it fails,
+	 * the next attempt resolves the hostname again.
+	 */
+	(void)mqtt_dns_cache_put(&dns_cache[0], record.addr, k_uptime_get(), DNS_CACHE_TTL_MS);
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(custom_mqtt, DNS_SETTINGS_SUBTREE, NULL, dns_settings_set,
+			       NULL, NULL);
+
+static void dns_cache_load(void)
+{
+	static bool loaded;
+	int ret;
+
+	if (loaded) {
+		return;
+	}
+
+	loaded = true;
+
+	ret = settings_subsys_init();
+	if (ret) {
+		LOG_WRN("Failed to initialize settings: %d", ret);
+		return;
+	}
+
+	ret = settings_load_subtree(DNS_SETTINGS_SUBTREE);
+	if (ret) {
+		LOG_WRN("Failed to load stored broker address: %d", ret);
+	}
+}
+
+static void dns_cache_save(uint32_t addr)
+{
+	struct dns_settings_record record = {
+		.addr = addr,
+		.host_crc = host_crc(),
+	};
+	int ret;
+
+	ret = settings_save_one(DNS_SETTINGS_SUBTREE "/" DNS_SETTINGS_NAME, &record,
+				sizeof(record));
+	if (ret) {
+		LOG_WRN("Failed to store broker address: %d", ret);
+	}
+}
+#endif /* CONFIG_APP_CUSTOM_MQTT_DNS_CACHE_PERSIST */
+
+/* Broker address from the cache while it is fresh, otherwise from a new lookup. If the lookup
+ * fails, the last address that was resolved is used.
+ */
+static int broker_resolve(size_t index, struct in_addr *addr)
+{
+	const char *hostname = brokers[index].hostname;
+	struct mqtt_dns_cache *cache = &dns_cache[index];
+	int64_t now = k_uptime_get();
+	uint32_t cached;
+	uint32_t resolved;
+	int cache_ret;
+	bool changed;
+	int ret;
+
+	k_mutex_lock(&dns_lock, K_FOREVER);
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_DNS_CACHE_PERSIST)
+	dns_cache_load();
+#endif
+
+	cache_ret = mqtt_dns_cache_get(cache, now, &cached);
+
+	k_mutex_unlock(&dns_lock);
+
+	if (cache_ret == 0) {
+		LOG_INF("Using cached address for %s", hostname);
+		addr->s_addr = cached;
+		return 0;
+	}
+
+	ret = broker_lookup(hostname, &resolved);
+	if (ret) {
+		if (cache_ret == -ESTALE) {
+			LOG_WRN("Using last known address for %s", hostname);
+			addr->s_addr = cached;
+			return 0;
+		}
+
+		return ret;
+	}
+
+	k_mutex_lock(&dns_lock, K_FOREVER);
+
+	changed = mqtt_dns_cache_put(cache, resolved, now, DNS_CACHE_TTL_MS);
+
+	k_mutex_unlock(&dns_lock);
+
+	if (changed && index == 0) {
+#if defined(CONFIG_APP_CUSTOM_MQTT_DNS_CACHE_PERSIST)
+		dns_cache_save(resolved);
+#endif
+	}
+
+	addr->s_addr = resolved;
+
+	return 0;
+}
+#else
+static int broker_resolve(size_t index, struct in_addr *addr)
+{
+	return broker_lookup(brokers[index].hostname, &addr->s_addr);
+}
+#endif /* CONFIG_APP_CUSTOM_MQTT_DNS_CACHE */
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_FAILOVER)
+/* Append the fallbacks, "hostname" or "hostname:port" separated by spaces or commas */
+static void brokers_parse(void)
+{
+	char *save;
+	char *entry = strtok_r(fallback_brokers, " ,", &save);
+
+	for (; entry != NULL; entry = strtok_r(NULL, " ,", &save)) {
+		char *port = strchr(entry, ':');
+		struct broker *broker;
+
+		if (broker_count == BROKER_MAX) {
+			LOG_WRN("Only %d brokers are supported, %s and later ones ignored",
+				BROKER_MAX, entry);
+			break;
+		}
+
+		broker = &brokers[broker_count];
+		broker->hostname = entry;
+		broker->port = MQTT_BROKER_PORT;
+
+		if (port != NULL) {
+			*port = '\0';
+			broker->port = (uint16_t)strtoul(port + 1, NULL, 10);
+		}
+
+		if (broker->port == 0) {
+			LOG_WRN("Invalid port for fallback broker %s, ignored", entry);
+			continue;
+		}
+
+		LOG_INF("Fallback broker %zu: %s:%d", broker_count, broker->hostname,
+			broker->port);
+		broker_count++;
+	}
+}
+#endif /* CONFIG_APP_CUSTOM_MQTT_FAILOVER */
+
+/* Read the payload of a received PUBLISH. The library requires the whole payload to be read
+ * before the next packet, the part that does not fit in the buffer is discarded.
+ */
+static int publish_payload_read(const struct mqtt_publish_param *pub, size_t *len)
+{
+	size_t remaining = pub->message.payload.len;
+	uint8_t discard[32];
+	int ret;
+
+	*len = MIN(remaining, sizeof(tcp.downlink_buf));
+
+	ret = mqtt_readall_publish_payload(&tcp.client, tcp.downlink_buf, *len);
+	if (ret) {
+		return ret;
+	}
+
+	remaining -= *len;
+
+	if (remaining > 0) {
+		LOG_WRN("Downlink message too large: %u bytes, truncated to %zu",
+			pub->message.payload.len, *len);
+	}
+
+	while (remaining > 0) {
+		size_t chunk = MIN(remaining, sizeof(discard));
+
+		ret = mqtt_readall_publish_payload(&tcp.client, discard, chunk);
+		if (ret) {
+			return ret;
+		}
+
+		remaining -= chunk;
+	}
+
+	return 0;
+}
+
+static void mqtt_evt_handler(struct mqtt_client *const client,
+			      const struct mqtt_evt *evt)
+{
+	struct mqtt_transport_evt out = {
+		.result = evt->result,
+	};
+	int ret;
+
+	switch (evt->type) {
+	case MQTT_EVT_CONNACK:
+		out.type = MQTT_TRANSPORT_EVT_CONNACK;
+		out.session_present = evt->param.connack.session_present_flag;
+		break;
+
+	case MQTT_EVT_DISCONNECT:
+		out.type = MQTT_TRANSPORT_EVT_DISCONNECT;
+		break;
+
+	case MQTT_EVT_PUBACK:
+		out.type = MQTT_TRANSPORT_EVT_PUBACK;
+		out.message_id = evt->param.puback.message_id;
+		break;
+
+	case MQTT_EVT_SUBACK: {
+		const struct mqtt_binstr *codes = &evt->param.suback.return_codes;
+
+		out.type = MQTT_TRANSPORT_EVT_SUBACK;
+		out.message_id = evt->param.suback.message_id;
+
+		/* One topic per SUBSCRIBE, the other return codes are the granted QoS */
+		if (out.result == 0 && codes->len > 0 && codes->data[0] == MQTT_SUBACK_FAILURE) {
+			out.result = MQTT_SUBACK_FAILURE;
+		}
+		break;
+	}
+
+	case MQTT_EVT_PUBLISH: {
+		const struct mqtt_publish_param *pub = &evt->param.publish;
+
+		ret = publish_payload_read(pub, &out.len);
+		if (ret) {
+			LOG_ERR("Failed to read downlink payload: %d", ret);
+			return;
+		}
+
+		/* The broker resends the message until it is acknowledged */
+		if (pub->message.topic.qos == MQTT_QOS_1_AT_LEAST_ONCE) {
+			struct mqtt_puback_param ack = {
+				.message_id = pub->message_id,
+			};
+
+			ret = mqtt_publish_qos1_ack(client, &ack);
+			if (ret) {
+				LOG_WRN("Failed to acknowledge downlink message: %d", ret);
+			}
+		}
+
+		out.type = MQTT_TRANSPORT_EVT_PUBLISH;
+		out.data = tcp.downlink_buf;
+		break;
+	}
+
+	case MQTT_EVT_UNSUBACK:
+		LOG_INF("MQTT unsubscription acknowledged");
+		return;
+
+	case MQTT_EVT_PINGRESP:
+		LOG_DBG("MQTT ping response received");
+		return;
+
+	default:
+		LOG_WRN("Unhandled MQTT event: %d", evt->type);
+		return;
+	}
+
+	tcp.evt_cb(&out);
+}
+
+int mqtt_transport_init(mqtt_transport_evt_cb_t evt_cb, mqtt_transport_wake_cb_t wake_cb)
+{
+	/* Events are only generated from calls made by the I/O thread */
+	ARG_UNUSED(wake_cb);
+
+	tcp.evt_cb = evt_cb;
+	tcp.keepalive = MQTT_KEEPALIVE;
+
+#if defined(CONFIG_APP_CUSTOM_MQTT_FAILOVER)
+	brokers_parse();
+#endif
+
+	return 0;
+}
+
+int mqtt_transport_keepalive_set(uint16_t keepalive)
+{
+	tcp.keepalive = keepalive;
+
+	return 0;
+}
+
+size_t mqtt_transport_broker_count(void)
+{
+	return broker_count;
+}
+
+int mqtt_transport_broker_set(size_t index)
+{
+	if (index >= broker_count) {
+		return -EINVAL;
+	}
+
+	tcp.broker = index;
+
+	return 0;
+}
+
+const char *mqtt_transport_broker_name(size_t index)
+{
+	return (index < broker_count) ? brokers[index].hostname : NULL;
+}
+
+int mqtt_transport_probe(size_t index, uint32_t *rtt_ms)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+	};
+	struct pollfd fds;
+	socklen_t len = sizeof(int);
+	int64_t start;
+	int err = 0;
+	int sock;
+	int ret;
+
+	if (index >= broker_count) {
+		return -EINVAL;
+	}
+
+	addr.sin_port = htons(brokers[index].port);
+
+	ret = broker_resolve(index, &addr.sin_addr);
+	if (ret) {
+		return ret;
+	}
+
+	sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (sock < 0) {
+		return -errno;
+	}
+
+	/* Non-blocking, so that the probe waits no longer than its timeout */
+	if (fcntl(sock, F_SETFL, O_NONBLOCK) < 0) {
+		ret = -errno;
+		goto out;
+	}
+
+	start = k_uptime_get();
+
+	/* The TCP handshake takes one round trip, no TLS session is set up */
+	if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		if (errno != EINPROGRESS) {
+			ret = -errno;
+			goto out;
+		}
+
+		fds.fd = sock;
+		fds.events = POLLOUT;
+
+		ret = poll(&fds, 1, MQTT_BROKER_PROBE_TIMEOUT_SEC * MSEC_PER_SEC);
+		if (ret == 0) {
+			ret = -ETIMEDOUT;
+			goto out;
+		} else if (ret < 0) {
+			ret = -errno;
+			goto out;
+		}
+
+		if (getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &len) < 0) {
+			ret = -errno;
+			goto out;
+		} else if (err) {
+			ret = -err;
+			goto out;
+		}
+	}
+
+	*rtt_ms = (uint32_t)(k_uptime_get() - start);
+	ret = 0;
+
+	LOG_DBG("Probe of %s took %u ms", brokers[index].hostname, *rtt_ms);
+
+out:
+	(void)close(sock);
+
+	return ret;
+}
+
+int mqtt_transport_connect(void)
+{
+	struct sockaddr_in *broker4 = (struct sockaddr_in *)&tcp.broker_addr;
+	const struct broker *broker = &brokers[tcp.broker];
+	
+	/* Configure broker address */
+	broker4->sin_family = AF_INET;
+	broker4->sin_port = htons(broker->port);
+	
+	/* Resolve hostname */
+	int ret = broker_resolve(tcp.broker, &broker4->sin_addr);
+	if (ret) {
+		return ret;
+	}
+
+	LOG_INF("Initializing MQTT client");
+	/* Initialize MQTT client */
+	mqtt_client_init(&tcp.client);
+
+	LOG_INF("Configuring MQTT client parameters");
+	/* Set up client configuration */
+	tcp.client.broker = &tcp.broker_addr;
+	tcp.client.evt_cb = mqtt_evt_handler;
+	tcp.client.client_id.utf8 = client_id;
+	tcp.client.client_id.size = strlen(client_id);
+	tcp.client.protocol_version = MQTT_VERSION_3_1_1;
+	tcp.client.rx_buf = tcp.rx_buffer;
+	tcp.client.rx_buf_size = sizeof(tcp.rx_buffer);
+	tcp.client.tx_buf = tcp.tx_buffer;
+	tcp.client.tx_buf_size = sizeof(tcp.tx_buffer);
+	tcp.client.keepalive = tcp.keepalive;
+
+	/* With a persistent session the broker keeps unacknowledged messages and subscriptions
+	 * across reconnects, in-flight publishes are sent again by the module.
+	 */
+	tcp.client.clean_session = IS_ENABLED(CONFIG_APP_CUSTOM_MQTT_PERSISTENT_SESSION) ? 0 : 1;
+
+	LOG_INF("Setting MQTT credentials");
+	/* Set username and password if provided */
+	if (strlen(MQTT_USERNAME) > 0) {
+		tcp.username.utf8 = MQTT_USERNAME;
+		tcp.username.size = strlen(MQTT_USERNAME);
+		tcp.client.user_name = &tcp.username;
+		
+		if (strlen(MQTT_PASSWORD) > 0) {
+			tcp.password.utf8 = MQTT_PASSWORD;
+			tcp.password.size = strlen(MQTT_PASSWORD);
+			tcp.client.password = &tcp.password;
+		} else {
+			tcp.client.password = NULL;
+		}
+		
+		LOG_INF("Using authentication with username: %s", MQTT_USERNAME);
+	} else {
+		tcp.client.user_name = NULL;
+		tcp.client.password = NULL;
+		LOG_INF("Using anonymous connection (no credentials)");
+	}
+
+	LOG_INF("Configuring TLS settings");
+	/* Configure TLS */
+	tcp.client.transport.type = MQTT_TRANSPORT_SECURE;
+	
+	struct mqtt_sec_config *tls_config = &tcp.client.transport.tls.config;
+	tls_config->peer_verify = TLS_PEER_VERIFY_NONE;  /* Disable peer verification for now */
+	tls_config->cipher_list = NULL;
+	
+	/* Use security tags if configured, otherwise use system CA certificates */
+	if (CONFIG_APP_CUSTOM_MQTT_SEC_TAG > 0) {
+		tls_config->sec_tag_count = ARRAY_SIZE(sec_tag_list);
+		tls_config->sec_tag_list = sec_tag_list;
+		LOG_INF("Using security tag: %d", CONFIG_APP_CUSTOM_MQTT_SEC_TAG);
+	} else {
+		tls_config->sec_tag_count = 0;
+		tls_config->sec_tag_list = NULL;
+		LOG_INF("Using system CA certificates");
+	}
+	
+	tls_config->hostname = broker->hostname;
+
+	/* Resume the previous session when the broker still knows it. The abbreviated handshake
+	 * skips the certificate exchange and the ECDHE key agreement.
+	 */
+	tls_config->session_cache = IS_ENABLED(CONFIG_APP_CUSTOM_MQTT_TLS_SESSION_CACHE) ?
+				    TLS_SESSION_CACHE_ENABLED : TLS_SESSION_CACHE_DISABLED;
+
+	LOG_INF("Starting MQTT connection to %s:%d", broker->hostname, broker->port);
+	LOG_INF("Client ID: %s, Username: %s", MQTT_CLIENT_ID, MQTT_USERNAME);
+	
+	/* Blocks for the TCP connection and the TLS handshake */
+	int64_t start = k_uptime_get();
+
+	ret = mqtt_connect(&tcp.client);
+	LOG_INF("mqtt_connect() returned: %d", ret);
+	if (ret) {
+		LOG_ERR("Failed to connect to MQTT broker: %d", ret);
+#if defined(CONFIG_APP_CUSTOM_MQTT_DNS_CACHE)
+		/* The broker may have moved, look it up again on the next attempt */
+		k_mutex_lock(&dns_lock, K_FOREVER);
+		mqtt_dns_cache_expire(&dns_cache[tcp.broker]);
+		k_mutex_unlock(&dns_lock);
+#endif
+		return ret;
+	}
+
+	setup_record(start);
+
+	LOG_INF("MQTT connection initiated successfully");
+	return 0;
+}
+
+int mqtt_transport_disconnect(void)
+{
+	LOG_INF("Disconnecting from MQTT broker");
+	return mqtt_disconnect(&tcp.client, NULL);
+}
+
+void mqtt_transport_abort(void)
+{
+	(void)mqtt_abort(&tcp.client);
+}
+
+int mqtt_transport_publish(uint16_t message_id, bool dup, const uint8_t *data, size_t len)
+{
+	struct mqtt_publish_param param = {
+		.message.topic.qos = MQTT_QOS_1_AT_LEAST_ONCE,
+		.message.topic.topic.utf8 = MQTT_PUB_TOPIC,
+		.message.topic.topic.size = strlen(MQTT_PUB_TOPIC),
+		.message.payload.data = (uint8_t *)data,
+		.message.payload.len = len,
+		.message_id = message_id,
+		.dup_flag = dup,
+		.retain_flag = 0,
+	};
+
+	return mqtt_publish(&tcp.client, &param);
+}
+
+int mqtt_transport_subscribe(uint16_t message_id)
+{
+	struct mqtt_topic subscribe_topic = {
+		.topic.utf8 = MQTT_SUB_TOPIC,
+		.topic.size = strlen(MQTT_SUB_TOPIC),
+		.qos = MQTT_QOS_1_AT_LEAST_ONCE,
+	};
+	const struct mqtt_subscription_list subscription_list = {
+		.list = &subscribe_topic,
+		.list_count = 1,
+		.message_id = message_id,
+	};
+
+	return mqtt_subscribe(&tcp.client, &subscription_list);
+}
+
+int mqtt_transport_input(void)
+{
+	/* Process received packets, the socket is non-blocking after the connection is up */
+	int ret = mqtt_input(&tcp.client);
+
+	if (ret < 0 && ret != -EAGAIN) {
+		LOG_ERR("MQTT input error: %d", ret);
+		return ret;
+	}
+
+	/* Send a ping if the keepalive time has passed */
+	ret = mqtt_live(&tcp.client);
+	if (ret < 0 && ret != -EAGAIN) {
+		LOG_ERR("MQTT live error: %d", ret);
+		return ret;
+	}
+
+	return 0;
+}
+
+int mqtt_transport_socket(void)
+{
+#if defined(CONFIG_MQTT_LIB_TLS)
+	if (tcp.client.transport.type == MQTT_TRANSPORT_SECURE) {
+		return tcp.client.transport.tls.sock;
+	}
+#endif
+
+	return tcp.client.transport.tcp.sock;
+}
+
+int mqtt_transport_timeout(void)
+{
+	return mqtt_keepalive_time_left(&tcp.client);
+}
+
+bool mqtt_transport_reports_acks(void)
+{
+	return true;
+}
+
+void mqtt_transport_stats_get(struct mqtt_transport_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	*out = stats;
+
+	k_spin_unlock(&stats_lock, key);
+}
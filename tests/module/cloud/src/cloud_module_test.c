@@ -139,6 +139,7 @@ void setUp(void)
 	RESET_FAKE(task_wdt_add);
 	RESET_FAKE(nrf_cloud_client_id_get);
 	RESET_FAKE(nrf_cloud_coap_json_message_send);
+	RESET_FAKE(nrf_cloud_coap_sensor_send);
 	RESET_FAKE(nrf_cloud_coap_connect);
 	RESET_FAKE(nrf_cloud_coap_location_send);
 	RESET_FAKE(date_time_now);
@@ -232,6 +233,40 @@ void test_sending_payload(void)
 	TEST_ASSERT_EQUAL(false, nrf_cloud_coap_json_message_send_fake.arg2_val);
 }
 
+void test_sensor_values_sent_as_bulk(void)
+{
+	int err;
+	const char *payload;
+	struct network_msg msg = {
+		.type = NETWORK_QUALITY_SAMPLE_RESPONSE,
+		.conn_eval_params = {
+			.energy_estimate = LTE_LC_ENERGY_CONSUMPTION_NORMAL,
+			.rsrp = -90,
+		},
+	};
+
+	err = zbus_chan_pub(&NETWORK_CHAN, &msg, K_SECONDS(1));
+	TEST_ASSERT_EQUAL(0, err);
+
+	/* Transport module needs CPU to run state machine */
+	k_sleep(K_MSEC(100));
+
+	/* Outside of a sampling cycle the values of a response are sent right away, in one
+	 * bulk request instead of one request per value.
+	 */
+	TEST_ASSERT_EQUAL(0, nrf_cloud_coap_sensor_send_fake.call_count);
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_json_message_send_fake.call_count);
+	TEST_ASSERT_EQUAL(true, nrf_cloud_coap_json_message_send_fake.arg1_val);
+
+	payload = nrf_cloud_coap_json_message_send_fake.arg0_val;
+
+	TEST_ASSERT_EQUAL('[', payload[0]);
+	TEST_ASSERT_NOT_NULL(strstr(payload, "{\"appId\":\"CONEVAL\",\"messageType\":\"DATA\","
+					     "\"data\":7}"));
+	TEST_ASSERT_NOT_NULL(strstr(payload, "{\"appId\":\"RSRP\",\"messageType\":\"DATA\","
+					     "\"data\":-90}"));
+}
+
 void test_connected_to_disconnected(void)
 {
 	int err;
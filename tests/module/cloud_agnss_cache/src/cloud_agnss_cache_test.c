@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+
+#include "cloud_agnss_cache.h"
+
+#define NOW		1700000000000LL
+#define HOUR_MS		(3600LL * 1000)
+
+#define ALL_SV		0xffffffffULL
+
+static struct {
+	struct agnss_cache_entry entry;
+	uint8_t data[16];
+} cache;
+
+static struct nrf_modem_gnss_agnss_data_frame request;
+
+void setUp(void)
+{
+	memset(&cache, 0, sizeof(cache));
+	memset(&request, 0, sizeof(request));
+
+	request.data_flags = NRF_MODEM_GNSS_AGNSS_GPS_UTC_REQUEST |
+			     NRF_MODEM_GNSS_AGNSS_KLOBUCHAR_REQUEST |
+			     NRF_MODEM_GNSS_AGNSS_GPS_SYS_TIME_AND_SV_TOW_REQUEST |
+			     NRF_MODEM_GNSS_AGNSS_POSITION_REQUEST;
+	request.system_count = 1;
+	request.system[0].system_id = NRF_MODEM_GNSS_SYSTEM_GPS;
+	request.system[0].sv_mask_ephe = ALL_SV;
+	request.system[0].sv_mask_alm = ALL_SV;
+}
+
+void tearDown(void)
+{
+}
+
+void test_request_is_split_into_kinds(void)
+{
+	struct nrf_modem_gnss_agnss_data_frame part;
+
+	agnss_cache_part(&request, AGNSS_CACHE_EPHEMERIDES, &part);
+	TEST_ASSERT_EQUAL(0, part.data_flags);
+	TEST_ASSERT_EQUAL(1, part.system_count);
+	TEST_ASSERT_EQUAL(NRF_MODEM_GNSS_SYSTEM_GPS, part.system[0].system_id);
+	TEST_ASSERT_TRUE(part.system[0].sv_mask_ephe == ALL_SV);
+	TEST_ASSERT_TRUE(part.system[0].sv_mask_alm == 0);
+
+	agnss_cache_part(&request, AGNSS_CACHE_ALMANACS, &part);
+	TEST_ASSERT_EQUAL(0, part.data_flags);
+	TEST_ASSERT_TRUE(part.system[0].sv_mask_ephe == 0);
+	TEST_ASSERT_TRUE(part.system[0].sv_mask_alm == ALL_SV);
+
+	agnss_cache_part(&request, AGNSS_CACHE_MODELS, &part);
+	TEST_ASSERT_EQUAL(NRF_MODEM_GNSS_AGNSS_GPS_UTC_REQUEST |
+			  NRF_MODEM_GNSS_AGNSS_KLOBUCHAR_REQUEST, part.data_flags);
+	TEST_ASSERT_EQUAL(0, part.system_count);
+
+	agnss_cache_part(&request, AGNSS_CACHE_LIVE, &part);
+	TEST_ASSERT_EQUAL(NRF_MODEM_GNSS_AGNSS_GPS_SYS_TIME_AND_SV_TOW_REQUEST |
+			  NRF_MODEM_GNSS_AGNSS_POSITION_REQUEST, part.data_flags);
+	TEST_ASSERT_EQUAL(0, part.system_count);
+}
+
+void test_empty_part(void)
+{
+	struct nrf_modem_gnss_agnss_data_frame part;
+
+	request.system[0].sv_mask_alm = 0;
+	request.data_flags = NRF_MODEM_GNSS_AGNSS_GPS_SYS_TIME_AND_SV_TOW_REQUEST;
+
+	agnss_cache_part(&request, AGNSS_CACHE_ALMANACS, &part);
+	TEST_ASSERT_TRUE(agnss_cache_part_empty(&part));
+
+	agnss_cache_part(&request, AGNSS_CACHE_MODELS, &part);
+	TEST_ASSERT_TRUE(agnss_cache_part_empty(&part));
+
+	agnss_cache_part(&request, AGNSS_CACHE_EPHEMERIDES, &part);
+	TEST_ASSERT_FALSE(agnss_cache_part_empty(&part));
+
+	agnss_cache_part(&request, AGNSS_CACHE_LIVE, &part);
+	TEST_ASSERT_FALSE(agnss_cache_part_empty(&part));
+}
+
+void test_entry_expires(void)
+{
+	struct nrf_modem_gnss_agnss_data_frame part;
+
+	agnss_cache_part(&request, AGNSS_CACHE_EPHEMERIDES, &part);
+
+	/* Never downloaded */
+	TEST_ASSERT_FALSE(agnss_cache_covers(&cache.entry, &part, NOW, 2 * HOUR_MS));
+
+	cache.entry.coverage = part;
+	cache.entry.fetched = NOW;
+
+	TEST_ASSERT_TRUE(agnss_cache_covers(&cache.entry, &part, NOW, 2 * HOUR_MS));
+	TEST_ASSERT_TRUE(agnss_cache_covers(&cache.entry, &part, NOW + 2 * HOUR_MS - 1,
+					    2 * HOUR_MS));
+	TEST_ASSERT_FALSE(agnss_cache_covers(&cache.entry, &part, NOW + 2 * HOUR_MS,
+					     2 * HOUR_MS));
+
+	/* The clock went backwards */
+	TEST_ASSERT_FALSE(agnss_cache_covers(&cache.entry, &part, NOW - 1, 2 * HOUR_MS));
+}
+
+void test_entry_covers_subset_of_satellites(void)
+{
+	struct nrf_modem_gnss_agnss_data_frame part;
+
+	agnss_cache_part(&request, AGNSS_CACHE_EPHEMERIDES, &part);
+
+	cache.entry.coverage = part;
+	cache.entry.coverage.system[0].sv_mask_ephe = 0x0000ffff;
+	cache.entry.fetched = NOW;
+
+	/* Satellites that are not in the entry are missing */
+	TEST_ASSERT_FALSE(agnss_cache_covers(&cache.entry, &part, NOW, HOUR_MS));
+
+	part.system[0].sv_mask_ephe = 0x00000f0f;
+	TEST_ASSERT_TRUE(agnss_cache_covers(&cache.entry, &part, NOW, HOUR_MS));
+}
+
+void test_entry_of_other_system_does_not_cover(void)
+{
+	struct nrf_modem_gnss_agnss_data_frame part;
+
+	agnss_cache_part(&request, AGNSS_CACHE_ALMANACS, &part);
+
+	cache.entry.coverage = part;
+	cache.entry.coverage.system[0].system_id = NRF_MODEM_GNSS_SYSTEM_QZSS;
+	cache.entry.fetched = NOW;
+
+	TEST_ASSERT_FALSE(agnss_cache_covers(&cache.entry, &part, NOW, HOUR_MS));
+}
+
+void test_model_flags_are_covered(void)
+{
+	struct nrf_modem_gnss_agnss_data_frame part;
+
+	agnss_cache_part(&request, AGNSS_CACHE_MODELS, &part);
+
+	cache.entry.coverage.data_flags = NRF_MODEM_GNSS_AGNSS_GPS_UTC_REQUEST;
+	cache.entry.fetched = NOW;
+
+	/* The Klobuchar model is missing */
+	TEST_ASSERT_FALSE(agnss_cache_covers(&cache.entry, &part, NOW, HOUR_MS));
+
+	cache.entry.coverage.data_flags = AGNSS_CACHE_MODEL_FLAGS;
+	TEST_ASSERT_TRUE(agnss_cache_covers(&cache.entry, &part, NOW, HOUR_MS));
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
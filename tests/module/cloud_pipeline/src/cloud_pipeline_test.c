@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+ /* Ensure 'strnlen' is available even with -std=c99. */
+#if !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <unity.h>
+#include <string.h>
+#include <zephyr/fff.h>
+#include <zephyr/task_wdt/task_wdt.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/net/coap_client.h>
+#include <zephyr/zbus/zbus.h>
+
+#include "environmental.h"
+#include "cloud.h"
+#include "power.h"
+#include "network.h"
+#include "location.h"
+#include "app_common.h"
+
+DEFINE_FFF_GLOBALS;
+
+ZBUS_CHAN_DEFINE(POWER_CHAN,
+		 struct power_msg,
+		 NULL,
+		 NULL,
+		 ZBUS_OBSERVERS_EMPTY,
+		 ZBUS_MSG_INIT(0)
+);
+ZBUS_CHAN_DEFINE(NETWORK_CHAN,
+		 struct network_msg,
+		 NULL,
+		 NULL,
+		 ZBUS_OBSERVERS_EMPTY,
+		 ZBUS_MSG_INIT(.type = NETWORK_DISCONNECTED)
+);
+ZBUS_CHAN_DEFINE(ENVIRONMENTAL_CHAN,
+		 struct environmental_msg,
+		 NULL,
+		 NULL,
+		 ZBUS_OBSERVERS_EMPTY,
+		 ZBUS_MSG_INIT(0)
+);
+ZBUS_CHAN_DEFINE(LOCATION_CHAN,
+		 struct location_msg,
+		 NULL,
+		 NULL,
+		 ZBUS_OBSERVERS_EMPTY,
+		 ZBUS_MSG_INIT(0)
+);
+
+/* Private channel of the cloud module */
+ZBUS_CHAN_DECLARE(PRIV_CLOUD_CHAN);
+
+/* CLOUD_REQUEST_DONE of enum priv_cloud_msg in cloud.c */
+#define PRIV_CLOUD_REQUEST_DONE	3
+
+FAKE_VALUE_FUNC(int, task_wdt_feed, int);
+FAKE_VALUE_FUNC(int, task_wdt_add, uint32_t, task_wdt_callback_t, void *);
+FAKE_VALUE_FUNC(int, nrf_cloud_client_id_get, char *, size_t);
+FAKE_VALUE_FUNC(int, nrf_cloud_coap_init);
+FAKE_VALUE_FUNC(int, nrf_cloud_coap_connect, const char * const);
+FAKE_VALUE_FUNC(int, nrf_cloud_coap_disconnect);
+FAKE_VALUE_FUNC(int, nrf_cloud_coap_shadow_device_status_update);
+FAKE_VALUE_FUNC(int, nrf_cloud_coap_bytes_send, uint8_t *, size_t, bool);
+FAKE_VALUE_FUNC(int, nrf_cloud_coap_sensor_send, const char *, double, int64_t, bool);
+FAKE_VALUE_FUNC(int, nrf_cloud_coap_json_message_send, const char *, bool, bool);
+FAKE_VALUE_FUNC(int, nrf_cloud_coap_shadow_get, char *, size_t *, bool, enum coap_content_format);
+FAKE_VALUE_FUNC(int, nrf_cloud_coap_patch, const char *, const char *,
+		const uint8_t *, size_t,
+		enum coap_content_format, bool,
+		coap_client_response_cb_t, void *);
+FAKE_VALUE_FUNC(int, nrf_cloud_coap_location_get,
+		struct nrf_cloud_rest_location_request const *,
+		struct nrf_cloud_location_result *const);
+FAKE_VALUE_FUNC(int, nrf_cloud_coap_agnss_data_get,
+		struct nrf_cloud_rest_agnss_request const *,
+		struct nrf_cloud_rest_agnss_result *);
+FAKE_VALUE_FUNC(int, nrf_cloud_coap_location_send, const struct nrf_cloud_gnss_data *, bool);
+FAKE_VALUE_FUNC(int, date_time_now, int64_t *);
+FAKE_VOID_FUNC(location_cloud_location_ext_result_set, enum location_ext_result,
+	       struct location_data *);
+FAKE_VALUE_FUNC(int, location_agnss_data_process, const char *, size_t);
+
+static void dummy_cb(const struct zbus_channel *chan);
+static void cloud_chan_cb(const struct zbus_channel *chan);
+static void priv_cloud_chan_cb(const struct zbus_channel *chan);
+
+ZBUS_SUBSCRIBER_DEFINE(app, 1);
+ZBUS_SUBSCRIBER_DEFINE(battery, 1);
+ZBUS_SUBSCRIBER_DEFINE(environmental, 1);
+ZBUS_SUBSCRIBER_DEFINE(fota, 1);
+ZBUS_SUBSCRIBER_DEFINE(led, 1);
+ZBUS_SUBSCRIBER_DEFINE(location, 1);
+ZBUS_LISTENER_DEFINE(trigger, dummy_cb);
+ZBUS_LISTENER_DEFINE(cloud_test_listener, cloud_chan_cb);
+ZBUS_LISTENER_DEFINE(priv_cloud_test_listener, priv_cloud_chan_cb);
+
+#define FAKE_DEVICE_ID		"test_device"
+
+static K_SEM_DEFINE(cloud_disconnected, 0, 1);
+static K_SEM_DEFINE(cloud_connected, 0, 1);
+static K_SEM_DEFINE(request_done, 0, 1);
+
+/* Set to hold the worker in nrf_cloud_coap_json_message_send() until released */
+static bool block_worker;
+static K_SEM_DEFINE(worker_blocked, 0, 1);
+static K_SEM_DEFINE(worker_release, 0, 1);
+
+/* Name of the thread that sent the last device message */
+static char sender_name[CONFIG_THREAD_MAX_NAME_LEN];
+
+static int nrf_cloud_client_id_get_custom_fake(char *buf, size_t len)
+{
+	TEST_ASSERT(len >= sizeof(FAKE_DEVICE_ID));
+	memcpy(buf, FAKE_DEVICE_ID, sizeof(FAKE_DEVICE_ID));
+
+	return 0;
+}
+
+static int nrf_cloud_coap_json_message_send_custom_fake(const char *message, bool bulk,
+							 bool confirmable)
+{
+	ARG_UNUSED(message);
+	ARG_UNUSED(bulk);
+	ARG_UNUSED(confirmable);
+
+	strncpy(sender_name, k_thread_name_get(k_current_get()), sizeof(sender_name) - 1);
+
+	if (block_worker) {
+		block_worker = false;
+
+		k_sem_give(&worker_blocked);
+		(void)k_sem_take(&worker_release, K_SECONDS(5));
+	}
+
+	return 0;
+}
+
+static void dummy_cb(const struct zbus_channel *chan)
+{
+	ARG_UNUSED(chan);
+}
+
+static void cloud_chan_cb(const struct zbus_channel *chan)
+{
+	if (chan == &CLOUD_CHAN) {
+		const struct cloud_msg *cloud_msg = zbus_chan_const_msg(chan);
+		enum cloud_msg_type status = cloud_msg->type;
+
+		if (status == CLOUD_DISCONNECTED) {
+			k_sem_give(&cloud_disconnected);
+		} else if (status == CLOUD_CONNECTED) {
+			k_sem_give(&cloud_connected);
+		}
+	}
+}
+
+static void priv_cloud_chan_cb(const struct zbus_channel *chan)
+{
+	const int msg = *(const int *)zbus_chan_const_msg(chan);
+
+	if (msg == PRIV_CLOUD_REQUEST_DONE) {
+		k_sem_give(&request_done);
+	}
+}
+
+static void payload_send(const char *payload)
+{
+	int err;
+	struct cloud_msg msg = {
+		.type = CLOUD_PAYLOAD_JSON,
+	};
+
+	strncpy(msg.payload.buffer, payload, sizeof(msg.payload.buffer) - 1);
+	msg.payload.buffer_data_len = strnlen(msg.payload.buffer, sizeof(msg.payload.buffer));
+
+	err = zbus_chan_pub(&CLOUD_CHAN, &msg, K_SECONDS(1));
+	TEST_ASSERT_EQUAL(0, err);
+
+	/* Cloud module needs CPU to run state machine */
+	k_sleep(K_MSEC(100));
+}
+
+static void network_send(enum network_msg_type type)
+{
+	int err;
+	struct network_msg msg = {
+		.type = type,
+	};
+
+	err = zbus_chan_pub(&NETWORK_CHAN, &msg, K_SECONDS(1));
+	TEST_ASSERT_EQUAL(0, err);
+}
+
+/* Send a device message and hold the worker in it */
+static void worker_block(void)
+{
+	block_worker = true;
+
+	payload_send("{\"blocking\": 1}");
+
+	TEST_ASSERT_EQUAL(0, k_sem_take(&worker_blocked, K_SECONDS(1)));
+}
+
+void setUp(void)
+{
+	const struct zbus_channel *chan;
+
+	RESET_FAKE(task_wdt_feed);
+	RESET_FAKE(task_wdt_add);
+	RESET_FAKE(nrf_cloud_client_id_get);
+	RESET_FAKE(nrf_cloud_coap_json_message_send);
+	RESET_FAKE(nrf_cloud_coap_connect);
+	RESET_FAKE(nrf_cloud_coap_disconnect);
+
+	nrf_cloud_client_id_get_fake.custom_fake = nrf_cloud_client_id_get_custom_fake;
+	nrf_cloud_coap_json_message_send_fake.custom_fake =
+		nrf_cloud_coap_json_message_send_custom_fake;
+
+	block_worker = false;
+	memset(sender_name, 0, sizeof(sender_name));
+	k_sem_reset(&request_done);
+	k_sem_reset(&worker_blocked);
+	k_sem_reset(&worker_release);
+
+	zbus_sub_wait(&location, &chan, K_NO_WAIT);
+	zbus_sub_wait(&app, &chan, K_NO_WAIT);
+	zbus_sub_wait(&fota, &chan, K_NO_WAIT);
+	zbus_sub_wait(&led, &chan, K_NO_WAIT);
+	zbus_sub_wait(&battery, &chan, K_NO_WAIT);
+
+	zbus_chan_add_obs(&CLOUD_CHAN, &cloud_test_listener, K_NO_WAIT);
+	zbus_chan_add_obs(&PRIV_CLOUD_CHAN, &priv_cloud_test_listener, K_NO_WAIT);
+}
+
+void test_initial_transition_to_disconnected(void)
+{
+	TEST_ASSERT_EQUAL(0, k_sem_take(&cloud_disconnected, K_SECONDS(1)));
+}
+
+void test_transition_disconnected_connected(void)
+{
+	network_send(NETWORK_CONNECTED);
+
+	TEST_ASSERT_EQUAL(0, k_sem_take(&cloud_connected, K_SECONDS(1)));
+}
+
+void test_request_sent_from_worker(void)
+{
+	payload_send("{\"test\": 1}");
+
+	/* The worker reports the completion to the cloud module thread */
+	TEST_ASSERT_EQUAL(0, k_sem_take(&request_done, K_SECONDS(1)));
+
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_json_message_send_fake.call_count);
+	TEST_ASSERT_EQUAL_STRING("cloud_request", sender_name);
+	TEST_ASSERT_EQUAL(0, nrf_cloud_coap_connect_fake.call_count);
+}
+
+void test_request_waits_in_queue_while_worker_busy(void)
+{
+	worker_block();
+
+	payload_send("{\"queued\": 1}");
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_json_message_send_fake.call_count);
+
+	k_sem_give(&worker_release);
+	k_sleep(K_MSEC(100));
+
+	TEST_ASSERT_EQUAL(2, nrf_cloud_coap_json_message_send_fake.call_count);
+	TEST_ASSERT_EQUAL(0, strcmp("{\"queued\": 1}",
+				    nrf_cloud_coap_json_message_send_fake.arg0_val));
+	TEST_ASSERT_EQUAL(0, nrf_cloud_coap_connect_fake.call_count);
+}
+
+void test_request_past_deadline_is_not_sent(void)
+{
+	worker_block();
+
+	payload_send("{\"late\": 1}");
+
+	/* Past the deadline of the queued request */
+	k_sleep(K_MSEC(1500));
+
+	k_sem_give(&worker_release);
+	k_sleep(K_MSEC(100));
+
+	/* Completed with -ETIME without being sent, which does not need a reconnect */
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_json_message_send_fake.call_count);
+	TEST_ASSERT_EQUAL(0, nrf_cloud_coap_connect_fake.call_count);
+}
+
+void test_request_without_free_slot_is_sent_when_workers_are_idle(void)
+{
+	worker_block();
+
+	/* Takes the second and last slot */
+	payload_send("{\"queued\": 1}");
+
+	/* Not sent from the cloud module thread while the worker is in the client */
+	payload_send("{\"inline\": 1}");
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_json_message_send_fake.call_count);
+
+	k_sem_give(&worker_release);
+	k_sleep(K_MSEC(100));
+
+	/* Sent after the queued request, from the cloud module thread instead of being dropped */
+	TEST_ASSERT_EQUAL(3, nrf_cloud_coap_json_message_send_fake.call_count);
+	TEST_ASSERT_EQUAL(0, strcmp("{\"queued\": 1}",
+				    nrf_cloud_coap_json_message_send_fake.arg0_history[1]));
+	TEST_ASSERT_EQUAL(0, strcmp("{\"inline\": 1}",
+				    nrf_cloud_coap_json_message_send_fake.arg0_val));
+	TEST_ASSERT_EQUAL_STRING("cloud_module_thread_id", sender_name);
+	TEST_ASSERT_EQUAL(0, nrf_cloud_coap_connect_fake.call_count);
+}
+
+void test_disconnect_cancels_queued_and_waits_for_running(void)
+{
+	worker_block();
+
+	payload_send("{\"canceled\": 1}");
+
+	network_send(NETWORK_DISCONNECTED);
+	k_sleep(K_MSEC(100));
+
+	/* The connection is not closed underneath the running request */
+	TEST_ASSERT_EQUAL(0, nrf_cloud_coap_disconnect_fake.call_count);
+
+	k_sem_give(&worker_release);
+
+	TEST_ASSERT_EQUAL(0, k_sem_take(&cloud_disconnected, K_SECONDS(1)));
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_disconnect_fake.call_count);
+
+	k_sleep(K_MSEC(100));
+
+	/* The queued request was completed without being sent */
+	TEST_ASSERT_EQUAL(1, nrf_cloud_coap_json_message_send_fake.call_count);
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+
+#include "custom_mqtt_batch.h"
+
+/* Limits are set in CMakeLists.txt */
+#define MAX_RECORDS	4
+#define TIMEOUT_MS	1000
+
+#define EXPECTED	(BIT(MQTT_RECORD_ENVIRONMENTAL) | BIT(MQTT_RECORD_POWER))
+
+static struct mqtt_batch batch;
+
+static void add(enum mqtt_record_type type, int64_t now)
+{
+	struct mqtt_record record = {
+		.type = type,
+		.timestamp = now,
+	};
+
+	TEST_ASSERT_EQUAL(0, mqtt_batch_add(&batch, &record, now));
+}
+
+void setUp(void)
+{
+	mqtt_batch_init(&batch, EXPECTED);
+}
+
+void tearDown(void)
+{
+}
+
+void test_empty_batch_is_never_due(void)
+{
+	TEST_ASSERT_FALSE(mqtt_batch_due(&batch, 0));
+	TEST_ASSERT_EQUAL(-1, mqtt_batch_time_left(&batch, 0));
+
+	mqtt_batch_cycle_start(&batch);
+
+	TEST_ASSERT_FALSE(mqtt_batch_due(&batch, 10 * TIMEOUT_MS));
+}
+
+void test_cycle_completes_when_all_responses_arrived(void)
+{
+	/* A location fix just before the cycle starts joins the batch */
+	add(MQTT_RECORD_LOCATION, 0);
+
+	mqtt_batch_cycle_start(&batch);
+
+	add(MQTT_RECORD_ENVIRONMENTAL, 10);
+	TEST_ASSERT_FALSE(mqtt_batch_due(&batch, 10));
+
+	add(MQTT_RECORD_POWER, 20);
+	TEST_ASSERT_TRUE(mqtt_batch_due(&batch, 20));
+	TEST_ASSERT_EQUAL(3, batch.count);
+	TEST_ASSERT_EQUAL(MQTT_RECORD_LOCATION, batch.records[0].type);
+
+	mqtt_batch_consume(&batch, batch.count);
+
+	TEST_ASSERT_EQUAL(0, batch.count);
+	TEST_ASSERT_FALSE(batch.cycle_open);
+}
+
+void test_records_outside_cycle_wait_for_timeout(void)
+{
+	add(MQTT_RECORD_UART_SENSOR, 100);
+	add(MQTT_RECORD_UART_SENSOR, 600);
+
+	TEST_ASSERT_FALSE(mqtt_batch_due(&batch, 600));
+	TEST_ASSERT_EQUAL(500, mqtt_batch_time_left(&batch, 600));
+
+	/* The timeout counts from the oldest record */
+	TEST_ASSERT_TRUE(mqtt_batch_due(&batch, 100 + TIMEOUT_MS));
+	TEST_ASSERT_EQUAL(0, mqtt_batch_time_left(&batch, 100 + TIMEOUT_MS));
+}
+
+void test_full_batch_is_due(void)
+{
+	struct mqtt_record record = {
+		.type = MQTT_RECORD_UART_SENSOR,
+	};
+
+	for (int i = 0; i < MAX_RECORDS; i++) {
+		add(MQTT_RECORD_UART_SENSOR, 0);
+	}
+
+	TEST_ASSERT_TRUE(mqtt_batch_due(&batch, 0));
+	TEST_ASSERT_EQUAL(-ENOMEM, mqtt_batch_add(&batch, &record, 0));
+}
+
+void test_partial_consume_keeps_order(void)
+{
+	add(MQTT_RECORD_LOCATION, 0);
+	add(MQTT_RECORD_ENVIRONMENTAL, 1);
+	add(MQTT_RECORD_POWER, 2);
+
+	mqtt_batch_consume(&batch, 2);
+
+	TEST_ASSERT_EQUAL(1, batch.count);
+	TEST_ASSERT_EQUAL(MQTT_RECORD_POWER, batch.records[0].type);
+}
+
+void test_new_cycle_flushes_unfinished_cycle(void)
+{
+	mqtt_batch_cycle_start(&batch);
+	add(MQTT_RECORD_ENVIRONMENTAL, 0);
+
+	/* The power response never arrived */
+	TEST_ASSERT_FALSE(mqtt_batch_due(&batch, 0));
+
+	mqtt_batch_cycle_start(&batch);
+	TEST_ASSERT_TRUE(mqtt_batch_due(&batch, 0));
+
+	mqtt_batch_consume(&batch, batch.count);
+
+	/* The new cycle is open once the old records are gone */
+	TEST_ASSERT_TRUE(batch.cycle_open);
+
+	add(MQTT_RECORD_POWER, 10);
+	TEST_ASSERT_FALSE(mqtt_batch_due(&batch, 10));
+
+	add(MQTT_RECORD_ENVIRONMENTAL, 20);
+	TEST_ASSERT_TRUE(mqtt_batch_due(&batch, 20));
+}
+
+void test_skipped_response_completes_cycle(void)
+{
+	mqtt_batch_cycle_start(&batch);
+
+	add(MQTT_RECORD_ENVIRONMENTAL, 0);
+	mqtt_batch_skip(&batch, MQTT_RECORD_POWER);
+
+	/* Published right away instead of after the timeout */
+	TEST_ASSERT_TRUE(mqtt_batch_due(&batch, 0));
+}
+
+void test_cycle_with_all_responses_skipped_is_closed(void)
+{
+	mqtt_batch_cycle_start(&batch);
+
+	mqtt_batch_skip(&batch, MQTT_RECORD_POWER);
+	TEST_ASSERT_TRUE(batch.cycle_open);
+
+	mqtt_batch_skip(&batch, MQTT_RECORD_ENVIRONMENTAL);
+	TEST_ASSERT_FALSE(batch.cycle_open);
+
+	/* Later records wait for the timeout as outside of a cycle */
+	add(MQTT_RECORD_LOCATION, 0);
+	TEST_ASSERT_FALSE(mqtt_batch_due(&batch, 0));
+}
+
+void test_no_expected_types_completes_on_first_record(void)
+{
+	mqtt_batch_init(&batch, 0);
+	mqtt_batch_cycle_start(&batch);
+
+	add(MQTT_RECORD_LOCATION, 0);
+
+	TEST_ASSERT_TRUE(mqtt_batch_due(&batch, 0));
+}
+
+void test_flush_makes_batch_due(void)
+{
+	/* Nothing to flush */
+	mqtt_batch_flush(&batch);
+	TEST_ASSERT_FALSE(mqtt_batch_due(&batch, 0));
+
+	add(MQTT_RECORD_LOCATION, 0);
+	TEST_ASSERT_FALSE(mqtt_batch_due(&batch, 0));
+
+	mqtt_batch_flush(&batch);
+	TEST_ASSERT_TRUE(mqtt_batch_due(&batch, 0));
+	TEST_ASSERT_EQUAL(0, mqtt_batch_time_left(&batch, 0));
+
+	mqtt_batch_consume(&batch, 1);
+
+	/* The next batch waits again */
+	add(MQTT_RECORD_LOCATION, 10);
+	TEST_ASSERT_FALSE(mqtt_batch_due(&batch, 10));
+}
+
+void test_flushed_cycle_stays_open(void)
+{
+	mqtt_batch_cycle_start(&batch);
+
+	add(MQTT_RECORD_ENVIRONMENTAL, 0);
+	mqtt_batch_flush(&batch);
+	TEST_ASSERT_TRUE(mqtt_batch_due(&batch, 0));
+	mqtt_batch_consume(&batch, 1);
+
+	/* The rest of the cycle completes the next batch */
+	add(MQTT_RECORD_POWER, 10);
+	TEST_ASSERT_TRUE(mqtt_batch_due(&batch, 10));
+	mqtt_batch_consume(&batch, 1);
+
+	TEST_ASSERT_FALSE(batch.cycle_open);
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
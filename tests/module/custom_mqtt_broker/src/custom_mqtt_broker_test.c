@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+
+#include "custom_mqtt_broker.h"
+
+#define HOLD_MS 60000
+
+static const struct mqtt_broker_config config = {
+	.connect_failures = 2,
+	.fail_rate = 300,
+	.hold_ms = HOLD_MS,
+	.probes = 3,
+};
+
+static struct mqtt_broker_list list;
+
+static void connect_fail(size_t count, int64_t now)
+{
+	for (size_t i = 0; i < count; i++) {
+		(void)mqtt_broker_connect_failed(&list, now);
+	}
+}
+
+void setUp(void)
+{
+	mqtt_broker_list_init(&list, 3, &config);
+}
+
+void tearDown(void)
+{
+}
+
+void test_count_is_clamped(void)
+{
+	mqtt_broker_list_init(&list, 0, &config);
+	TEST_ASSERT_EQUAL(1, list.count);
+
+	mqtt_broker_list_init(&list, MQTT_BROKER_MAX + 1, &config);
+	TEST_ASSERT_EQUAL(MQTT_BROKER_MAX, list.count);
+}
+
+void test_primary_is_preferred(void)
+{
+	TEST_ASSERT_EQUAL(0, mqtt_broker_select(&list, 0));
+	TEST_ASSERT_FALSE(mqtt_broker_connect_failed(&list, 0));
+	TEST_ASSERT_EQUAL(0, mqtt_broker_select(&list, 0));
+	TEST_ASSERT_EQUAL(0, list.switches);
+}
+
+void test_failover_after_connect_failures(void)
+{
+	TEST_ASSERT_EQUAL(0, mqtt_broker_select(&list, 0));
+	TEST_ASSERT_FALSE(mqtt_broker_connect_failed(&list, 0));
+	TEST_ASSERT_TRUE(mqtt_broker_connect_failed(&list, 1000));
+	TEST_ASSERT_TRUE(mqtt_broker_is_down(&list, 0, 1000));
+
+	TEST_ASSERT_EQUAL(1, mqtt_broker_select(&list, 1000));
+	TEST_ASSERT_EQUAL(1, list.switches);
+
+	/* The next fallback is used when the first one is down as well */
+	connect_fail(2, 2000);
+	TEST_ASSERT_EQUAL(2, mqtt_broker_select(&list, 2000));
+
+	/* The primary is used again once its hold time has passed */
+	TEST_ASSERT_EQUAL(0, mqtt_broker_select(&list, 1000 + HOLD_MS));
+}
+
+void test_fallback_with_lowest_score(void)
+{
+	mqtt_broker_list_init(&list, 4, &config);
+
+	list.active = 1;
+	mqtt_broker_connected(&list, 3000);
+	list.active = 2;
+	mqtt_broker_connected(&list, 800);
+	list.active = 3;
+	mqtt_broker_connected(&list, 1500);
+
+	list.active = 0;
+	connect_fail(2, 0);
+
+	TEST_ASSERT_EQUAL(2, mqtt_broker_select(&list, 0));
+}
+
+void test_all_brokers_down(void)
+{
+	connect_fail(2, 0);
+	TEST_ASSERT_EQUAL(1, mqtt_broker_select(&list, 0));
+	connect_fail(2, 100);
+	TEST_ASSERT_EQUAL(2, mqtt_broker_select(&list, 200));
+	TEST_ASSERT_FALSE(mqtt_broker_connect_failed(&list, 200));
+
+	/* No broker left to fail over to, the caller backs off */
+	TEST_ASSERT_FALSE(mqtt_broker_connect_failed(&list, 200));
+	TEST_ASSERT_TRUE(mqtt_broker_is_down(&list, 2, 200));
+
+	/* The primary went down first and is back first */
+	TEST_ASSERT_EQUAL(0, mqtt_broker_select(&list, 300));
+}
+
+void test_single_broker_never_fails_over(void)
+{
+	mqtt_broker_list_init(&list, 1, &config);
+
+	TEST_ASSERT_FALSE(mqtt_broker_connect_failed(&list, 0));
+	TEST_ASSERT_FALSE(mqtt_broker_connect_failed(&list, 0));
+	TEST_ASSERT_EQUAL(0, mqtt_broker_select(&list, 0));
+}
+
+void test_connect_time_smoothing(void)
+{
+	mqtt_broker_connected(&list, 1000);
+	TEST_ASSERT_EQUAL(1000, list.health[0].connect_ms);
+
+	mqtt_broker_connected(&list, 2000);
+	TEST_ASSERT_EQUAL(1250, list.health[0].connect_ms);
+
+	connect_fail(1, 0);
+	TEST_ASSERT_EQUAL(1250 + 10000, mqtt_broker_score(&list.health[0]));
+
+	/* A successful connection clears the failures */
+	mqtt_broker_connected(&list, 1250);
+	TEST_ASSERT_EQUAL(1250, mqtt_broker_score(&list.health[0]));
+}
+
+void test_failover_on_publish_failure_rate(void)
+{
+	TEST_ASSERT_FALSE(mqtt_broker_publish_result(&list, false, 0));
+	TEST_ASSERT_FALSE(mqtt_broker_publish_result(&list, false, 0));
+	TEST_ASSERT_TRUE(mqtt_broker_publish_result(&list, false, 0));
+	TEST_ASSERT_TRUE(mqtt_broker_is_down(&list, 0, 0));
+	TEST_ASSERT_EQUAL(0, list.health[0].fail_rate);
+}
+
+void test_publish_failures_decay(void)
+{
+	for (int i = 0; i < 20; i++) {
+		TEST_ASSERT_FALSE(mqtt_broker_publish_result(&list, false, 0));
+		TEST_ASSERT_FALSE(mqtt_broker_publish_result(&list, true, 0));
+		TEST_ASSERT_FALSE(mqtt_broker_publish_result(&list, true, 0));
+		TEST_ASSERT_FALSE(mqtt_broker_publish_result(&list, true, 0));
+	}
+
+	for (int i = 0; i < 50; i++) {
+		TEST_ASSERT_FALSE(mqtt_broker_publish_result(&list, true, 0));
+	}
+
+	TEST_ASSERT_EQUAL(0, list.health[0].fail_rate);
+}
+
+void test_return_to_primary_after_probes(void)
+{
+	connect_fail(2, 0);
+	TEST_ASSERT_EQUAL(1, mqtt_broker_select(&list, 0));
+	mqtt_broker_connected(&list, 500);
+
+	/* The primary is not probed during its hold time */
+	TEST_ASSERT_FALSE(mqtt_broker_probe_due(&list, HOLD_MS - 1));
+	TEST_ASSERT_TRUE(mqtt_broker_probe_due(&list, HOLD_MS));
+
+	TEST_ASSERT_FALSE(mqtt_broker_probe_result(&list, 0, 40, HOLD_MS));
+	TEST_ASSERT_FALSE(mqtt_broker_probe_result(&list, 0, 50, HOLD_MS));
+	TEST_ASSERT_TRUE(mqtt_broker_probe_result(&list, 0, 60, HOLD_MS));
+	TEST_ASSERT_EQUAL(60, list.health[0].probe_rtt_ms);
+	TEST_ASSERT_EQUAL(0, list.health[0].connect_failures);
+
+	TEST_ASSERT_EQUAL(0, mqtt_broker_select(&list, HOLD_MS));
+	TEST_ASSERT_FALSE(mqtt_broker_probe_due(&list, HOLD_MS));
+}
+
+void test_failed_probe_restarts_hold(void)
+{
+	connect_fail(2, 0);
+	TEST_ASSERT_EQUAL(1, mqtt_broker_select(&list, 0));
+
+	TEST_ASSERT_FALSE(mqtt_broker_probe_result(&list, 0, 40, HOLD_MS));
+	TEST_ASSERT_FALSE(mqtt_broker_probe_result(&list, -ETIMEDOUT, 0, HOLD_MS));
+	TEST_ASSERT_FALSE(mqtt_broker_probe_due(&list, HOLD_MS + 1));
+	TEST_ASSERT_TRUE(mqtt_broker_is_down(&list, 0, HOLD_MS + 1));
+
+	/* Probes in a row are counted again after the next hold time */
+	TEST_ASSERT_FALSE(mqtt_broker_probe_result(&list, 0, 40, 2 * HOLD_MS));
+	TEST_ASSERT_FALSE(mqtt_broker_probe_result(&list, 0, 40, 2 * HOLD_MS));
+	TEST_ASSERT_TRUE(mqtt_broker_probe_result(&list, 0, 40, 2 * HOLD_MS));
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
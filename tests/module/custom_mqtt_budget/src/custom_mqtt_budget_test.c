@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <zephyr/kernel.h>
+
+#include "custom_mqtt_budget.h"
+
+/* Days since 1970-01-01 */
+#define DAY_2024_02_29	19782
+#define DAY_2024_03_01	19783
+#define DAY_2025_12_31	20453
+
+static const struct mqtt_budget_config config = {
+	.rates = {
+		[MQTT_BUDGET_TELEMETRY] = { .rate = 600, .burst = 100 },
+		[MQTT_BUDGET_LOCATION] = { .rate = 60, .burst = 200 },
+		[MQTT_BUDGET_PROBE] = { .rate = 60, .burst = 60 },
+		[MQTT_BUDGET_DIAGNOSTICS] = { .rate = 0, .burst = 0 },
+	},
+	.daily_limit = 1000,
+	.monthly_limit = 5000,
+};
+
+static struct mqtt_budget budget;
+
+void setUp(void)
+{
+	mqtt_budget_init(&budget, &config, 0);
+}
+
+void tearDown(void)
+{
+}
+
+void test_month_of_day(void)
+{
+	TEST_ASSERT_EQUAL(0, mqtt_budget_month(0));
+	TEST_ASSERT_EQUAL(1, mqtt_budget_month(31));
+	TEST_ASSERT_EQUAL(54 * 12 + 1, mqtt_budget_month(DAY_2024_02_29));
+	TEST_ASSERT_EQUAL(54 * 12 + 2, mqtt_budget_month(DAY_2024_03_01));
+	TEST_ASSERT_EQUAL(55 * 12 + 11, mqtt_budget_month(DAY_2025_12_31));
+	TEST_ASSERT_EQUAL(56 * 12, mqtt_budget_month(DAY_2025_12_31 + 1));
+}
+
+void test_bucket_debt_is_refilled(void)
+{
+	TEST_ASSERT_TRUE(mqtt_budget_allow(&budget, MQTT_BUDGET_TELEMETRY, 0));
+
+	/* 50 bytes more than the burst, refilled at 10 bytes per second */
+	mqtt_budget_spend(&budget, MQTT_BUDGET_TELEMETRY, 150, 0);
+	TEST_ASSERT_FALSE(mqtt_budget_allow(&budget, MQTT_BUDGET_TELEMETRY, 0));
+	TEST_ASSERT_EQUAL(5001, mqtt_budget_wait(&budget, MQTT_BUDGET_TELEMETRY, 0));
+
+	TEST_ASSERT_FALSE(mqtt_budget_allow(&budget, MQTT_BUDGET_TELEMETRY, 5000));
+	TEST_ASSERT_TRUE(mqtt_budget_allow(&budget, MQTT_BUDGET_TELEMETRY, 5001));
+
+	/* Other classes have their own bucket */
+	TEST_ASSERT_TRUE(mqtt_budget_allow(&budget, MQTT_BUDGET_LOCATION, 0));
+}
+
+void test_bucket_is_capped_at_burst(void)
+{
+	mqtt_budget_spend(&budget, MQTT_BUDGET_PROBE, 60, 0);
+	TEST_ASSERT_FALSE(mqtt_budget_allow(&budget, MQTT_BUDGET_PROBE, 0));
+
+	/* A long idle time does not add more than the burst */
+	TEST_ASSERT_TRUE(mqtt_budget_allow(&budget, MQTT_BUDGET_PROBE, 3600 * 1000));
+	mqtt_budget_spend(&budget, MQTT_BUDGET_PROBE, 60, 3600 * 1000);
+	TEST_ASSERT_FALSE(mqtt_budget_allow(&budget, MQTT_BUDGET_PROBE, 3600 * 1000));
+}
+
+void test_class_without_rate_is_not_limited(void)
+{
+	mqtt_budget_spend(&budget, MQTT_BUDGET_DIAGNOSTICS, 500, 0);
+	TEST_ASSERT_TRUE(mqtt_budget_allow(&budget, MQTT_BUDGET_DIAGNOSTICS, 0));
+	TEST_ASSERT_EQUAL(500, budget.usage.class_bytes[MQTT_BUDGET_DIAGNOSTICS]);
+}
+
+void test_daily_limit_blocks_all_classes(void)
+{
+	TEST_ASSERT_TRUE(mqtt_budget_period(&budget, DAY_2024_02_29 - 1));
+
+	mqtt_budget_spend(&budget, MQTT_BUDGET_DIAGNOSTICS, 1000, 0);
+	TEST_ASSERT_EQUAL(-1, mqtt_budget_wait(&budget, MQTT_BUDGET_DIAGNOSTICS, 0));
+	TEST_ASSERT_FALSE(mqtt_budget_allow(&budget, MQTT_BUDGET_LOCATION, 0));
+
+	/* The same day again changes nothing */
+	TEST_ASSERT_FALSE(mqtt_budget_period(&budget, DAY_2024_02_29 - 1));
+
+	TEST_ASSERT_TRUE(mqtt_budget_period(&budget, DAY_2024_02_29));
+	TEST_ASSERT_EQUAL(0, budget.usage.daily_bytes);
+	TEST_ASSERT_EQUAL(1000, budget.usage.monthly_bytes);
+	TEST_ASSERT_TRUE(mqtt_budget_allow(&budget, MQTT_BUDGET_LOCATION, 0));
+}
+
+void test_monthly_limit_until_next_month(void)
+{
+	(void)mqtt_budget_period(&budget, DAY_2024_02_29 - 5);
+
+	for (int i = 0; i < 5; i++) {
+		(void)mqtt_budget_period(&budget, DAY_2024_02_29 - 5 + i);
+		mqtt_budget_spend(&budget, MQTT_BUDGET_DIAGNOSTICS, 1000, 0);
+	}
+
+	TEST_ASSERT_EQUAL(5000, budget.usage.monthly_bytes);
+
+	/* A new day does not help */
+	TEST_ASSERT_TRUE(mqtt_budget_period(&budget, DAY_2024_02_29));
+	TEST_ASSERT_FALSE(mqtt_budget_allow(&budget, MQTT_BUDGET_TELEMETRY, 0));
+
+	TEST_ASSERT_TRUE(mqtt_budget_period(&budget, DAY_2024_03_01));
+	TEST_ASSERT_EQUAL(0, budget.usage.monthly_bytes);
+	TEST_ASSERT_EQUAL(0, budget.usage.class_bytes[MQTT_BUDGET_DIAGNOSTICS]);
+	TEST_ASSERT_TRUE(mqtt_budget_allow(&budget, MQTT_BUDGET_TELEMETRY, 0));
+}
+
+void test_bytes_before_date_is_known_are_kept(void)
+{
+	mqtt_budget_spend(&budget, MQTT_BUDGET_LOCATION, 100, 0);
+
+	TEST_ASSERT_TRUE(mqtt_budget_period(&budget, DAY_2025_12_31));
+	TEST_ASSERT_EQUAL(100, budget.usage.daily_bytes);
+	TEST_ASSERT_EQUAL(100, budget.usage.monthly_bytes);
+	TEST_ASSERT_EQUAL(55 * 12 + 11, budget.usage.month);
+}
+
+void test_counts_saturate(void)
+{
+	budget.usage.daily_bytes = UINT32_MAX - 10;
+
+	mqtt_budget_spend(&budget, MQTT_BUDGET_DIAGNOSTICS, 100, 0);
+	TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, budget.usage.daily_bytes);
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
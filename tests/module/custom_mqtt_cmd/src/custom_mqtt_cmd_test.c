@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+
+#include "custom_mqtt_cmd.h"
+#include "custom_mqtt_json.h"
+
+/* Arguments of the last call to cmd_set */
+static struct mqtt_cmd_arg set_args[3];
+static int set_calls;
+static int set_result;
+
+static int cmd_set(const struct mqtt_cmd_arg *args)
+{
+	memcpy(set_args, args, sizeof(set_args));
+	set_calls++;
+
+	return set_result;
+}
+
+static int cmd_noop(const struct mqtt_cmd_arg *args)
+{
+	ARG_UNUSED(args);
+
+	return 0;
+}
+
+MQTT_CMD_DEFINE(set, cmd_set,
+	MQTT_CMD_ARG("interval", INT, true),
+	MQTT_CMD_ARG("enabled", BOOL, false),
+	MQTT_CMD_ARG("label", STR, false)
+);
+MQTT_CMD_DEFINE(noop, cmd_noop);
+
+static int dispatch(const char *payload, struct mqtt_record_ack *ack)
+{
+	return mqtt_cmd_dispatch(payload, strlen(payload), ack);
+}
+
+void setUp(void)
+{
+	memset(set_args, 0, sizeof(set_args));
+	set_calls = 0;
+	set_result = 0;
+}
+
+void tearDown(void)
+{
+}
+
+void test_tokenize_nested_document(void)
+{
+	const char *json = " {\"a\": [1, true, \"x\"], \"b\": {\"c\": null}} ";
+	struct mqtt_json_tok toks[16];
+	int count = mqtt_json_tokenize(json, strlen(json), toks, ARRAY_SIZE(toks));
+
+	/* object, "a", array, 1, true, "x", "b", object, "c", null */
+	TEST_ASSERT_EQUAL(10, count);
+	TEST_ASSERT_EQUAL(MQTT_JSON_TOK_OBJECT, toks[0].type);
+	TEST_ASSERT_EQUAL(2, toks[0].size);
+	TEST_ASSERT_EQUAL(MQTT_JSON_TOK_ARRAY, toks[2].type);
+	TEST_ASSERT_EQUAL(3, toks[2].size);
+	TEST_ASSERT_TRUE(mqtt_json_tok_eq(json, &toks[5], "x"));
+
+	/* Members are found after skipping over the array */
+	TEST_ASSERT_EQUAL(6, mqtt_json_tok_skip(toks, count, 2));
+	TEST_ASSERT_EQUAL(7, mqtt_json_obj_get(json, toks, count, 0, "b"));
+	TEST_ASSERT_EQUAL(-ENOENT, mqtt_json_obj_get(json, toks, count, 0, "c"));
+}
+
+void test_tokenize_rejects_invalid_documents(void)
+{
+	static const char *const invalid[] = {
+		"", "{", "{\"a\"}", "{\"a\":}", "{\"a\":1,}", "[1 2]", "{a:1}", "\"\\q\"",
+		"01", "1.", "-", "tru", "{} {}", "\"line\nbreak\"",
+	};
+	struct mqtt_json_tok toks[8];
+
+	for (size_t i = 0; i < ARRAY_SIZE(invalid); i++) {
+		int ret = mqtt_json_tokenize(invalid[i], strlen(invalid[i]), toks,
+					     ARRAY_SIZE(toks));
+
+		TEST_ASSERT_EQUAL_MESSAGE(-EINVAL, ret, invalid[i]);
+	}
+}
+
+void test_tokenize_limits(void)
+{
+	const char *deep = "[[[[[[[[[]]]]]]]]]";
+	const char *many = "[1,2,3,4]";
+	struct mqtt_json_tok toks[16];
+
+	TEST_ASSERT_EQUAL(-EINVAL, mqtt_json_tokenize(deep, strlen(deep), toks, ARRAY_SIZE(toks)));
+	TEST_ASSERT_EQUAL(-ENOMEM, mqtt_json_tokenize(many, strlen(many), toks, 4));
+	TEST_ASSERT_EQUAL(5, mqtt_json_tokenize(many, strlen(many), toks, 5));
+}
+
+void test_token_values(void)
+{
+	const char *json = "[2147483647,-2147483648,2147483648,1.5,false]";
+	struct mqtt_json_tok toks[8];
+	int32_t value;
+	bool flag = true;
+
+	TEST_ASSERT_EQUAL(6, mqtt_json_tokenize(json, strlen(json), toks, ARRAY_SIZE(toks)));
+
+	TEST_ASSERT_EQUAL(0, mqtt_json_tok_int(json, &toks[1], &value));
+	TEST_ASSERT_EQUAL(INT32_MAX, value);
+	TEST_ASSERT_EQUAL(0, mqtt_json_tok_int(json, &toks[2], &value));
+	TEST_ASSERT_EQUAL(INT32_MIN, value);
+	TEST_ASSERT_EQUAL(-ERANGE, mqtt_json_tok_int(json, &toks[3], &value));
+	TEST_ASSERT_EQUAL(-EINVAL, mqtt_json_tok_int(json, &toks[4], &value));
+	TEST_ASSERT_EQUAL(0, mqtt_json_tok_bool(json, &toks[5], &flag));
+	TEST_ASSERT_FALSE(flag);
+	TEST_ASSERT_EQUAL(-EINVAL, mqtt_json_tok_bool(json, &toks[1], &flag));
+}
+
+void test_dispatch_passes_arguments_in_schema_order(void)
+{
+	struct mqtt_record_ack ack;
+	const char *payload =
+		"{\"label\":\"lab\",\"interval\":60,\"command\":\"set\",\"id\":\"42\"}";
+
+	TEST_ASSERT_EQUAL(0, dispatch(payload, &ack));
+	TEST_ASSERT_EQUAL(1, set_calls);
+	TEST_ASSERT_EQUAL_STRING("set", ack.command);
+	TEST_ASSERT_EQUAL_STRING("42", ack.id);
+	TEST_ASSERT_EQUAL(0, ack.result);
+
+	TEST_ASSERT_TRUE(set_args[0].present);
+	TEST_ASSERT_EQUAL(60, set_args[0].i);
+	TEST_ASSERT_FALSE(set_args[1].present);
+	TEST_ASSERT_TRUE(set_args[2].present);
+	TEST_ASSERT_EQUAL(3, set_args[2].str.len);
+
+	/* String arguments point into the message */
+	TEST_ASSERT_EQUAL_PTR(strstr(payload, ":\"lab\"") + 2, set_args[2].str.ptr);
+}
+
+void test_dispatch_reports_handler_result(void)
+{
+	struct mqtt_record_ack ack;
+
+	set_result = -EALREADY;
+
+	TEST_ASSERT_EQUAL(-EALREADY,
+			  dispatch("{\"command\":\"set\",\"interval\":1,\"id\":7}", &ack));
+	TEST_ASSERT_EQUAL(-EALREADY, ack.result);
+	TEST_ASSERT_EQUAL_STRING("7", ack.id);
+}
+
+void test_dispatch_command_without_arguments(void)
+{
+	struct mqtt_record_ack ack;
+
+	TEST_ASSERT_EQUAL(0, dispatch("{\"command\":\"noop\",\"extra\":[1,2]}", &ack));
+	TEST_ASSERT_EQUAL_STRING("noop", ack.command);
+	TEST_ASSERT_EQUAL_STRING("", ack.id);
+}
+
+void test_dispatch_rejects_schema_violations(void)
+{
+	struct mqtt_record_ack ack;
+
+	/* Missing required argument */
+	TEST_ASSERT_EQUAL(-EINVAL, dispatch("{\"command\":\"set\"}", &ack));
+	/* Wrong types */
+	TEST_ASSERT_EQUAL(-EINVAL, dispatch("{\"command\":\"set\",\"interval\":\"60\"}", &ack));
+	TEST_ASSERT_EQUAL(-EINVAL, dispatch("{\"command\":\"set\",\"interval\":1,\"enabled\":1}",
+					    &ack));
+	TEST_ASSERT_EQUAL(-EINVAL, dispatch("{\"command\":\"set\",\"interval\":1.5}", &ack));
+	/* ID too long for the acknowledgment */
+	TEST_ASSERT_EQUAL(-EINVAL,
+			  dispatch("{\"command\":\"noop\",\"id\":\"0123456789abcdef01234567\"}",
+				   &ack));
+
+	TEST_ASSERT_EQUAL(0, set_calls);
+}
+
+void test_dispatch_rejects_unknown_and_malformed_messages(void)
+{
+	struct mqtt_record_ack ack;
+
+	TEST_ASSERT_EQUAL(-ENOENT, dispatch("{\"command\":\"reboot\",\"id\":\"1\"}", &ack));
+	TEST_ASSERT_EQUAL_STRING("reboot", ack.command);
+	TEST_ASSERT_EQUAL_STRING("1", ack.id);
+
+	TEST_ASSERT_EQUAL(-ENOENT, dispatch("{\"command\":\"a_very_long_command_name\"}", &ack));
+	TEST_ASSERT_EQUAL(-EBADMSG, dispatch("{\"command\":1}", &ack));
+	TEST_ASSERT_EQUAL(-EBADMSG, dispatch("[\"set\"]", &ack));
+	TEST_ASSERT_EQUAL(-EBADMSG, dispatch("hello", &ack));
+	TEST_ASSERT_EQUAL_STRING("", ack.command);
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+
+#include "custom_mqtt_deadband.h"
+#include "custom_mqtt_budget.h"
+
+#define MAX_SILENCE_MS	60000
+
+static struct mqtt_deadband deadband;
+
+static bool environmental(double temperature, double humidity, double pressure, int64_t now)
+{
+	struct mqtt_record record = {
+		.type = MQTT_RECORD_ENVIRONMENTAL,
+		.timestamp = now,
+		.environmental = {
+			.temperature = temperature,
+			.humidity = humidity,
+			.pressure = pressure,
+		},
+	};
+
+	return mqtt_deadband_filter(&deadband, &record);
+}
+
+static bool power(double percentage, double voltage, double current_ma, int64_t now)
+{
+	struct mqtt_record record = {
+		.type = MQTT_RECORD_POWER,
+		.timestamp = now,
+		.power = {
+			.percentage = percentage,
+			.voltage = voltage,
+			.current_ma = current_ma,
+		},
+	};
+
+	return mqtt_deadband_filter(&deadband, &record);
+}
+
+static void band_set(enum mqtt_deadband_field field, double abs, double rel)
+{
+	struct mqtt_deadband_band band = {
+		.abs = abs,
+		.rel = rel,
+	};
+
+	TEST_ASSERT_EQUAL(0, mqtt_deadband_band_set(&deadband, field, &band));
+}
+
+void setUp(void)
+{
+	mqtt_deadband_init(&deadband, MAX_SILENCE_MS);
+
+	band_set(MQTT_DEADBAND_TEMPERATURE, 0.2, 0);
+	band_set(MQTT_DEADBAND_HUMIDITY, 1.0, 0);
+	band_set(MQTT_DEADBAND_PRESSURE, 0.1, 0);
+	band_set(MQTT_DEADBAND_BATTERY, 1.0, 0);
+	band_set(MQTT_DEADBAND_VOLTAGE, 0, 0.01);
+}
+
+void tearDown(void)
+{
+}
+
+void test_first_record_is_sent(void)
+{
+	TEST_ASSERT_TRUE(environmental(21.0, 40.0, 101.3, 0));
+	TEST_ASSERT_TRUE(power(80.0, 3.9, 10.0, 0));
+	TEST_ASSERT_EQUAL(0, mqtt_deadband_suppressed(&deadband));
+}
+
+void test_small_changes_are_suppressed(void)
+{
+	TEST_ASSERT_TRUE(environmental(21.0, 40.0, 101.3, 0));
+
+	TEST_ASSERT_FALSE(environmental(21.01, 40.5, 101.35, 1000));
+	TEST_ASSERT_FALSE(environmental(21.2, 39.0, 101.2, 2000));
+	TEST_ASSERT_EQUAL(2, deadband.suppressed[MQTT_DEADBAND_CHANNEL_ENVIRONMENTAL]);
+
+	/* One field out of its band is enough */
+	TEST_ASSERT_TRUE(environmental(21.0, 40.0, 101.5, 3000));
+}
+
+void test_change_is_measured_from_last_sent_value(void)
+{
+	TEST_ASSERT_TRUE(environmental(21.0, 40.0, 101.3, 0));
+
+	/* A slow drift is sent once it adds up to more than the band */
+	TEST_ASSERT_FALSE(environmental(21.1, 40.0, 101.3, 1000));
+	TEST_ASSERT_FALSE(environmental(21.2, 40.0, 101.3, 2000));
+	TEST_ASSERT_TRUE(environmental(21.3, 40.0, 101.3, 3000));
+	TEST_ASSERT_FALSE(environmental(21.4, 40.0, 101.3, 4000));
+}
+
+void test_relative_band(void)
+{
+	/* 1 % of 4.0 V */
+	TEST_ASSERT_TRUE(power(80.0, 4.0, 10.0, 0));
+	TEST_ASSERT_FALSE(power(80.0, 3.97, 10.0, 1000));
+	TEST_ASSERT_TRUE(power(80.0, 3.95, 10.0, 2000));
+
+	/* The larger of both bands applies */
+	band_set(MQTT_DEADBAND_VOLTAGE, 0.1, 0.01);
+	TEST_ASSERT_FALSE(power(80.0, 3.9, 10.0, 3000));
+}
+
+void test_fields_without_band_do_not_trigger(void)
+{
+	TEST_ASSERT_TRUE(power(80.0, 3.9, 10.0, 0));
+	TEST_ASSERT_FALSE(power(80.0, 3.9, 250.0, 1000));
+	TEST_ASSERT_EQUAL(1, deadband.suppressed[MQTT_DEADBAND_CHANNEL_POWER]);
+}
+
+void test_max_silence_forces_record(void)
+{
+	TEST_ASSERT_TRUE(environmental(21.0, 40.0, 101.3, 0));
+	TEST_ASSERT_FALSE(environmental(21.0, 40.0, 101.3, MAX_SILENCE_MS - 1));
+	TEST_ASSERT_TRUE(environmental(21.0, 40.0, 101.3, MAX_SILENCE_MS));
+
+	/* Counted per record type */
+	TEST_ASSERT_TRUE(power(80.0, 3.9, 10.0, MAX_SILENCE_MS));
+	TEST_ASSERT_FALSE(power(80.0, 3.9, 10.0, MAX_SILENCE_MS + 1));
+}
+
+void test_zero_band_sends_every_change(void)
+{
+	mqtt_deadband_init(&deadband, 0);
+
+	TEST_ASSERT_TRUE(environmental(21.0, 40.0, 101.3, 0));
+	TEST_ASSERT_FALSE(environmental(21.0, 40.0, 101.3, 10 * MAX_SILENCE_MS));
+	TEST_ASSERT_TRUE(environmental(21.01, 40.0, 101.3, 10 * MAX_SILENCE_MS));
+}
+
+void test_other_records_are_not_filtered(void)
+{
+	struct mqtt_record record = {
+		.type = MQTT_RECORD_LOCATION,
+	};
+
+	TEST_ASSERT_TRUE(mqtt_deadband_filter(&deadband, &record));
+	TEST_ASSERT_TRUE(mqtt_deadband_filter(&deadband, &record));
+	TEST_ASSERT_EQUAL(0, mqtt_deadband_suppressed(&deadband));
+}
+
+/* Take a record from the queue the way the I/O thread does: the dead-band first, then the
+ * budget, and only a record that goes out becomes the reference.
+ */
+static bool take(struct mqtt_budget *budget, const struct mqtt_record *record, int64_t now)
+{
+	if (!mqtt_deadband_check(&deadband, record) ||
+	    !mqtt_budget_allow(budget, MQTT_BUDGET_TELEMETRY, now)) {
+		return false;
+	}
+
+	mqtt_deadband_sent(&deadband, record);
+	mqtt_budget_spend(budget, MQTT_BUDGET_TELEMETRY, 150, now);
+
+	return true;
+}
+
+void test_record_held_back_by_budget_is_sent_later(void)
+{
+	static const struct mqtt_budget_config config = {
+		.rates = {
+			/* A record of 150 bytes leaves a debt that takes 30 s to refill */
+			[MQTT_BUDGET_TELEMETRY] = { .rate = 100, .burst = 100 },
+		},
+	};
+	struct mqtt_budget budget;
+	struct mqtt_record record = {
+		.type = MQTT_RECORD_ENVIRONMENTAL,
+		.environmental = {
+			.temperature = 21.0,
+			.humidity = 40.0,
+			.pressure = 101.3,
+		},
+	};
+
+	mqtt_budget_init(&budget, &config, 0);
+
+	TEST_ASSERT_TRUE(take(&budget, &record, 0));
+
+	/* Significant, but the budget holds it back */
+	record.timestamp = 1000;
+	record.environmental.temperature = 22.0;
+	TEST_ASSERT_FALSE(take(&budget, &record, 1000));
+
+	/* Released once the budget allows, it is still significant */
+	TEST_ASSERT_TRUE(take(&budget, &record, 60000));
+	TEST_ASSERT_EQUAL(0, mqtt_deadband_suppressed(&deadband));
+
+	/* And only now it is the reference for the next record */
+	record.timestamp = 2000;
+	TEST_ASSERT_FALSE(take(&budget, &record, 60000));
+	TEST_ASSERT_EQUAL(1, mqtt_deadband_suppressed(&deadband));
+}
+
+void test_check_does_not_change_reference(void)
+{
+	struct mqtt_record record = {
+		.type = MQTT_RECORD_POWER,
+		.power = {
+			.percentage = 80.0,
+			.voltage = 3.9,
+		},
+	};
+
+	TEST_ASSERT_TRUE(mqtt_deadband_check(&deadband, &record));
+	TEST_ASSERT_TRUE(mqtt_deadband_check(&deadband, &record));
+
+	mqtt_deadband_sent(&deadband, &record);
+	TEST_ASSERT_FALSE(mqtt_deadband_check(&deadband, &record));
+}
+
+void test_band_validation_and_field_names(void)
+{
+	struct mqtt_deadband_band band = {
+		.abs = -1.0,
+	};
+
+	TEST_ASSERT_EQUAL(-EINVAL,
+			  mqtt_deadband_band_set(&deadband, MQTT_DEADBAND_HUMIDITY, &band));
+	TEST_ASSERT_EQUAL(-EINVAL,
+			  mqtt_deadband_band_set(&deadband, MQTT_DEADBAND_FIELD_COUNT, &band));
+
+	TEST_ASSERT_EQUAL(MQTT_DEADBAND_PRESSURE, mqtt_deadband_field_get("pressure", 8));
+	TEST_ASSERT_EQUAL(MQTT_DEADBAND_VOLTAGE, mqtt_deadband_field_get("voltage,", 7));
+	TEST_ASSERT_EQUAL(-ENOENT, mqtt_deadband_field_get("press", 5));
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+
+#include "custom_mqtt_dns.h"
+
+#define ADDR_A	0x0100007F
+#define ADDR_B	0x0200000A
+#define TTL_MS	60000
+
+static struct mqtt_dns_cache cache;
+
+void setUp(void)
+{
+	mqtt_dns_cache_init(&cache);
+}
+
+void tearDown(void)
+{
+}
+
+void test_empty_cache_has_no_address(void)
+{
+	uint32_t addr;
+
+	TEST_ASSERT_EQUAL(-ENOENT, mqtt_dns_cache_get(&cache, 0, &addr));
+}
+
+void test_address_is_fresh_until_ttl(void)
+{
+	uint32_t addr = 0;
+
+	TEST_ASSERT_TRUE(mqtt_dns_cache_put(&cache, ADDR_A, 1000, TTL_MS));
+
+	TEST_ASSERT_EQUAL(0, mqtt_dns_cache_get(&cache, 1000 + TTL_MS - 1, &addr));
+	TEST_ASSERT_EQUAL_HEX32(ADDR_A, addr);
+
+	/* Still returned after expiry, as last-known-good */
+	addr = 0;
+	TEST_ASSERT_EQUAL(-ESTALE, mqtt_dns_cache_get(&cache, 1000 + TTL_MS, &addr));
+	TEST_ASSERT_EQUAL_HEX32(ADDR_A, addr);
+}
+
+void test_put_reports_changed_address(void)
+{
+	TEST_ASSERT_TRUE(mqtt_dns_cache_put(&cache, ADDR_A, 0, TTL_MS));
+
+	/* A refresh with the same address does not need to be stored again */
+	TEST_ASSERT_FALSE(mqtt_dns_cache_put(&cache, ADDR_A, TTL_MS, TTL_MS));
+	TEST_ASSERT_TRUE(mqtt_dns_cache_put(&cache, ADDR_B, 2 * TTL_MS, TTL_MS));
+}
+
+void test_refresh_extends_lifetime(void)
+{
+	uint32_t addr;
+
+	mqtt_dns_cache_put(&cache, ADDR_A, 0, TTL_MS);
+	mqtt_dns_cache_put(&cache, ADDR_A, TTL_MS, TTL_MS);
+
+	TEST_ASSERT_EQUAL(0, mqtt_dns_cache_get(&cache, TTL_MS + 1, &addr));
+}
+
+void test_expire_keeps_fallback(void)
+{
+	uint32_t addr = 0;
+
+	mqtt_dns_cache_put(&cache, ADDR_B, 0, TTL_MS);
+	mqtt_dns_cache_expire(&cache);
+
+	TEST_ASSERT_EQUAL(-ESTALE, mqtt_dns_cache_get(&cache, 1, &addr));
+	TEST_ASSERT_EQUAL_HEX32(ADDR_B, addr);
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <zephyr/kernel.h>
+
+#include "custom_mqtt_energy.h"
+
+#define TAIL_MS		10000
+#define ACTIVE_MW	100
+
+static struct mqtt_energy energy;
+static struct mqtt_energy_cycle cycle;
+
+void setUp(void)
+{
+	const struct mqtt_energy_model model = {
+		.tail_ms = TAIL_MS,
+		.active_mw = ACTIVE_MW,
+	};
+
+	mqtt_energy_init(&energy, &model, 0);
+}
+
+void tearDown(void)
+{
+}
+
+void test_idle_cycle(void)
+{
+	mqtt_energy_cycle_end(&energy, 60000, &cycle);
+
+	TEST_ASSERT_EQUAL(60000, cycle.duration_ms);
+	TEST_ASSERT_EQUAL(0, cycle.wakeups);
+	TEST_ASSERT_EQUAL(0, cycle.active_ms);
+	TEST_ASSERT_EQUAL(0, cycle.energy_mj);
+}
+
+void test_activity_within_tail_is_one_wakeup(void)
+{
+	/* Connect, publish and PUBACK in one burst */
+	mqtt_energy_activity(&energy, 1000);
+	mqtt_energy_activity(&energy, 3000);
+	mqtt_energy_activity(&energy, 5000);
+
+	mqtt_energy_cycle_end(&energy, 60000, &cycle);
+
+	TEST_ASSERT_EQUAL(1, cycle.wakeups);
+	TEST_ASSERT_EQUAL(4000 + TAIL_MS, cycle.active_ms);
+	TEST_ASSERT_EQUAL((4000 + TAIL_MS) * ACTIVE_MW / 1000, cycle.energy_mj);
+}
+
+void test_activity_after_tail_wakes_up_again(void)
+{
+	/* Keepalive pings of an idle connection */
+	mqtt_energy_activity(&energy, 0);
+	mqtt_energy_activity(&energy, 20000);
+	mqtt_energy_activity(&energy, 40000);
+
+	mqtt_energy_cycle_end(&energy, 60000, &cycle);
+
+	TEST_ASSERT_EQUAL(3, cycle.wakeups);
+	TEST_ASSERT_EQUAL(3 * TAIL_MS, cycle.active_ms);
+}
+
+void test_open_connection_is_split_between_cycles(void)
+{
+	mqtt_energy_activity(&energy, 55000);
+
+	mqtt_energy_cycle_end(&energy, 60000, &cycle);
+
+	TEST_ASSERT_EQUAL(1, cycle.wakeups);
+	TEST_ASSERT_EQUAL(5000, cycle.active_ms);
+
+	/* Activity within the tail extends the same connection */
+	mqtt_energy_activity(&energy, 62000);
+
+	mqtt_energy_cycle_end(&energy, 120000, &cycle);
+
+	TEST_ASSERT_EQUAL(60000, cycle.duration_ms);
+	TEST_ASSERT_EQUAL(0, cycle.wakeups);
+	TEST_ASSERT_EQUAL(2000 + TAIL_MS, cycle.active_ms);
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
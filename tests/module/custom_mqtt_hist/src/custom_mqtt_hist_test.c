@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+
+#include "custom_mqtt_hist.h"
+
+#define WINDOW_MS 60000
+
+static struct mqtt_hist hist;
+static struct mqtt_hist_rate rate;
+
+void setUp(void)
+{
+	mqtt_hist_reset(&hist);
+	mqtt_hist_rate_init(&rate, WINDOW_MS, 0);
+}
+
+void tearDown(void)
+{
+}
+
+void test_empty_histogram(void)
+{
+	TEST_ASSERT_EQUAL(0, hist.count);
+	TEST_ASSERT_EQUAL(0, mqtt_hist_percentile(&hist, 50));
+	TEST_ASSERT_EQUAL(0, mqtt_hist_percentile(&hist, 100));
+}
+
+void test_bucket_bounds(void)
+{
+	TEST_ASSERT_EQUAL(0, mqtt_hist_bucket_max(0));
+	TEST_ASSERT_EQUAL(1, mqtt_hist_bucket_max(1));
+	TEST_ASSERT_EQUAL(1023, mqtt_hist_bucket_max(10));
+	TEST_ASSERT_EQUAL(UINT32_MAX, mqtt_hist_bucket_max(MQTT_HIST_BUCKETS - 1));
+
+	mqtt_hist_add(&hist, 0);
+	mqtt_hist_add(&hist, 1);
+	mqtt_hist_add(&hist, 512);
+	mqtt_hist_add(&hist, 1023);
+	mqtt_hist_add(&hist, 1024);
+	mqtt_hist_add(&hist, UINT32_MAX);
+
+	TEST_ASSERT_EQUAL(1, hist.buckets[0]);
+	TEST_ASSERT_EQUAL(1, hist.buckets[1]);
+	TEST_ASSERT_EQUAL(2, hist.buckets[10]);
+	TEST_ASSERT_EQUAL(1, hist.buckets[11]);
+	TEST_ASSERT_EQUAL(1, hist.buckets[MQTT_HIST_BUCKETS - 1]);
+}
+
+void test_min_max_sum(void)
+{
+	mqtt_hist_add(&hist, 300);
+	mqtt_hist_add(&hist, 20);
+	mqtt_hist_add(&hist, 4000);
+
+	TEST_ASSERT_EQUAL(3, hist.count);
+	TEST_ASSERT_EQUAL(20, hist.min);
+	TEST_ASSERT_EQUAL(4000, hist.max);
+	TEST_ASSERT_EQUAL(4320, hist.sum);
+}
+
+void test_percentiles(void)
+{
+	/* 90 fast acknowledgments and 10 slow ones */
+	for (int i = 0; i < 90; i++) {
+		mqtt_hist_add(&hist, 200);
+	}
+
+	for (int i = 0; i < 10; i++) {
+		mqtt_hist_add(&hist, 3000);
+	}
+
+	TEST_ASSERT_EQUAL(255, mqtt_hist_percentile(&hist, 50));
+	TEST_ASSERT_EQUAL(255, mqtt_hist_percentile(&hist, 90));
+
+	/* The bucket bound is limited to the largest value seen */
+	TEST_ASSERT_EQUAL(3000, mqtt_hist_percentile(&hist, 91));
+	TEST_ASSERT_EQUAL(3000, mqtt_hist_percentile(&hist, 100));
+}
+
+void test_rate_counts_per_window(void)
+{
+	mqtt_hist_rate_add(&rate, 0);
+	mqtt_hist_rate_add(&rate, 1000);
+	mqtt_hist_rate_add(&rate, WINDOW_MS - 1);
+
+	/* The window is only closed by the next event or an update */
+	TEST_ASSERT_EQUAL(0, rate.hist.count);
+
+	mqtt_hist_rate_add(&rate, WINDOW_MS);
+
+	TEST_ASSERT_EQUAL(1, rate.hist.count);
+	TEST_ASSERT_EQUAL(3, rate.hist.max);
+	TEST_ASSERT_EQUAL(1, rate.window_count);
+}
+
+void test_rate_empty_windows(void)
+{
+	mqtt_hist_rate_add(&rate, 0);
+
+	/* Four windows without events */
+	mqtt_hist_rate_update(&rate, 5 * WINDOW_MS + 10);
+
+	TEST_ASSERT_EQUAL(5, rate.hist.count);
+	TEST_ASSERT_EQUAL(4, rate.hist.buckets[0]);
+	TEST_ASSERT_EQUAL(0, rate.hist.min);
+	TEST_ASSERT_EQUAL(1, rate.hist.max);
+	TEST_ASSERT_EQUAL(5 * WINDOW_MS, rate.window_start);
+
+	/* Nothing changes within the same window */
+	mqtt_hist_rate_update(&rate, 6 * WINDOW_MS - 1);
+
+	TEST_ASSERT_EQUAL(5, rate.hist.count);
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+
+#include "custom_mqtt_inflight.h"
+
+/* Limits are set in CMakeLists.txt */
+#define WINDOW		3
+#define PAYLOAD_MAX	16
+
+static struct mqtt_inflight inflight;
+
+static uint16_t send(const char *payload, int64_t now)
+{
+	uint16_t id = mqtt_inflight_next_id(&inflight);
+
+	TEST_ASSERT_EQUAL(0, mqtt_inflight_add(&inflight, id, (const uint8_t *)payload,
+					       strlen(payload), now));
+
+	return id;
+}
+
+void setUp(void)
+{
+	mqtt_inflight_init(&inflight);
+}
+
+void tearDown(void)
+{
+}
+
+void test_ids_start_at_one(void)
+{
+	TEST_ASSERT_EQUAL(1, mqtt_inflight_next_id(&inflight));
+	TEST_ASSERT_EQUAL(2, mqtt_inflight_next_id(&inflight));
+}
+
+void test_ids_wrap_around_without_zero(void)
+{
+	inflight.last_id = UINT16_MAX - 1;
+
+	TEST_ASSERT_EQUAL(UINT16_MAX, mqtt_inflight_next_id(&inflight));
+	TEST_ASSERT_EQUAL(1, mqtt_inflight_next_id(&inflight));
+}
+
+void test_ids_in_flight_are_skipped(void)
+{
+	uint32_t latency;
+
+	TEST_ASSERT_EQUAL(1, send("a", 0));
+	TEST_ASSERT_EQUAL(2, send("b", 0));
+	TEST_ASSERT_EQUAL(0, mqtt_inflight_ack(&inflight, 1, 0, &latency));
+
+	/* After wrapping around, 1 is free again while 2 is still in flight */
+	inflight.last_id = UINT16_MAX;
+
+	TEST_ASSERT_EQUAL(1, mqtt_inflight_next_id(&inflight));
+	TEST_ASSERT_EQUAL(3, mqtt_inflight_next_id(&inflight));
+}
+
+void test_window_limits_outstanding_messages(void)
+{
+	for (int i = 0; i < WINDOW; i++) {
+		TEST_ASSERT_FALSE(mqtt_inflight_full(&inflight));
+		send("x", 0);
+	}
+
+	TEST_ASSERT_TRUE(mqtt_inflight_full(&inflight));
+	TEST_ASSERT_EQUAL(-ENOMEM, mqtt_inflight_add(&inflight, 100, (const uint8_t *)"x", 1, 0));
+}
+
+void test_ack_reports_latency_and_frees_slot(void)
+{
+	uint32_t latency = 0;
+	uint16_t id;
+
+	id = send("hello", 1000);
+	send("world", 1100);
+	send("again", 1200);
+
+	TEST_ASSERT_EQUAL(0, mqtt_inflight_ack(&inflight, id, 1250, &latency));
+	TEST_ASSERT_EQUAL(250, latency);
+	TEST_ASSERT_FALSE(mqtt_inflight_full(&inflight));
+
+	/* A duplicate PUBACK is not matched */
+	TEST_ASSERT_EQUAL(-ENOENT, mqtt_inflight_ack(&inflight, id, 1300, &latency));
+}
+
+void test_entries_keep_send_order(void)
+{
+	struct mqtt_inflight_entry *entry;
+	uint32_t latency;
+	uint16_t first;
+	uint16_t second;
+	uint16_t third;
+
+	first = send("first", 0);
+	second = send("second", 0);
+	third = send("third", 0);
+
+	TEST_ASSERT_EQUAL(0, mqtt_inflight_ack(&inflight, second, 0, &latency));
+
+	entry = mqtt_inflight_get(&inflight, 0);
+	TEST_ASSERT_NOT_NULL(entry);
+	TEST_ASSERT_EQUAL(first, entry->message_id);
+	TEST_ASSERT_EQUAL(5, entry->len);
+	TEST_ASSERT_EQUAL_MEMORY("first", entry->payload, entry->len);
+
+	entry = mqtt_inflight_get(&inflight, 1);
+	TEST_ASSERT_NOT_NULL(entry);
+	TEST_ASSERT_EQUAL(third, entry->message_id);
+	TEST_ASSERT_EQUAL_MEMORY("third", entry->payload, entry->len);
+
+	TEST_ASSERT_NULL(mqtt_inflight_get(&inflight, 2));
+}
+
+void test_payload_larger_than_buffer_is_rejected(void)
+{
+	uint8_t payload[PAYLOAD_MAX + 1] = { 0 };
+
+	TEST_ASSERT_EQUAL(-EMSGSIZE, mqtt_inflight_add(&inflight, 1, payload, sizeof(payload), 0));
+	TEST_ASSERT_EQUAL(0, inflight.count);
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
@@ -0,0 +1,405 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <cJSON.h>
+
+#include "custom_mqtt_json.h"
+#include "custom_mqtt_codec.h"
+
+static char buf[512];
+static struct mqtt_json_writer writer;
+
+/* Heap usage accounting for the validation cost measurement */
+static size_t heap_allocs;
+static size_t heap_bytes;
+
+static void *counting_malloc(size_t size)
+{
+	heap_allocs++;
+	heap_bytes += size;
+
+	return k_malloc(size);
+}
+
+static void counting_free(void *ptr)
+{
+	k_free(ptr);
+}
+
+/* Encode a message with the same layout as an environmental uplink */
+static int encode_environmental_sample(void)
+{
+	mqtt_json_init(&writer, buf, sizeof(buf));
+	mqtt_json_obj_start(&writer, NULL);
+	mqtt_json_add_str(&writer, "device_id", "thingy91x-asset-tracker");
+	mqtt_json_add_str(&writer, "type", "environmental");
+	mqtt_json_add_int(&writer, "timestamp", 123456789);
+	mqtt_json_add_int(&writer, "sequence", 42);
+	mqtt_json_obj_start(&writer, "data");
+	mqtt_json_add_double(&writer, "temperature", 21.37, 2);
+	mqtt_json_add_double(&writer, "humidity", 45.12, 2);
+	mqtt_json_add_double(&writer, "pressure", 101.3, 1);
+	mqtt_json_obj_end(&writer);
+	mqtt_json_obj_end(&writer);
+
+	return mqtt_json_finish(&writer);
+}
+
+void setUp(void)
+{
+	memset(buf, 0xff, sizeof(buf));
+	mqtt_json_init(&writer, buf, sizeof(buf));
+}
+
+void tearDown(void)
+{
+}
+
+void test_compact_object(void)
+{
+	const char *expected =
+		"{\"device_id\":\"dev\",\"sequence\":42,\"data\":{\"temperature\":23.46,"
+		"\"pressure\":101,\"valid\":true},\"list\":[1,-2]}";
+
+	mqtt_json_obj_start(&writer, NULL);
+	mqtt_json_add_str(&writer, "device_id", "dev");
+	mqtt_json_add_int(&writer, "sequence", 42);
+	mqtt_json_obj_start(&writer, "data");
+	mqtt_json_add_double(&writer, "temperature", 23.456, 2);
+	mqtt_json_add_double(&writer, "pressure", 101.04, 1);
+	mqtt_json_add_bool(&writer, "valid", true);
+	mqtt_json_obj_end(&writer);
+	mqtt_json_arr_start(&writer, "list");
+	mqtt_json_add_int(&writer, NULL, 1);
+	mqtt_json_add_int(&writer, NULL, -2);
+	mqtt_json_arr_end(&writer);
+	mqtt_json_obj_end(&writer);
+
+	TEST_ASSERT_EQUAL(strlen(expected), mqtt_json_finish(&writer));
+	TEST_ASSERT_EQUAL_STRING(expected, buf);
+}
+
+void test_number_formatting(void)
+{
+	mqtt_json_arr_start(&writer, NULL);
+	mqtt_json_add_double(&writer, NULL, -12.5, 2);
+	mqtt_json_add_double(&writer, NULL, -0.001, 2);
+	mqtt_json_add_double(&writer, NULL, 3.05, 2);
+	mqtt_json_add_double(&writer, NULL, 63.4305519, 6);
+	mqtt_json_add_int(&writer, NULL, INT64_MIN);
+	mqtt_json_arr_end(&writer);
+
+	TEST_ASSERT_GREATER_THAN(0, mqtt_json_finish(&writer));
+	TEST_ASSERT_EQUAL_STRING("[-12.5,0,3.05,63.430552,-9223372036854775808]", buf);
+}
+
+void test_string_escaping(void)
+{
+	mqtt_json_obj_start(&writer, NULL);
+	mqtt_json_add_str(&writer, "s", "a\"b\\c\n\x01");
+	mqtt_json_obj_end(&writer);
+
+	TEST_ASSERT_GREATER_THAN(0, mqtt_json_finish(&writer));
+	TEST_ASSERT_EQUAL_STRING("{\"s\":\"a\\\"b\\\\c\\n\\u0001\"}", buf);
+}
+
+void test_overflow_is_bounded(void)
+{
+	char small[9];
+
+	memset(small, 0xff, sizeof(small));
+	mqtt_json_init(&writer, small, sizeof(small));
+
+	/* {"a":123} needs 10 bytes including the NULL terminator */
+	mqtt_json_obj_start(&writer, NULL);
+	mqtt_json_add_int(&writer, "a", 123);
+	mqtt_json_obj_end(&writer);
+
+	TEST_ASSERT_EQUAL(-ENOMEM, mqtt_json_finish(&writer));
+	TEST_ASSERT_EQUAL_STRING("", small);
+	TEST_ASSERT_LESS_OR_EQUAL(sizeof(small) - 1, writer.len);
+}
+
+void test_exact_fit(void)
+{
+	char exact[10];
+
+	mqtt_json_init(&writer, exact, sizeof(exact));
+
+	mqtt_json_obj_start(&writer, NULL);
+	mqtt_json_add_int(&writer, "a", 123);
+	mqtt_json_obj_end(&writer);
+
+	TEST_ASSERT_EQUAL(9, mqtt_json_finish(&writer));
+	TEST_ASSERT_EQUAL_STRING("{\"a\":123}", exact);
+}
+
+void test_unbalanced_is_rejected(void)
+{
+	mqtt_json_obj_start(&writer, NULL);
+	mqtt_json_add_int(&writer, "a", 1);
+
+	TEST_ASSERT_EQUAL(-EINVAL, mqtt_json_finish(&writer));
+}
+
+void test_mismatched_container_is_rejected(void)
+{
+	mqtt_json_obj_start(&writer, NULL);
+	mqtt_json_arr_end(&writer);
+
+	TEST_ASSERT_EQUAL(-EINVAL, mqtt_json_finish(&writer));
+}
+
+void test_missing_key_is_rejected(void)
+{
+	mqtt_json_obj_start(&writer, NULL);
+	mqtt_json_add_int(&writer, NULL, 1);
+	mqtt_json_obj_end(&writer);
+
+	TEST_ASSERT_EQUAL(-EINVAL, mqtt_json_finish(&writer));
+}
+
+void test_non_finite_is_rejected(void)
+{
+	mqtt_json_obj_start(&writer, NULL);
+	mqtt_json_add_double(&writer, "t", NAN, 2);
+	mqtt_json_obj_end(&writer);
+
+	TEST_ASSERT_EQUAL(-EINVAL, mqtt_json_finish(&writer));
+}
+
+void test_codec_environmental_layout(void)
+{
+	const char *expected =
+		"{\"device_id\":\"thingy91x-asset-tracker\",\"type\":\"environmental\","
+		"\"timestamp\":123456789,\"sequence\":42,\"data\":{\"temperature\":21.37,"
+		"\"humidity\":45.12,\"pressure\":101.3}}";
+	struct mqtt_record record = {
+		.type = MQTT_RECORD_ENVIRONMENTAL,
+		.sequence = 42,
+		.timestamp = 123456789,
+		.environmental = {
+			.temperature = 21.37,
+			.humidity = 45.12,
+			.pressure = 101.3,
+		},
+	};
+
+	TEST_ASSERT_EQUAL(strlen(expected),
+			  mqtt_codec_encode(&record, (uint8_t *)buf, sizeof(buf)));
+	TEST_ASSERT_EQUAL_STRING(expected, buf);
+
+	/* The codec produces the same message as the hand written layout */
+	TEST_ASSERT_EQUAL(strlen(expected), encode_environmental_sample());
+	TEST_ASSERT_EQUAL_STRING(expected, buf);
+}
+
+void test_codec_ack_layout(void)
+{
+	const char *expected =
+		"{\"device_id\":\"thingy91x-asset-tracker\",\"type\":\"ack\","
+		"\"timestamp\":1000,\"sequence\":7,\"command\":\"ping\",\"id\":\"a1\","
+		"\"result\":0}";
+	struct mqtt_record record = {
+		.type = MQTT_RECORD_ACK,
+		.sequence = 7,
+		.timestamp = 1000,
+		.ack = {
+			.command = "ping",
+			.id = "a1",
+		},
+	};
+
+	TEST_ASSERT_EQUAL(strlen(expected),
+			  mqtt_codec_encode(&record, (uint8_t *)buf, sizeof(buf)));
+	TEST_ASSERT_EQUAL_STRING(expected, buf);
+
+	/* Without an ID the member is left out */
+	record.ack.id[0] = '\0';
+	record.ack.result = -2;
+
+	TEST_ASSERT_GREATER_THAN(0, mqtt_codec_encode(&record, (uint8_t *)buf, sizeof(buf)));
+	TEST_ASSERT_NULL(strstr(buf, "\"id\""));
+	TEST_ASSERT_NOT_NULL(strstr(buf, "\"result\":-2}"));
+}
+
+void test_codec_unknown_type_is_rejected(void)
+{
+	struct mqtt_record record = {
+		.type = 0,
+	};
+
+	TEST_ASSERT_EQUAL(-EINVAL, mqtt_codec_encode(&record, (uint8_t *)buf, sizeof(buf)));
+}
+
+void test_codec_batch_layout(void)
+{
+	const char *expected =
+		"{\"device_id\":\"thingy91x-asset-tracker\",\"type\":\"batch\","
+		"\"uptime\":1000,\"sequence\":7,\"records\":["
+		"{\"type\":\"environmental\",\"dt\":0,\"data\":{\"temperature\":21.37,"
+		"\"humidity\":45.12,\"pressure\":101.3}},"
+		"{\"type\":\"location\",\"dt\":500,\"data\":{\"lat\":63.421,"
+		"\"lng\":10.437,\"acc\":12.5}}]}";
+	const struct mqtt_record records[] = {
+		{
+			.type = MQTT_RECORD_ENVIRONMENTAL,
+			.timestamp = 1000,
+			.environmental = {
+				.temperature = 21.37,
+				.humidity = 45.12,
+				.pressure = 101.3,
+			},
+		},
+		{
+			.type = MQTT_RECORD_LOCATION,
+			.timestamp = 1500,
+			/* Not all records are dated, the batch falls back to uptime */
+			.time = 1735689600500,
+			.location = {
+				.latitude = 63.421,
+				.longitude = 10.437,
+				.accuracy = 12.5,
+			},
+		},
+	};
+
+	TEST_ASSERT_EQUAL(strlen(expected),
+			  mqtt_codec_encode_batch(7, records, ARRAY_SIZE(records),
+						  (uint8_t *)buf, sizeof(buf)));
+	TEST_ASSERT_EQUAL_STRING(expected, buf);
+}
+
+void test_codec_batch_time_base(void)
+{
+	const char *expected =
+		"{\"device_id\":\"thingy91x-asset-tracker\",\"type\":\"batch\","
+		"\"time\":1735689600000,\"sequence\":3,\"records\":["
+		"{\"type\":\"location\",\"dt\":2500,\"data\":{\"lat\":63.421,"
+		"\"lng\":10.437,\"acc\":12.5}},"
+		"{\"type\":\"ack\",\"dt\":0,\"command\":\"ping\",\"result\":0}]}";
+	const struct mqtt_record records[] = {
+		{
+			.type = MQTT_RECORD_LOCATION,
+			.timestamp = 500,
+			.time = 1735689602500,
+			.location = {
+				.latitude = 63.421,
+				.longitude = 10.437,
+				.accuracy = 12.5,
+			},
+		},
+		{
+			/* Replayed from a previous boot, the uptime is meaningless */
+			.type = MQTT_RECORD_ACK,
+			.timestamp = 90000,
+			.time = 1735689600000,
+			.ack = {
+				.command = "ping",
+			},
+		},
+	};
+	int64_t base;
+
+	TEST_ASSERT_TRUE(mqtt_codec_batch_base(records, ARRAY_SIZE(records), &base));
+	TEST_ASSERT_TRUE(base == 1735689600000);
+
+	TEST_ASSERT_EQUAL(strlen(expected),
+			  mqtt_codec_encode_batch(3, records, ARRAY_SIZE(records),
+						  (uint8_t *)buf, sizeof(buf)));
+	TEST_ASSERT_EQUAL_STRING(expected, buf);
+}
+
+void test_codec_record_time(void)
+{
+	struct mqtt_record record = {
+		.type = MQTT_RECORD_ACK,
+		.timestamp = 1000,
+		.ack = {
+			.command = "ping",
+		},
+	};
+
+	/* Only sent once the record is dated */
+	TEST_ASSERT_GREATER_THAN(0, mqtt_codec_encode(&record, (uint8_t *)buf, sizeof(buf)));
+	TEST_ASSERT_NULL(strstr(buf, "\"time\""));
+
+	record.time = 1735689600000;
+
+	TEST_ASSERT_GREATER_THAN(0, mqtt_codec_encode(&record, (uint8_t *)buf, sizeof(buf)));
+	TEST_ASSERT_NOT_NULL(strstr(buf, "\"timestamp\":1000,\"time\":1735689600000,"));
+}
+
+void test_codec_batch_errors(void)
+{
+	const struct mqtt_record records[] = {
+		{ .type = MQTT_RECORD_ENVIRONMENTAL },
+		{ .type = MQTT_RECORD_POWER },
+		{ .type = 0 },
+	};
+
+	/* Does not fit, the caller splits the batch */
+	TEST_ASSERT_EQUAL(-ENOMEM, mqtt_codec_encode_batch(0, records, 2, (uint8_t *)buf, 64));
+
+	/* One record of unknown type fails the whole batch */
+	TEST_ASSERT_EQUAL(-EINVAL, mqtt_codec_encode_batch(0, records, ARRAY_SIZE(records),
+							   (uint8_t *)buf, sizeof(buf)));
+}
+
+void test_validation_round_trip_cost(void)
+{
+	cJSON_Hooks hooks = {
+		.malloc_fn = counting_malloc,
+		.free_fn = counting_free,
+	};
+	cJSON *parsed;
+	size_t encode_allocs;
+	int len;
+
+	cJSON_InitHooks(&hooks);
+
+	heap_allocs = 0;
+	heap_bytes = 0;
+
+	/* Construction-time validation: the writer alone */
+	len = encode_environmental_sample();
+	TEST_ASSERT_GREATER_THAN(0, len);
+
+	encode_allocs = heap_allocs;
+	TEST_ASSERT_EQUAL(0, encode_allocs);
+
+	/* CONFIG_APP_CUSTOM_MQTT_JSON_VALIDATE: full re-parse of the encoded message */
+	parsed = cJSON_Parse(buf);
+	TEST_ASSERT_NOT_NULL(parsed);
+	cJSON_Delete(parsed);
+
+	TEST_ASSERT_GREATER_THAN(encode_allocs, heap_allocs);
+
+	printk("Message size: %d bytes\n", len);
+	printk("Writer only: %zu heap allocations\n", encode_allocs);
+	printk("Writer + re-parse: %zu heap allocations, %zu bytes\n", heap_allocs, heap_bytes);
+
+	cJSON_InitHooks(NULL);
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
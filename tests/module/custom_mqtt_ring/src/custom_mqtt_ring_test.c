@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+
+#include "custom_mqtt_ring.h"
+
+#define RING_SIZE 4
+
+struct item {
+	uint32_t value;
+	char text[12];
+};
+
+MQTT_RING_DEFINE(ring, sizeof(struct item), RING_SIZE);
+
+static int put(uint32_t value)
+{
+	struct item item = {
+		.value = value,
+		.text = "item",
+	};
+
+	return mqtt_ring_put(&ring, &item);
+}
+
+static uint32_t get(void)
+{
+	struct item item;
+
+	TEST_ASSERT_EQUAL(0, mqtt_ring_get(&ring, &item));
+	TEST_ASSERT_EQUAL_STRING("item", item.text);
+
+	return item.value;
+}
+
+/* Move an empty ring to another position, as if @p pos items had passed through it */
+static void ring_start_at(uint32_t pos)
+{
+	for (uint32_t i = 0; i < RING_SIZE; i++) {
+		uint32_t slot_pos = pos + i;
+
+		atomic_set(&ring.seq[slot_pos & (RING_SIZE - 1)], (atomic_val_t)slot_pos);
+	}
+
+	atomic_set(&ring.head, (atomic_val_t)pos);
+	ring.tail = pos;
+}
+
+void setUp(void)
+{
+	mqtt_ring_init(&ring);
+}
+
+void tearDown(void)
+{
+}
+
+void test_empty_ring(void)
+{
+	struct item item;
+
+	TEST_ASSERT_EQUAL(0, mqtt_ring_count(&ring));
+	TEST_ASSERT_EQUAL(-ENODATA, mqtt_ring_peek(&ring, &item));
+	TEST_ASSERT_EQUAL(-ENODATA, mqtt_ring_get(&ring, &item));
+}
+
+void test_items_in_order(void)
+{
+	TEST_ASSERT_EQUAL(0, put(1));
+	TEST_ASSERT_EQUAL(0, put(2));
+	TEST_ASSERT_EQUAL(0, put(3));
+	TEST_ASSERT_EQUAL(3, mqtt_ring_count(&ring));
+
+	TEST_ASSERT_EQUAL(1, get());
+	TEST_ASSERT_EQUAL(2, get());
+	TEST_ASSERT_EQUAL(0, put(4));
+	TEST_ASSERT_EQUAL(3, get());
+	TEST_ASSERT_EQUAL(4, get());
+	TEST_ASSERT_EQUAL(0, mqtt_ring_count(&ring));
+}
+
+void test_peek_does_not_remove(void)
+{
+	struct item item;
+
+	TEST_ASSERT_EQUAL(0, put(7));
+
+	TEST_ASSERT_EQUAL(0, mqtt_ring_peek(&ring, &item));
+	TEST_ASSERT_EQUAL(7, item.value);
+	TEST_ASSERT_EQUAL(0, mqtt_ring_peek(&ring, &item));
+	TEST_ASSERT_EQUAL(1, mqtt_ring_count(&ring));
+	TEST_ASSERT_EQUAL(7, get());
+}
+
+void test_full_ring_rejects_items(void)
+{
+	for (uint32_t i = 0; i < RING_SIZE; i++) {
+		TEST_ASSERT_EQUAL(0, put(i));
+	}
+
+	TEST_ASSERT_EQUAL(-ENOMEM, put(100));
+	TEST_ASSERT_EQUAL(-ENOMEM, put(101));
+	TEST_ASSERT_EQUAL(2, atomic_get(&ring.dropped));
+
+	/* The queued items are kept, a freed slot can be used again */
+	TEST_ASSERT_EQUAL(0, get());
+	TEST_ASSERT_EQUAL(0, put(102));
+
+	for (uint32_t i = 1; i < RING_SIZE; i++) {
+		TEST_ASSERT_EQUAL(i, get());
+	}
+
+	TEST_ASSERT_EQUAL(102, get());
+}
+
+void test_many_laps(void)
+{
+	for (uint32_t i = 0; i < 10 * RING_SIZE; i++) {
+		TEST_ASSERT_EQUAL(0, put(i));
+		TEST_ASSERT_EQUAL(0, put(i + 1000));
+		TEST_ASSERT_EQUAL(i, get());
+		TEST_ASSERT_EQUAL(i + 1000, get());
+	}
+}
+
+void test_position_wrap_around(void)
+{
+	ring_start_at(UINT32_MAX - 1);
+
+	TEST_ASSERT_EQUAL(0, put(1));
+	TEST_ASSERT_EQUAL(0, put(2));
+	TEST_ASSERT_EQUAL(0, put(3));
+	TEST_ASSERT_EQUAL(0, put(4));
+	TEST_ASSERT_EQUAL(-ENOMEM, put(5));
+	TEST_ASSERT_EQUAL(RING_SIZE, mqtt_ring_count(&ring));
+
+	TEST_ASSERT_EQUAL(1, get());
+	TEST_ASSERT_EQUAL(2, get());
+	TEST_ASSERT_EQUAL(3, get());
+	TEST_ASSERT_EQUAL(0, put(6));
+	TEST_ASSERT_EQUAL(4, get());
+	TEST_ASSERT_EQUAL(6, get());
+	TEST_ASSERT_EQUAL(0, mqtt_ring_count(&ring));
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+
+#include "custom_mqtt_sched.h"
+
+#define MARGIN 30
+
+static const struct mqtt_sched defaults = {
+	.keepalive = 60,
+	.heartbeat = 30,
+};
+
+static struct mqtt_sched_params params;
+static struct mqtt_sched sched;
+
+static void sched_get(void)
+{
+	mqtt_sched_get(&params, &defaults, MARGIN, &sched);
+}
+
+void setUp(void)
+{
+	mqtt_sched_params_init(&params);
+	memset(&sched, 0, sizeof(sched));
+}
+
+void tearDown(void)
+{
+}
+
+void test_defaults_without_power_saving(void)
+{
+	sched_get();
+
+	TEST_ASSERT_EQUAL(60, sched.keepalive);
+	TEST_ASSERT_EQUAL(30, sched.heartbeat);
+}
+
+void test_psm_heartbeat_before_tau(void)
+{
+	params.tau = 7200;
+	params.active_time = 6;
+
+	sched_get();
+
+	TEST_ASSERT_EQUAL(7200 - MARGIN, sched.heartbeat);
+	TEST_ASSERT_EQUAL(7200, sched.keepalive);
+}
+
+void test_psm_not_granted(void)
+{
+	/* A TAU without active time means PSM was not granted */
+	params.tau = 3600;
+	params.active_time = -1;
+
+	sched_get();
+
+	TEST_ASSERT_EQUAL(60, sched.keepalive);
+	TEST_ASSERT_EQUAL(30, sched.heartbeat);
+}
+
+void test_psm_short_tau(void)
+{
+	/* No room for the margin, and never more often than the default */
+	params.tau = 50;
+	params.active_time = 0;
+
+	sched_get();
+
+	TEST_ASSERT_EQUAL(50, sched.heartbeat);
+	TEST_ASSERT_EQUAL(80, sched.keepalive);
+
+	params.tau = 10;
+
+	sched_get();
+
+	TEST_ASSERT_EQUAL(30, sched.heartbeat);
+	TEST_ASSERT_EQUAL(60, sched.keepalive);
+}
+
+void test_psm_long_tau_is_limited_by_keepalive(void)
+{
+	params.tau = 36000 * 3;
+	params.active_time = 2;
+
+	sched_get();
+
+	TEST_ASSERT_EQUAL(MQTT_SCHED_KEEPALIVE_MAX, sched.keepalive);
+	TEST_ASSERT_EQUAL(MQTT_SCHED_KEEPALIVE_MAX - MARGIN, sched.heartbeat);
+}
+
+void test_edrx_rounds_up_to_whole_cycles(void)
+{
+	params.edrx = 5.12f;
+
+	sched_get();
+
+	/* 6 and 12 cycles */
+	TEST_ASSERT_EQUAL(31, sched.heartbeat);
+	TEST_ASSERT_EQUAL(62, sched.keepalive);
+
+	params.edrx = 81.92f;
+
+	sched_get();
+
+	/* The keepalive follows the heartbeat */
+	TEST_ASSERT_EQUAL(82, sched.heartbeat);
+	TEST_ASSERT_EQUAL(82 + MARGIN, sched.keepalive);
+}
+
+void test_psm_takes_precedence_over_edrx(void)
+{
+	params.tau = 3600;
+	params.active_time = 10;
+	params.edrx = 20.48f;
+
+	sched_get();
+
+	TEST_ASSERT_EQUAL(3600 - MARGIN, sched.heartbeat);
+	TEST_ASSERT_EQUAL(3600, sched.keepalive);
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
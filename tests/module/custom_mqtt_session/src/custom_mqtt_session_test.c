@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <zephyr/kernel.h>
+
+#include "custom_mqtt_session.h"
+
+#define LINGER_MS	2000
+#define TIMEOUT_MS	60000
+
+static const struct mqtt_session_limits limits = {
+	.linger_ms = LINGER_MS,
+	.timeout_ms = TIMEOUT_MS,
+};
+
+static struct mqtt_session session;
+
+void setUp(void)
+{
+	session.start = 1000;
+	session.activity = 1000;
+}
+
+void tearDown(void)
+{
+}
+
+void test_idle_session_lingers_after_last_packet(void)
+{
+	session.activity = 5000;
+
+	TEST_ASSERT_EQUAL(LINGER_MS, mqtt_session_time_left(&session, &limits, false, 5000));
+	TEST_ASSERT_EQUAL(500, mqtt_session_time_left(&session, &limits, false, 6500));
+	TEST_ASSERT_FALSE(mqtt_session_done(&session, &limits, false, 6500));
+
+	TEST_ASSERT_EQUAL(0, mqtt_session_time_left(&session, &limits, false, 7000));
+	TEST_ASSERT_TRUE(mqtt_session_done(&session, &limits, false, 7000));
+}
+
+void test_busy_session_after_linger_waits_for_timeout(void)
+{
+	/* Publish sent at 5000, PUBACK still pending well after the linger time */
+	session.activity = 5000;
+
+	TEST_ASSERT_FALSE(mqtt_session_done(&session, &limits, true, 10000));
+	TEST_ASSERT_EQUAL(1000 + TIMEOUT_MS - 10000,
+			  mqtt_session_time_left(&session, &limits, true, 10000));
+
+	/* The PUBACK arrives, the linger time counts from it */
+	session.activity = 20000;
+
+	TEST_ASSERT_EQUAL(LINGER_MS, mqtt_session_time_left(&session, &limits, false, 20000));
+	TEST_ASSERT_TRUE(mqtt_session_done(&session, &limits, false, 20000 + LINGER_MS));
+}
+
+void test_busy_session_times_out(void)
+{
+	session.activity = 50000;
+
+	TEST_ASSERT_EQUAL(1000, mqtt_session_time_left(&session, &limits, true, TIMEOUT_MS));
+	TEST_ASSERT_TRUE(mqtt_session_done(&session, &limits, true, 1000 + TIMEOUT_MS));
+	TEST_ASSERT_EQUAL(0, mqtt_session_time_left(&session, &limits, true, 2000 + TIMEOUT_MS));
+}
+
+void test_idle_session_closes_at_timeout(void)
+{
+	/* Linger time would end after the timeout */
+	session.activity = TIMEOUT_MS;
+
+	TEST_ASSERT_EQUAL(1000, mqtt_session_time_left(&session, &limits, false, TIMEOUT_MS));
+	TEST_ASSERT_TRUE(mqtt_session_done(&session, &limits, false, 1000 + TIMEOUT_MS));
+}
+
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
@@ -0,0 +1,412 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/socket.h>
+#include <arpa/inet.h>
+#include <poll.h>
+
+#include "custom_mqtt_config.h"
+#include "custom_mqtt_transport.h"
+
+LOG_MODULE_REGISTER(custom_mqtt, CONFIG_APP_CUSTOM_MQTT_LOG_LEVEL);
+
+/* Values are set in CMakeLists.txt */
+#define GATEWAY_PORT		10883
+#define PUB_TOPIC		"devices/data/up"
+#define PUB_TOPIC_ID		1
+#define SUB_TOPIC_ID		2
+
+#define WAIT_TIMEOUT_MS		5000
+
+/* MQTT-SN message types */
+#define SN_CONNECT		0x04
+#define SN_CONNACK		0x05
+#define SN_REGISTER		0x0A
+#define SN_REGACK		0x0B
+#define SN_PUBLISH		0x0C
+#define SN_PUBACK		0x0D
+#define SN_SUBSCRIBE		0x12
+#define SN_SUBACK		0x13
+#define SN_PINGREQ		0x16
+#define SN_PINGRESP		0x17
+#define SN_DISCONNECT		0x18
+
+#define SN_FLAGS_QOS_1		0x20
+#define SN_TOPIC_PREDEFINED	0x01
+
+/* Gateway stand-in: answers every request of the client and counts the traffic */
+static struct {
+	int sock;
+	struct sockaddr_in client_addr;
+	socklen_t client_addr_len;
+	size_t bytes_up;
+	size_t bytes_down;
+	size_t datagrams;
+	size_t publishes;
+	uint8_t publish_flags;
+	uint16_t publish_topic_id;
+	size_t publish_len;
+	uint8_t subscribe_flags;
+	uint16_t subscribe_topic_id;
+} gw;
+
+static K_SEM_DEFINE(gateway_ready, 0, 1);
+
+/* Events seen by the transport user */
+static size_t evt_count[MQTT_TRANSPORT_EVT_PUBLISH + 1];
+static char downlink[64];
+static size_t downlink_len;
+
+static void gateway_send(const uint8_t *buf, size_t len)
+{
+	ssize_t ret = sendto(gw.sock, buf, len, 0, (struct sockaddr *)&gw.client_addr,
+			     gw.client_addr_len);
+
+	if (ret == len) {
+		gw.bytes_down += len;
+		gw.datagrams++;
+	}
+}
+
+static void gateway_handle(const uint8_t *buf, size_t len)
+{
+	uint8_t reply[8];
+
+	switch (buf[1]) {
+	case SN_CONNECT:
+		reply[0] = 3;
+		reply[1] = SN_CONNACK;
+		reply[2] = 0;
+		gateway_send(reply, 3);
+		break;
+
+	case SN_REGISTER:
+		/* Not expected with predefined topics, answered with topic ID 0x7F */
+		reply[0] = 7;
+		reply[1] = SN_REGACK;
+		reply[2] = 0;
+		reply[3] = 0x7F;
+		memcpy(&reply[4], &buf[4], 2);
+		reply[6] = 0;
+		gateway_send(reply, 7);
+		break;
+
+	case SN_PUBLISH:
+		gw.publishes++;
+		gw.publish_flags = buf[2];
+		gw.publish_topic_id = (buf[3] << 8) | buf[4];
+		gw.publish_len = len - 7;
+
+		reply[0] = 7;
+		reply[1] = SN_PUBACK;
+		memcpy(&reply[2], &buf[3], 4);
+		reply[6] = 0;
+		gateway_send(reply, 7);
+		break;
+
+	case SN_SUBSCRIBE:
+		gw.subscribe_flags = buf[2];
+		gw.subscribe_topic_id = (buf[5] << 8) | buf[6];
+
+		reply[0] = 8;
+		reply[1] = SN_SUBACK;
+		reply[2] = SN_FLAGS_QOS_1;
+		memcpy(&reply[3], &buf[5], 2);
+		memcpy(&reply[5], &buf[3], 2);
+		reply[7] = 0;
+		gateway_send(reply, 8);
+		break;
+
+	case SN_PINGREQ:
+		reply[0] = 2;
+		reply[1] = SN_PINGRESP;
+		gateway_send(reply, 2);
+		break;
+
+	case SN_DISCONNECT:
+		reply[0] = 2;
+		reply[1] = SN_DISCONNECT;
+		gateway_send(reply, 2);
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void gateway_thread(void)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(GATEWAY_PORT),
+	};
+	uint8_t buf[300];
+	ssize_t len;
+
+	inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+	gw.sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	__ASSERT_NO_MSG(gw.sock >= 0);
+	__ASSERT_NO_MSG(bind(gw.sock, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+
+	k_sem_give(&gateway_ready);
+
+	while (1) {
+		gw.client_addr_len = sizeof(gw.client_addr);
+
+		len = recvfrom(gw.sock, buf, sizeof(buf), 0, (struct sockaddr *)&gw.client_addr,
+			       &gw.client_addr_len);
+		if (len < 2 || buf[0] != len) {
+			continue;
+		}
+
+		gw.bytes_up += len;
+		gw.datagrams++;
+
+		gateway_handle(buf, len);
+	}
+}
+
+K_THREAD_DEFINE(gateway_thread_id, 2048, gateway_thread, NULL, NULL, NULL,
+		K_PRIO_PREEMPT(5), 0, 0);
+
+static void evt_handler(const struct mqtt_transport_evt *evt)
+{
+	evt_count[evt->type]++;
+
+	if (evt->type == MQTT_TRANSPORT_EVT_PUBLISH) {
+		downlink_len = MIN(evt->len, sizeof(downlink) - 1);
+		memcpy(downlink, evt->data, downlink_len);
+		downlink[downlink_len] = '\0';
+	}
+}
+
+static void wake_handler(void)
+{
+}
+
+/* Run the transport like the I/O thread does until the condition holds */
+static bool run_until(bool (*cond)(void))
+{
+	int64_t deadline = k_uptime_get() + WAIT_TIMEOUT_MS;
+
+	while (k_uptime_get() < deadline) {
+		struct pollfd fds = {
+			.fd = mqtt_transport_socket(),
+			.events = POLLIN,
+		};
+
+		(void)poll(&fds, 1, 50);
+		(void)mqtt_transport_input();
+
+		if (cond()) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool connected(void)
+{
+	return evt_count[MQTT_TRANSPORT_EVT_CONNACK] > 0;
+}
+
+static bool disconnected(void)
+{
+	return evt_count[MQTT_TRANSPORT_EVT_DISCONNECT] > 0;
+}
+
+static bool downlink_received(void)
+{
+	return evt_count[MQTT_TRANSPORT_EVT_PUBLISH] > 0;
+}
+
+static bool subscribed(void)
+{
+	return gw.subscribe_topic_id == SUB_TOPIC_ID;
+}
+
+static size_t expected_publishes;
+
+static bool publishes_arrived(void)
+{
+	return gw.publishes >= expected_publishes;
+}
+
+static void connect(void)
+{
+	TEST_ASSERT_EQUAL(0, mqtt_transport_connect());
+	TEST_ASSERT_TRUE(run_until(connected));
+	TEST_ASSERT_TRUE(mqtt_transport_socket() >= 0);
+}
+
+void setUp(void)
+{
+	static bool gateway_started;
+
+	if (!gateway_started) {
+		TEST_ASSERT_EQUAL(0, k_sem_take(&gateway_ready, K_SECONDS(5)));
+		gateway_started = true;
+	}
+
+	memset(evt_count, 0, sizeof(evt_count));
+	downlink_len = 0;
+	gw.bytes_up = 0;
+	gw.bytes_down = 0;
+	gw.datagrams = 0;
+	gw.publishes = 0;
+	gw.subscribe_flags = 0;
+	gw.subscribe_topic_id = 0;
+
+	TEST_ASSERT_EQUAL(0, mqtt_transport_init(evt_handler, wake_handler));
+}
+
+void tearDown(void)
+{
+	mqtt_transport_abort();
+}
+
+void test_publish_uses_predefined_topic_id(void)
+{
+	const char *payload = "{\"temp\":21.5}";
+
+	connect();
+
+	TEST_ASSERT_EQUAL(0, mqtt_transport_publish(1, false, (const uint8_t *)payload,
+						    strlen(payload)));
+
+	expected_publishes = 1;
+	TEST_ASSERT_TRUE(run_until(publishes_arrived));
+
+	TEST_ASSERT_EQUAL(PUB_TOPIC_ID, gw.publish_topic_id);
+	TEST_ASSERT_EQUAL(SN_TOPIC_PREDEFINED, gw.publish_flags & 0x03);
+	TEST_ASSERT_EQUAL(SN_FLAGS_QOS_1, gw.publish_flags & 0x60);
+	TEST_ASSERT_EQUAL(strlen(payload), gw.publish_len);
+
+	/* Retransmissions are left to the library */
+	TEST_ASSERT_FALSE(mqtt_transport_reports_acks());
+	TEST_ASSERT_EQUAL(0, evt_count[MQTT_TRANSPORT_EVT_PUBACK]);
+}
+
+void test_downlink_on_subscribe_topic(void)
+{
+	const char *command = "{\"command\":\"ping\"}";
+	uint8_t buf[64];
+	size_t len = 7 + strlen(command);
+
+	connect();
+
+	TEST_ASSERT_EQUAL(0, mqtt_transport_subscribe(1));
+	TEST_ASSERT_TRUE(run_until(subscribed));
+
+	/* Predefined topic ID in the SUBSCRIBE, no topic name */
+	TEST_ASSERT_EQUAL(SN_TOPIC_PREDEFINED, gw.subscribe_flags & 0x03);
+
+	/* QoS 0 PUBLISH from the gateway */
+	buf[0] = len;
+	buf[1] = SN_PUBLISH;
+	buf[2] = SN_TOPIC_PREDEFINED;
+	buf[3] = 0;
+	buf[4] = SUB_TOPIC_ID;
+	buf[5] = 0;
+	buf[6] = 0;
+	memcpy(&buf[7], command, strlen(command));
+	gateway_send(buf, len);
+
+	TEST_ASSERT_TRUE(run_until(downlink_received));
+	TEST_ASSERT_EQUAL_STRING(command, downlink);
+}
+
+void test_disconnect_is_reported(void)
+{
+	connect();
+
+	TEST_ASSERT_EQUAL(0, mqtt_transport_disconnect());
+	TEST_ASSERT_TRUE(run_until(disconnected));
+}
+
+/* Size of the MQTT 3.1.1 fixed header for the given remaining length */
+static size_t mqtt_fixed_header_size(size_t remaining)
+{
+	size_t header = 1;
+
+	do {
+		header++;
+		remaining >>= 7;
+	} while (remaining > 0);
+
+	return header;
+}
+
+/* Traffic of one connection with a number of publishes, compared to the same exchange with
+ * MQTT 3.1.1. Only the MQTT packets are counted for both: the TCP and TLS handshakes, TLS record
+ * overhead and the larger TCP header would add to the MQTT side.
+ */
+void test_traffic_compared_to_mqtt(void)
+{
+	const size_t publish_count = 10;
+	const size_t payload_len = 64;
+	uint8_t payload[64];
+	size_t id_len = strlen(MQTT_CLIENT_ID);
+	size_t topic_len = strlen(PUB_TOPIC);
+	size_t mqtt_bytes = 0;
+	size_t mqtt_packets = 0;
+	size_t remaining;
+
+	memset(payload, 'x', sizeof(payload));
+
+	connect();
+
+	for (size_t i = 0; i < publish_count; i++) {
+		TEST_ASSERT_EQUAL(0, mqtt_transport_publish(i + 1, false, payload, payload_len));
+
+		/* One message at a time, as with the in-flight window of the TCP transport */
+		expected_publishes = i + 1;
+		TEST_ASSERT_TRUE(run_until(publishes_arrived));
+	}
+
+	TEST_ASSERT_EQUAL(0, mqtt_transport_disconnect());
+	TEST_ASSERT_TRUE(run_until(disconnected));
+
+	/* CONNECT: protocol name, level, flags, keepalive and client ID */
+	remaining = 10 + 2 + id_len;
+	mqtt_bytes += mqtt_fixed_header_size(remaining) + remaining;
+	/* CONNACK */
+	mqtt_bytes += 4;
+	/* PUBLISH: topic name, packet identifier and payload, then PUBACK */
+	remaining = 2 + topic_len + 2 + payload_len;
+	mqtt_bytes += publish_count * (mqtt_fixed_header_size(remaining) + remaining + 4);
+	/* DISCONNECT */
+	mqtt_bytes += 2;
+	mqtt_packets = 3 + 2 * publish_count;
+
+	printk("MQTT-SN over UDP: %zu bytes up, %zu bytes down, %zu datagrams\n",
+	       gw.bytes_up, gw.bytes_down, gw.datagrams);
+	printk("MQTT over TCP:    %zu bytes in %zu packets, without TCP and TLS overhead\n",
+	       mqtt_bytes, mqtt_packets);
+
+	TEST_ASSERT_LESS_THAN(mqtt_bytes, gw.bytes_up + gw.bytes_down);
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
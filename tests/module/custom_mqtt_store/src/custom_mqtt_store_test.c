@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+
+#include "custom_mqtt_store.h"
+
+/* TTL is set to 60 seconds in CMakeLists.txt */
+#define TTL_MS (60 * 1000LL)
+
+/* UNIX time used for records with a known time */
+#define NOW_MS 1700000000000LL
+
+static void put_records(uint32_t first, uint32_t count, int64_t now)
+{
+	struct mqtt_record record = {
+		.type = MQTT_RECORD_ENVIRONMENTAL,
+		.environmental.temperature = 21.5,
+	};
+
+	for (uint32_t i = first; i < first + count; i++) {
+		record.sequence = i;
+		TEST_ASSERT_EQUAL(0, mqtt_store_put(&record, now));
+	}
+}
+
+static uint32_t pop_sequence(int64_t now)
+{
+	struct mqtt_record record;
+
+	TEST_ASSERT_EQUAL(0, mqtt_store_peek(&record, now));
+	TEST_ASSERT_EQUAL(0, mqtt_store_pop());
+
+	return record.sequence;
+}
+
+void setUp(void)
+{
+	TEST_ASSERT_EQUAL(0, mqtt_store_init());
+	TEST_ASSERT_EQUAL(0, mqtt_store_clear());
+}
+
+void tearDown(void)
+{
+}
+
+void test_empty_store(void)
+{
+	struct mqtt_record record;
+
+	TEST_ASSERT_EQUAL(0, mqtt_store_count());
+	TEST_ASSERT_EQUAL(-ENODATA, mqtt_store_peek(&record, NOW_MS));
+	TEST_ASSERT_EQUAL(-ENODATA, mqtt_store_pop());
+}
+
+void test_fifo_order_across_sectors(void)
+{
+	struct mqtt_record record;
+
+	/* More than fits in one 4 kB sector */
+	put_records(0, 100, NOW_MS);
+	TEST_ASSERT_EQUAL(100, mqtt_store_count());
+
+	/* Peek does not consume */
+	TEST_ASSERT_EQUAL(0, mqtt_store_peek(&record, NOW_MS));
+	TEST_ASSERT_EQUAL(0, record.sequence);
+	TEST_ASSERT_EQUAL(MQTT_RECORD_ENVIRONMENTAL, record.type);
+	TEST_ASSERT_EQUAL_FLOAT(21.5, record.environmental.temperature);
+
+	for (uint32_t i = 0; i < 100; i++) {
+		TEST_ASSERT_EQUAL(i, pop_sequence(NOW_MS));
+	}
+
+	TEST_ASSERT_EQUAL(0, mqtt_store_count());
+	TEST_ASSERT_EQUAL(-ENODATA, mqtt_store_peek(&record, NOW_MS));
+}
+
+void test_records_survive_reinit(void)
+{
+	uint32_t first;
+
+	put_records(0, 100, NOW_MS);
+
+	/* Read past the first sector so that it is erased */
+	for (uint32_t i = 0; i < 60; i++) {
+		TEST_ASSERT_EQUAL(i, pop_sequence(NOW_MS));
+	}
+
+	/* Simulate a reboot */
+	TEST_ASSERT_EQUAL(0, mqtt_store_init());
+
+	/* Records read from a sector that was not erased yet are delivered again */
+	first = pop_sequence(NOW_MS);
+	TEST_ASSERT_GREATER_THAN(0, first);
+	TEST_ASSERT_LESS_OR_EQUAL(60, first);
+	TEST_ASSERT_EQUAL(100 - first - 1, mqtt_store_count());
+
+	for (uint32_t i = first + 1; i < 100; i++) {
+		TEST_ASSERT_EQUAL(i, pop_sequence(NOW_MS));
+	}
+
+	TEST_ASSERT_EQUAL(0, mqtt_store_count());
+}
+
+void test_full_store_drops_oldest(void)
+{
+	uint32_t count;
+	uint32_t first;
+
+	/* Far more than fits in the 32 kB partition */
+	put_records(0, 1000, NOW_MS);
+
+	count = mqtt_store_count();
+	TEST_ASSERT_GREATER_THAN(0, count);
+	TEST_ASSERT_LESS_THAN(1000, count);
+
+	/* The newest records are kept, in order */
+	first = pop_sequence(NOW_MS);
+	TEST_ASSERT_EQUAL(1000 - count, first);
+
+	for (uint32_t i = first + 1; i < 1000; i++) {
+		TEST_ASSERT_EQUAL(i, pop_sequence(NOW_MS));
+	}
+
+	TEST_ASSERT_EQUAL(0, mqtt_store_count());
+}
+
+void test_expired_records_are_dropped(void)
+{
+	put_records(0, 5, NOW_MS);
+	put_records(5, 5, NOW_MS + TTL_MS);
+
+	/* The first five are older than the TTL one millisecond after the second batch */
+	TEST_ASSERT_EQUAL(5, pop_sequence(NOW_MS + TTL_MS + 1));
+	TEST_ASSERT_EQUAL(4, mqtt_store_count());
+}
+
+void test_unknown_time_never_expires(void)
+{
+	/* Stored before the time was known */
+	put_records(0, 1, 0);
+	/* Stored with a known time, replayed before the time is known */
+	put_records(1, 1, NOW_MS);
+
+	TEST_ASSERT_EQUAL(0, pop_sequence(NOW_MS + 100 * TTL_MS));
+	TEST_ASSERT_EQUAL(1, pop_sequence(0));
+}
+
+/* This is required to be added to each test. That is because unity's
+ * main may return nonzero, while zephyr's main currently must
+ * return 0 in all cases (other values are reserved).
+ */
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2025 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <unity.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+
+#include "custom_mqtt_sub.h"
+
+#define MESSAGE_ID	7
+
+/* SUBACK return code of a rejected subscription */
+#define SUBACK_FAILURE	0x80
+
+static struct mqtt_sub sub;
+
+void setUp(void)
+{
+	sub = (struct mqtt_sub){0};
+}
+
+void tearDown(void)
+{
+}
+
+void test_nothing_pending_initially(void)
+{
+	TEST_ASSERT_FALSE(mqtt_sub_pending(&sub));
+	TEST_ASSERT_EQUAL(-ENOENT, mqtt_sub_ack(&sub, MESSAGE_ID, 0));
+	TEST_ASSERT_FALSE(mqtt_sub_cancel(&sub));
+}
+
+void test_granted_subscription_is_ready(void)
+{
+	/* Subscribing */
+	mqtt_sub_start(&sub, MESSAGE_ID);
+	TEST_ASSERT_TRUE(mqtt_sub_pending(&sub));
+
+	/* Ready, the status message can be queued */
+	TEST_ASSERT_EQUAL(0, mqtt_sub_ack(&sub, MESSAGE_ID, 0));
+	TEST_ASSERT_FALSE(mqtt_sub_pending(&sub));
+	TEST_ASSERT_TRUE(sub.granted);
+
+	/* The timeout that fires afterwards has nothing to do */
+	TEST_ASSERT_FALSE(mqtt_sub_cancel(&sub));
+}
+
+void test_rejected_subscription_is_ready_without_downlink(void)
+{
+	mqtt_sub_start(&sub, MESSAGE_ID);
+
+	TEST_ASSERT_EQUAL(-EACCES, mqtt_sub_ack(&sub, MESSAGE_ID, SUBACK_FAILURE));
+	TEST_ASSERT_FALSE(mqtt_sub_pending(&sub));
+	TEST_ASSERT_FALSE(sub.granted);
+}
+
+void test_suback_with_other_id_is_ignored(void)
+{
+	mqtt_sub_start(&sub, MESSAGE_ID);
+
+	TEST_ASSERT_EQUAL(-ENOENT, mqtt_sub_ack(&sub, MESSAGE_ID + 1, 0));
+	TEST_ASSERT_TRUE(mqtt_sub_pending(&sub));
+
+	TEST_ASSERT_EQUAL(0, mqtt_sub_ack(&sub, MESSAGE_ID, 0));
+}
+
+void test_suback_after_timeout_is_ignored(void)
+{
+	mqtt_sub_start(&sub, MESSAGE_ID);
+
+	/* No SUBACK in time, ready without the subscription */
+	TEST_ASSERT_TRUE(mqtt_sub_cancel(&sub));
+	TEST_ASSERT_FALSE(mqtt_sub_pending(&sub));
+
+	TEST_ASSERT_EQUAL(-ENOENT, mqtt_sub_ack(&sub, MESSAGE_ID, 0));
+	TEST_ASSERT_FALSE(sub.granted);
+}
+
+void test_resubscribe_after_reconnect(void)
+{
+	mqtt_sub_start(&sub, MESSAGE_ID);
+	TEST_ASSERT_EQUAL(0, mqtt_sub_ack(&sub, MESSAGE_ID, 0));
+
+	/* A new connection subscribes again, the previous grant no longer applies */
+	mqtt_sub_start(&sub, MESSAGE_ID + 1);
+	TEST_ASSERT_TRUE(mqtt_sub_pending(&sub));
+	TEST_ASSERT_FALSE(sub.granted);
+
+	TEST_ASSERT_EQUAL(-ENOENT, mqtt_sub_ack(&sub, MESSAGE_ID, 0));
+	TEST_ASSERT_EQUAL(0, mqtt_sub_ack(&sub, MESSAGE_ID + 1, 0));
+}
+
+extern int unity_main(void);
+
+int main(void)
+{
+	/* use the runner from test_runner_generate() */
+	(void)unity_main();
+
+	return 0;
+}